@@ -28,6 +28,15 @@
  *
  * A helper GObject to use for accessing urfkill information, and to be
  * notified when it is changed.
+ *
+ * Signals of a #UrfClient are delivered in the thread-default main
+ * context that was current when the client was created, and each main
+ * context has its own shared instance.
+ *
+ * When the private socket of urfkilld is available, the client talks to
+ * the daemon directly instead of through the system bus. The socket is
+ * looked up in $URFKILL_RUNTIME_DIR if that is set, for a daemon that
+ * was started with --runtime-dir.
  */
 
 #include "config.h"
@@ -35,26 +44,51 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <glib.h>
-#include <dbus/dbus-glib.h>
+#include <gio/gio.h>
 
 #include "urf-client.h"
+#include "urf-device-private.h"
+#include "urf-peer-address.h"
+#include "urf-type-names.h"
 
 static void	urf_client_class_init	(UrfClientClass	*klass);
 static void	urf_client_init		(UrfClient	*client);
 static void	urf_client_dispose	(GObject	*object);
 static void	urf_client_finalize	(GObject	*object);
+static void	urf_client_initable_iface_init		(GInitableIface		*iface);
+static void	urf_client_async_initable_iface_init	(GAsyncInitableIface	*iface);
+static const char *urf_client_get_bus_name		(UrfClient		*client);
 
 #define URF_CLIENT_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), URF_TYPE_CLIENT, UrfClientPrivate))
 
+#define URFKILL_DBUS_NAME	"org.freedesktop.URfkill"
+#define URFKILL_OBJECT_PATH	"/org/freedesktop/URfkill"
+#define URFKILL_INTERFACE	"org.freedesktop.URfkill"
+#define URFKILL_DEVICE_INTERFACE "org.freedesktop.URfkill.Device"
+
+typedef enum {
+	URF_CLIENT_INIT_NONE,
+	URF_CLIENT_INIT_RUNNING,
+	URF_CLIENT_INIT_DONE
+} UrfClientInitState;
+
 struct _UrfClientPrivate
 {
-	DBusGConnection	*bus;
-	DBusGProxy	*proxy;
-	DBusGProxy	*prop_proxy;
+	GDBusConnection	*connection;
+	gboolean	 is_peer;
+	char		*bus_address;
+	GDBusProxy	*proxy;
+	GDBusObjectManager *manager;
 	GList		*devices;
+	GHashTable	*devices_by_path;
+	GHashTable	*devices_by_index;
 	char		*daemon_version;
 	gboolean	 key_control;
-	gboolean	 have_properties;
+	GMainContext	*context;
+	UrfClientInitState init_state;
+	GError		*init_error;
+	GList		*init_results;
+	GCancellable	*init_cancellable;
 };
 
 enum {
@@ -69,13 +103,21 @@ enum {
 	PROP_0,
 	PROP_DAEMON_VERSION,
 	PROP_KEY_CONTROL,
+	PROP_BUS_ADDRESS,
 	PROP_LAST
 };
 
 static guint signals [URF_CLIENT_LAST_SIGNAL] = { 0 };
-static gpointer urf_client_object = NULL;
 
-G_DEFINE_TYPE (UrfClient, urf_client, G_TYPE_OBJECT)
+/* one client per thread-default main context */
+static GHashTable *urf_client_objects = NULL;
+G_LOCK_DEFINE_STATIC (urf_client_objects);
+
+G_DEFINE_TYPE_WITH_CODE (UrfClient, urf_client, G_TYPE_OBJECT,
+			 G_IMPLEMENT_INTERFACE (G_TYPE_INITABLE,
+						urf_client_initable_iface_init)
+			 G_IMPLEMENT_INTERFACE (G_TYPE_ASYNC_INITABLE,
+						urf_client_async_initable_iface_init))
 
 /**
  * urf_client_find_device:
@@ -83,21 +125,88 @@ G_DEFINE_TYPE (UrfClient, urf_client, G_TYPE_OBJECT)
 static UrfDevice *
 urf_client_find_device (UrfClient   *client,
 			const char  *object_path)
+{
+	if (object_path == NULL)
+		return NULL;
+
+	return g_hash_table_lookup (client->priv->devices_by_path, object_path);
+}
+
+/**
+ * urf_client_index_device:
+ **/
+static void
+urf_client_index_device (UrfClient *client,
+			 UrfDevice *device)
 {
 	UrfClientPrivate *priv = client->priv;
-	UrfDevice *device = NULL;
-	GList *item;
+	guint index;
+
+	g_object_get (device, "index", &index, NULL);
+	g_hash_table_insert (priv->devices_by_path,
+			     (gpointer) urf_device_get_object_path (device),
+			     device);
+	g_hash_table_insert (priv->devices_by_index,
+			     GUINT_TO_POINTER (index),
+			     device);
+}
 
-	if (priv->devices == NULL)
-		return NULL;
+/**
+ * urf_client_unindex_device:
+ **/
+static void
+urf_client_unindex_device (UrfClient *client,
+			   UrfDevice *device)
+{
+	UrfClientPrivate *priv = client->priv;
+	guint index;
 
-	for (item = priv->devices; item; item = item->next) {
-		device = (UrfDevice *) item->data;
-		if (g_strcmp0 (urf_device_get_object_path (device), object_path) == 0)
-			return device;
-	}
+	g_object_get (device, "index", &index, NULL);
+	g_hash_table_remove (priv->devices_by_path,
+			     urf_device_get_object_path (device));
+	if (g_hash_table_lookup (priv->devices_by_index, GUINT_TO_POINTER (index)) == device)
+		g_hash_table_remove (priv->devices_by_index, GUINT_TO_POINTER (index));
+}
 
-	return NULL;
+/**
+ * urf_client_get_device_by_path:
+ * @client: a #UrfClient instance
+ * @object_path: the object path of the device
+ *
+ * Look up a device by its object path.
+ *
+ * Return value: (transfer none): the #UrfDevice, or %NULL
+ *
+ * Since: 0.3.0
+ **/
+UrfDevice *
+urf_client_get_device_by_path (UrfClient  *client,
+			       const char *object_path)
+{
+	g_return_val_if_fail (URF_IS_CLIENT (client), NULL);
+
+	return urf_client_find_device (client, object_path);
+}
+
+/**
+ * urf_client_get_device_by_index:
+ * @client: a #UrfClient instance
+ * @index: the rfkill index of the device
+ *
+ * Look up a device by its rfkill index.
+ *
+ * Return value: (transfer none): the #UrfDevice, or %NULL
+ *
+ * Since: 0.3.0
+ **/
+UrfDevice *
+urf_client_get_device_by_index (UrfClient *client,
+				guint      index)
+{
+	g_return_val_if_fail (URF_IS_CLIENT (client), NULL);
+
+	return g_hash_table_lookup (client->priv->devices_by_index,
+				    GUINT_TO_POINTER (index));
 }
 
 /**
@@ -118,6 +227,185 @@ urf_client_get_devices (UrfClient *client)
 	return client->priv->devices;
 }
 
+typedef struct {
+	GMainContext	*context;
+	GMainLoop	*loop;
+	GAsyncResult	*res;
+} UrfClientSyncData;
+
+/**
+ * urf_client_sync_begin:
+ *
+ * Route the callbacks of the async calls to a private main context
+ **/
+static void
+urf_client_sync_begin (UrfClientSyncData *data)
+{
+	data->context = g_main_context_new ();
+	data->loop = g_main_loop_new (data->context, FALSE);
+	data->res = NULL;
+	g_main_context_push_thread_default (data->context);
+}
+
+/**
+ * urf_client_sync_cb:
+ **/
+static void
+urf_client_sync_cb (GObject      *source_object,
+		    GAsyncResult *res,
+		    gpointer      user_data)
+{
+	UrfClientSyncData *data = user_data;
+
+	data->res = g_object_ref (res);
+	g_main_loop_quit (data->loop);
+}
+
+/**
+ * urf_client_sync_wait:
+ **/
+static void
+urf_client_sync_wait (UrfClientSyncData *data)
+{
+	g_main_loop_run (data->loop);
+	g_main_context_pop_thread_default (data->context);
+}
+
+/**
+ * urf_client_sync_end:
+ **/
+static void
+urf_client_sync_end (UrfClientSyncData *data)
+{
+	g_object_unref (data->res);
+	g_main_loop_unref (data->loop);
+	g_main_context_unref (data->context);
+}
+
+/**
+ * urf_client_block_cb:
+ **/
+static void
+urf_client_block_cb (GObject      *source_object,
+		     GAsyncResult *res,
+		     gpointer      user_data)
+{
+	GSimpleAsyncResult *result = G_SIMPLE_ASYNC_RESULT (user_data);
+	GVariant *reply;
+	gboolean status = FALSE;
+	GError *error = NULL;
+
+	reply = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
+	if (reply == NULL) {
+		/* the caller gets the error, a cancelled call included */
+		g_simple_async_result_take_error (result, error);
+	} else {
+		g_variant_get (reply, "(b)", &status);
+		g_simple_async_result_set_op_res_gboolean (result, status);
+		g_variant_unref (reply);
+	}
+
+	g_simple_async_result_complete (result);
+	g_object_unref (result);
+}
+
+/**
+ * urf_client_call_block:
+ *
+ * The reply waits for the polkit dialog, so no timeout is used
+ **/
+static void
+urf_client_call_block (UrfClient          *client,
+		       const char         *method,
+		       GVariant           *parameters,
+		       GCancellable       *cancellable,
+		       GAsyncReadyCallback callback,
+		       gpointer            user_data,
+		       gpointer            source_tag)
+{
+	GSimpleAsyncResult *result;
+
+	result = g_simple_async_result_new (G_OBJECT (client), callback, user_data,
+					    source_tag);
+	g_dbus_proxy_call (client->priv->proxy, method, parameters,
+			   G_DBUS_CALL_FLAGS_NONE,
+			   G_MAXINT, cancellable,
+			   urf_client_block_cb, result);
+}
+
+/**
+ * urf_client_block_finish:
+ **/
+static gboolean
+urf_client_block_finish (UrfClient     *client,
+			 GAsyncResult  *res,
+			 gpointer       source_tag,
+			 GError       **error)
+{
+	GSimpleAsyncResult *result = G_SIMPLE_ASYNC_RESULT (res);
+
+	g_return_val_if_fail (g_simple_async_result_is_valid (res, G_OBJECT (client),
+							      source_tag), FALSE);
+
+	if (g_simple_async_result_propagate_error (result, error))
+		return FALSE;
+
+	return g_simple_async_result_get_op_res_gboolean (result);
+}
+
+/**
+ * urf_client_set_block_async:
+ * @client: a #UrfClient instance
+ * @type: the type of the devices
+ * @block: %TRUE to block the devices or %FALSE to unblock
+ * @cancellable: a #GCancellable or %NULL
+ * @callback: a #GAsyncReadyCallback to call when the request is done
+ * @user_data: the data to pass to @callback
+ *
+ * Asynchronously block or unblock the devices belonging to the type.
+ * The reply may wait for the user to authenticate, so the call has no
+ * timeout and is only stopped by @cancellable.
+ *
+ * Since: 0.3.0
+ **/
+void
+urf_client_set_block_async (UrfClient          *client,
+			    UrfDeviceType       type,
+			    const gboolean      block,
+			    GCancellable       *cancellable,
+			    GAsyncReadyCallback callback,
+			    gpointer            user_data)
+{
+	g_return_if_fail (URF_IS_CLIENT (client));
+	g_return_if_fail (client->priv->proxy != NULL);
+	g_return_if_fail (type < NUM_URFDEVICE_TYPES);
+
+	urf_client_call_block (client, "Block",
+			       g_variant_new ("(ub)", type, block),
+			       cancellable, callback, user_data,
+			       urf_client_set_block_async);
+}
+
+/**
+ * urf_client_set_block_finish:
+ * @client: a #UrfClient instance
+ * @res: the #GAsyncResult passed to the callback
+ * @error: a #GError, or %NULL
+ *
+ * Finish an operation started with urf_client_set_block_async().
+ *
+ * Return value: #TRUE for success, else #FALSE and @error may be used
+ *
+ * Since: 0.3.0
+ **/
+gboolean
+urf_client_set_block_finish (UrfClient     *client,
+			     GAsyncResult  *res,
+			     GError       **error)
+{
+	return urf_client_block_finish (client, res, urf_client_set_block_async, error);
+}
+
 /**
  * urf_client_set_block:
  * @client: a #UrfClient instance
@@ -126,7 +414,8 @@ urf_client_get_devices (UrfClient *client)
  * @cancellable: a #GCancellable or %NULL
  * @error: a #GError, or %NULL
  *
- * Block or unblock the devices belonging to the type.
+ * Block or unblock the devices belonging to the type. This blocks
+ * until the daemon replied, see urf_client_set_block_async().
  *
  * <note>
  *   <para>
@@ -147,27 +436,71 @@ urf_client_set_block (UrfClient      *client,
 		      GCancellable   *cancellable,
 		      GError         **error)
 {
-	gboolean ret, status = FALSE;
-	GError *error_local = NULL;
+	UrfClientSyncData data;
+	gboolean ret;
 
 	g_return_val_if_fail (URF_IS_CLIENT (client), FALSE);
 	g_return_val_if_fail (client->priv->proxy != NULL, FALSE);
 	g_return_val_if_fail (type < NUM_URFDEVICE_TYPES, FALSE);
 
-	ret = dbus_g_proxy_call (client->priv->proxy, "Block", &error_local,
-				 G_TYPE_UINT, type,
-				 G_TYPE_BOOLEAN, block,
-				 G_TYPE_INVALID,
-				 G_TYPE_BOOLEAN, &status,
-				 G_TYPE_INVALID);
-	if (!ret) {
-		g_warning ("Couldn't sent BLOCK: %s", error_local->message);
-		g_set_error (error, 1, 0, "%s", error_local->message);
-		status = FALSE;
-	}
-	if (error_local != NULL)
-		g_error_free (error_local);
-	return status;
+	urf_client_sync_begin (&data);
+	urf_client_set_block_async (client, type, block, cancellable,
+				    urf_client_sync_cb, &data);
+	urf_client_sync_wait (&data);
+	ret = urf_client_set_block_finish (client, data.res, error);
+	urf_client_sync_end (&data);
+
+	return ret;
+}
+
+/**
+ * urf_client_set_block_idx_async:
+ * @client: a #UrfClient instance
+ * @index: the index of the device
+ * @block: %TRUE to block the device or %FALSE to unblock
+ * @cancellable: a #GCancellable or %NULL
+ * @callback: a #GAsyncReadyCallback to call when the request is done
+ * @user_data: the data to pass to @callback
+ *
+ * Asynchronously block or unblock the device by the index.
+ *
+ * Since: 0.3.0
+ **/
+void
+urf_client_set_block_idx_async (UrfClient          *client,
+				const guint         index,
+				const gboolean      block,
+				GCancellable       *cancellable,
+				GAsyncReadyCallback callback,
+				gpointer            user_data)
+{
+	g_return_if_fail (URF_IS_CLIENT (client));
+	g_return_if_fail (client->priv->proxy != NULL);
+
+	urf_client_call_block (client, "BlockIdx",
+			       g_variant_new ("(ub)", index, block),
+			       cancellable, callback, user_data,
+			       urf_client_set_block_idx_async);
+}
+
+/**
+ * urf_client_set_block_idx_finish:
+ * @client: a #UrfClient instance
+ * @res: the #GAsyncResult passed to the callback
+ * @error: a #GError, or %NULL
+ *
+ * Finish an operation started with urf_client_set_block_idx_async().
+ *
+ * Return value: #TRUE for success, else #FALSE and @error may be used
+ *
+ * Since: 0.3.0
+ **/
+gboolean
+urf_client_set_block_idx_finish (UrfClient     *client,
+				 GAsyncResult  *res,
+				 GError       **error)
+{
+	return urf_client_block_finish (client, res, urf_client_set_block_idx_async, error);
 }
 
 /**
@@ -178,7 +511,8 @@ urf_client_set_block (UrfClient      *client,
  * @cancellable: a #GCancellable or %NULL
  * @error: a #GError, or %NULL
  *
- * Block or unblock the device by the index.
+ * Block or unblock the device by the index. This blocks until the
+ * daemon replied, see urf_client_set_block_idx_async().
  *
  * <note>
  *   <para>
@@ -199,26 +533,144 @@ urf_client_set_block_idx (UrfClient      *client,
 			  GCancellable   *cancellable,
 			  GError         **error)
 {
-	gboolean ret, status;
-	GError *error_local = NULL;
+	UrfClientSyncData data;
+	gboolean ret;
 
 	g_return_val_if_fail (URF_IS_CLIENT (client), FALSE);
 	g_return_val_if_fail (client->priv->proxy != NULL, FALSE);
 
-	ret = dbus_g_proxy_call (client->priv->proxy, "BlockIdx", &error_local,
-				 G_TYPE_UINT, index,
-				 G_TYPE_BOOLEAN, block,
-				 G_TYPE_INVALID,
-				 G_TYPE_BOOLEAN, &status,
-				 G_TYPE_INVALID);
-	if (!ret) {
-		g_warning ("Couldn't sent BLOCKIDX: %s", error_local->message);
-		g_set_error (error, 1, 0, "%s", error_local->message);
-		status = FALSE;
+	urf_client_sync_begin (&data);
+	urf_client_set_block_idx_async (client, index, block, cancellable,
+					urf_client_sync_cb, &data);
+	urf_client_sync_wait (&data);
+	ret = urf_client_set_block_idx_finish (client, data.res, error);
+	urf_client_sync_end (&data);
+
+	return ret;
+}
+
+typedef struct {
+	GSimpleAsyncResult	*result;
+	guint			 pending;
+	gboolean		 status;
+	GError			*error;
+} UrfClientBatch;
+
+/**
+ * urf_client_batch_cb:
+ **/
+static void
+urf_client_batch_cb (GObject      *source_object,
+		     GAsyncResult *res,
+		     gpointer      user_data)
+{
+	UrfClientBatch *batch = user_data;
+	GVariant *reply;
+	gboolean status = FALSE;
+	GError *error = NULL;
+
+	reply = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
+	if (reply == NULL) {
+		/* report the first failure */
+		if (batch->error == NULL)
+			batch->error = error;
+		else
+			g_error_free (error);
+		batch->status = FALSE;
+	} else {
+		g_variant_get (reply, "(b)", &status);
+		batch->status = batch->status && status;
+		g_variant_unref (reply);
 	}
-	if (error_local != NULL)
-		g_error_free (error_local);
-	return status;
+
+	if (--batch->pending > 0)
+		return;
+
+	if (batch->error != NULL)
+		g_simple_async_result_take_error (batch->result, batch->error);
+	else
+		g_simple_async_result_set_op_res_gboolean (batch->result, batch->status);
+	g_simple_async_result_complete (batch->result);
+	g_object_unref (batch->result);
+	g_free (batch);
+}
+
+/**
+ * urf_client_set_block_idx_multiple_async:
+ * @client: a #UrfClient instance
+ * @indices: (array length=n_indices): the indices of the devices
+ * @n_indices: the number of indices
+ * @block: %TRUE to block the devices or %FALSE to unblock
+ * @cancellable: a #GCancellable or %NULL
+ * @callback: a #GAsyncReadyCallback to call when all requests are done
+ * @user_data: the data to pass to @callback
+ *
+ * Block or unblock several devices by their indices. All requests are
+ * sent at once without waiting for the replies in between, and
+ * @callback is called after the last reply arrived.
+ *
+ * Since: 0.3.0
+ **/
+void
+urf_client_set_block_idx_multiple_async (UrfClient          *client,
+					 const guint        *indices,
+					 guint               n_indices,
+					 const gboolean      block,
+					 GCancellable       *cancellable,
+					 GAsyncReadyCallback callback,
+					 gpointer            user_data)
+{
+	UrfClientBatch *batch;
+	guint i;
+
+	g_return_if_fail (URF_IS_CLIENT (client));
+	g_return_if_fail (client->priv->proxy != NULL);
+	g_return_if_fail (indices != NULL || n_indices == 0);
+
+	batch = g_new0 (UrfClientBatch, 1);
+	batch->result = g_simple_async_result_new (G_OBJECT (client), callback, user_data,
+						   urf_client_set_block_idx_multiple_async);
+	batch->status = TRUE;
+
+	if (n_indices == 0) {
+		g_simple_async_result_set_op_res_gboolean (batch->result, TRUE);
+		g_simple_async_result_complete_in_idle (batch->result);
+		g_object_unref (batch->result);
+		g_free (batch);
+		return;
+	}
+
+	batch->pending = n_indices;
+	for (i = 0; i < n_indices; i++) {
+		g_dbus_proxy_call (client->priv->proxy, "BlockIdx",
+				   g_variant_new ("(ub)", indices[i], block),
+				   G_DBUS_CALL_FLAGS_NONE,
+				   G_MAXINT, cancellable,
+				   urf_client_batch_cb, batch);
+	}
+}
+
+/**
+ * urf_client_set_block_idx_multiple_finish:
+ * @client: a #UrfClient instance
+ * @res: the #GAsyncResult passed to the callback
+ * @error: a #GError, or %NULL
+ *
+ * Finish an operation started with urf_client_set_block_idx_multiple_async().
+ *
+ * Return value: #TRUE if every device was changed, else #FALSE and
+ * @error is set to the first failed request, if any
+ *
+ * Since: 0.3.0
+ **/
+gboolean
+urf_client_set_block_idx_multiple_finish (UrfClient     *client,
+					  GAsyncResult  *res,
+					  GError       **error)
+{
+	return urf_client_block_finish (client, res,
+					urf_client_set_block_idx_multiple_async,
+					error);
 }
 
 /**
@@ -236,25 +688,26 @@ gboolean
 urf_client_is_inhibited (UrfClient *client,
 			 GError    **error)
 {
-	gboolean ret, is_inhibited;
+	GVariant *reply;
+	gboolean is_inhibited = FALSE;
 	GError *error_local = NULL;
 
 	g_return_val_if_fail (URF_IS_CLIENT (client), FALSE);
 	g_return_val_if_fail (client->priv->proxy != NULL, FALSE);
 
-	ret = dbus_g_proxy_call (client->priv->proxy, "IsInhibited", &error_local,
-				 G_TYPE_INVALID,
-				 G_TYPE_BOOLEAN, &is_inhibited,
-				 G_TYPE_INVALID);
-	if (!ret) {
-		g_warning ("Couldn't sent IsInhibited: %s", error_local->message);
-		g_set_error (error, 1, 0, "%s", error_local->message);
-		is_inhibited = FALSE;
+	reply = g_dbus_proxy_call_sync (client->priv->proxy, "IsInhibited",
+					NULL,
+					G_DBUS_CALL_FLAGS_NONE,
+					-1, NULL, &error_local);
+	if (reply == NULL) {
+		g_propagate_error (error, error_local);
+		return FALSE;
 	}
-	if (error_local != NULL)
-		g_error_free (error_local);
-	return is_inhibited;
 
+	g_variant_get (reply, "(b)", &is_inhibited);
+	g_variant_unref (reply);
+
+	return is_inhibited;
 }
 
 /**
@@ -275,31 +728,28 @@ urf_client_inhibit (UrfClient  *client,
 		    GError     **error)
 {
 	GError *error_local = NULL;
-	gboolean ret;
+	GVariant *reply;
 	guint cookie = 0;
 
 	if (!URF_IS_CLIENT (client) || client->priv->proxy == NULL) {
 		error_local = g_error_new (URF_CLIENT_ERROR,
 					   URF_CLIENT_ERROR_GENERAL,
 					   "Not a vaild UrfClient instance");
-		g_warning ("Inhibit: %s", error_local->message);
-		g_set_error (error, 1, 0, "%s", error_local->message);
 		goto out;
 	}
 
-	ret = dbus_g_proxy_call (client->priv->proxy, "Inhibit", &error_local,
-				 G_TYPE_STRING, reason,
-				 G_TYPE_INVALID,
-				 G_TYPE_UINT, &cookie,
-				 G_TYPE_INVALID);
-	if (!ret) {
-		g_warning ("Couldn't sent INHIBIT: %s", error_local->message);
-		g_set_error (error, 1, 0, "%s", error_local->message);
+	reply = g_dbus_proxy_call_sync (client->priv->proxy, "Inhibit",
+					g_variant_new ("(s)", reason),
+					G_DBUS_CALL_FLAGS_NONE,
+					-1, NULL, &error_local);
+	if (reply == NULL)
 		goto out;
-	}
+
+	g_variant_get (reply, "(u)", &cookie);
+	g_variant_unref (reply);
 out:
 	if (error_local != NULL)
-		g_error_free (error_local);
+		g_propagate_error (error, error_local);
 	return cookie;
 }
 
@@ -319,10 +769,147 @@ urf_client_uninhibit (UrfClient   *client,
 	g_return_if_fail (URF_IS_CLIENT (client));
 	g_return_if_fail (client->priv->proxy != NULL);
 
-	dbus_g_proxy_call_no_reply (client->priv->proxy, "Uninhibit",
-				    G_TYPE_UINT, cookie,
-				    G_TYPE_INVALID,
-				    G_TYPE_INVALID);
+	g_dbus_proxy_call (client->priv->proxy, "Uninhibit",
+			   g_variant_new ("(u)", cookie),
+			   G_DBUS_CALL_FLAGS_NONE,
+			   -1, NULL, NULL, NULL);
+}
+
+typedef struct {
+	UrfClient		*client;
+	UrfClientTypeFunc	 callback;
+	gpointer		 user_data;
+	GDestroyNotify		 notify;
+} UrfClientWatch;
+
+/**
+ * urf_client_watch_free:
+ **/
+static void
+urf_client_watch_free (UrfClientWatch *watch)
+{
+	if (watch->notify != NULL)
+		watch->notify (watch->user_data);
+	g_free (watch);
+}
+
+/**
+ * urf_client_type_from_name:
+ **/
+static gint
+urf_client_type_from_name (const char *name)
+{
+	static const char *names[] = URF_TYPE_NAMES;
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (names); i++) {
+		if (g_strcmp0 (names[i], name) == 0)
+			return i;
+	}
+	return -1;
+}
+
+/**
+ * urf_client_watch_type_cb:
+ **/
+static void
+urf_client_watch_type_cb (GDBusConnection *connection,
+			  const char      *sender_name,
+			  const char      *object_path,
+			  const char      *interface_name,
+			  const char      *signal_name,
+			  GVariant        *parameters,
+			  gpointer         user_data)
+{
+	UrfClientWatch *watch = user_data;
+	const char *type_name;
+	const char *device_path;
+	gboolean soft;
+	gboolean hard;
+	guint generation;
+	gint type;
+
+	if (!g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(sobbu)")))
+		return;
+
+	g_variant_get (parameters, "(&s&obbu)",
+		       &type_name, &device_path, &soft, &hard, &generation);
+	type = urf_client_type_from_name (type_name);
+	if (type < 0)
+		return;
+
+	watch->callback (watch->client, type, device_path, soft, hard,
+			 generation, watch->user_data);
+}
+
+/**
+ * urf_client_watch_type:
+ * @client: a #UrfClient instance
+ * @type: the type of the devices to watch, or %URFDEVICE_TYPE_ALL
+ * @callback: function to call when a device of @type changes
+ * @user_data: data to pass to @callback
+ * @notify: function to free @user_data, or %NULL
+ *
+ * Watch the devices of one type. The daemon tags its change signals
+ * with the device type and the subscription installs an arg0 match
+ * rule, so the bus only delivers the changes of @type to this process.
+ * A generation more than one ahead of the previous one of the same
+ * device means that changes were missed.
+ *
+ * Return value: an id for urf_client_unwatch_type(), or 0 on failure
+ *
+ * Since: 0.3.0
+ **/
+guint
+urf_client_watch_type (UrfClient         *client,
+		       UrfDeviceType      type,
+		       UrfClientTypeFunc  callback,
+		       gpointer           user_data,
+		       GDestroyNotify     notify)
+{
+	static const char *names[] = URF_TYPE_NAMES;
+	UrfClientWatch *watch;
+
+	g_return_val_if_fail (URF_IS_CLIENT (client), 0);
+	g_return_val_if_fail (client->priv->connection != NULL, 0);
+	g_return_val_if_fail (type < NUM_URFDEVICE_TYPES, 0);
+	g_return_val_if_fail (callback != NULL, 0);
+
+	watch = g_new0 (UrfClientWatch, 1);
+	watch->client = client;
+	watch->callback = callback;
+	watch->user_data = user_data;
+	watch->notify = notify;
+
+	return g_dbus_connection_signal_subscribe (client->priv->connection,
+						   urf_client_get_bus_name (client),
+						   URFKILL_INTERFACE,
+						   "DeviceTypeChanged",
+						   URFKILL_OBJECT_PATH,
+						   type == URFDEVICE_TYPE_ALL ? NULL : names[type],
+						   G_DBUS_SIGNAL_FLAGS_NONE,
+						   urf_client_watch_type_cb,
+						   watch,
+						   (GDestroyNotify) urf_client_watch_free);
+}
+
+/**
+ * urf_client_unwatch_type:
+ * @client: a #UrfClient instance
+ * @watch_id: an id returned by urf_client_watch_type()
+ *
+ * Stop watching the devices of a type and remove the match rule.
+ *
+ * Since: 0.3.0
+ **/
+void
+urf_client_unwatch_type (UrfClient *client,
+			 guint      watch_id)
+{
+	g_return_if_fail (URF_IS_CLIENT (client));
+	g_return_if_fail (client->priv->connection != NULL);
+
+	g_dbus_connection_signal_unsubscribe (client->priv->connection, watch_id);
 }
 
 
@@ -374,228 +961,657 @@ urf_client_set_bluetooth_block (UrfClient     *client,
  *
  * Return value: #TRUE for success, else #FALSE
  *
- * Since: 0.2.0
+ * Since: 0.2.0
+ **/
+gboolean
+urf_client_set_wwan_block (UrfClient     *client,
+			   const gboolean block)
+{
+	return urf_client_set_block (client, URFDEVICE_TYPE_WWAN, block, NULL, NULL);
+}
+
+/**
+ * urf_client_update_properties:
+ *
+ * Copy the daemon properties cached by the proxy
+ **/
+static void
+urf_client_update_properties (UrfClient *client)
+{
+	UrfClientPrivate *priv = client->priv;
+	GVariant *value;
+
+	value = g_dbus_proxy_get_cached_property (priv->proxy, "DaemonVersion");
+	if (value != NULL) {
+		g_free (priv->daemon_version);
+		priv->daemon_version = g_variant_dup_string (value, NULL);
+		g_variant_unref (value);
+	} else {
+		g_warning ("No 'DaemonVersion' property");
+	}
+
+	value = g_dbus_proxy_get_cached_property (priv->proxy, "KeyControl");
+	if (value != NULL) {
+		priv->key_control = g_variant_get_boolean (value);
+		g_variant_unref (value);
+	} else {
+		g_warning ("No 'KeyControl' property");
+	}
+}
+
+/**
+ * urf_client_get_daemon_version:
+ * @client: a #UrfClient instance
+ *
+ * Get urfkill daemon version
+ *
+ * Return value: string containing the daemon version, e.g. 0.2.0
+ *
+ * Since: 0.2.0
+ **/
+const char *
+urf_client_get_daemon_version (UrfClient *client)
+{
+	g_return_val_if_fail (URF_IS_CLIENT (client), NULL);
+	return client->priv->daemon_version;
+}
+
+/**
+ * urf_client_get_key_control:
+ **/
+static gboolean
+urf_client_get_key_control (UrfClient *client)
+{
+	g_return_val_if_fail (URF_IS_CLIENT (client), FALSE);
+	return client->priv->key_control;
+}
+
+/**
+ * urf_client_add_object:
+ **/
+static UrfDevice *
+urf_client_add_object (UrfClient   *client,
+		       GDBusObject *object)
+{
+	GDBusInterface *interface;
+	UrfDevice *device;
+	const char *object_path;
+
+	interface = g_dbus_object_get_interface (object, URFKILL_DEVICE_INTERFACE);
+	if (interface == NULL)
+		return NULL;
+
+	object_path = g_dbus_object_get_object_path (object);
+	device = urf_client_find_device (client, object_path);
+	if (device != NULL) {
+		g_warning ("already added: %s", object_path);
+		g_object_unref (interface);
+		return NULL;
+	}
+
+	device = _urf_device_new_for_proxy (G_DBUS_PROXY (interface));
+	client->priv->devices = g_list_append (client->priv->devices, device);
+	urf_client_index_device (client, device);
+
+	return device;
+}
+
+/**
+ * urf_client_object_added_cb:
+ **/
+static void
+urf_client_object_added_cb (GDBusObjectManager *manager,
+			    GDBusObject        *object,
+			    UrfClient          *client)
+{
+	UrfDevice *device;
+
+	device = urf_client_add_object (client, object);
+	if (device != NULL)
+		g_signal_emit (client, signals [URF_CLIENT_DEVICE_ADDED], 0, device);
+}
+
+/**
+ * urf_client_object_removed_cb:
+ **/
+static void
+urf_client_object_removed_cb (GDBusObjectManager *manager,
+			      GDBusObject        *object,
+			      UrfClient          *client)
+{
+	UrfClientPrivate *priv = client->priv;
+	UrfDevice *device;
+	const char *object_path;
+
+	object_path = g_dbus_object_get_object_path (object);
+	device = urf_client_find_device (client, object_path);
+
+	if (device == NULL) {
+		g_warning ("no such device to be removed: %s", object_path);
+		return;
+	}
+
+	client->priv->devices = g_list_remove (priv->devices, device);
+	urf_client_unindex_device (client, device);
+
+	g_signal_emit (client, signals [URF_CLIENT_DEVICE_REMOVED], 0, device);
+
+	g_object_unref (device);
+}
+
+/**
+ * urf_client_device_changed_cb:
+ **/
+static void
+urf_client_device_changed_cb (UrfClient  *client,
+			      const char *object_path)
+{
+	UrfDevice *device;
+
+	device = urf_client_find_device (client, object_path);
+
+	if (device == NULL) {
+		g_warning ("no device to be changed: %s", object_path);
+		return;
+	}
+
+	g_signal_emit (client, signals [URF_CLIENT_DEVICE_CHANGED], 0, device);
+}
+
+/**
+ * urf_client_proxy_signal_cb:
+ **/
+static void
+urf_client_proxy_signal_cb (GDBusProxy *proxy,
+			    const char *sender_name,
+			    const char *signal_name,
+			    GVariant   *parameters,
+			    UrfClient  *client)
+{
+	const char *object_path;
+	int keycode;
+
+	if (g_strcmp0 (signal_name, "UrfkeyPressed") == 0) {
+		g_variant_get (parameters, "(i)", &keycode);
+		g_signal_emit (client, signals [URF_CLIENT_RF_KEY_PRESSED], 0, keycode);
+		return;
+	}
+
+	if (!g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(o)")))
+		return;
+	g_variant_get (parameters, "(&o)", &object_path);
+
+	/* DeviceAdded and DeviceRemoved come from the object manager */
+	if (g_strcmp0 (signal_name, "DeviceChanged") == 0)
+		urf_client_device_changed_cb (client, object_path);
+}
+
+/**
+ * urf_client_proxy_properties_changed_cb:
+ **/
+static void
+urf_client_proxy_properties_changed_cb (GDBusProxy *proxy,
+					GVariant   *changed_properties,
+					GStrv       invalidated_properties,
+					UrfClient  *client)
+{
+	urf_client_update_properties (client);
+
+	if (g_variant_lookup (changed_properties, "DaemonVersion", "&s", NULL))
+		g_object_notify (G_OBJECT (client), "daemon-version");
+	if (g_variant_lookup (changed_properties, "KeyControl", "b", NULL))
+		g_object_notify (G_OBJECT (client), "key-control");
+}
+
+/**
+ * urf_client_set_proxy:
+ **/
+static void
+urf_client_set_proxy (UrfClient  *client,
+		      GDBusProxy *proxy)
+{
+	client->priv->proxy = proxy;
+
+	g_signal_connect (proxy, "g-signal",
+			  G_CALLBACK (urf_client_proxy_signal_cb), client);
+	g_signal_connect (proxy, "g-properties-changed",
+			  G_CALLBACK (urf_client_proxy_properties_changed_cb), client);
+
+	urf_client_update_properties (client);
+}
+
+/**
+ * urf_client_set_manager:
+ **/
+static void
+urf_client_set_manager (UrfClient          *client,
+			GDBusObjectManager *manager)
+{
+	GList *objects;
+	GList *item;
+
+	client->priv->manager = manager;
+
+	/* the manager already holds every device with its properties */
+	objects = g_dbus_object_manager_get_objects (manager);
+	for (item = objects; item; item = item->next) {
+		urf_client_add_object (client, G_DBUS_OBJECT (item->data));
+		g_object_unref (item->data);
+	}
+	g_list_free (objects);
+
+	g_signal_connect (manager, "object-added",
+			  G_CALLBACK (urf_client_object_added_cb), client);
+	g_signal_connect (manager, "object-removed",
+			  G_CALLBACK (urf_client_object_removed_cb), client);
+}
+
+/**
+ * urf_client_get_bus_name:
+ *
+ * Return value: the name of the daemon, or %NULL on the private socket
  **/
-gboolean
-urf_client_set_wwan_block (UrfClient     *client,
-			   const gboolean block)
+static const char *
+urf_client_get_bus_name (UrfClient *client)
 {
-	return urf_client_set_block (client, URFDEVICE_TYPE_WWAN, block, NULL, NULL);
+	return client->priv->is_peer ? NULL : URFKILL_DBUS_NAME;
 }
 
 /**
- * urf_client_get_properties_sync:
+ * urf_client_get_peer_address:
+ *
+ * Return value: the address of the private socket of the daemon, or
+ *               %NULL if there is none
  **/
-static gboolean
-urf_client_get_properties_sync (UrfClient    *client,
-				GCancellable *cancellable,
-				GError       **error)
+static char *
+urf_client_get_peer_address (void)
 {
-	gboolean ret = TRUE;
-	GHashTable *props;
-	GValue *value;
+	char *path;
+	char *address = NULL;
 
-	props = NULL;
+	path = urf_runtime_path (URF_PEER_SOCKET_NAME);
+	if (g_file_test (path, G_FILE_TEST_EXISTS))
+		address = g_strdup_printf ("unix:path=%s", path);
+	g_free (path);
 
-	if (client->priv->have_properties)
-		goto out;
-	if (!client->priv->prop_proxy)
-		goto out;
+	return address;
+}
 
-	error = NULL;
-	ret = dbus_g_proxy_call (client->priv->prop_proxy, "GetAll", error,
-				 G_TYPE_STRING, "org.freedesktop.URfkill",
-				 G_TYPE_INVALID,
-				 dbus_g_type_get_map ("GHashTable", G_TYPE_STRING, G_TYPE_VALUE), &props,
-				 G_TYPE_INVALID);
+/**
+ * urf_client_connect_sync:
+ *
+ * Use the bus given at construction, else prefer the private socket of
+ * the daemon and fall back to the system bus
+ **/
+static GDBusConnection *
+urf_client_connect_sync (UrfClient     *client,
+			 GCancellable  *cancellable,
+			 GError       **error)
+{
+	GDBusConnection *connection;
+	GError *error_local = NULL;
+	char *address;
+
+	if (client->priv->bus_address != NULL)
+		return g_dbus_connection_new_for_address_sync (client->priv->bus_address,
+							       G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+							       G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+							       NULL,
+							       cancellable,
+							       error);
+
+	address = urf_client_get_peer_address ();
+	if (address != NULL) {
+		connection = g_dbus_connection_new_for_address_sync (address,
+								     G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT,
+								     NULL,
+								     cancellable,
+								     &error_local);
+		g_free (address);
+		if (connection != NULL) {
+			client->priv->is_peer = TRUE;
+			return connection;
+		}
+		g_debug ("Using the system bus: %s", error_local->message);
+		g_error_free (error_local);
+	}
 
-	if (!ret)
-		goto out;
+	return g_bus_get_sync (G_BUS_TYPE_SYSTEM, cancellable, error);
+}
 
-	value = g_hash_table_lookup (props, "DaemonVersion");
-	if (value == NULL) {
-		g_warning ("No 'DaemonVersion' property");
-		goto out;
+/**
+ * urf_client_initable_init:
+ **/
+static gboolean
+urf_client_initable_init (GInitable     *initable,
+			  GCancellable  *cancellable,
+			  GError       **error)
+{
+	UrfClient *client = URF_CLIENT (initable);
+	UrfClientPrivate *priv = client->priv;
+	GDBusProxy *proxy;
+	GDBusObjectManager *manager;
+
+	if (priv->init_state == URF_CLIENT_INIT_RUNNING) {
+		g_set_error_literal (error, URF_CLIENT_ERROR,
+				     URF_CLIENT_ERROR_GENERAL,
+				     "Asynchronous initialization in progress");
+		return FALSE;
 	}
-	client->priv->daemon_version = g_strdup (g_value_get_string (value));
 
-	value = g_hash_table_lookup (props, "KeyControl");
-	if (value == NULL) {
-		g_warning ("No 'KeyControl' property");
+	if (priv->init_state == URF_CLIENT_INIT_DONE)
 		goto out;
-	}
-	client->priv->key_control = g_value_get_boolean (value);
 
-	/* All done */
-	client->priv->have_properties = TRUE;
+	priv->connection = urf_client_connect_sync (client, cancellable, &priv->init_error);
+	if (priv->connection == NULL)
+		goto done;
+
+	/* connect to main interface */
+	proxy = g_dbus_proxy_new_sync (priv->connection,
+				       G_DBUS_PROXY_FLAGS_NONE,
+				       NULL,
+				       urf_client_get_bus_name (client),
+				       URFKILL_OBJECT_PATH,
+				       URFKILL_INTERFACE,
+				       cancellable,
+				       &priv->init_error);
+	if (proxy == NULL)
+		goto done;
+	urf_client_set_proxy (client, proxy);
+
+	manager = g_dbus_object_manager_client_new_sync (priv->connection,
+							 G_DBUS_OBJECT_MANAGER_CLIENT_FLAGS_NONE,
+							 urf_client_get_bus_name (client),
+							 URFKILL_OBJECT_PATH,
+							 NULL, NULL, NULL,
+							 cancellable,
+							 &priv->init_error);
+	if (manager == NULL)
+		goto done;
+	urf_client_set_manager (client, manager);
+done:
+	priv->init_state = URF_CLIENT_INIT_DONE;
 out:
-	if (props != NULL)
-		g_hash_table_unref (props);
-	return ret;
+	if (priv->init_error != NULL) {
+		g_propagate_error (error, g_error_copy (priv->init_error));
+		return FALSE;
+	}
+	return TRUE;
 }
 
 /**
- * urf_client_get_daemon_version:
- * @client: a #UrfClient instance
- *
- * Get urfkill daemon version
- *
- * Return value: string containing the daemon version, e.g. 0.2.0
- *
- * Since: 0.2.0
+ * urf_client_initable_iface_init:
  **/
-const char *
-urf_client_get_daemon_version (UrfClient *client)
+static void
+urf_client_initable_iface_init (GInitableIface *iface)
 {
-	g_return_val_if_fail (URF_IS_CLIENT (client), NULL);
-	urf_client_get_properties_sync (client, NULL, NULL);
-	return client->priv->daemon_version;
+	iface->init = urf_client_initable_init;
 }
 
 /**
- * urf_client_get_key_control:
+ * urf_client_init_done:
+ *
+ * Complete every pending urf_client_init_async() call
  **/
-static gboolean
-urf_client_get_key_control (UrfClient *client)
+static void
+urf_client_init_done (UrfClient *client,
+		      GError    *error)
 {
-	g_return_val_if_fail (URF_IS_CLIENT (client), FALSE);
-	urf_client_get_properties_sync (client, NULL, NULL);
-	return client->priv->key_control;
+	UrfClientPrivate *priv = client->priv;
+	GSimpleAsyncResult *result;
+	GList *results;
+	GList *item;
+
+	priv->init_state = URF_CLIENT_INIT_DONE;
+	priv->init_error = error;
+
+	if (priv->init_cancellable) {
+		g_object_unref (priv->init_cancellable);
+		priv->init_cancellable = NULL;
+	}
+
+	results = priv->init_results;
+	priv->init_results = NULL;
+
+	for (item = results; item; item = item->next) {
+		result = G_SIMPLE_ASYNC_RESULT (item->data);
+		if (error != NULL)
+			g_simple_async_result_set_from_error (result, error);
+		g_simple_async_result_complete (result);
+		g_object_unref (result);
+	}
+	g_list_free (results);
 }
 
 /**
- * urf_client_add:
+ * urf_client_init_manager_cb:
  **/
-static UrfDevice *
-urf_client_add (UrfClient  *client,
-		const char *object_path)
+static void
+urf_client_init_manager_cb (GObject      *source_object,
+			    GAsyncResult *res,
+			    gpointer      user_data)
 {
-	UrfDevice *device;
-
-	device = urf_device_new ();
-	urf_device_set_object_path_sync (device, object_path, NULL, NULL);
+	UrfClient *client = URF_CLIENT (user_data);
+	GDBusObjectManager *manager;
+	GError *error = NULL;
 
-	client->priv->devices = g_list_append (client->priv->devices, device);
+	manager = g_dbus_object_manager_client_new_finish (res, &error);
+	if (manager == NULL) {
+		urf_client_init_done (client, error);
+		goto out;
+	}
 
-	return device;
+	urf_client_set_manager (client, manager);
+	urf_client_init_done (client, NULL);
+out:
+	g_object_unref (client);
 }
 
 /**
- * urf_client_device_added_cb:
+ * urf_client_init_proxy_cb:
  **/
 static void
-urf_client_device_added_cb (DBusGProxy  *proxy,
-			    const gchar *object_path,
-			    UrfClient   *client)
+urf_client_init_proxy_cb (GObject      *source_object,
+			  GAsyncResult *res,
+			  gpointer      user_data)
 {
-	UrfDevice *device;
+	UrfClient *client = URF_CLIENT (user_data);
+	GDBusProxy *proxy;
+	GError *error = NULL;
 
-	device = urf_client_find_device (client, object_path);
-	if (device != NULL) {
-		g_warning ("already added: %s", object_path);
+	proxy = g_dbus_proxy_new_finish (res, &error);
+	if (proxy == NULL) {
+		urf_client_init_done (client, error);
+		g_object_unref (client);
 		return;
 	}
-
-	device = urf_client_add (client, object_path);
-
-	g_signal_emit (client, signals [URF_CLIENT_DEVICE_ADDED], 0, device);
+	urf_client_set_proxy (client, proxy);
+
+	/* one GetManagedObjects call fetches all devices */
+	g_dbus_object_manager_client_new (client->priv->connection,
+					  G_DBUS_OBJECT_MANAGER_CLIENT_FLAGS_NONE,
+					  urf_client_get_bus_name (client),
+					  URFKILL_OBJECT_PATH,
+					  NULL, NULL, NULL,
+					  client->priv->init_cancellable,
+					  urf_client_init_manager_cb,
+					  client);
 }
 
 /**
- * urf_client_device_removed_cb:
+ * urf_client_init_connected:
  **/
 static void
-urf_client_device_removed_cb (DBusGProxy *proxy,
-			      const char *object_path,
-			      UrfClient  *client)
+urf_client_init_connected (UrfClient *client)
 {
-	UrfClientPrivate *priv = client->priv;
-	UrfDevice *device;
+	g_dbus_proxy_new (client->priv->connection,
+			  G_DBUS_PROXY_FLAGS_NONE,
+			  NULL,
+			  urf_client_get_bus_name (client),
+			  URFKILL_OBJECT_PATH,
+			  URFKILL_INTERFACE,
+			  client->priv->init_cancellable,
+			  urf_client_init_proxy_cb,
+			  client);
+}
 
-	device = urf_client_find_device (client, object_path);
+/**
+ * urf_client_init_bus_cb:
+ **/
+static void
+urf_client_init_bus_cb (GObject      *source_object,
+			GAsyncResult *res,
+			gpointer      user_data)
+{
+	UrfClient *client = URF_CLIENT (user_data);
+	GError *error = NULL;
 
-	if (device == NULL) {
-		g_warning ("no such device to be removed: %s", object_path);
+	client->priv->connection = g_bus_get_finish (res, &error);
+	if (client->priv->connection == NULL) {
+		urf_client_init_done (client, error);
+		g_object_unref (client);
 		return;
 	}
 
-	client->priv->devices = g_list_remove (priv->devices, device);
-
-	g_signal_emit (client, signals [URF_CLIENT_DEVICE_REMOVED], 0, device);
-
-	g_object_unref (device);
+	urf_client_init_connected (client);
 }
 
 /**
- * urf_client_device_changed_cb:
+ * urf_client_init_address_cb:
  **/
 static void
-urf_client_device_changed_cb (DBusGProxy     *proxy,
-			      const char     *object_path,
-			      UrfClient      *client)
+urf_client_init_address_cb (GObject      *source_object,
+			    GAsyncResult *res,
+			    gpointer      user_data)
 {
-	UrfDevice *device;
-
-	device = urf_client_find_device (client, object_path);
+	UrfClient *client = URF_CLIENT (user_data);
+	GError *error = NULL;
 
-	if (device == NULL) {
-		g_warning ("no device to be changed: %s", object_path);
+	client->priv->connection = g_dbus_connection_new_for_address_finish (res, &error);
+	if (client->priv->connection == NULL) {
+		urf_client_init_done (client, error);
+		g_object_unref (client);
 		return;
 	}
 
-	g_signal_emit (client, signals [URF_CLIENT_DEVICE_CHANGED], 0, device);
+	urf_client_init_connected (client);
 }
 
 /**
- * urf_client_rf_key_pressed_cb:
+ * urf_client_init_peer_cb:
  **/
 static void
-urf_client_rf_key_pressed_cb (DBusGProxy *proxy,
-			      const int   keycode,
-			      UrfClient  *client)
+urf_client_init_peer_cb (GObject      *source_object,
+			 GAsyncResult *res,
+			 gpointer      user_data)
 {
-	g_signal_emit (client, signals [URF_CLIENT_RF_KEY_PRESSED], 0, keycode);
+	UrfClient *client = URF_CLIENT (user_data);
+	GError *error = NULL;
+
+	client->priv->connection = g_dbus_connection_new_for_address_finish (res, &error);
+	if (client->priv->connection == NULL) {
+		g_debug ("Using the system bus: %s", error->message);
+		g_error_free (error);
+		g_bus_get (G_BUS_TYPE_SYSTEM,
+			   client->priv->init_cancellable,
+			   urf_client_init_bus_cb,
+			   client);
+		return;
+	}
+
+	client->priv->is_peer = TRUE;
+	urf_client_init_connected (client);
 }
 
 /**
- * urf_client_get_devices_private:
+ * urf_client_init_async:
  **/
 static void
-urf_client_get_devices_private (UrfClient *client,
-				GError    **error)
+urf_client_init_async (GAsyncInitable      *initable,
+		       int                  io_priority,
+		       GCancellable        *cancellable,
+		       GAsyncReadyCallback  callback,
+		       gpointer             user_data)
 {
-	GError *error_local = NULL;
-	GType g_type_array;
-	GPtrArray *devices = NULL;
-	const char *object_path;
-	gboolean ret;
-	guint i;
+	UrfClient *client = URF_CLIENT (initable);
+	UrfClientPrivate *priv = client->priv;
+	GSimpleAsyncResult *result;
+	char *address;
 
-	g_return_if_fail (URF_IS_CLIENT (client));
-	g_return_if_fail (client->priv->proxy != NULL);
+	result = g_simple_async_result_new (G_OBJECT (client), callback, user_data,
+					    urf_client_init_async);
 
-	g_type_array = dbus_g_type_get_collection ("GPtrArray", DBUS_TYPE_G_OBJECT_PATH);
-	ret = dbus_g_proxy_call (client->priv->proxy, "EnumerateDevices", &error_local,
-				 G_TYPE_INVALID,
-				 g_type_array, &devices,
-				 G_TYPE_INVALID);
-	if (!ret) {
-		g_set_error (error, 1, 0, "%s", error_local->message);
-		g_error_free (error_local);
+	if (priv->init_state == URF_CLIENT_INIT_DONE) {
+		if (priv->init_error != NULL)
+			g_simple_async_result_set_from_error (result, priv->init_error);
+		g_simple_async_result_complete_in_idle (result);
+		g_object_unref (result);
 		return;
 	}
 
-	/* no data */
-	if (devices == NULL) {
-		g_set_error_literal (error, 1, 0, "no data");
+	/* share the running initialization */
+	priv->init_results = g_list_append (priv->init_results, result);
+	if (priv->init_state == URF_CLIENT_INIT_RUNNING)
+		return;
+
+	priv->init_state = URF_CLIENT_INIT_RUNNING;
+	if (cancellable != NULL)
+		priv->init_cancellable = g_object_ref (cancellable);
+
+	if (priv->bus_address != NULL) {
+		g_dbus_connection_new_for_address (priv->bus_address,
+						   G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+						   G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+						   NULL,
+						   cancellable,
+						   urf_client_init_address_cb,
+						   g_object_ref (client));
 		return;
 	}
 
-	/* convert */
-	for (i=0; i < devices->len; i++) {
-		object_path = (const char *) g_ptr_array_index (devices, i);
-		urf_client_add (client, object_path);
+	/* prefer the private socket of the daemon */
+	address = urf_client_get_peer_address ();
+	if (address != NULL) {
+		g_dbus_connection_new_for_address (address,
+						   G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT,
+						   NULL,
+						   cancellable,
+						   urf_client_init_peer_cb,
+						   g_object_ref (client));
+		g_free (address);
+		return;
 	}
+
+	g_bus_get (G_BUS_TYPE_SYSTEM,
+		   cancellable,
+		   urf_client_init_bus_cb,
+		   g_object_ref (client));
+}
+
+/**
+ * urf_client_init_finish:
+ **/
+static gboolean
+urf_client_init_finish (GAsyncInitable  *initable,
+			GAsyncResult    *res,
+			GError         **error)
+{
+	GSimpleAsyncResult *result = G_SIMPLE_ASYNC_RESULT (res);
+
+	g_return_val_if_fail (g_simple_async_result_is_valid (res, G_OBJECT (initable),
+							      urf_client_init_async), FALSE);
+
+	return !g_simple_async_result_propagate_error (result, error);
+}
+
+/**
+ * urf_client_async_initable_iface_init:
+ **/
+static void
+urf_client_async_initable_iface_init (GAsyncInitableIface *iface)
+{
+	iface->init_async = urf_client_init_async;
+	iface->init_finish = urf_client_init_finish;
 }
 
 /**
@@ -609,8 +1625,6 @@ urf_client_get_property (GObject    *object,
 {
 	UrfClient *client = URF_CLIENT (object);
 
-	urf_client_get_properties_sync (client, NULL, NULL);
-
 	switch (prop_id) {
 	case PROP_DAEMON_VERSION:
 		g_value_set_string (value, urf_client_get_daemon_version (client));
@@ -618,6 +1632,31 @@ urf_client_get_property (GObject    *object,
 	case PROP_KEY_CONTROL:
 		g_value_set_boolean (value, urf_client_get_key_control (client));
 		break;
+	case PROP_BUS_ADDRESS:
+		g_value_set_string (value, client->priv->bus_address);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+/**
+ * urf_client_set_property:
+ **/
+static void
+urf_client_set_property (GObject      *object,
+			 guint         prop_id,
+			 const GValue *value,
+			 GParamSpec   *pspec)
+{
+	UrfClient *client = URF_CLIENT (object);
+
+	switch (prop_id) {
+	case PROP_BUS_ADDRESS:
+		g_free (client->priv->bus_address);
+		client->priv->bus_address = g_value_dup_string (value);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -666,6 +1705,7 @@ urf_client_class_init (UrfClientClass *klass)
 	GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
 	object_class->get_property = urf_client_get_property;
+	object_class->set_property = urf_client_set_property;
 	object_class->dispose = urf_client_dispose;
 	object_class->finalize = urf_client_finalize;
 
@@ -699,6 +1739,23 @@ urf_client_class_init (UrfClientClass *klass)
 							       FALSE,
 							       G_PARAM_READABLE));
 
+	/**
+	 * UrfClient:bus-address:
+	 *
+	 * The address of the message bus to use instead of the system bus,
+	 * or %NULL. Used to run against a private bus, e.g. in tests.
+	 *
+	 * Since: 0.3.0
+	 **/
+	g_object_class_install_property (object_class,
+					 PROP_BUS_ADDRESS,
+					 g_param_spec_string ("bus-address",
+							      "Bus address",
+							      "The address of the message bus",
+							      NULL,
+							      G_PARAM_READWRITE |
+							      G_PARAM_CONSTRUCT_ONLY));
+
 	/* install signals */
 	/**
 	 * UrfClient::device-added:
@@ -774,75 +1831,22 @@ urf_client_class_init (UrfClientClass *klass)
 static void
 urf_client_init (UrfClient *client)
 {
-	GError *error = NULL;
-
 	client->priv = URF_CLIENT_GET_PRIVATE (client);
+	client->priv->connection = NULL;
+	client->priv->is_peer = FALSE;
+	client->priv->bus_address = NULL;
+	client->priv->proxy = NULL;
+	client->priv->manager = NULL;
+	client->priv->devices = NULL;
+	client->priv->devices_by_path = g_hash_table_new (g_str_hash, g_str_equal);
+	client->priv->devices_by_index = g_hash_table_new (g_direct_hash, g_direct_equal);
 	client->priv->daemon_version = NULL;
 	client->priv->key_control = FALSE;
-	client->priv->have_properties = FALSE;
-
-	/* get on the bus */
-	client->priv->bus = dbus_g_bus_get (DBUS_BUS_SYSTEM, &error);
-	if (client->priv->bus == NULL) {
-		g_warning ("Couldn't connect to system bus: %s", error->message);
-		g_error_free (error);
-		goto out;
-	}
-
-	/* connect to main interface */
-	client->priv->proxy = dbus_g_proxy_new_for_name (client->priv->bus,
-							 "org.freedesktop.URfkill",
-							 "/org/freedesktop/URfkill",
-							 "org.freedesktop.URfkill");
-	if (client->priv->proxy == NULL) {
-		g_warning ("Couldn't connect to proxy");
-		goto out;
-	}
-
-	/* connect to main interface */
-	client->priv->prop_proxy = dbus_g_proxy_new_for_name (client->priv->bus,
-							      "org.freedesktop.URfkill",
-							      "/org/freedesktop/URfkill",
-							      "org.freedesktop.DBus.Properties");
-	if (client->priv->prop_proxy == NULL) {
-		g_warning ("Couldn't connect to proxy");
-		goto out;
-	}
-
-	client->priv->devices = NULL;
-
-	urf_client_get_devices_private (client, &error);
-	if (error) {
-		g_warning ("Failed to enumerate devices: %s", error->message);
-		g_error_free (error);
-		goto out;
-	}
-
-	/* connect signals */
-	dbus_g_proxy_add_signal (client->priv->proxy, "DeviceAdded",
-				 G_TYPE_STRING,
-				 G_TYPE_INVALID);
-	dbus_g_proxy_add_signal (client->priv->proxy, "DeviceRemoved",
-				 G_TYPE_STRING,
-				 G_TYPE_INVALID);
-	dbus_g_proxy_add_signal (client->priv->proxy, "DeviceChanged",
-				 G_TYPE_STRING,
-				 G_TYPE_INVALID);
-	dbus_g_proxy_add_signal (client->priv->proxy, "UrfkeyPressed",
-				 G_TYPE_INT,
-				 G_TYPE_INVALID);
-	/* callbacks */
-	dbus_g_proxy_connect_signal (client->priv->proxy, "DeviceAdded",
-				     G_CALLBACK (urf_client_device_added_cb), client, NULL);
-	dbus_g_proxy_connect_signal (client->priv->proxy, "DeviceRemoved",
-				     G_CALLBACK (urf_client_device_removed_cb), client, NULL);
-	dbus_g_proxy_connect_signal (client->priv->proxy, "DeviceChanged",
-				     G_CALLBACK (urf_client_device_changed_cb), client, NULL);
-	dbus_g_proxy_connect_signal (client->priv->proxy, "UrfkeyPressed",
-				     G_CALLBACK (urf_client_rf_key_pressed_cb), client, NULL);
-
-out:
-	return;
+	client->priv->context = NULL;
+	client->priv->init_state = URF_CLIENT_INIT_NONE;
+	client->priv->init_error = NULL;
+	client->priv->init_results = NULL;
+	client->priv->init_cancellable = NULL;
 }
 
 /**
@@ -857,19 +1861,31 @@ urf_client_dispose (GObject *object)
 
 	client = URF_CLIENT (object);
 
-	if (client->priv->bus) {
-		dbus_g_connection_unref (client->priv->bus);
-		client->priv->bus = NULL;
-	}
-
 	if (client->priv->proxy) {
+		g_signal_handlers_disconnect_by_func (client->priv->proxy,
+						      urf_client_proxy_signal_cb,
+						      client);
+		g_signal_handlers_disconnect_by_func (client->priv->proxy,
+						      urf_client_proxy_properties_changed_cb,
+						      client);
 		g_object_unref (client->priv->proxy);
 		client->priv->proxy = NULL;
 	}
 
-	if (client->priv->prop_proxy) {
-		g_object_unref (client->priv->prop_proxy);
-		client->priv->prop_proxy = NULL;
+	if (client->priv->manager) {
+		g_signal_handlers_disconnect_by_func (client->priv->manager,
+						      urf_client_object_added_cb,
+						      client);
+		g_signal_handlers_disconnect_by_func (client->priv->manager,
+						      urf_client_object_removed_cb,
+						      client);
+		g_object_unref (client->priv->manager);
+		client->priv->manager = NULL;
+	}
+
+	if (client->priv->connection) {
+		g_object_unref (client->priv->connection);
+		client->priv->connection = NULL;
 	}
 
 	G_OBJECT_CLASS (urf_client_parent_class)->dispose (object);
@@ -888,7 +1904,22 @@ urf_client_finalize (GObject *object)
 
 	client = URF_CLIENT (object);
 
+	if (client->priv->context) {
+		G_LOCK (urf_client_objects);
+		if (g_hash_table_lookup (urf_client_objects, client->priv->context) == client)
+			g_hash_table_remove (urf_client_objects, client->priv->context);
+		G_UNLOCK (urf_client_objects);
+		g_main_context_unref (client->priv->context);
+	}
+
 	g_free (client->priv->daemon_version);
+	g_free (client->priv->bus_address);
+
+	if (client->priv->init_error)
+		g_error_free (client->priv->init_error);
+
+	g_hash_table_destroy (client->priv->devices_by_path);
+	g_hash_table_destroy (client->priv->devices_by_index);
 
 	if (client->priv->devices) {
 		for (item = client->priv->devices; item; item = item->next)
@@ -900,10 +1931,47 @@ urf_client_finalize (GObject *object)
 	G_OBJECT_CLASS (urf_client_parent_class)->finalize (object);
 }
 
+/**
+ * urf_client_get_shared:
+ *
+ * Return value: the client of the thread-default main context with a
+ * reference added, or a new one that is not initialized yet
+ **/
+static UrfClient *
+urf_client_get_shared (void)
+{
+	GMainContext *context;
+	UrfClient *client;
+
+	context = g_main_context_get_thread_default ();
+	if (context == NULL)
+		context = g_main_context_default ();
+
+	G_LOCK (urf_client_objects);
+
+	if (urf_client_objects == NULL)
+		urf_client_objects = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	client = g_hash_table_lookup (urf_client_objects, context);
+	if (client != NULL) {
+		g_object_ref (client);
+	} else {
+		client = URF_CLIENT (g_object_new (URF_TYPE_CLIENT, NULL));
+		client->priv->context = g_main_context_ref (context);
+		g_hash_table_insert (urf_client_objects, context, client);
+	}
+
+	G_UNLOCK (urf_client_objects);
+
+	return client;
+}
+
 /**
  * urf_client_new:
  *
- * Creates a new #UrfClient object.
+ * Creates a new #UrfClient object, or returns the one already created
+ * for the thread-default main context. The devices are enumerated
+ * synchronously.
  *
  * Return value: a new #UrfClient object.
  *
@@ -911,12 +1979,130 @@ urf_client_finalize (GObject *object)
 UrfClient *
 urf_client_new (void)
 {
-	if (urf_client_object != NULL) {
-		g_object_ref (urf_client_object);
-	} else {
-		urf_client_object = g_object_new (URF_TYPE_CLIENT, NULL);
-		g_object_add_weak_pointer (urf_client_object, &urf_client_object);
+	UrfClient *client;
+	GError *error = NULL;
+
+	client = urf_client_get_shared ();
+
+	if (!g_initable_init (G_INITABLE (client), NULL, &error)) {
+		g_warning ("Couldn't initialize UrfClient: %s", error->message);
+		g_error_free (error);
 	}
-	return URF_CLIENT (urf_client_object);
+
+	return client;
+}
+
+/**
+ * urf_client_new_async:
+ * @cancellable: a #GCancellable or %NULL
+ * @callback: a #GAsyncReadyCallback to call when the client is ready
+ * @user_data: the data to pass to @callback
+ *
+ * Asynchronously creates a #UrfClient object for the thread-default main
+ * context. The daemon properties and the properties of all devices are
+ * fetched without blocking, and @callback is invoked in the thread-default
+ * main context once they have arrived. Call urf_client_new_finish() in
+ * @callback to get the client.
+ *
+ * Since: 0.3.0
+ **/
+void
+urf_client_new_async (GCancellable        *cancellable,
+		      GAsyncReadyCallback  callback,
+		      gpointer             user_data)
+{
+	UrfClient *client;
+
+	client = urf_client_get_shared ();
+	g_async_initable_init_async (G_ASYNC_INITABLE (client),
+				     G_PRIORITY_DEFAULT,
+				     cancellable,
+				     callback,
+				     user_data);
+	g_object_unref (client);
+}
+
+/**
+ * urf_client_new_finish:
+ * @res: the #GAsyncResult passed to the callback
+ * @error: a #GError, or %NULL
+ *
+ * Finish an operation started with urf_client_new_async().
+ *
+ * Return value: (transfer full): a #UrfClient object, or %NULL and @error is used
+ *
+ * Since: 0.3.0
+ **/
+UrfClient *
+urf_client_new_finish (GAsyncResult  *res,
+		       GError       **error)
+{
+	GObject *source_object;
+	GObject *object;
+
+	source_object = g_async_result_get_source_object (res);
+	object = g_async_initable_new_finish (G_ASYNC_INITABLE (source_object),
+					      res, error);
+	g_object_unref (source_object);
+
+	if (object == NULL)
+		return NULL;
+	return URF_CLIENT (object);
+}
+
+/**
+ * urf_client_new_for_address:
+ * @address: the address of a message bus
+ * @cancellable: a #GCancellable or %NULL
+ * @error: a #GError, or %NULL
+ *
+ * Creates a #UrfClient talking to the daemon on the message bus at
+ * @address instead of the system bus, e.g. a private bus in a test
+ * setup. Unlike urf_client_new(), every call returns a new client with
+ * its own connection.
+ *
+ * Return value: (transfer full): a #UrfClient object, or %NULL and @error is used
+ *
+ * Since: 0.3.0
+ **/
+UrfClient *
+urf_client_new_for_address (const char    *address,
+			    GCancellable  *cancellable,
+			    GError       **error)
+{
+	g_return_val_if_fail (address != NULL, NULL);
+
+	return g_initable_new (URF_TYPE_CLIENT, cancellable, error,
+			       "bus-address", address,
+			       NULL);
 }
 
+/**
+ * urf_client_new_for_address_async:
+ * @address: the address of a message bus
+ * @cancellable: a #GCancellable or %NULL
+ * @callback: a #GAsyncReadyCallback to call when the client is ready
+ * @user_data: the data to pass to @callback
+ *
+ * Asynchronously creates a #UrfClient talking to the daemon on the
+ * message bus at @address. Call urf_client_new_finish() in @callback
+ * to get the client.
+ *
+ * Since: 0.3.0
+ **/
+void
+urf_client_new_for_address_async (const char          *address,
+				  GCancellable        *cancellable,
+				  GAsyncReadyCallback  callback,
+				  gpointer             user_data)
+{
+	g_return_if_fail (address != NULL);
+
+	g_async_initable_new_async (URF_TYPE_CLIENT,
+				    G_PRIORITY_DEFAULT,
+				    cancellable,
+				    callback,
+				    user_data,
+				    "bus-address", address,
+				    NULL);
+}
@@ -78,6 +78,26 @@ struct _UrfClientClass
 							 const int	 keycode);
 };
 
+/**
+ * UrfClientTypeFunc:
+ * @client: the #UrfClient
+ * @type: the type of the device that changed
+ * @object_path: the object path of the device
+ * @soft: the new soft block state
+ * @hard: the new hard block state
+ * @generation: the generation of the new states
+ * @user_data: the data passed to urf_client_watch_type()
+ *
+ * Callback for urf_client_watch_type().
+ **/
+typedef void	(*UrfClientTypeFunc)	(UrfClient	*client,
+					 UrfDeviceType	 type,
+					 const char	*object_path,
+					 gboolean	 soft,
+					 gboolean	 hard,
+					 guint		 generation,
+					 gpointer	 user_data);
+
 typedef enum
 {
 	URF_CLIENT_ERROR_GENERAL,
@@ -87,11 +107,27 @@ typedef enum
 /* general */
 GType		 urf_client_get_type			(void);
 UrfClient	*urf_client_new				(void);
+void		 urf_client_new_async			(GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+UrfClient	*urf_client_new_finish			(GAsyncResult	*res,
+							 GError		**error);
+UrfClient	*urf_client_new_for_address		(const char	*address,
+							 GCancellable	*cancellable,
+							 GError		**error);
+void		 urf_client_new_for_address_async	(const char	*address,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
 GQuark		 urf_client_error_quark			(void);
 GType		 urf_client_error_get_type		(void);
 
 /* generic */
 GList		*urf_client_get_devices			(UrfClient	*client);
+UrfDevice	*urf_client_get_device_by_path		(UrfClient	*client,
+							 const char	*object_path);
+UrfDevice	*urf_client_get_device_by_index		(UrfClient	*client,
+							 guint		 index);
 gboolean	 urf_client_set_block 			(UrfClient	*client,
 							 UrfDeviceType	 type,
 							 const gboolean	 block,
@@ -102,6 +138,34 @@ gboolean	 urf_client_set_block_idx 		(UrfClient	*client,
 							 const gboolean	 block,
 							 GCancellable	*cancellable,
 							 GError		**error);
+void		 urf_client_set_block_async		(UrfClient	*client,
+							 UrfDeviceType	 type,
+							 const gboolean	 block,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+gboolean	 urf_client_set_block_finish		(UrfClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 urf_client_set_block_idx_async		(UrfClient	*client,
+							 const guint	 index,
+							 const gboolean	 block,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+gboolean	 urf_client_set_block_idx_finish	(UrfClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 urf_client_set_block_idx_multiple_async (UrfClient	*client,
+							 const guint	*indices,
+							 guint		 n_indices,
+							 const gboolean	 block,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+gboolean	 urf_client_set_block_idx_multiple_finish (UrfClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
 gboolean	 urf_client_is_inhibited		(UrfClient	*client,
 							 GError		**error);
 guint		 urf_client_inhibit			(UrfClient	*client,
@@ -109,6 +173,13 @@ guint		 urf_client_inhibit			(UrfClient	*client,
 							 GError		**error);
 void		 urf_client_uninhibit			(UrfClient	*client,
 							 const guint	 cookie);
+guint		 urf_client_watch_type			(UrfClient	*client,
+							 UrfDeviceType	 type,
+							 UrfClientTypeFunc callback,
+							 gpointer	 user_data,
+							 GDestroyNotify	 notify);
+void		 urf_client_unwatch_type		(UrfClient	*client,
+							 guint		 watch_id);
 
 /* specific type */
 gboolean	 urf_client_set_wlan_block		(UrfClient	*client,
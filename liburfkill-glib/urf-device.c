@@ -34,18 +34,20 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <glib.h>
-#include <dbus/dbus-glib.h>
+#include <gio/gio.h>
 
 #include "urf-device.h"
+#include "urf-device-private.h"
 
 #define URF_DEVICE_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), \
 					URF_TYPE_DEVICE, UrfDevicePrivate))
 
+#define URFKILL_DBUS_NAME	"org.freedesktop.URfkill"
+#define URFKILL_DEVICE_INTERFACE "org.freedesktop.URfkill.Device"
+
 struct _UrfDevicePrivate
 {
-	DBusGConnection *bus;
-	DBusGProxy	*proxy;
-	DBusGProxy      *proxy_props;
+	GDBusProxy	*proxy;
 	char            *object_path;
 	guint            index;
 	guint            type;
@@ -53,6 +55,8 @@ struct _UrfDevicePrivate
 	gboolean         hard;
 	char            *name;
 	gboolean         platform;
+	guint            generation;
+	gboolean         resync_pending;
 };
 
 enum {
@@ -63,95 +67,275 @@ enum {
 	PROP_DEVICE_HARD,
 	PROP_DEVICE_NAME,
 	PROP_DEVICE_PLATFORM,
+	PROP_DEVICE_GENERATION,
 	PROP_LAST
 };
 
 G_DEFINE_TYPE (UrfDevice, urf_device, G_TYPE_OBJECT)
 
 /**
- * urf_device_get_device_properties:
+ * urf_device_update_property:
+ *
+ * Return value: #TRUE if the property is known
  **/
-static GHashTable *
-urf_device_get_device_properties (UrfDevice *device,
-				  GError    **error)
+static gboolean
+urf_device_update_property (UrfDevice  *device,
+			    const char *key,
+			    GVariant   *value)
 {
-	gboolean ret;
-	GError *error_local = NULL;
-	GHashTable *hash_table = NULL;
-
-	ret = dbus_g_proxy_call (device->priv->proxy_props, "GetAll", &error_local,
-				 G_TYPE_STRING, "org.freedesktop.URfkill.Device",
-				 G_TYPE_INVALID,
-				 dbus_g_type_get_map ("GHashTable", G_TYPE_STRING, G_TYPE_VALUE),
-				 &hash_table,
-				 G_TYPE_INVALID);
-	if (!ret) {
-		g_set_error (error, 1, 0, "Couldn't call GetAll() to get properties for %s: %s",
-			     device->priv->object_path, error_local->message);
-		g_error_free (error_local);
-		goto out;
-	}
-out:
-	return hash_table;
-}
+	UrfDevicePrivate *priv = device->priv;
 
-/**
- * urf_device_collect_props_cb:
- **/
-static void
-urf_device_collect_props_cb (const char   *key,
-			     const GValue *value,
-			     UrfDevice    *device)
-{
 	if (g_strcmp0 (key, "index") == 0) {
-		device->priv->index = g_value_get_uint (value);
+		priv->index = g_variant_get_uint32 (value);
 	} else if (g_strcmp0 (key, "type") == 0) {
-		device->priv->type = g_value_get_uint (value);
+		priv->type = g_variant_get_uint32 (value);
 	} else if (g_strcmp0 (key, "soft") == 0) {
-		device->priv->soft = g_value_get_boolean (value);
+		priv->soft = g_variant_get_boolean (value);
 	} else if (g_strcmp0 (key, "hard") == 0) {
-		device->priv->hard = g_value_get_boolean (value);
+		priv->hard = g_variant_get_boolean (value);
 	} else if (g_strcmp0 (key, "name") == 0) {
-		g_free (device->priv->name);
-		device->priv->name = g_strdup (g_value_get_string (value));
+		g_free (priv->name);
+		priv->name = g_variant_dup_string (value, NULL);
 	} else if (g_strcmp0 (key, "platform") == 0) {
-		device->priv->platform = g_value_get_boolean (value);
+		priv->platform = g_variant_get_boolean (value);
+	} else if (g_strcmp0 (key, "generation") == 0) {
+		priv->generation = g_variant_get_uint32 (value);
 	} else {
 		g_warning ("unhandled property '%s'", key);
+		return FALSE;
 	}
+
+	return TRUE;
 }
 
 /**
  * urf_device_refresh_private:
+ *
+ * Copy the properties the proxy fetched with GetAll()
  **/
 static gboolean
 urf_device_refresh_private (UrfDevice *device,
 			    GError    **error)
 {
-	GHashTable *hash;
-	GError *error_local = NULL;
-
-	/* get all the properties */
-	hash = urf_device_get_device_properties (device, &error_local);
-	if (hash == NULL) {
-		g_set_error (error, 1, 0, "Cannot get device properties for %s: %s",
-			     device->priv->object_path, error_local->message);
-		g_error_free (error_local);
+	UrfDevicePrivate *priv = device->priv;
+	char **keys;
+	GVariant *value;
+	guint i;
+
+	keys = g_dbus_proxy_get_cached_property_names (priv->proxy);
+	if (keys == NULL) {
+		g_set_error (error, 1, 0, "Cannot get device properties for %s",
+			     priv->object_path);
 		return FALSE;
 	}
-	g_hash_table_foreach (hash, (GHFunc) urf_device_collect_props_cb, device);
-	g_hash_table_unref (hash);
+
+	for (i = 0; keys[i] != NULL; i++) {
+		value = g_dbus_proxy_get_cached_property (priv->proxy, keys[i]);
+		urf_device_update_property (device, keys[i], value);
+		g_variant_unref (value);
+	}
+	g_strfreev (keys);
+
 	return TRUE;
 }
 
 /**
- * urf_device_changed_cb:
+ * urf_device_apply_properties:
+ **/
+static void
+urf_device_apply_properties (UrfDevice *device,
+			     GVariant  *properties)
+{
+	GVariantIter iter;
+	const char *key;
+	GVariant *value;
+
+	g_object_freeze_notify (G_OBJECT (device));
+	g_variant_iter_init (&iter, properties);
+	while (g_variant_iter_next (&iter, "{&sv}", &key, &value)) {
+		if (urf_device_update_property (device, key, value))
+			g_object_notify (G_OBJECT (device), key);
+		g_variant_unref (value);
+	}
+	g_object_thaw_notify (G_OBJECT (device));
+}
+
+/**
+ * urf_device_resync_cb:
+ **/
+static void
+urf_device_resync_cb (GObject      *source_object,
+		      GAsyncResult *res,
+		      gpointer      user_data)
+{
+	UrfDevice *device = URF_DEVICE (user_data);
+	UrfDevicePrivate *priv = device->priv;
+	GVariant *reply;
+	GVariant *properties;
+	GVariantIter iter;
+	const char *key;
+	GVariant *value;
+	GError *error = NULL;
+
+	priv->resync_pending = FALSE;
+
+	reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object),
+					       res, &error);
+	if (reply == NULL) {
+		g_warning ("Couldn't resync %s: %s", priv->object_path, error->message);
+		g_error_free (error);
+		goto out;
+	}
+
+	properties = g_variant_get_child_value (reply, 0);
+
+	/* keep the cache of the proxy in step with ours */
+	if (priv->proxy != NULL) {
+		g_variant_iter_init (&iter, properties);
+		while (g_variant_iter_next (&iter, "{&sv}", &key, &value)) {
+			g_dbus_proxy_set_cached_property (priv->proxy, key, value);
+			g_variant_unref (value);
+		}
+	}
+
+	urf_device_apply_properties (device, properties);
+	g_variant_unref (properties);
+	g_variant_unref (reply);
+out:
+	g_object_unref (device);
+}
+
+/**
+ * urf_device_resync:
+ *
+ * Fetch all properties in one call after an update was missed
  **/
 static void
-urf_device_changed_cb (DBusGProxy *proxy,
-		       UrfDevice  *device)
+urf_device_resync (UrfDevice *device)
+{
+	UrfDevicePrivate *priv = device->priv;
+
+	if (priv->resync_pending)
+		return;
+	priv->resync_pending = TRUE;
+
+	g_dbus_connection_call (g_dbus_proxy_get_connection (priv->proxy),
+				g_dbus_proxy_get_name (priv->proxy),
+				priv->object_path,
+				"org.freedesktop.DBus.Properties",
+				"GetAll",
+				g_variant_new ("(s)", URFKILL_DEVICE_INTERFACE),
+				G_VARIANT_TYPE ("(a{sv})"),
+				G_DBUS_CALL_FLAGS_NONE,
+				-1, NULL,
+				urf_device_resync_cb,
+				g_object_ref (device));
+}
+
+/**
+ * urf_device_properties_changed_cb:
+ **/
+static void
+urf_device_properties_changed_cb (GDBusProxy *proxy,
+				  GVariant   *changed_properties,
+				  GStrv       invalidated_properties,
+				  UrfDevice  *device)
+{
+	UrfDevicePrivate *priv = device->priv;
+	GVariant *value;
+	guint generation;
+
+	/* the reply of GetAll supersedes everything before it */
+	if (priv->resync_pending)
+		return;
+
+	value = g_variant_lookup_value (changed_properties, "generation",
+					G_VARIANT_TYPE_UINT32);
+	if (value != NULL) {
+		generation = g_variant_get_uint32 (value);
+		g_variant_unref (value);
+
+		/* our copy is already current */
+		if (generation <= priv->generation)
+			return;
+
+		/* missed an update, the other states may be stale too */
+		if (generation != priv->generation + 1) {
+			g_debug ("%s: generation %u after %u, resyncing",
+				 priv->object_path, generation, priv->generation);
+			urf_device_resync (device);
+			return;
+		}
+	}
+
+	urf_device_apply_properties (device, changed_properties);
+}
+
+/**
+ * urf_device_set_proxy:
+ **/
+static gboolean
+urf_device_set_proxy (UrfDevice   *device,
+		      GDBusProxy  *proxy,
+		      GError     **error)
 {
-	urf_device_refresh_private (device, NULL);
+	UrfDevicePrivate *priv = device->priv;
+
+	priv->proxy = proxy;
+	priv->object_path = g_strdup (g_dbus_proxy_get_object_path (proxy));
+
+	/* the daemon sends PropertiesChanged before Changed */
+	g_signal_connect (priv->proxy, "g-properties-changed",
+			  G_CALLBACK (urf_device_properties_changed_cb), device);
+
+	return urf_device_refresh_private (device, error);
+}
+
+/**
+ * _urf_device_new_for_proxy:
+ * @proxy: a proxy of the device, the reference is taken over
+ *
+ * Creates a device from a proxy of the object manager in #UrfClient
+ * whose properties are already cached.
+ *
+ * Return value: a new #UrfDevice object.
+ **/
+UrfDevice *
+_urf_device_new_for_proxy (GDBusProxy *proxy)
+{
+	UrfDevice *device;
+	GError *error = NULL;
+
+	device = urf_device_new ();
+	if (!urf_device_set_proxy (device, proxy, &error)) {
+		g_warning ("%s", error->message);
+		g_error_free (error);
+	}
+
+	return device;
+}
+
+/**
+ * urf_device_check_object_path:
+ **/
+static gboolean
+urf_device_check_object_path (UrfDevice   *device,
+			      const char  *object_path,
+			      GError     **error)
+{
+	if (device->priv->proxy != NULL) {
+		g_set_error (error, 1, 0, "Object path already set to %s",
+			     device->priv->object_path);
+		return FALSE;
+	}
+
+	/* invalid */
+	if (object_path == NULL || !g_variant_is_object_path (object_path)) {
+		g_set_error (error, 1, 0, "Object path %s invalid", object_path);
+		return FALSE;
+	}
+
+	return TRUE;
 }
 
 /**
@@ -173,70 +357,122 @@ urf_device_set_object_path_sync (UrfDevice    *device,
 				 GCancellable *cancellable,
 				 GError       **error)
 {
-	UrfDevicePrivate *priv = device->priv;
-	GError *error_local = NULL;
-	gboolean ret = FALSE;
-	DBusGProxy *proxy_props;
+	GDBusProxy *proxy;
 
 	g_return_val_if_fail (URF_IS_DEVICE (device), FALSE);
 
-	if (device->priv->object_path != NULL)
+	if (!urf_device_check_object_path (device, object_path, error))
 		return FALSE;
-	if (object_path == NULL)
+
+	proxy = g_dbus_proxy_new_for_bus_sync (G_BUS_TYPE_SYSTEM,
+					       G_DBUS_PROXY_FLAGS_NONE,
+					       NULL,
+					       URFKILL_DBUS_NAME,
+					       object_path,
+					       URFKILL_DEVICE_INTERFACE,
+					       cancellable,
+					       error);
+	if (proxy == NULL)
 		return FALSE;
 
-	/* invalid */
-	if (object_path == NULL || object_path[0] != '/') {
-		g_set_error (error, 1, 0, "Object path %s invalid", object_path);
-		goto out;
-	}
+	return urf_device_set_proxy (device, proxy, error);
+}
 
-	/* connect to the bus */
-	priv->bus = dbus_g_bus_get (DBUS_BUS_SYSTEM, &error_local);
-	if (priv->bus == NULL) {
-		g_set_error (error, 1, 0, "Couldn't connect to system bus: %s", error_local->message);
-		g_error_free (error_local);
-		goto out;
-	}
+/**
+ * urf_device_proxy_new_cb:
+ **/
+static void
+urf_device_proxy_new_cb (GObject      *source_object,
+			 GAsyncResult *res,
+			 gpointer      user_data)
+{
+	GSimpleAsyncResult *result = G_SIMPLE_ASYNC_RESULT (user_data);
+	UrfDevice *device;
+	GDBusProxy *proxy;
+	GError *error = NULL;
 
-	/* connect to the correct path for properties */
-	proxy_props = dbus_g_proxy_new_for_name (priv->bus,
-						 "org.freedesktop.URfkill",
-						 object_path,
-						 "org.freedesktop.DBus.Properties");
-	if (proxy_props == NULL) {
-		g_set_error_literal (error, 1, 0, "Couldn't connect to proxy");
-		goto out;
-	}
+	device = URF_DEVICE (g_async_result_get_source_object (G_ASYNC_RESULT (result)));
 
-	priv->proxy = dbus_g_proxy_new_for_name (priv->bus,
-						 "org.freedesktop.URfkill",
-						 object_path,
-						 "org.freedesktop.URfkill.Device");
-	if (priv->proxy == NULL) {
-		g_set_error_literal (error, 1, 0, "Couldn't connect to proxy");
-		goto out;
-	}
+	proxy = g_dbus_proxy_new_for_bus_finish (res, &error);
+	if (proxy == NULL || !urf_device_set_proxy (device, proxy, &error))
+		g_simple_async_result_take_error (result, error);
 
-        device->priv->proxy_props = proxy_props;
-        device->priv->object_path = g_strdup (object_path);
+	g_simple_async_result_complete (result);
+	g_object_unref (result);
+	g_object_unref (device);
+}
 
-	ret = urf_device_refresh_private (device, &error_local);
+/**
+ * urf_device_set_object_path:
+ * @device: a #UrfDevice instance
+ * @object_path: the #UrfDevice object path
+ * @cancellable: a #GCancellable or %NULL
+ * @callback: a #GAsyncReadyCallback to call when the properties are fetched
+ * @user_data: the data to pass to @callback
+ *
+ * Asynchronously set the object path of the object and fill up the
+ * initial properties. Several devices can be set up at the same time,
+ * their property requests are sent together. Changes of the device are
+ * delivered in the thread-default main context of the caller.
+ *
+ * Since: 0.3.0
+ **/
+void
+urf_device_set_object_path (UrfDevice           *device,
+			    const char          *object_path,
+			    GCancellable        *cancellable,
+			    GAsyncReadyCallback  callback,
+			    gpointer             user_data)
+{
+	GSimpleAsyncResult *result;
+	GError *error = NULL;
 
-	if (!ret) {
-		g_set_error (error, 1, 0, "cannot refresh: %s", error_local->message);
-		g_error_free (error_local);
+	g_return_if_fail (URF_IS_DEVICE (device));
+
+	result = g_simple_async_result_new (G_OBJECT (device), callback, user_data,
+					    urf_device_set_object_path);
+
+	if (!urf_device_check_object_path (device, object_path, &error)) {
+		g_simple_async_result_take_error (result, error);
+		g_simple_async_result_complete_in_idle (result);
+		g_object_unref (result);
+		return;
 	}
 
-	/* connect signals */
-	dbus_g_proxy_add_signal (priv->proxy, "Changed",
-				 G_TYPE_INVALID);
+	g_dbus_proxy_new_for_bus (G_BUS_TYPE_SYSTEM,
+				  G_DBUS_PROXY_FLAGS_NONE,
+				  NULL,
+				  URFKILL_DBUS_NAME,
+				  object_path,
+				  URFKILL_DEVICE_INTERFACE,
+				  cancellable,
+				  urf_device_proxy_new_cb,
+				  result);
+}
 
-	/* callbacks */
-	dbus_g_proxy_connect_signal (priv->proxy, "Changed",
-				     G_CALLBACK (urf_device_changed_cb), device, NULL);
-out:
-	return ret;
+/**
+ * urf_device_set_object_path_finish:
+ * @device: a #UrfDevice instance
+ * @res: the #GAsyncResult passed to the callback
+ * @error: a #GError, or %NULL
+ *
+ * Finish an operation started with urf_device_set_object_path().
+ *
+ * Return value: #TRUE for success, else #FALSE and @error is used
+ *
+ * Since: 0.3.0
+ **/
+gboolean
+urf_device_set_object_path_finish (UrfDevice     *device,
+				   GAsyncResult  *res,
+				   GError       **error)
+{
+	GSimpleAsyncResult *result = G_SIMPLE_ASYNC_RESULT (res);
+
+	g_return_val_if_fail (g_simple_async_result_is_valid (res, G_OBJECT (device),
+							      urf_device_set_object_path), FALSE);
+
+	return !g_simple_async_result_propagate_error (result, error);
 }
 
 /**
@@ -288,12 +524,34 @@ urf_device_get_property (GObject    *object,
 	case PROP_DEVICE_PLATFORM:
 		g_value_set_boolean (value, priv->platform);
 		break;
+	case PROP_DEVICE_GENERATION:
+		g_value_set_uint (value, priv->generation);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
 	}
 }
 
+/**
+ * urf_device_dispose:
+ **/
+static void
+urf_device_dispose (GObject *object)
+{
+	UrfDevicePrivate *priv = URF_DEVICE (object)->priv;
+
+	if (priv->proxy) {
+		g_signal_handlers_disconnect_by_func (priv->proxy,
+						      urf_device_properties_changed_cb,
+						      object);
+		g_object_unref (priv->proxy);
+		priv->proxy = NULL;
+	}
+
+	G_OBJECT_CLASS(urf_device_parent_class)->dispose(object);
+}
+
 /**
  * urf_device_finalize:
  **/
@@ -324,6 +582,7 @@ urf_device_class_init(UrfDeviceClass *klass)
 
 	g_type_class_add_private(klass, sizeof(UrfDevicePrivate));
 	object_class->get_property = urf_device_get_property;
+	object_class->dispose = urf_device_dispose;
 	object_class->finalize = urf_device_finalize;
 
 	/**
@@ -405,6 +664,20 @@ urf_device_class_init(UrfDeviceClass *klass)
 				      FALSE,
 				      G_PARAM_READABLE);
 	g_object_class_install_property (object_class, PROP_DEVICE_PLATFORM, pspec);
+
+	/**
+	 * UrfDevice:generation:
+	 *
+	 * The generation of the block states. It grows by one with every
+	 * change, and a missed change is fetched again automatically.
+	 *
+	 * Since: 0.3.0
+	 */
+	pspec = g_param_spec_uint ("generation",
+				   "Generation", "The generation of the block states",
+				   0, G_MAXUINT, 0,
+				   G_PARAM_READABLE);
+	g_object_class_install_property (object_class, PROP_DEVICE_GENERATION, pspec);
 }
 
 /**
@@ -415,6 +688,9 @@ static void
 urf_device_init (UrfDevice *device)
 {
 	device->priv = URF_DEVICE_GET_PRIVATE (device);
+	device->priv->proxy = NULL;
+	device->priv->generation = 0;
+	device->priv->resync_pending = FALSE;
 	device->priv->name = NULL;
 	device->priv->object_path = NULL;
 }
@@ -102,6 +102,16 @@ gboolean		 urf_device_set_object_path_sync	(UrfDevice	*device,
 								 GCancellable	*cancellable,
 								 GError		**error);
 
+/* async versions */
+void			 urf_device_set_object_path		(UrfDevice	*device,
+								 const char	*object_path,
+								 GCancellable	*cancellable,
+								 GAsyncReadyCallback callback,
+								 gpointer	 user_data);
+gboolean		 urf_device_set_object_path_finish	(UrfDevice	*device,
+								 GAsyncResult	*res,
+								 GError		**error);
+
 /* accessors */
 const char		*urf_device_get_object_path		(UrfDevice	*device);
 
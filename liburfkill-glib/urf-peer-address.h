@@ -0,0 +1,36 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Name of the private socket of urfkilld. It is shared between the
+ * daemon and liburfkill-glib and is not installed.
+ */
+
+#ifndef __URF_PEER_ADDRESS_H
+#define __URF_PEER_ADDRESS_H
+
+#include "urf-state-format.h"
+
+/* in the runtime directory */
+#define URF_PEER_SOCKET_NAME		"socket"
+
+#endif /* __URF_PEER_ADDRESS_H */
+
@@ -0,0 +1,91 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Layout of the state file published by urfkilld. It is shared between
+ * the daemon and liburfkill-glib and is not installed.
+ */
+
+#ifndef __URF_STATE_FORMAT_H
+#define __URF_STATE_FORMAT_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * urfkilld keeps its state file and its socket in the runtime directory,
+ * /run/urfkill unless it was started with --runtime-dir. Clients find
+ * such an instance through $URFKILL_RUNTIME_DIR.
+ */
+#define URF_RUNTIME_DIR			"/run/urfkill"
+#define URF_RUNTIME_DIR_ENV		"URFKILL_RUNTIME_DIR"
+
+/* in the runtime directory */
+#define URF_STATE_FILE_NAME		"state"
+
+#define URF_STATE_FILE_MAGIC		0x53465255	/* "URFS" */
+#define URF_STATE_FILE_VERSION		1
+#define URF_STATE_FILE_MAX_DEVICES	64
+#define URF_STATE_FILE_MAX_TYPES	16
+
+typedef struct {
+	guint32		 index;
+	guint32		 type;
+	guint8		 soft;
+	guint8		 hard;
+	guint8		 platform;
+	guint8		 reserved;
+} UrfStateFileDevice;
+
+/*
+ * The daemon increments sequence before and after every update, so it is
+ * odd while the data is being written. Readers copy the data and retry if
+ * sequence was odd or has changed in the meantime.
+ */
+typedef struct {
+	guint32		 magic;
+	guint32		 version;
+	gint		 sequence;
+	guint32		 n_devices;
+	gint32		 type_state[URF_STATE_FILE_MAX_TYPES];
+	UrfStateFileDevice devices[URF_STATE_FILE_MAX_DEVICES];
+} UrfStateFileData;
+
+/**
+ * urf_runtime_path:
+ *
+ * Return value: @name in the runtime directory of the clients, g_free() it
+ **/
+static inline char *
+urf_runtime_path (const char *name)
+{
+	const char *dir = g_getenv (URF_RUNTIME_DIR_ENV);
+
+	if (dir == NULL || dir[0] == '\0')
+		dir = URF_RUNTIME_DIR;
+	return g_build_filename (dir, name, NULL);
+}
+
+G_END_DECLS
+
+#endif /* __URF_STATE_FORMAT_H */
+
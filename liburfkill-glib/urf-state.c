@@ -0,0 +1,433 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * SECTION:urf-state
+ * @short_description: Lock-free reader of the state file of urfkilld
+ * @title: UrfState
+ * @include: urfkill.h
+ * @see_also: #UrfClient
+ *
+ * urfkilld publishes the states of all rfkill devices in a small file
+ * that is updated in place on every change. #UrfState maps the file and
+ * reads consistent snapshots of it without talking to the daemon, which
+ * makes it suitable for applets that only need to show the states.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "urf-state.h"
+#include "urf-state-format.h"
+
+#define URF_STATE_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), \
+					URF_TYPE_STATE, UrfStatePrivate))
+
+/* how often to retry while the daemon keeps writing */
+#define URF_STATE_MAX_RETRIES	1000
+
+struct _UrfStatePrivate
+{
+	int			 fd;
+	const UrfStateFileData	*data;
+	UrfStateFileData	 snapshot;
+	gboolean		 have_snapshot;
+	GFileMonitor		*monitor;
+};
+
+enum {
+	URF_STATE_CHANGED,
+	URF_STATE_LAST_SIGNAL
+};
+
+static guint signals [URF_STATE_LAST_SIGNAL] = { 0 };
+
+G_DEFINE_TYPE (UrfState, urf_state, G_TYPE_OBJECT)
+
+/**
+ * urf_state_refresh:
+ * @state: a #UrfState instance
+ *
+ * Take a new snapshot of the state file. This is only a memory copy and
+ * never blocks on the daemon.
+ *
+ * Return value: #TRUE if the states have changed since the last snapshot
+ *
+ * Since: 0.3.0
+ **/
+gboolean
+urf_state_refresh (UrfState *state)
+{
+	UrfStatePrivate *priv;
+	gint *sequence;
+	gint begin, end;
+	guint i;
+
+	g_return_val_if_fail (URF_IS_STATE (state), FALSE);
+
+	priv = state->priv;
+	if (priv->data == NULL)
+		return FALSE;
+
+	sequence = (gint *) &priv->data->sequence;
+
+	for (i = 0; i < URF_STATE_MAX_RETRIES; i++) {
+		begin = g_atomic_int_get (sequence);
+		if (begin & 1)
+			continue;
+
+		/* nothing new */
+		if (priv->have_snapshot && begin == priv->snapshot.sequence)
+			return FALSE;
+
+		__sync_synchronize ();
+		memcpy (&priv->snapshot, priv->data, sizeof (UrfStateFileData));
+		__sync_synchronize ();
+
+		end = g_atomic_int_get (sequence);
+		if (begin == end) {
+			priv->snapshot.sequence = begin;
+			priv->have_snapshot = TRUE;
+			return TRUE;
+		}
+	}
+
+	g_warning ("the state file is being updated, try again later");
+	return FALSE;
+}
+
+/**
+ * urf_state_get_generation:
+ * @state: a #UrfState instance
+ *
+ * Get the generation of the current snapshot. It grows with every change
+ * the daemon publishes.
+ *
+ * Return value: the generation of the snapshot
+ *
+ * Since: 0.3.0
+ **/
+guint
+urf_state_get_generation (UrfState *state)
+{
+	g_return_val_if_fail (URF_IS_STATE (state), 0);
+
+	return ((guint) state->priv->snapshot.sequence) / 2;
+}
+
+/**
+ * urf_state_get_n_devices:
+ * @state: a #UrfState instance
+ *
+ * Get the number of devices in the current snapshot.
+ *
+ * Return value: the number of devices
+ *
+ * Since: 0.3.0
+ **/
+guint
+urf_state_get_n_devices (UrfState *state)
+{
+	g_return_val_if_fail (URF_IS_STATE (state), 0);
+
+	return MIN (state->priv->snapshot.n_devices, URF_STATE_FILE_MAX_DEVICES);
+}
+
+/**
+ * urf_state_get_device:
+ * @state: a #UrfState instance
+ * @n: the position of the device in the snapshot
+ * @index: (out) (allow-none): the index of the device
+ * @type: (out) (allow-none): the type of the device
+ * @soft: (out) (allow-none): whether the soft block is on
+ * @hard: (out) (allow-none): whether the hard block is on
+ *
+ * Get the states of a device in the current snapshot.
+ *
+ * Return value: #TRUE if there is a device at @n
+ *
+ * Since: 0.3.0
+ **/
+gboolean
+urf_state_get_device (UrfState      *state,
+		      guint          n,
+		      guint         *index,
+		      UrfDeviceType *type,
+		      gboolean      *soft,
+		      gboolean      *hard)
+{
+	const UrfStateFileDevice *entry;
+
+	g_return_val_if_fail (URF_IS_STATE (state), FALSE);
+
+	if (n >= urf_state_get_n_devices (state))
+		return FALSE;
+
+	entry = &state->priv->snapshot.devices[n];
+	if (index != NULL)
+		*index = entry->index;
+	if (type != NULL)
+		*type = entry->type;
+	if (soft != NULL)
+		*soft = entry->soft;
+	if (hard != NULL)
+		*hard = entry->hard;
+
+	return TRUE;
+}
+
+/**
+ * urf_state_get_type_state:
+ * @state: a #UrfState instance
+ * @type: the type of the devices
+ *
+ * Get the aggregated state of the devices of @type as the daemon uses it
+ * for the rfkill keys.
+ *
+ * Return value: the #UrfKillswitchState of @type
+ *
+ * Since: 0.3.0
+ **/
+UrfKillswitchState
+urf_state_get_type_state (UrfState      *state,
+			  UrfDeviceType  type)
+{
+	g_return_val_if_fail (URF_IS_STATE (state), URF_KILLSWITCH_STATE_NO_ADAPTER);
+
+	if (!state->priv->have_snapshot || type >= URF_STATE_FILE_MAX_TYPES)
+		return URF_KILLSWITCH_STATE_NO_ADAPTER;
+
+	return state->priv->snapshot.type_state[type];
+}
+
+/**
+ * urf_state_monitor_changed_cb:
+ **/
+static void
+urf_state_monitor_changed_cb (GFileMonitor      *monitor,
+			      GFile             *file,
+			      GFile             *other_file,
+			      GFileMonitorEvent  event_type,
+			      UrfState          *state)
+{
+	if (event_type != G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED &&
+	    event_type != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT)
+		return;
+
+	if (urf_state_refresh (state))
+		g_signal_emit (state, signals [URF_STATE_CHANGED], 0);
+}
+
+/**
+ * urf_state_open:
+ * @state: a #UrfState instance
+ * @path: the path of the state file, or %NULL for the one in
+ *        $URFKILL_RUNTIME_DIR or /run/urfkill
+ * @error: a #GError, or %NULL
+ *
+ * Map the state file and take the first snapshot. The file is watched
+ * afterwards and #UrfState::changed is emitted in the thread-default
+ * main context whenever the daemon publishes new states.
+ *
+ * Return value: #TRUE for success, else #FALSE and @error is used
+ *
+ * Since: 0.3.0
+ **/
+gboolean
+urf_state_open (UrfState    *state,
+		const char  *path,
+		GError     **error)
+{
+	UrfStatePrivate *priv;
+	const UrfStateFileData *data;
+	struct stat st;
+	GFile *file;
+	GError *error_local = NULL;
+	char *default_path = NULL;
+	gboolean ret = FALSE;
+	void *map;
+	int fd;
+
+	g_return_val_if_fail (URF_IS_STATE (state), FALSE);
+
+	priv = state->priv;
+	g_return_val_if_fail (priv->data == NULL, FALSE);
+
+	if (path == NULL)
+		path = default_path = urf_runtime_path (URF_STATE_FILE_NAME);
+
+	fd = open (path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+			     "Cannot open %s: %s", path, g_strerror (errno));
+		goto out;
+	}
+
+	if (fstat (fd, &st) < 0 || st.st_size < (off_t) sizeof (UrfStateFileData)) {
+		g_set_error (error, 1, 0, "%s is not a state file", path);
+		close (fd);
+		goto out;
+	}
+
+	map = mmap (NULL, sizeof (UrfStateFileData), PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+			     "Cannot map %s: %s", path, g_strerror (errno));
+		close (fd);
+		goto out;
+	}
+
+	data = map;
+	if (data->magic != URF_STATE_FILE_MAGIC ||
+	    data->version != URF_STATE_FILE_VERSION) {
+		g_set_error (error, 1, 0, "%s has an unknown format", path);
+		munmap (map, sizeof (UrfStateFileData));
+		close (fd);
+		goto out;
+	}
+
+	priv->fd = fd;
+	priv->data = data;
+	urf_state_refresh (state);
+
+	/* polling with urf_state_refresh() still works without the monitor */
+	file = g_file_new_for_path (path);
+	priv->monitor = g_file_monitor_file (file, G_FILE_MONITOR_NONE, NULL, &error_local);
+	if (priv->monitor != NULL) {
+		g_signal_connect (priv->monitor, "changed",
+				  G_CALLBACK (urf_state_monitor_changed_cb), state);
+	} else {
+		g_warning ("Cannot monitor %s: %s", path, error_local->message);
+		g_error_free (error_local);
+	}
+	g_object_unref (file);
+
+	ret = TRUE;
+out:
+	g_free (default_path);
+	return ret;
+}
+
+/**
+ * urf_state_dispose:
+ **/
+static void
+urf_state_dispose (GObject *object)
+{
+	UrfStatePrivate *priv = URF_STATE (object)->priv;
+
+	if (priv->monitor) {
+		g_signal_handlers_disconnect_by_func (priv->monitor,
+						      urf_state_monitor_changed_cb,
+						      object);
+		g_file_monitor_cancel (priv->monitor);
+		g_object_unref (priv->monitor);
+		priv->monitor = NULL;
+	}
+
+	G_OBJECT_CLASS(urf_state_parent_class)->dispose(object);
+}
+
+/**
+ * urf_state_finalize:
+ **/
+static void
+urf_state_finalize (GObject *object)
+{
+	UrfStatePrivate *priv = URF_STATE (object)->priv;
+
+	if (priv->data)
+		munmap ((void *) priv->data, sizeof (UrfStateFileData));
+	if (priv->fd >= 0)
+		close (priv->fd);
+
+	G_OBJECT_CLASS(urf_state_parent_class)->finalize(object);
+}
+
+/**
+ * urf_state_class_init:
+ * @klass: The UrfStateClass
+ **/
+static void
+urf_state_class_init (UrfStateClass *klass)
+{
+	GObjectClass *object_class = (GObjectClass *) klass;
+
+	g_type_class_add_private (klass, sizeof (UrfStatePrivate));
+	object_class->dispose = urf_state_dispose;
+	object_class->finalize = urf_state_finalize;
+
+	/**
+	 * UrfState::changed:
+	 * @state: the #UrfState instance that emitted the signal
+	 *
+	 * The changed signal is emitted when a new snapshot with different
+	 * states has been taken from the state file.
+	 *
+	 * Since 0.3.0
+	 **/
+	signals[URF_STATE_CHANGED] =
+		g_signal_new ("changed",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (UrfStateClass, changed),
+			      NULL, NULL, g_cclosure_marshal_VOID__VOID,
+			      G_TYPE_NONE, 0);
+}
+
+/**
+ * urf_state_init:
+ * @state: This class instance
+ **/
+static void
+urf_state_init (UrfState *state)
+{
+	state->priv = URF_STATE_GET_PRIVATE (state);
+	state->priv->fd = -1;
+	state->priv->data = NULL;
+	state->priv->have_snapshot = FALSE;
+	state->priv->monitor = NULL;
+}
+
+/**
+ * urf_state_new:
+ *
+ * Creates a new #UrfState object. Call urf_state_open() to map the
+ * state file.
+ *
+ * Return value: a new #UrfState object.
+ *
+ * Since: 0.3.0
+ **/
+UrfState *
+urf_state_new (void)
+{
+	UrfState *state;
+	state = URF_STATE (g_object_new (URF_TYPE_STATE, NULL));
+	return state;
+}
@@ -0,0 +1,110 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#if !defined (__URFKILL_H_INSIDE__) && !defined (URF_COMPILATION)
+#error "Only <urfkill.h> can be included directly."
+#endif
+
+#ifndef __URF_STATE_H
+#define __URF_STATE_H
+
+#include <glib-object.h>
+
+#include "urf-device.h"
+
+G_BEGIN_DECLS
+
+/**
+ * UrfKillswitchState:
+ * @URF_KILLSWITCH_STATE_NO_ADAPTER: there is no device of the type
+ * @URF_KILLSWITCH_STATE_SOFT_BLOCKED: the devices are blocked by software
+ * @URF_KILLSWITCH_STATE_UNBLOCKED: the devices are not blocked
+ * @URF_KILLSWITCH_STATE_HARD_BLOCKED: the devices are blocked by hardware
+ *
+ * The aggregated state of the devices of one type
+ */
+typedef enum {
+	URF_KILLSWITCH_STATE_NO_ADAPTER = -1,
+	URF_KILLSWITCH_STATE_SOFT_BLOCKED = 0,
+	URF_KILLSWITCH_STATE_UNBLOCKED,
+	URF_KILLSWITCH_STATE_HARD_BLOCKED
+} UrfKillswitchState;
+
+#define URF_TYPE_STATE		(urf_state_get_type ())
+#define URF_STATE(o)		(G_TYPE_CHECK_INSTANCE_CAST ((o), URF_TYPE_STATE, UrfState))
+#define URF_STATE_CLASS(k)	(G_TYPE_CHECK_CLASS_CAST((k), URF_TYPE_STATE, UrfStateClass))
+#define URF_IS_STATE(o)		(G_TYPE_CHECK_INSTANCE_TYPE ((o), URF_TYPE_STATE))
+#define URF_IS_STATE_CLASS(k)	(G_TYPE_CHECK_CLASS_TYPE ((k), URF_TYPE_STATE))
+#define URF_STATE_GET_CLASS(o)	(G_TYPE_INSTANCE_GET_CLASS ((o), URF_TYPE_STATE, UrfStateClass))
+
+typedef struct _UrfState UrfState;
+typedef struct _UrfStateClass UrfStateClass;
+typedef struct _UrfStatePrivate UrfStatePrivate;
+
+/**
+ * UrfState:
+ *
+ * The UrfState struct contains only private fields
+ * and should not be directly accessed.
+ */
+struct _UrfState
+{
+	/*< private >*/
+	GObject			 parent;
+	UrfStatePrivate		*priv;
+};
+
+/**
+ * UrfStateClass:
+ *
+ * Class structure for #UrfState
+ **/
+struct _UrfStateClass
+{
+	/*< private>*/
+	GObjectClass		 parent_class;
+	void			(*changed)			(UrfState	*state);
+};
+
+/* general */
+GType			 urf_state_get_type			(void);
+UrfState		*urf_state_new				(void);
+gboolean		 urf_state_open				(UrfState	*state,
+								 const char	*path,
+								 GError		**error);
+gboolean		 urf_state_refresh			(UrfState	*state);
+
+/* accessors */
+guint			 urf_state_get_generation		(UrfState	*state);
+guint			 urf_state_get_n_devices		(UrfState	*state);
+gboolean		 urf_state_get_device			(UrfState	*state,
+								 guint		 n,
+								 guint		*index,
+								 UrfDeviceType	*type,
+								 gboolean	*soft,
+								 gboolean	*hard);
+UrfKillswitchState	 urf_state_get_type_state		(UrfState	*state,
+								 UrfDeviceType	 type);
+
+G_END_DECLS
+
+#endif /* __URF_STATE_H */
+
@@ -27,6 +27,7 @@
 #include <liburfkill-glib/urf-version.h>
 #include <liburfkill-glib/urf-client.h>
 #include <liburfkill-glib/urf-device.h>
+#include <liburfkill-glib/urf-state.h>
 
 #undef __URFKILL_H_INSIDE__
 
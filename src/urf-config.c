@@ -29,6 +29,10 @@
 #include <sys/stat.h>
 #include "urf-utils.h"
 #include "urf-config.h"
+#include "urf-log.h"
+#include "urf-startup.h"
+
+#include "liburfkill-glib/urf-state-format.h"
 
 #define URFKILL_PROFILE_DIR URFKILL_CONFIG_DIR"profile/"
 #define URFKILL_CONFIGURED_PROFILE URFKILL_CONFIG_DIR"hardware.conf"
@@ -85,6 +89,11 @@ typedef struct {
                                      URF_TYPE_CONFIG, UrfConfigPrivate))
 struct UrfConfigPrivate {
 	char 	*user;
+	char	*rfkill_backend;
+	char	*trace_file;
+	char	*metrics_file;
+	char	*runtime_dir;
+	gboolean watch_main_loop;
 	Options	 options;
 };
 
@@ -404,7 +413,7 @@ profile_xml_parse (DmiInfo    *hardware_info,
 	int len;
 
 	if (!g_file_get_contents (filename, &content, &length, NULL)) {
-		g_debug ("Failed to read profile: %s", filename);
+		urf_debug ("Failed to read profile: %s", filename);
 		return FALSE;
 	}
 
@@ -428,7 +437,7 @@ profile_xml_parse (DmiInfo    *hardware_info,
 	len = strlen (content);
 
 	if (XML_Parse (parser, content, len, 1) == XML_STATUS_ERROR) {
-		g_warning ("Profile Parse error: %s", filename);
+		urf_warning ("Profile Parse error: %s", filename);
 		XML_ParserFree (parser);
 		g_free (info);
 		return FALSE;
@@ -457,13 +466,13 @@ load_configured_settings (UrfConfig *config)
 					 G_KEY_FILE_NONE,
 					 NULL);
 	if (!ret) {
-		g_debug ("No configured profile found");
+		urf_debug ("No configured profile found");
 		g_key_file_free (profile);
 		return FALSE;
 	}
 
 	if (!g_key_file_has_group (profile, "Profile")) {
-		g_debug ("No valid group in the configured profile");
+		urf_debug ("No valid group in the configured profile");
 		return FALSE;
 	}
 
@@ -494,9 +503,8 @@ load_configured_settings (UrfConfig *config)
 }
 
 static void
-save_configured_profile (UrfConfig *config)
+save_configured_profile (const Options *options)
 {
-	UrfConfigPrivate *priv = config->priv;
 	GKeyFile *profile;
 	gboolean ret, value;
 	const char *header = "# DO NOT EDIT! This file is created by urfkilld automatically.\n";
@@ -517,15 +525,15 @@ save_configured_profile (UrfConfig *config)
 		return;
 	}
 
-	value = priv->options.key_control;
+	value = options->key_control;
 	g_key_file_set_value (profile, "Profile", "key_control",
 			      value?"true":"false");
 
-	value = priv->options.master_key;
+	value = options->master_key;
 	g_key_file_set_value (profile, "Profile", "master_key",
 			      value?"true":"false");
 
-	value = priv->options.force_sync;
+	value = options->force_sync;
 	g_key_file_set_value (profile, "Profile", "force_sync",
 			      value?"true":"false");
 
@@ -537,8 +545,8 @@ save_configured_profile (UrfConfig *config)
 		ret = g_file_set_contents (URFKILL_CONFIGURED_PROFILE,
 					   content, -1, NULL);
 		if (!ret)
-			g_debug ("Failed to save configured profile: %s",
-				 URFKILL_CONFIGURED_PROFILE);
+			urf_debug ("Failed to save configured profile: %s",
+				   URFKILL_CONFIGURED_PROFILE);
 		g_free (content);
 		g_chmod (URFKILL_CONFIGURED_PROFILE,
 			 S_IRUSR | S_IRGRP | S_IROTH);
@@ -572,7 +580,7 @@ urf_config_load_profile (UrfConfig *config)
 
 	hardware_info = get_dmi_info ();
 	if (hardware_info == NULL) {
-		g_debug ("Failed to get DMI information");
+		urf_debug ("Failed to get DMI information");
 		return;
 	}
 
@@ -612,7 +620,8 @@ urf_config_load_profile (UrfConfig *config)
 	priv->options.master_key = options->master_key;
 	priv->options.force_sync = options->force_sync;
 
-	save_configured_profile (config);
+	/* write it now, urfkilld may drop root once the config is loaded */
+	save_configured_profile (options);
 
 	dmi_info_free (hardware_info);
 	g_free (options);
@@ -629,13 +638,16 @@ urf_config_load_from_file (UrfConfig  *config,
 	GKeyFile *key_file = g_key_file_new ();
 	gboolean ret = FALSE;
 	GError *error = NULL;
+	gint64 start;
 
+	start = urf_startup_begin ();
 	urf_config_load_profile (config);
+	urf_startup_end (start, "profile");
 
 	ret = g_key_file_load_from_file (key_file, filename, G_KEY_FILE_NONE, NULL);
 
 	if (!ret) {
-		g_warning ("Failed to load config file: %s", filename);
+		urf_warning ("Failed to load config file: %s", filename);
 		g_key_file_free (key_file);
 		return;
 	}
@@ -703,6 +715,117 @@ urf_config_get_force_sync (UrfConfig *config)
 	return config->priv->options.force_sync;
 }
 
+/**
+ * urf_config_get_rfkill_backend:
+ *
+ * Return value: the rfkill backend, or %NULL for /dev/rfkill
+ **/
+const char *
+urf_config_get_rfkill_backend (UrfConfig *config)
+{
+	return (const char *)config->priv->rfkill_backend;
+}
+
+/**
+ * urf_config_set_rfkill_backend:
+ **/
+void
+urf_config_set_rfkill_backend (UrfConfig  *config,
+			       const char *backend)
+{
+	g_free (config->priv->rfkill_backend);
+	config->priv->rfkill_backend = g_strdup (backend);
+}
+
+/**
+ * urf_config_get_trace_file:
+ *
+ * Return value: the file to record the rfkill trace to, or %NULL
+ **/
+const char *
+urf_config_get_trace_file (UrfConfig *config)
+{
+	return (const char *)config->priv->trace_file;
+}
+
+/**
+ * urf_config_set_trace_file:
+ **/
+void
+urf_config_set_trace_file (UrfConfig  *config,
+			   const char *filename)
+{
+	g_free (config->priv->trace_file);
+	config->priv->trace_file = g_strdup (filename);
+}
+
+/**
+ * urf_config_get_metrics_file:
+ *
+ * Return value: the Prometheus textfile to write the metrics to, or %NULL
+ **/
+const char *
+urf_config_get_metrics_file (UrfConfig *config)
+{
+	return (const char *)config->priv->metrics_file;
+}
+
+/**
+ * urf_config_set_metrics_file:
+ **/
+void
+urf_config_set_metrics_file (UrfConfig  *config,
+			     const char *filename)
+{
+	g_free (config->priv->metrics_file);
+	config->priv->metrics_file = g_strdup (filename);
+}
+
+/**
+ * urf_config_get_runtime_dir:
+ *
+ * Return value: the directory of the state file and the peer socket
+ **/
+const char *
+urf_config_get_runtime_dir (UrfConfig *config)
+{
+	if (config->priv->runtime_dir == NULL)
+		return URF_RUNTIME_DIR;
+	return (const char *)config->priv->runtime_dir;
+}
+
+/**
+ * urf_config_set_runtime_dir:
+ **/
+void
+urf_config_set_runtime_dir (UrfConfig  *config,
+			    const char *dir)
+{
+	g_free (config->priv->runtime_dir);
+	config->priv->runtime_dir = g_strdup (dir);
+}
+
+/**
+ * urf_config_get_watch_main_loop:
+ *
+ * Return value: %TRUE if the main loop latency should be measured
+ **/
+gboolean
+urf_config_get_watch_main_loop (UrfConfig *config)
+{
+	return config->priv->watch_main_loop;
+}
+
+/**
+ * urf_config_set_watch_main_loop:
+ **/
+void
+urf_config_set_watch_main_loop (UrfConfig *config,
+				gboolean   watch)
+{
+	config->priv->watch_main_loop = watch;
+}
+
 /**
  * urf_config_init:
  **/
@@ -711,6 +834,11 @@ urf_config_init (UrfConfig *config)
 {
 	UrfConfigPrivate *priv = URF_CONFIG_GET_PRIVATE (config);
 	priv->user = NULL;
+	priv->rfkill_backend = NULL;
+	priv->trace_file = NULL;
+	priv->metrics_file = NULL;
+	priv->runtime_dir = NULL;
+	priv->watch_main_loop = FALSE;
 	priv->options.key_control = TRUE;
 	priv->options.master_key = FALSE;
 	priv->options.force_sync = FALSE;
@@ -726,6 +854,10 @@ urf_config_finalize (GObject *object)
 	UrfConfigPrivate *priv = URF_CONFIG(object)->priv;
 
 	g_free (priv->user);
+	g_free (priv->rfkill_backend);
+	g_free (priv->trace_file);
+	g_free (priv->metrics_file);
+	g_free (priv->runtime_dir);
 
 	G_OBJECT_CLASS(urf_config_parent_class)->finalize(object);
 }
@@ -59,6 +59,21 @@ const char	*urf_config_get_user		(UrfConfig	*config);
 gboolean	 urf_config_get_key_control	(UrfConfig	*config);
 gboolean	 urf_config_get_master_key	(UrfConfig	*config);
 gboolean	 urf_config_get_force_sync	(UrfConfig	*config);
+const char	*urf_config_get_rfkill_backend	(UrfConfig	*config);
+void		 urf_config_set_rfkill_backend	(UrfConfig	*config,
+						 const char	*backend);
+const char	*urf_config_get_trace_file	(UrfConfig	*config);
+void		 urf_config_set_trace_file	(UrfConfig	*config,
+						 const char	*filename);
+const char	*urf_config_get_metrics_file	(UrfConfig	*config);
+void		 urf_config_set_metrics_file	(UrfConfig	*config,
+						 const char	*filename);
+const char	*urf_config_get_runtime_dir	(UrfConfig	*config);
+void		 urf_config_set_runtime_dir	(UrfConfig	*config,
+						 const char	*dir);
+gboolean	 urf_config_get_watch_main_loop	(UrfConfig	*config);
+void		 urf_config_set_watch_main_loop	(UrfConfig	*config,
+						 gboolean	 watch);
 
 G_END_DECLS
 
@@ -23,41 +23,30 @@
 #endif
 
 #include <glib.h>
-#include <string.h>
-#include <dbus/dbus-glib.h>
+#include <gio/gio.h>
 
 #include "urf-consolekit.h"
+#include "urf-log.h"
+#include "urf-seat.h"
+#include "urf-watchdog.h"
 
-typedef struct {
-	guint		 cookie;
-	char		*session_id;
-	char		*bus_name;
-	char		*reason;
-} UrfInhibitor;
+#define CONSOLEKIT_NAME			"org.freedesktop.ConsoleKit"
+#define CONSOLEKIT_MANAGER_PATH		"/org/freedesktop/ConsoleKit/Manager"
+#define CONSOLEKIT_MANAGER_INTERFACE	"org.freedesktop.ConsoleKit.Manager"
 
 struct UrfConsolekitPrivate {
-	DBusGConnection	*connection;
-	DBusGProxy	*proxy;
-	DBusGProxy	*bus_proxy;
+	GDBusConnection	*connection;
+	guint		 seat_added_id;
+	guint		 seat_removed_id;
+	GCancellable	*seats_call;
 	GList		*seats;
-	GList		*inhibitors;
-	gboolean	 inhibit;
 };
 
-G_DEFINE_TYPE (UrfConsolekit, urf_consolekit, G_TYPE_OBJECT)
+G_DEFINE_TYPE (UrfConsolekit, urf_consolekit, URF_TYPE_SESSION_BACKEND)
 
 #define URF_CONSOLEKIT_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), \
 				URF_TYPE_CONSOLEKIT, UrfConsolekitPrivate))
 
-/**
- * urf_consolekit_is_inhibited:
- **/
-gboolean
-urf_consolekit_is_inhibited (UrfConsolekit *consolekit)
-{
-	return consolekit->priv->inhibit;
-}
-
 /**
  * urf_consolekit_find_seat:
  **/
@@ -78,84 +67,24 @@ urf_consolekit_find_seat (UrfConsolekit *consolekit,
 	return NULL;
 }
 
-static UrfInhibitor *
-find_inhibitor_by_sid (UrfConsolekit *consolekit,
-		       const char    *session_id)
-{
-	UrfConsolekitPrivate *priv = consolekit->priv;
-	UrfInhibitor *inhibitor;
-	GList *item;
-
-	for (item = priv->inhibitors; item; item = item->next) {
-		inhibitor = (UrfInhibitor *)item->data;
-		if (g_strcmp0 (inhibitor->session_id, session_id) == 0)
-			return inhibitor;
-	}
-	return NULL;
-}
-
-static UrfInhibitor *
-find_inhibitor_by_bus_name (UrfConsolekit *consolekit,
-			    const char    *bus_name)
-{
-	UrfConsolekitPrivate *priv = consolekit->priv;
-	UrfInhibitor *inhibitor;
-	GList *item;
-
-	for (item = priv->inhibitors; item; item = item->next) {
-		inhibitor = (UrfInhibitor *)item->data;
-		if (g_strcmp0 (inhibitor->bus_name, bus_name) == 0)
-			return inhibitor;
-	}
-	return NULL;
-}
-
-static UrfInhibitor *
-find_inhibitor_by_cookie (UrfConsolekit *consolekit,
-			  const guint    cookie)
-{
-	UrfConsolekitPrivate *priv = consolekit->priv;
-	UrfInhibitor *inhibitor;
-	GList *item;
-
-	if (cookie == 0)
-		return NULL;
-
-	for (item = priv->inhibitors; item; item = item->next) {
-		inhibitor = (UrfInhibitor *)item->data;
-		if (inhibitor->cookie == cookie)
-			return inhibitor;
-	}
-	return NULL;
-}
-
+/**
+ * urf_consolekit_is_session_active:
+ **/
 static gboolean
-is_inhibited (UrfConsolekit *consolekit)
+urf_consolekit_is_session_active (UrfSessionBackend *backend,
+				  const char        *session_id)
 {
-	UrfConsolekitPrivate *priv = consolekit->priv;
-	UrfSeat *seat;
-	const char *active_id;
+	UrfConsolekitPrivate *priv = URF_CONSOLEKIT (backend)->priv;
 	GList *item;
 
 	for (item = priv->seats; item; item = item->next) {
-		seat = URF_SEAT (item->data);
-		active_id = urf_seat_get_active (seat);
-		if (find_inhibitor_by_sid (consolekit, active_id))
+		if (g_strcmp0 (urf_seat_get_active (URF_SEAT (item->data)), session_id) == 0)
 			return TRUE;
 	}
 
 	return FALSE;
 }
 
-static void
-free_inhibitor (UrfInhibitor *inhibitor)
-{
-	g_free (inhibitor->session_id);
-	g_free (inhibitor->bus_name);
-	g_free (inhibitor->reason);
-	g_free (inhibitor);
-}
-
 /**
  * urf_consolekit_seat_active_changed:
  **/
@@ -164,128 +93,48 @@ urf_consolekit_seat_active_changed (UrfSeat       *seat,
 				    const char    *session_id,
 				    UrfConsolekit *consolekit)
 {
-	consolekit->priv->inhibit = is_inhibited (consolekit);
-	g_debug ("Active Session changed: %s", session_id);
+	urf_debug ("Active Session changed: %s", session_id);
+	urf_session_backend_active_changed (URF_SESSION_BACKEND (consolekit));
 }
 
+/**
+ * urf_consolekit_get_session_for_pid:
+ **/
 static char *
-get_session_id (UrfConsolekit *consolekit,
-		const char    *bus_name)
+urf_consolekit_get_session_for_pid (UrfSessionBackend *backend,
+				    guint              pid)
 {
-	UrfConsolekitPrivate *priv = consolekit->priv;
-	pid_t calling_pid;
+	UrfConsolekitPrivate *priv = URF_CONSOLEKIT (backend)->priv;
 	char *session_id = NULL;
-	GError *error;
-
-        error = NULL;
-	if (!dbus_g_proxy_call (priv->bus_proxy, "GetConnectionUnixProcessID", &error,
-				G_TYPE_STRING, bus_name,
-				G_TYPE_INVALID,
-				G_TYPE_UINT, &calling_pid,
-				G_TYPE_INVALID)) {
-		g_warning("GetConnectionUnixProcessID() failed: %s", error->message);
+	GVariant *reply;
+	GError *error = NULL;
+	gint64 start;
+
+	g_return_val_if_fail (priv->connection != NULL, NULL);
+
+	start = urf_watchdog_begin ();
+	reply = g_dbus_connection_call_sync (priv->connection,
+					     CONSOLEKIT_NAME,
+					     CONSOLEKIT_MANAGER_PATH,
+					     CONSOLEKIT_MANAGER_INTERFACE,
+					     "GetSessionForUnixProcess",
+					     g_variant_new ("(u)", pid),
+					     G_VARIANT_TYPE ("(o)"),
+					     G_DBUS_CALL_FLAGS_NONE,
+					     -1, NULL, &error);
+	urf_watchdog_end (start, "ConsoleKit GetSessionForUnixProcess");
+	if (reply == NULL) {
+		urf_warning ("Couldn't sent GetSessionForUnixProcess: %s", error->message);
 		g_error_free (error);
-		goto out;
+		return NULL;
 	}
 
-        error = NULL;
-	if (!dbus_g_proxy_call (priv->proxy, "GetSessionForUnixProcess", &error,
-				G_TYPE_UINT, calling_pid,
-				G_TYPE_INVALID,
-				DBUS_TYPE_G_OBJECT_PATH, &session_id,
-				G_TYPE_INVALID)) {
-		g_warning ("Couldn't sent GetSessionForUnixProcess: %s", error->message);
-		g_error_free (error);
-		session_id = NULL;
-		goto out;
-	}
+	g_variant_get (reply, "(o)", &session_id);
+	g_variant_unref (reply);
 
-	session_id = g_strdup (session_id);
-out:
 	return session_id;
 }
 
-static guint
-generate_unique_cookie (UrfConsolekit *consolekit)
-{
-	UrfInhibitor *inhibitor;
-	guint cookie;
-
-	do {
-		cookie = g_random_int_range (1, G_MAXINT);
-		inhibitor = find_inhibitor_by_cookie (consolekit, cookie);
-	} while (inhibitor != NULL);
-
-	return cookie;
-}
-
-/**
- * urf_consolekit_inhibit:
- **/
-guint
-urf_consolekit_inhibit (UrfConsolekit *consolekit,
-			const char    *bus_name,
-			const char    *reason)
-{
-	UrfConsolekitPrivate *priv = consolekit->priv;
-	UrfInhibitor *inhibitor;
-
-	g_return_val_if_fail (priv->proxy != NULL, 0);
-
-	inhibitor = find_inhibitor_by_bus_name (consolekit, bus_name);
-	if (inhibitor)
-		return inhibitor->cookie;
-
-	inhibitor = g_new0 (UrfInhibitor, 1);
-	inhibitor->session_id = get_session_id (consolekit, bus_name);
-	if (inhibitor->session_id == NULL) {
-		g_free (inhibitor);
-		return 0;
-	}
-
-	inhibitor->reason = g_strdup (reason);
-	inhibitor->bus_name = g_strdup (bus_name);
-	inhibitor->cookie = generate_unique_cookie (consolekit);
-
-	priv->inhibitors = g_list_prepend (priv->inhibitors, inhibitor);
-
-	consolekit->priv->inhibit = is_inhibited (consolekit);
-	g_debug ("Inhibit: %s for %s", bus_name, reason);
-
-	return inhibitor->cookie;
-}
-
-static void
-remove_inhibitor (UrfConsolekit *consolekit,
-		  UrfInhibitor  *inhibitor)
-{
-	UrfConsolekitPrivate *priv = consolekit->priv;
-
-	g_return_if_fail (priv->proxy != NULL);
-
-	priv->inhibitors = g_list_remove (priv->inhibitors, inhibitor);
-	consolekit->priv->inhibit = is_inhibited (consolekit);
-	g_debug ("Remove inhibitor: %s", inhibitor->bus_name);
-	free_inhibitor (inhibitor);
-}
-
-/**
- * urf_consolekit_uninhibit:
- **/
-void
-urf_consolekit_uninhibit (UrfConsolekit *consolekit,
-			  const guint    cookie)
-{
-	UrfInhibitor *inhibitor;
-
-	inhibitor = find_inhibitor_by_cookie (consolekit, cookie);
-	if (inhibitor == NULL) {
-		g_debug ("Cookie outdated");
-		return;
-	}
-	remove_inhibitor (consolekit, inhibitor);
-}
-
 /**
  * urf_consolekit_add_seat:
  **/
@@ -294,176 +143,171 @@ urf_consolekit_add_seat (UrfConsolekit *consolekit,
 			 const char    *object_path)
 {
 	UrfConsolekitPrivate *priv = consolekit->priv;
-	UrfSeat *seat = urf_seat_new ();
-	gboolean ret;
-
-	ret = urf_seat_object_path_sync (seat, object_path);
+	UrfSeat *seat;
 
-	if (!ret) {
-		g_warning ("Failed to sync %s", object_path);
+	if (urf_consolekit_find_seat (consolekit, object_path) != NULL)
 		return;
-	}
 
+	seat = urf_seat_new ();
 	priv->seats = g_list_prepend (priv->seats, seat);
 
 	/* connect signal */
 	g_signal_connect (seat, "active-changed",
 			  G_CALLBACK (urf_consolekit_seat_active_changed),
 			  consolekit);
-}
-
-/**
- * urf_consolekit_seat_added_cb:
- **/
-static void
-urf_consolekit_seat_added_cb (DBusGProxy    *proxy,
-			      const char    *object_path,
-			      UrfConsolekit *consolekit)
-{
-	if (urf_consolekit_find_seat (consolekit, object_path) != NULL) {
-		g_debug ("Already added seat: %s", object_path);
-		return;
-	}
 
-	urf_consolekit_add_seat (consolekit, object_path);
-	g_debug ("Monitor seat: %s", object_path);
+	/* the active session is filled in by "active-changed" */
+	urf_seat_object_path_async (seat, priv->connection, object_path);
 }
 
 /**
- * urf_consolekit_seat_removed_cb:
+ * urf_consolekit_seat_signal_cb:
  **/
 static void
-urf_consolekit_seat_removed_cb (DBusGProxy    *proxy,
-				const char    *object_path,
-				UrfConsolekit *consolekit)
+urf_consolekit_seat_signal_cb (GDBusConnection *connection,
+			       const char      *sender_name,
+			       const char      *object_path,
+			       const char      *interface_name,
+			       const char      *signal_name,
+			       GVariant        *parameters,
+			       gpointer         user_data)
 {
+	UrfConsolekit *consolekit = URF_CONSOLEKIT (user_data);
 	UrfConsolekitPrivate *priv = consolekit->priv;
+	const char *seat_path;
 	UrfSeat *seat;
 
-	seat = urf_consolekit_find_seat (consolekit, object_path);
-	if (seat == NULL)
+	if (!g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(o)")))
 		return;
+	g_variant_get (parameters, "(&o)", &seat_path);
 
-	priv->seats = g_list_remove (priv->seats, seat);
+	seat = urf_consolekit_find_seat (consolekit, seat_path);
 
-	g_object_unref (seat);
-	g_debug ("Removed seat: %s", object_path);
-}
+	if (g_strcmp0 (signal_name, "SeatAdded") == 0) {
+		if (seat != NULL) {
+			urf_debug ("Already added seat: %s", seat_path);
+			return;
+		}
+		urf_consolekit_add_seat (consolekit, seat_path);
+		urf_debug ("Monitor seat: %s", seat_path);
+	} else if (seat != NULL) {
+		priv->seats = g_list_remove (priv->seats, seat);
 
-/**
- * urf_consolekit_bus_owner_changed_cb:
- **/
-static void
-urf_consolekit_bus_owner_changed_cb (DBusGProxy    *bus_proxy,
-				     const char    *name,
-				     const char    *old_owner,
-				     const char    *new_owner,
-				     UrfConsolekit *consolekit)
-{
-	UrfInhibitor *inhibitor;
+		g_object_unref (seat);
+		urf_debug ("Removed seat: %s", seat_path);
 
-	if (strlen (new_owner) == 0 &&
-	    strlen (old_owner) > 0) {
-		/* A process disconnected from the bus */
-		inhibitor = find_inhibitor_by_bus_name (consolekit, old_owner);
-		if (inhibitor == NULL)
-			return;
-		remove_inhibitor (consolekit, inhibitor);
+		urf_session_backend_active_changed (URF_SESSION_BACKEND (consolekit));
 	}
 }
 
 /**
- * urf_consolekit_get_seats:
+ * urf_consolekit_get_seats_cb:
  **/
-static gboolean
-urf_consolekit_get_seats (UrfConsolekit *consolekit)
+static void
+urf_consolekit_get_seats_cb (GObject      *source,
+			     GAsyncResult *res,
+			     gpointer      user_data)
 {
-	UrfConsolekitPrivate *priv = consolekit->priv;
-	GType g_type_array;
-	GPtrArray *seats = NULL;
+	UrfConsolekit *consolekit;
+	GVariant *reply;
+	GVariantIter *iter;
 	GError *error = NULL;
 	const char *object_path;
-	gboolean ret;
-	int i;
 
-	g_type_array = dbus_g_type_get_collection ("GPtrArray", DBUS_TYPE_G_OBJECT_PATH);
-	ret = dbus_g_proxy_call (priv->proxy, "GetSeats", &error,
-				 G_TYPE_INVALID,
-				 g_type_array, &seats,
-				 G_TYPE_INVALID);
-
-	if (!ret) {
-		g_warning ("GetSeats Failed: %s", error->message);
+	reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source), res, &error);
+	if (reply == NULL && g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		/* the backend is gone already */
 		g_error_free (error);
-		return FALSE;
+		return;
 	}
 
-	if (seats == NULL) {
-		g_debug ("No Seat exists");
-		return FALSE;
+	consolekit = URF_CONSOLEKIT (user_data);
+	g_object_unref (consolekit->priv->seats_call);
+	consolekit->priv->seats_call = NULL;
+
+	if (reply == NULL) {
+		urf_warning ("GetSeats Failed: %s", error->message);
+		g_error_free (error);
+		return;
 	}
 
-	for (i = 0; i < seats->len; i++) {
-		object_path = (const char *) g_ptr_array_index (seats, i);
+	g_variant_get (reply, "(ao)", &iter);
+	if (g_variant_iter_n_children (iter) == 0)
+		urf_debug ("No Seat exists");
+
+	/* every seat asks for its active session in parallel */
+	while (g_variant_iter_loop (iter, "&o", &object_path)) {
 		urf_consolekit_add_seat (consolekit, object_path);
-		g_debug ("Added seat: %s", object_path);
+		urf_debug ("Added seat: %s", object_path);
 	}
+	g_variant_iter_free (iter);
+	g_variant_unref (reply);
+}
 
-	return TRUE;
+/**
+ * urf_consolekit_get_seats:
+ **/
+static void
+urf_consolekit_get_seats (UrfConsolekit *consolekit)
+{
+	UrfConsolekitPrivate *priv = consolekit->priv;
+
+	priv->seats_call = g_cancellable_new ();
+	g_dbus_connection_call (priv->connection,
+				CONSOLEKIT_NAME,
+				CONSOLEKIT_MANAGER_PATH,
+				CONSOLEKIT_MANAGER_INTERFACE,
+				"GetSeats",
+				NULL,
+				G_VARIANT_TYPE ("(ao)"),
+				G_DBUS_CALL_FLAGS_NONE,
+				-1,
+				priv->seats_call,
+				urf_consolekit_get_seats_cb,
+				consolekit);
 }
 
 /**
  * urf_consolekit_startup:
  **/
-gboolean
-urf_consolekit_startup (UrfConsolekit *consolekit)
+static gboolean
+urf_consolekit_startup (UrfSessionBackend *backend)
 {
+	UrfConsolekit *consolekit = URF_CONSOLEKIT (backend);
 	UrfConsolekitPrivate *priv = consolekit->priv;
 	GError *error = NULL;
-	gboolean ret;
 
-	priv->connection = dbus_g_bus_get (DBUS_BUS_SYSTEM, &error);
-	if (error != NULL) {
-		g_warning ("Failed to get bus: %s", error->message);
+	priv->connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, &error);
+	if (priv->connection == NULL) {
+		urf_warning ("Failed to get bus: %s", error->message);
 		g_error_free (error);
 		return FALSE;
 	}
 
-	priv->proxy = dbus_g_proxy_new_for_name (priv->connection,
-						 "org.freedesktop.ConsoleKit",
-						 "/org/freedesktop/ConsoleKit/Manager",
-						 "org.freedesktop.ConsoleKit.Manager");
-
-	priv->bus_proxy = dbus_g_proxy_new_for_name (priv->connection,
-						     DBUS_SERVICE_DBUS,
-						     DBUS_PATH_DBUS,
-						     DBUS_INTERFACE_DBUS);
-	/* Get seats */
-	ret = urf_consolekit_get_seats (consolekit);
-	if (!ret)
-		return FALSE;
-
 	/* connect signals */
-	dbus_g_proxy_add_signal (priv->proxy, "SeatAdded",
-				 G_TYPE_STRING,
-				 G_TYPE_INVALID);
-	dbus_g_proxy_add_signal (priv->proxy, "SeatRemoved",
-				 G_TYPE_STRING,
-				 G_TYPE_INVALID);
-
-	dbus_g_proxy_add_signal (priv->bus_proxy, "NameOwnerChanged",
-				 G_TYPE_STRING,
-				 G_TYPE_STRING,
-				 G_TYPE_STRING,
-				 G_TYPE_INVALID);
-	/* callbacks */
-	dbus_g_proxy_connect_signal (priv->proxy, "SeatAdded",
-				     G_CALLBACK (urf_consolekit_seat_added_cb), consolekit, NULL);
-	dbus_g_proxy_connect_signal (priv->proxy, "SeatRemoved",
-				     G_CALLBACK (urf_consolekit_seat_removed_cb), consolekit, NULL);
-
-	dbus_g_proxy_connect_signal (priv->bus_proxy, "NameOwnerChanged",
-				     G_CALLBACK (urf_consolekit_bus_owner_changed_cb), consolekit, NULL);
+	priv->seat_added_id =
+		g_dbus_connection_signal_subscribe (priv->connection,
+						    CONSOLEKIT_NAME,
+						    CONSOLEKIT_MANAGER_INTERFACE,
+						    "SeatAdded",
+						    CONSOLEKIT_MANAGER_PATH,
+						    NULL,
+						    G_DBUS_SIGNAL_FLAGS_NONE,
+						    urf_consolekit_seat_signal_cb,
+						    consolekit, NULL);
+	priv->seat_removed_id =
+		g_dbus_connection_signal_subscribe (priv->connection,
+						    CONSOLEKIT_NAME,
+						    CONSOLEKIT_MANAGER_INTERFACE,
+						    "SeatRemoved",
+						    CONSOLEKIT_MANAGER_PATH,
+						    NULL,
+						    G_DBUS_SIGNAL_FLAGS_NONE,
+						    urf_consolekit_seat_signal_cb,
+						    consolekit, NULL);
+
+	/* Get seats, no session is active until the first answers arrive */
+	urf_consolekit_get_seats (consolekit);
 
 	return TRUE;
 }
@@ -476,18 +320,19 @@ urf_consolekit_dispose (GObject *object)
 {
 	UrfConsolekit *consolekit = URF_CONSOLEKIT(object);
 
+	if (consolekit->priv->seats_call) {
+		g_cancellable_cancel (consolekit->priv->seats_call);
+		g_object_unref (consolekit->priv->seats_call);
+		consolekit->priv->seats_call = NULL;
+	}
 	if (consolekit->priv->connection) {
-		dbus_g_connection_unref (consolekit->priv->connection);
+		g_dbus_connection_signal_unsubscribe (consolekit->priv->connection,
+						      consolekit->priv->seat_added_id);
+		g_dbus_connection_signal_unsubscribe (consolekit->priv->connection,
+						      consolekit->priv->seat_removed_id);
+		g_object_unref (consolekit->priv->connection);
 		consolekit->priv->connection = NULL;
 	}
-	if (consolekit->priv->proxy) {
-		g_object_unref (consolekit->priv->proxy);
-		consolekit->priv->proxy = NULL;
-	}
-	if (consolekit->priv->bus_proxy) {
-		g_object_unref (consolekit->priv->bus_proxy);
-		consolekit->priv->bus_proxy = NULL;
-	}
 
 	G_OBJECT_CLASS (urf_consolekit_parent_class)->dispose (object);
 }
@@ -507,12 +352,6 @@ urf_consolekit_finalize (GObject *object)
 		g_list_free (consolekit->priv->seats);
 		consolekit->priv->seats = NULL;
 	}
-	if (consolekit->priv->inhibitors) {
-		for (item = consolekit->priv->inhibitors; item; item = item->next)
-			free_inhibitor (item->data);
-		g_list_free (consolekit->priv->inhibitors);
-		consolekit->priv->inhibitors = NULL;
-	}
 
 	G_OBJECT_CLASS (urf_consolekit_parent_class)->finalize (object);
 }
@@ -524,10 +363,15 @@ static void
 urf_consolekit_class_init (UrfConsolekitClass *klass)
 {
 	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	UrfSessionBackendClass *backend_class = URF_SESSION_BACKEND_CLASS (klass);
 
 	object_class->dispose = urf_consolekit_dispose;
 	object_class->finalize = urf_consolekit_finalize;
 
+	backend_class->startup = urf_consolekit_startup;
+	backend_class->get_session_for_pid = urf_consolekit_get_session_for_pid;
+	backend_class->is_session_active = urf_consolekit_is_session_active;
+
 	g_type_class_add_private (klass, sizeof (UrfConsolekitPrivate));
 }
 
@@ -539,11 +383,10 @@ urf_consolekit_init (UrfConsolekit *consolekit)
 {
 	consolekit->priv = URF_CONSOLEKIT_GET_PRIVATE (consolekit);
 	consolekit->priv->seats = NULL;
-	consolekit->priv->inhibitors = NULL;
-	consolekit->priv->inhibit = FALSE;
 	consolekit->priv->connection = NULL;
-	consolekit->priv->proxy = NULL;
-	consolekit->priv->bus_proxy = NULL;
+	consolekit->priv->seat_added_id = 0;
+	consolekit->priv->seat_removed_id = 0;
+	consolekit->priv->seats_call = NULL;
 }
 
 /**
@@ -23,7 +23,7 @@
 
 #include <glib-object.h>
 
-#include "urf-seat.h"
+#include "urf-session-backend.h"
 
 G_BEGIN_DECLS
 
@@ -42,27 +42,18 @@ G_BEGIN_DECLS
 typedef struct UrfConsolekitPrivate UrfConsolekitPrivate;
 
 typedef struct {
-	GObject 		 parent;
+	UrfSessionBackend	 parent;
 	UrfConsolekitPrivate 	*priv;
 } UrfConsolekit;
 
 typedef struct {
-        GObjectClass	 	 parent_class;
+	UrfSessionBackendClass	 parent_class;
 } UrfConsolekitClass;
 
 GType			 urf_consolekit_get_type	(void);
 
 UrfConsolekit		*urf_consolekit_new		(void);
 
-gboolean		 urf_consolekit_startup		(UrfConsolekit	*consolekit);
-
-gboolean		 urf_consolekit_is_inhibited	(UrfConsolekit	*consolekit);
-guint			 urf_consolekit_inhibit		(UrfConsolekit	*consolekit,
-							 const char	*bus_name,
-							 const char	*reason);
-void			 urf_consolekit_uninhibit	(UrfConsolekit	*consolekit,
-							 const guint	 cookie);
-
 G_END_DECLS
 
 #endif /* __URF_CONSOLEKIT_H__ */
@@ -0,0 +1,463 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <glib.h>
+#include <string.h>
+#include <gio/gio.h>
+
+#include "urf-credentials.h"
+#include "urf-log.h"
+#include "urf-watchdog.h"
+#include "urf-metrics.h"
+
+#define DBUS_SERVICE_DBUS	"org.freedesktop.DBus"
+#define DBUS_PATH_DBUS		"/org/freedesktop/DBus"
+#define DBUS_INTERFACE_DBUS	"org.freedesktop.DBus"
+
+enum {
+	SIGNAL_VANISHED,
+	SIGNAL_LAST
+};
+
+static guint signals[SIGNAL_LAST] = { 0 };
+
+typedef struct {
+	char		*bus_name;
+	guint32		 pid;
+	guint32		 uid;
+	char		*session_id;
+	gboolean	 session_checked;
+	guint		 watch_id;
+} UrfPeer;
+
+struct UrfCredentialsPrivate {
+	GDBusConnection		*connection;
+	UrfSessionBackend	*backend;
+	GHashTable		*peers;		/* unique bus name -> UrfPeer */
+	gboolean		 has_get_credentials;
+};
+
+G_DEFINE_TYPE (UrfCredentials, urf_credentials, G_TYPE_OBJECT)
+
+#define URF_CREDENTIALS_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), \
+				URF_TYPE_CREDENTIALS, UrfCredentialsPrivate))
+
+static gpointer urf_credentials_object = NULL;
+
+static void
+free_peer (UrfPeer *peer)
+{
+	g_free (peer->bus_name);
+	g_free (peer->session_id);
+	g_free (peer);
+}
+
+static void urf_credentials_name_owner_changed (GDBusConnection *connection,
+						const char      *sender_name,
+						const char      *object_path,
+						const char      *interface_name,
+						const char      *signal_name,
+						GVariant        *parameters,
+						gpointer         user_data);
+
+/**
+ * watch_bus_name:
+ *
+ * Subscribe to NameOwnerChanged for this bus name only, so that we are
+ * not woken up by every other client coming and going on the bus.
+ **/
+static guint
+watch_bus_name (UrfCredentials *credentials,
+		const char     *bus_name)
+{
+	/* GDBus adds the arg0 match rule without waiting for the reply */
+	return g_dbus_connection_signal_subscribe (credentials->priv->connection,
+						   DBUS_SERVICE_DBUS,
+						   DBUS_INTERFACE_DBUS,
+						   "NameOwnerChanged",
+						   DBUS_PATH_DBUS,
+						   bus_name,
+						   G_DBUS_SIGNAL_FLAGS_NONE,
+						   urf_credentials_name_owner_changed,
+						   credentials, NULL);
+}
+
+/**
+ * call_bus_method:
+ *
+ * A proxy to the bus daemon would add a match rule for every signal
+ * the bus emits, so talk to it with plain method calls instead.
+ **/
+static GVariant *
+call_bus_method (UrfCredentials     *credentials,
+		 const char         *method,
+		 const char         *bus_name,
+		 const GVariantType *reply_type,
+		 GError            **error)
+{
+	GVariant *reply;
+	gint64 start;
+
+	start = urf_watchdog_begin ();
+	reply = g_dbus_connection_call_sync (credentials->priv->connection,
+					     DBUS_SERVICE_DBUS,
+					     DBUS_PATH_DBUS,
+					     DBUS_INTERFACE_DBUS,
+					     method,
+					     g_variant_new ("(s)", bus_name),
+					     reply_type,
+					     G_DBUS_CALL_FLAGS_NONE,
+					     -1, NULL, error);
+	urf_watchdog_end (start, "bus daemon credentials lookup");
+	return reply;
+}
+
+/**
+ * fetch_credentials:
+ *
+ * Pick ProcessID and UnixUserID out of the a{sv} returned by
+ * GetConnectionCredentials.
+ **/
+static gboolean
+fetch_credentials (UrfCredentials *credentials,
+		   UrfPeer        *peer,
+		   GError        **error)
+{
+	GVariant *reply;
+	GVariant *dict;
+	gboolean ret;
+
+	reply = call_bus_method (credentials, "GetConnectionCredentials",
+				 peer->bus_name, G_VARIANT_TYPE ("(a{sv})"), error);
+	if (reply == NULL)
+		return FALSE;
+
+	dict = g_variant_get_child_value (reply, 0);
+	ret = g_variant_lookup (dict, "ProcessID", "u", &peer->pid) &&
+	      g_variant_lookup (dict, "UnixUserID", "u", &peer->uid);
+	g_variant_unref (dict);
+	g_variant_unref (reply);
+
+	if (!ret)
+		g_set_error_literal (error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+				     "incomplete credentials");
+	return ret;
+}
+
+/**
+ * fetch_credentials_fallback:
+ *
+ * For bus daemons older than GetConnectionCredentials (dbus < 1.7.0)
+ **/
+static gboolean
+fetch_credentials_fallback (UrfCredentials *credentials,
+			    UrfPeer        *peer,
+			    GError        **error)
+{
+	GVariant *reply;
+
+	reply = call_bus_method (credentials, "GetConnectionUnixProcessID",
+				 peer->bus_name, G_VARIANT_TYPE ("(u)"), error);
+	if (reply == NULL)
+		return FALSE;
+	g_variant_get (reply, "(u)", &peer->pid);
+	g_variant_unref (reply);
+
+	reply = call_bus_method (credentials, "GetConnectionUnixUser",
+				 peer->bus_name, G_VARIANT_TYPE ("(u)"), error);
+	if (reply == NULL)
+		return FALSE;
+	g_variant_get (reply, "(u)", &peer->uid);
+	g_variant_unref (reply);
+
+	return TRUE;
+}
+
+/**
+ * lookup_peer:
+ **/
+static UrfPeer *
+lookup_peer (UrfCredentials *credentials,
+	     const char     *bus_name)
+{
+	UrfCredentialsPrivate *priv = credentials->priv;
+	UrfPeer *peer;
+	GError *error = NULL;
+	gboolean ret = FALSE;
+
+	g_return_val_if_fail (bus_name != NULL, NULL);
+
+	peer = g_hash_table_lookup (priv->peers, bus_name);
+	if (peer != NULL) {
+		urf_metrics_count (URF_METRICS_CREDENTIALS_CACHE_HITS);
+		return peer;
+	}
+	urf_metrics_count (URF_METRICS_CREDENTIALS_CACHE_MISSES);
+
+	peer = g_new0 (UrfPeer, 1);
+	peer->bus_name = g_strdup (bus_name);
+
+	/* watch the name before asking about it: if the peer is gone
+	 * already, the call below fails and nothing gets cached */
+	peer->watch_id = watch_bus_name (credentials, bus_name);
+
+	if (priv->has_get_credentials) {
+		ret = fetch_credentials (credentials, peer, &error);
+		if (ret || !g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD))
+			goto out;
+
+		urf_debug ("GetConnectionCredentials not supported by the bus");
+		priv->has_get_credentials = FALSE;
+		g_clear_error (&error);
+	}
+	ret = fetch_credentials_fallback (credentials, peer, &error);
+out:
+	if (!ret) {
+		urf_warning ("Failed to get credentials of %s: %s",
+			     bus_name, error->message);
+		g_error_free (error);
+		g_dbus_connection_signal_unsubscribe (priv->connection, peer->watch_id);
+		free_peer (peer);
+		return NULL;
+	}
+
+	g_hash_table_insert (priv->peers, peer->bus_name, peer);
+	return peer;
+}
+
+/**
+ * urf_credentials_get_pid:
+ **/
+gboolean
+urf_credentials_get_pid (UrfCredentials *credentials,
+			 const char     *bus_name,
+			 guint          *pid)
+{
+	UrfPeer *peer;
+
+	peer = lookup_peer (credentials, bus_name);
+	if (peer == NULL)
+		return FALSE;
+
+	*pid = peer->pid;
+	return TRUE;
+}
+
+/**
+ * urf_credentials_get_uid:
+ **/
+gboolean
+urf_credentials_get_uid (UrfCredentials *credentials,
+			 const char     *bus_name,
+			 guint          *uid)
+{
+	UrfPeer *peer;
+
+	peer = lookup_peer (credentials, bus_name);
+	if (peer == NULL)
+		return FALSE;
+
+	*uid = peer->uid;
+	return TRUE;
+}
+
+/**
+ * urf_credentials_get_session:
+ *
+ * Return value: the session of the peer, owned by the cache
+ **/
+const char *
+urf_credentials_get_session (UrfCredentials *credentials,
+			     const char     *bus_name)
+{
+	UrfPeer *peer;
+
+	g_return_val_if_fail (credentials->priv->backend != NULL, NULL);
+
+	peer = lookup_peer (credentials, bus_name);
+	if (peer == NULL)
+		return NULL;
+
+	/* a process never changes its session */
+	if (!peer->session_checked) {
+		peer->session_id = urf_session_backend_get_session_for_pid (credentials->priv->backend,
+									    peer->pid);
+		peer->session_checked = TRUE;
+	}
+
+	return peer->session_id;
+}
+
+/**
+ * urf_credentials_set_session_backend:
+ **/
+void
+urf_credentials_set_session_backend (UrfCredentials    *credentials,
+				     UrfSessionBackend *backend)
+{
+	UrfCredentialsPrivate *priv = credentials->priv;
+
+	if (priv->backend != NULL)
+		g_object_unref (priv->backend);
+	priv->backend = g_object_ref (backend);
+}
+
+/**
+ * urf_credentials_name_owner_changed:
+ **/
+static void
+urf_credentials_name_owner_changed (GDBusConnection *connection,
+				    const char      *sender_name,
+				    const char      *object_path,
+				    const char      *interface_name,
+				    const char      *signal_name,
+				    GVariant        *parameters,
+				    gpointer         user_data)
+{
+	UrfCredentials *credentials = URF_CREDENTIALS (user_data);
+	UrfCredentialsPrivate *priv = credentials->priv;
+	const char *name;
+	const char *old_owner;
+	const char *new_owner;
+	UrfPeer *peer;
+	char *bus_name;
+
+	if (!g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(sss)")))
+		return;
+
+	g_variant_get (parameters, "(&s&s&s)", &name, &old_owner, &new_owner);
+	if (strlen (new_owner) != 0)
+		return;
+
+	peer = g_hash_table_lookup (priv->peers, name);
+	if (peer == NULL)
+		return;
+
+	/* A process disconnected from the bus */
+	bus_name = g_strdup (name);
+	g_dbus_connection_signal_unsubscribe (priv->connection, peer->watch_id);
+	g_hash_table_remove (priv->peers, bus_name);
+	g_signal_emit (credentials, signals[SIGNAL_VANISHED], 0, bus_name);
+	g_free (bus_name);
+}
+
+/**
+ * urf_credentials_dispose:
+ **/
+static void
+urf_credentials_dispose (GObject *object)
+{
+	UrfCredentialsPrivate *priv = URF_CREDENTIALS (object)->priv;
+	GHashTableIter iter;
+	UrfPeer *peer;
+
+	if (priv->connection) {
+		g_hash_table_iter_init (&iter, priv->peers);
+		while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &peer))
+			g_dbus_connection_signal_unsubscribe (priv->connection, peer->watch_id);
+		g_hash_table_remove_all (priv->peers);
+
+		g_object_unref (priv->connection);
+		priv->connection = NULL;
+	}
+	if (priv->backend) {
+		g_object_unref (priv->backend);
+		priv->backend = NULL;
+	}
+
+	G_OBJECT_CLASS (urf_credentials_parent_class)->dispose (object);
+}
+
+/**
+ * urf_credentials_finalize:
+ **/
+static void
+urf_credentials_finalize (GObject *object)
+{
+	UrfCredentials *credentials = URF_CREDENTIALS (object);
+
+	g_hash_table_destroy (credentials->priv->peers);
+
+	G_OBJECT_CLASS (urf_credentials_parent_class)->finalize (object);
+}
+
+/**
+ * urf_credentials_class_init:
+ **/
+static void
+urf_credentials_class_init (UrfCredentialsClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->dispose = urf_credentials_dispose;
+	object_class->finalize = urf_credentials_finalize;
+
+	signals[SIGNAL_VANISHED] =
+		g_signal_new ("vanished",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (UrfCredentialsClass, vanished),
+			      NULL, NULL, g_cclosure_marshal_VOID__STRING,
+			      G_TYPE_NONE, 1, G_TYPE_STRING);
+
+	g_type_class_add_private (klass, sizeof (UrfCredentialsPrivate));
+}
+
+/**
+ * urf_credentials_init:
+ **/
+static void
+urf_credentials_init (UrfCredentials *credentials)
+{
+	GError *error = NULL;
+
+	credentials->priv = URF_CREDENTIALS_GET_PRIVATE (credentials);
+	credentials->priv->backend = NULL;
+	credentials->priv->has_get_credentials = TRUE;
+	credentials->priv->peers = g_hash_table_new_full (g_str_hash,
+							  g_str_equal,
+							  NULL,
+							  (GDestroyNotify) free_peer);
+
+	/* the signal subscriptions are added per peer in watch_bus_name () */
+	credentials->priv->connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, &error);
+	if (credentials->priv->connection == NULL) {
+		g_critical ("error getting system bus: %s", error->message);
+		g_error_free (error);
+	}
+}
+
+/**
+ * urf_credentials_new:
+ **/
+UrfCredentials *
+urf_credentials_new (void)
+{
+	if (urf_credentials_object != NULL) {
+		g_object_ref (urf_credentials_object);
+	} else {
+		urf_credentials_object = g_object_new (URF_TYPE_CREDENTIALS, NULL);
+		g_object_add_weak_pointer (urf_credentials_object, &urf_credentials_object);
+	}
+	return URF_CREDENTIALS (urf_credentials_object);
+}
@@ -0,0 +1,72 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __URF_CREDENTIALS_H__
+#define __URF_CREDENTIALS_H__
+
+#include <glib-object.h>
+
+#include "urf-session-backend.h"
+
+G_BEGIN_DECLS
+
+#define URF_TYPE_CREDENTIALS (urf_credentials_get_type())
+#define URF_CREDENTIALS(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj), \
+					URF_TYPE_CREDENTIALS, UrfCredentials))
+#define URF_CREDENTIALS_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST((klass), \
+					URF_TYPE_CREDENTIALS, UrfCredentialsClass))
+#define URF_IS_CREDENTIALS(obj) (G_TYPE_CHECK_INSTANCE_TYPE((obj), \
+					URF_TYPE_CREDENTIALS))
+#define URF_IS_CREDENTIALS_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), \
+					URF_TYPE_CREDENTIALS))
+#define URF_GET_CREDENTIALS_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS((obj), \
+					URF_TYPE_CREDENTIALS, UrfCredentialsClass))
+
+typedef struct UrfCredentialsPrivate UrfCredentialsPrivate;
+
+typedef struct {
+	GObject 		 parent;
+	UrfCredentialsPrivate	*priv;
+} UrfCredentials;
+
+typedef struct {
+        GObjectClass	 	 parent_class;
+	void			(*vanished)		(UrfCredentials	*credentials,
+							 const char	*bus_name);
+} UrfCredentialsClass;
+
+GType			 urf_credentials_get_type	(void);
+
+UrfCredentials		*urf_credentials_new		(void);
+
+void			 urf_credentials_set_session_backend (UrfCredentials	*credentials,
+							 UrfSessionBackend *backend);
+gboolean		 urf_credentials_get_pid	(UrfCredentials	*credentials,
+							 const char	*bus_name,
+							 guint		*pid);
+gboolean		 urf_credentials_get_uid	(UrfCredentials	*credentials,
+							 const char	*bus_name,
+							 guint		*uid);
+const char		*urf_credentials_get_session	(UrfCredentials	*credentials,
+							 const char	*bus_name);
+
+G_END_DECLS
+
+#endif /* __URF_CREDENTIALS_H__ */
@@ -28,50 +28,57 @@
 #include <glib.h>
 #include <glib/gi18n-lib.h>
 #include <glib-object.h>
-#include <dbus/dbus-glib.h>
-#include <dbus/dbus-glib-lowlevel.h>
+#include <gio/gio.h>
 #include <linux/input.h>
 #include <linux/rfkill.h>
 
 #include "urf-polkit.h"
 #include "urf-daemon.h"
+#include "urf-log.h"
 #include "urf-killswitch.h"
 #include "urf-input.h"
 #include "urf-utils.h"
 #include "urf-config.h"
-#include "urf-consolekit.h"
+#include "urf-session-checker.h"
+#include "urf-peer-server.h"
+#include "urf-rfkill-replay.h"
+#include "urf-trace.h"
+#include "urf-watchdog.h"
+#include "urf-metrics.h"
+#include "urf-probes.h"
+#include "urf-startup.h"
+#include "liburfkill-glib/urf-peer-address.h"
+#include "liburfkill-glib/urf-type-names.h"
 
 #include "urf-daemon-glue.h"
+#include "urf-debug-glue.h"
 
-enum
-{
-	PROP_0,
-	PROP_DAEMON_VERSION,
-	PROP_KEY_CONTROL,
-	PROP_LAST
-};
-
-enum
-{
-	SIGNAL_DEVICE_ADDED,
-	SIGNAL_DEVICE_REMOVED,
-	SIGNAL_DEVICE_CHANGED,
-	SIGNAL_URFKEY_PRESSED,
-	SIGNAL_LAST,
-};
+#define URFKILL_OBJECT_PATH "/org/freedesktop/URfkill"
 
-static guint signals[SIGNAL_LAST] = { 0 };
+/* in seconds */
+#define URF_DAEMON_METRICS_INTERVAL 15
 
 struct UrfDaemonPrivate
 {
 	UrfConfig	*config;
-	DBusGConnection	*connection;
+	GDBusConnection	*connection;
+	UrfDbusDaemon	*skeleton;
+	UrfDbusDebug	*debug_skeleton;
+	GDBusObjectManagerServer *manager;
+	GVariant	*devices_reply;
+	guint		 devices_generation;
+	UrfPeerServer	*peer_server;
 	UrfPolkit	*polkit;
 	UrfKillswitch   *killswitch;
 	UrfInput	*input;
-	UrfConsolekit	*consolekit;
+	UrfSessionChecker *session_checker;
+	UrfTrace	*trace;
+	UrfWatchdog	*watchdog;
+	UrfMetrics	*metrics;
 	gboolean	 key_control;
 	gboolean	 master_key;
+	gboolean	 late_started;
+	guint		 late_startup_id;
 };
 
 static void urf_daemon_dispose (GObject *object);
@@ -91,19 +98,35 @@ urf_daemon_register_rfkill_daemon (UrfDaemon *daemon)
 	gboolean ret = FALSE;
 	UrfDaemonPrivate *priv = daemon->priv;
 
-	priv->connection = dbus_g_bus_get (DBUS_BUS_SYSTEM, &error);
+	priv->connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, &error);
 	if (priv->connection == NULL) {
-		if (error != NULL) {
-			g_critical ("error getting system bus: %s", error->message);
-			g_error_free (error);
-		}
+		g_critical ("error getting system bus: %s", error->message);
+		g_error_free (error);
 		goto out;
 	}
 
-	/* register GObject */
-	dbus_g_connection_register_g_object (priv->connection,
-					     "/org/freedesktop/URfkill",
-					     G_OBJECT (daemon));
+	/* export the generated skeleton */
+	if (!g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (priv->skeleton),
+					       priv->connection,
+					       URFKILL_OBJECT_PATH,
+					       &error)) {
+		g_critical ("error exporting %s: %s", URFKILL_OBJECT_PATH, error->message);
+		g_error_free (error);
+		goto out;
+	}
+
+	/* diagnostics, the bus policy limits them to root */
+	if (!g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (priv->debug_skeleton),
+					       priv->connection,
+					       URFKILL_OBJECT_PATH,
+					       &error)) {
+		urf_warning ("error exporting the debug interface: %s", error->message);
+		g_error_free (error);
+		error = NULL;
+	}
+
+	/* the devices are exported through the object manager */
+	g_dbus_object_manager_server_set_connection (priv->manager, priv->connection);
 
 	/* success */
 	ret = TRUE;
@@ -125,8 +148,18 @@ urf_daemon_input_event_cb (UrfInput *input,
 	gint type;
 	gboolean block = FALSE;
 
-	if (urf_consolekit_is_inhibited (priv->consolekit))
+	if (priv->trace)
+		urf_trace_record_key (priv->trace, code);
+	urf_metrics_count_key (code);
+	if (URF_PROBE_ENABLED (key__dispatch))
+		URF_PROBE3 (key__dispatch, code,
+			    urf_session_checker_is_inhibited (priv->session_checker),
+			    g_get_monotonic_time ());
+
+	if (urf_session_checker_is_inhibited (priv->session_checker)) {
+		urf_metrics_count (URF_METRICS_RFKILL_WRITES_ELIDED);
 		goto out;
+	}
 
 	switch (code) {
 	case KEY_WLAN:
@@ -160,6 +193,7 @@ urf_daemon_input_event_cb (UrfInput *input,
 		break;
 	case KILLSWITCH_STATE_NO_ADAPTER:
 	default:
+		urf_metrics_count (URF_METRICS_RFKILL_WRITES_ELIDED);
 		goto out;
 	}
 
@@ -168,7 +202,66 @@ urf_daemon_input_event_cb (UrfInput *input,
 
 	urf_killswitch_set_block (killswitch, type, block);
 out:
-	g_signal_emit (daemon, signals[SIGNAL_URFKEY_PRESSED], 0, code);
+	urf_dbus_daemon_emit_urfkey_pressed (priv->skeleton, code);
+	urf_metrics_count (URF_METRICS_SIGNALS_EMITTED);
+}
+
+/**
+ * urf_daemon_probe_rfkill:
+ **/
+static gpointer
+urf_daemon_probe_rfkill (gpointer unused)
+{
+	return get_rfkill_udev_attrs ();
+}
+
+/**
+ * urf_daemon_probe_input:
+ **/
+static gpointer
+urf_daemon_probe_input (gpointer unused)
+{
+	return urf_input_find_device ();
+}
+
+/**
+ * urf_daemon_late_startup:
+ *
+ * Start the session checker, which only key handling needs. Runs from
+ * an idle once the main loop is up, or right away when a method needs
+ * the session checker first. Unlike the input device, it doesn't need
+ * root.
+ **/
+static void
+urf_daemon_late_startup (UrfDaemon *daemon)
+{
+	UrfDaemonPrivate *priv = daemon->priv;
+	gint64 start;
+
+	if (priv->late_startup_id != 0) {
+		g_source_remove (priv->late_startup_id);
+		priv->late_startup_id = 0;
+	}
+	if (priv->late_started)
+		return;
+	priv->late_started = TRUE;
+
+	/* not fatal, the radios can still be switched over D-Bus */
+	start = urf_startup_begin ();
+	if (!urf_session_checker_startup (priv->session_checker))
+		urf_warning ("failed to setup session checker");
+	urf_startup_end (start, "session checker");
+}
+
+/**
+ * urf_daemon_late_startup_cb:
+ **/
+static gboolean
+urf_daemon_late_startup_cb (UrfDaemon *daemon)
+{
+	daemon->priv->late_startup_id = 0;
+	urf_daemon_late_startup (daemon);
+	return FALSE;
 }
 
 /**
@@ -178,180 +271,377 @@ gboolean
 urf_daemon_startup (UrfDaemon *daemon)
 {
 	UrfDaemonPrivate *priv = daemon->priv;
+	UrfRfkillBackend *backend;
+	const char *trace_file;
+	const char *metrics_file;
+	UrfStartupProbe *rfkill_probe;
+	UrfStartupProbe *input_probe = NULL;
+	char *socket_path = NULL;
+	char *dev_node;
 	gboolean ret;
+	gint64 start;
+
+	/* the udev scans don't need anything set up below, let them run
+	 * on the worker pool meanwhile */
+	rfkill_probe = urf_startup_probe_start ("rfkill udev", urf_daemon_probe_rfkill, NULL);
+	if (priv->key_control)
+		input_probe = urf_startup_probe_start ("input udev", urf_daemon_probe_input, NULL);
 
 	/* register on bus */
+	start = urf_startup_begin ();
 	ret = urf_daemon_register_rfkill_daemon (daemon);
 	if (!ret) {
-		g_warning ("failed to register");
+		urf_warning ("failed to register");
+		goto out;
+	}
+	urf_startup_end (start, "register");
+
+	/* the socket is shared by name, a live daemon keeps it */
+	socket_path = g_build_filename (urf_config_get_runtime_dir (priv->config),
+					URF_PEER_SOCKET_NAME, NULL);
+	if (urf_peer_server_in_use (socket_path)) {
+		urf_warning ("another urfkilld is serving %s", socket_path);
+		ret = FALSE;
 		goto out;
 	}
 
+	/* local consumers may skip the bus, the system bus still works */
+	start = urf_startup_begin ();
+	if (!urf_peer_server_startup (priv->peer_server,
+				      socket_path,
+				      G_DBUS_INTERFACE_SKELETON (priv->skeleton)))
+		urf_warning ("failed to setup peer socket");
+	urf_startup_end (start, "peer socket");
+
+	/* not fatal, tracing is for debugging */
+	trace_file = urf_config_get_trace_file (priv->config);
+	if (trace_file != NULL) {
+		priv->trace = urf_trace_new ();
+		if (urf_trace_open (priv->trace, trace_file)) {
+			urf_debug ("Recording a trace to %s", trace_file);
+			urf_killswitch_set_trace (priv->killswitch, priv->trace);
+		} else {
+			urf_warning ("failed to open the trace file");
+			g_object_unref (priv->trace);
+			priv->trace = NULL;
+		}
+	}
+
+	/* not fatal either, the metrics are still on the Debug interface */
+	metrics_file = urf_config_get_metrics_file (priv->config);
+	if (metrics_file != NULL &&
+	    !urf_metrics_start_textfile (priv->metrics, metrics_file,
+					 URF_DAEMON_METRICS_INTERVAL))
+		urf_warning ("failed to write the metrics file");
+
+	/* the timer costs wakeups, so only when debugging */
+	if (urf_config_get_watch_main_loop (priv->config))
+		urf_watchdog_watch_main_loop (priv->watchdog);
+
 	/* start up the killswitch */
+	urf_killswitch_set_udev_attrs (priv->killswitch,
+				       urf_startup_probe_join (rfkill_probe));
+	rfkill_probe = NULL;
+
+	start = urf_startup_begin ();
 	ret = urf_killswitch_startup (priv->killswitch, priv->config);
 	if (!ret) {
-		g_warning ("failed to setup killswitch");
+		urf_warning ("failed to setup killswitch");
 		goto out;
 	}
-
-	if (priv->key_control) {
-		/* start up input device monitor */
-		ret = urf_input_startup (priv->input);
-		if (!ret) {
-			g_warning ("failed to setup input device monitor");
-			goto out;
-		}
-
-		/* start up consolekit checker */
-		ret = urf_consolekit_startup (priv->consolekit);
-		if (!ret) {
-			g_warning ("failed to setup consolekit session checker");
-			goto out;
-		}
+	urf_startup_end (start, "killswitch");
+
+	/* a replayed trace brings its own key presses */
+	backend = urf_killswitch_get_backend (priv->killswitch);
+	if (URF_IS_RFKILL_REPLAY (backend))
+		g_signal_connect (backend, "rf-key-pressed",
+				  G_CALLBACK (urf_daemon_input_event_cb), daemon);
+
+	/* the input device has to be opened before the daemon drops root,
+	 * not fatal, the radios can still be switched over D-Bus */
+	if (input_probe != NULL) {
+		start = urf_startup_begin ();
+		dev_node = urf_startup_probe_join (input_probe);
+		input_probe = NULL;
+		if (!urf_input_open_device (priv->input, dev_node))
+			urf_warning ("failed to setup input device monitor");
+		g_free (dev_node);
+		urf_startup_end (start, "input");
 	}
+
+	/* the service is usable without key handling, so the ConsoleKit
+	 * round trips wait for the main loop */
+	if (priv->key_control)
+		priv->late_startup_id = g_idle_add_full (G_PRIORITY_LOW,
+							 (GSourceFunc) urf_daemon_late_startup_cb,
+							 daemon, NULL);
 out:
+	g_free (socket_path);
+	if (rfkill_probe != NULL)
+		g_hash_table_unref (urf_startup_probe_join (rfkill_probe));
+	if (input_probe != NULL)
+		g_free (urf_startup_probe_join (input_probe));
 	return ret;
 }
 
 /**
- * urf_daemon_block:
+ * urf_daemon_method_begin:
+ * @method: a static string naming the method
+ *
+ * Return value: the start time to pass to urf_daemon_method_end()
  **/
-gboolean
-urf_daemon_block (UrfDaemon             *daemon,
-		  const guint            type,
-		  const gboolean         block,
-		  DBusGMethodInvocation *context)
+static gint64
+urf_daemon_method_begin (const char *method)
+{
+	gint64 start = g_get_monotonic_time ();
+
+	if (URF_PROBE_ENABLED (method__entry))
+		URF_PROBE2 (method__entry, method, start);
+	return start;
+}
+
+/**
+ * urf_daemon_method_end:
+ *
+ * Call once the invocation has been answered.
+ **/
+static void
+urf_daemon_method_end (const char *method,
+		       gint64      start)
+{
+	urf_metrics_observe (URF_METRICS_METHOD_LATENCY, start);
+	if (URF_PROBE_ENABLED (method__return))
+		URF_PROBE3 (method__return, method, start, g_get_monotonic_time ());
+}
+
+/**
+ * urf_daemon_handle_block:
+ **/
+static gboolean
+urf_daemon_handle_block (UrfDbusDaemon         *skeleton,
+			 GDBusMethodInvocation *invocation,
+			 guint                  type,
+			 gboolean               block,
+			 UrfDaemon             *daemon)
 {
 	UrfDaemonPrivate *priv = daemon->priv;
-	PolkitSubject *subject = NULL;
+	PolkitSubject *subject;
+	gint64 start = urf_daemon_method_begin ("Block");
 	gboolean ret = FALSE;
 
-	if (!urf_killswitch_has_devices (priv->killswitch))
+	if (!urf_killswitch_has_devices (priv->killswitch)) {
+		urf_metrics_count (URF_METRICS_RFKILL_WRITES_ELIDED);
 		goto out;
+	}
 
-	subject = urf_polkit_get_subject (priv->polkit, context);
+	/* on failure the invocation has been answered with an error */
+	subject = urf_polkit_get_subject (priv->polkit, invocation);
 	if (subject == NULL)
-		goto out;
+		goto answered;
 
-	if (!urf_polkit_check_auth (priv->polkit, subject, "org.freedesktop.urfkill.block", context))
-		goto out;
+	if (!urf_polkit_check_auth (priv->polkit, subject, "org.freedesktop.urfkill.block", invocation)) {
+		g_object_unref (subject);
+		goto answered;
+	}
+	g_object_unref (subject);
 
 	ret = urf_killswitch_set_block (priv->killswitch, type, block);
 out:
-	if (subject != NULL)
-		g_object_unref (subject);
-
-	dbus_g_method_return (context, ret);
-
-	return ret;
+	urf_dbus_daemon_complete_block (skeleton, invocation, ret);
+answered:
+	urf_daemon_method_end ("Block", start);
+	return TRUE;
 }
 
 /**
- * urf_daemon_block_idx:
+ * urf_daemon_handle_block_idx:
  **/
-gboolean
-urf_daemon_block_idx (UrfDaemon             *daemon,
-		      const guint            index,
-		      const gboolean         block,
-		      DBusGMethodInvocation *context)
+static gboolean
+urf_daemon_handle_block_idx (UrfDbusDaemon         *skeleton,
+			     GDBusMethodInvocation *invocation,
+			     guint                  index,
+			     gboolean               block,
+			     UrfDaemon             *daemon)
 {
 	UrfDaemonPrivate *priv = daemon->priv;
-	PolkitSubject *subject = NULL;
+	PolkitSubject *subject;
+	gint64 start = urf_daemon_method_begin ("BlockIdx");
 	gboolean ret = FALSE;
 
-	if (!urf_killswitch_has_devices (priv->killswitch))
+	if (!urf_killswitch_has_devices (priv->killswitch)) {
+		urf_metrics_count (URF_METRICS_RFKILL_WRITES_ELIDED);
 		goto out;
+	}
 
-	subject = urf_polkit_get_subject (priv->polkit, context);
+	/* on failure the invocation has been answered with an error */
+	subject = urf_polkit_get_subject (priv->polkit, invocation);
 	if (subject == NULL)
-		goto out;
+		goto answered;
 
-	if (!urf_polkit_check_auth (priv->polkit, subject, "org.freedesktop.urfkill.blockidx", context))
-		goto out;
+	if (!urf_polkit_check_auth (priv->polkit, subject, "org.freedesktop.urfkill.blockidx", invocation)) {
+		g_object_unref (subject);
+		goto answered;
+	}
+	g_object_unref (subject);
 
 	ret = urf_killswitch_set_block_idx (priv->killswitch, index, block);
 out:
-	if (subject != NULL)
-		g_object_unref (subject);
+	urf_dbus_daemon_complete_block_idx (skeleton, invocation, ret);
+answered:
+	urf_daemon_method_end ("BlockIdx", start);
+	return TRUE;
+}
 
-	dbus_g_method_return (context, ret);
+/**
+ * urf_daemon_get_devices_reply:
+ *
+ * Return value: (transfer none): the reply of EnumerateDevices, built
+ *               once per change of the device list
+ **/
+static GVariant *
+urf_daemon_get_devices_reply (UrfDaemon *daemon)
+{
+	UrfDaemonPrivate *priv = daemon->priv;
+	GVariantBuilder builder;
+	GList *item;
 
-	return ret;
+	if (priv->devices_reply != NULL)
+		return priv->devices_reply;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("ao"));
+	item = urf_killswitch_get_devices (priv->killswitch);
+	for (; item; item = g_list_next (item))
+		g_variant_builder_add (&builder, "o",
+				       urf_device_get_object_path (URF_DEVICE (item->data)));
+
+	priv->devices_reply = g_variant_ref_sink (g_variant_new ("(ao)", &builder));
+
+	/* serialize now so that every reply only copies the data */
+	g_variant_get_data (priv->devices_reply);
+
+	urf_debug ("device list snapshot %u built", priv->devices_generation);
+
+	return priv->devices_reply;
 }
 
 /**
- * urf_daemon_get_all:
+ * urf_daemon_invalidate_devices_reply:
  **/
-gboolean
-urf_daemon_enumerate_devices (UrfDaemon             *daemon,
-			      DBusGMethodInvocation *context)
+static void
+urf_daemon_invalidate_devices_reply (UrfDaemon *daemon)
 {
 	UrfDaemonPrivate *priv = daemon->priv;
-	UrfDevice *device;
-	GPtrArray *object_paths;
-	GList *devices = NULL, *item = NULL;
 
-	g_return_val_if_fail (URF_IS_DAEMON (daemon), FALSE);
+	if (priv->devices_reply != NULL) {
+		g_variant_unref (priv->devices_reply);
+		priv->devices_reply = NULL;
+	}
+	priv->devices_generation++;
+}
 
-	devices = urf_killswitch_get_devices (priv->killswitch);
+/**
+ * urf_daemon_handle_enumerate_devices:
+ **/
+static gboolean
+urf_daemon_handle_enumerate_devices (UrfDbusDaemon         *skeleton,
+				     GDBusMethodInvocation *invocation,
+				     UrfDaemon             *daemon)
+{
+	gint64 start = urf_daemon_method_begin ("EnumerateDevices");
 
-	object_paths = g_ptr_array_sized_new (g_list_length(devices));
-	g_ptr_array_set_free_func (object_paths, g_free);
-	for (item = devices; item; item = g_list_next (item)) {
-		device = (UrfDevice *)item->data;
-		g_ptr_array_add (object_paths, g_strdup (urf_device_get_object_path (device)));
-	}
+	g_dbus_method_invocation_return_value (invocation,
+					       urf_daemon_get_devices_reply (daemon));
+	urf_daemon_method_end ("EnumerateDevices", start);
 
-	dbus_g_method_return (context, object_paths);
+	return TRUE;
+}
 
-	g_ptr_array_unref (object_paths);
+/**
+ * urf_daemon_handle_is_inhibited:
+ **/
+static gboolean
+urf_daemon_handle_is_inhibited (UrfDbusDaemon         *skeleton,
+				GDBusMethodInvocation *invocation,
+				UrfDaemon             *daemon)
+{
+	gint64 start = urf_daemon_method_begin ("IsInhibited");
 
+	urf_dbus_daemon_complete_is_inhibited (skeleton, invocation,
+					       urf_session_checker_is_inhibited (daemon->priv->session_checker));
+	urf_daemon_method_end ("IsInhibited", start);
 	return TRUE;
 }
 
 /**
- * urf_daemon_is_inhibited:
+ * urf_daemon_handle_inhibit:
  **/
-gboolean
-urf_daemon_is_inhibited (UrfDaemon             *daemon,
-			 DBusGMethodInvocation *context)
+static gboolean
+urf_daemon_handle_inhibit (UrfDbusDaemon         *skeleton,
+			   GDBusMethodInvocation *invocation,
+			   const char            *reason,
+			   UrfDaemon             *daemon)
 {
-	UrfDaemonPrivate *priv = daemon->priv;
+	const char *bus_name;
+	gint64 start = urf_daemon_method_begin ("Inhibit");
+	guint cookie = 0;
+
+	urf_metrics_count (URF_METRICS_INHIBITS);
+
+	/* inhibitions are dropped when the bus name vanishes, a peer
+	 * connection has none and gets cookie 0 like before */
+	bus_name = g_dbus_method_invocation_get_sender (invocation);
+	if (bus_name == NULL)
+		goto out;
 
-	dbus_g_method_return (context,
-			      urf_consolekit_is_inhibited (priv->consolekit));
+	/* the session checker may not be up yet */
+	if (daemon->priv->key_control)
+		urf_daemon_late_startup (daemon);
 
+	/* without key control no sessions are tracked, nothing to inhibit */
+	if (urf_session_checker_is_running (daemon->priv->session_checker))
+		cookie = urf_session_checker_inhibit (daemon->priv->session_checker, bus_name, reason);
+out:
+	urf_dbus_daemon_complete_inhibit (skeleton, invocation, cookie);
+	urf_daemon_method_end ("Inhibit", start);
 	return TRUE;
 }
 
 /**
- * urf_daemon_inhibit:
+ * urf_daemon_handle_uninhibit:
  **/
-gboolean
-urf_daemon_inhibit (UrfDaemon             *daemon,
-		    const char            *reason,
-		    DBusGMethodInvocation *context)
+static gboolean
+urf_daemon_handle_uninhibit (UrfDbusDaemon         *skeleton,
+			     GDBusMethodInvocation *invocation,
+			     guint                  cookie,
+			     UrfDaemon             *daemon)
 {
-	UrfDaemonPrivate *priv = daemon->priv;
-	char *bus_name;
-	guint cookie = 0;
+	gint64 start = urf_daemon_method_begin ("Uninhibit");
 
-	bus_name = dbus_g_method_get_sender (context);
-	cookie = urf_consolekit_inhibit (priv->consolekit, bus_name, reason);
-	dbus_g_method_return (context, cookie);
+	urf_metrics_count (URF_METRICS_UNINHIBITS);
+	urf_session_checker_uninhibit (daemon->priv->session_checker, cookie);
+	urf_dbus_daemon_complete_uninhibit (skeleton, invocation);
+	urf_daemon_method_end ("Uninhibit", start);
 
 	return TRUE;
 }
 
 /**
- * urf_daemon_uninhibit:
+ * urf_daemon_find_device:
  **/
-void
-urf_daemon_uninhibit (UrfDaemon             *daemon,
-		      const guint            cookie,
-		      DBusGMethodInvocation *context)
+static UrfDevice *
+urf_daemon_find_device (UrfDaemon  *daemon,
+			const char *object_path)
 {
-	urf_consolekit_uninhibit (daemon->priv->consolekit, cookie);
+	GList *item;
+
+	item = urf_killswitch_get_devices (daemon->priv->killswitch);
+	for (; item; item = g_list_next (item)) {
+		if (g_strcmp0 (urf_device_get_object_path (URF_DEVICE (item->data)),
+			       object_path) == 0)
+			return URF_DEVICE (item->data);
+	}
+
+	return NULL;
 }
 
 /**
@@ -362,14 +652,31 @@ urf_daemon_device_added_cb (UrfKillswitch *killswitch,
 			    const char    *object_path,
 			    UrfDaemon     *daemon)
 {
+	UrfDevice *device;
+
 	g_return_if_fail (URF_IS_DAEMON (daemon));
 	g_return_if_fail (URF_IS_KILLSWITCH (killswitch));
 
 	if (object_path == NULL) {
-		g_warning ("Invalid object path");
+		urf_warning ("Invalid object path");
 		return;
 	}
-	g_signal_emit (daemon, signals[SIGNAL_DEVICE_ADDED], 0, object_path);
+
+	device = urf_daemon_find_device (daemon, object_path);
+	if (device == NULL) {
+		urf_warning ("No device for %s", object_path);
+		return;
+	}
+
+	urf_daemon_invalidate_devices_reply (daemon);
+
+	/* InterfacesAdded carries all the properties of the device */
+	g_dbus_object_manager_server_export (daemon->priv->manager,
+					     urf_device_get_object (device));
+	urf_peer_server_export_device (daemon->priv->peer_server,
+				       urf_device_get_object (device));
+	urf_dbus_daemon_emit_device_added (daemon->priv->skeleton, object_path);
+	urf_metrics_count (URF_METRICS_SIGNALS_EMITTED);
 }
 
 /**
@@ -383,10 +690,27 @@ urf_daemon_device_removed_cb (UrfKillswitch *killswitch,
 	g_return_if_fail (URF_IS_DAEMON (daemon));
 	g_return_if_fail (URF_IS_KILLSWITCH (killswitch));
 	if (object_path == NULL) {
-		g_warning ("Invalid object path");
+		urf_warning ("Invalid object path");
 		return;
 	}
-	g_signal_emit (daemon, signals[SIGNAL_DEVICE_REMOVED], 0, object_path);
+	urf_daemon_invalidate_devices_reply (daemon);
+	g_dbus_object_manager_server_unexport (daemon->priv->manager, object_path);
+	urf_peer_server_unexport_device (daemon->priv->peer_server, object_path);
+	urf_dbus_daemon_emit_device_removed (daemon->priv->skeleton, object_path);
+	urf_metrics_count (URF_METRICS_SIGNALS_EMITTED);
+}
+
+/**
+ * urf_daemon_type_name:
+ **/
+static const char *
+urf_daemon_type_name (guint type)
+{
+	static const char *names[] = URF_TYPE_NAMES;
+
+	if (type >= G_N_ELEMENTS (names))
+		return NULL;
+	return names[type];
 }
 
 /**
@@ -397,13 +721,104 @@ urf_daemon_device_changed_cb (UrfKillswitch *killswitch,
 			      const char    *object_path,
 			      UrfDaemon     *daemon)
 {
+	UrfDevice *device;
+	const char *type_name;
+
 	g_return_if_fail (URF_IS_DAEMON (daemon));
 	g_return_if_fail (URF_IS_KILLSWITCH (killswitch));
 	if (object_path == NULL) {
-		g_warning ("Invalid object path");
+		urf_warning ("Invalid object path");
 		return;
 	}
-	g_signal_emit (daemon, signals[SIGNAL_DEVICE_CHANGED], 0, object_path);
+	urf_dbus_daemon_emit_device_changed (daemon->priv->skeleton, object_path);
+	urf_metrics_count (URF_METRICS_SIGNALS_EMITTED);
+
+	/* type-tagged copy, so arg0 match rules can filter by type */
+	device = urf_daemon_find_device (daemon, object_path);
+	if (device == NULL)
+		return;
+	type_name = urf_daemon_type_name (urf_device_get_rf_type (device));
+	if (type_name == NULL)
+		return;
+	urf_dbus_daemon_emit_device_type_changed (daemon->priv->skeleton,
+						  type_name,
+						  object_path,
+						  urf_device_get_soft (device),
+						  urf_device_get_hard (device),
+						  urf_device_get_generation (device));
+	urf_metrics_count (URF_METRICS_SIGNALS_EMITTED);
+}
+
+/**
+ * urf_daemon_handle_get_main_loop_stats:
+ **/
+static gboolean
+urf_daemon_handle_get_main_loop_stats (UrfDbusDebug          *skeleton,
+				       GDBusMethodInvocation *invocation,
+				       UrfDaemon             *daemon)
+{
+	guint interval;
+	guint64 ticks, stalls, max_latency, total_latency;
+
+	urf_watchdog_get_main_loop_stats (daemon->priv->watchdog,
+					  &interval, &ticks, &stalls,
+					  &max_latency, &total_latency);
+	urf_dbus_debug_complete_get_main_loop_stats (skeleton, invocation,
+						     interval, ticks, stalls,
+						     max_latency, total_latency);
+	return TRUE;
+}
+
+/**
+ * urf_daemon_handle_get_blocking_calls:
+ **/
+static gboolean
+urf_daemon_handle_get_blocking_calls (UrfDbusDebug          *skeleton,
+				      GDBusMethodInvocation *invocation,
+				      UrfDaemon             *daemon)
+{
+	urf_dbus_debug_complete_get_blocking_calls (skeleton, invocation,
+						    urf_watchdog_get_blocking_calls (daemon->priv->watchdog));
+	return TRUE;
+}
+
+/**
+ * urf_daemon_handle_get_counters:
+ **/
+static gboolean
+urf_daemon_handle_get_counters (UrfDbusDebug          *skeleton,
+				GDBusMethodInvocation *invocation,
+				UrfDaemon             *daemon)
+{
+	urf_dbus_debug_complete_get_counters (skeleton, invocation,
+					      urf_metrics_get_counters (daemon->priv->metrics));
+	return TRUE;
+}
+
+/**
+ * urf_daemon_handle_get_key_presses:
+ **/
+static gboolean
+urf_daemon_handle_get_key_presses (UrfDbusDebug          *skeleton,
+				   GDBusMethodInvocation *invocation,
+				   UrfDaemon             *daemon)
+{
+	urf_dbus_debug_complete_get_key_presses (skeleton, invocation,
+						 urf_metrics_get_key_presses (daemon->priv->metrics));
+	return TRUE;
+}
+
+/**
+ * urf_daemon_handle_get_histograms:
+ **/
+static gboolean
+urf_daemon_handle_get_histograms (UrfDbusDebug          *skeleton,
+				  GDBusMethodInvocation *invocation,
+				  UrfDaemon             *daemon)
+{
+	urf_dbus_debug_complete_get_histograms (skeleton, invocation,
+						urf_metrics_get_histograms (daemon->priv->metrics));
+	return TRUE;
 }
 
 /**
@@ -413,6 +828,8 @@ static void
 urf_daemon_init (UrfDaemon *daemon)
 {
 	daemon->priv = URF_DAEMON_GET_PRIVATE (daemon);
+	daemon->priv->watchdog = urf_watchdog_new ();
+	daemon->priv->metrics = urf_metrics_new ();
 	daemon->priv->polkit = urf_polkit_new ();
 
 	daemon->priv->killswitch = urf_killswitch_new ();
@@ -427,32 +844,44 @@ urf_daemon_init (UrfDaemon *daemon)
 	g_signal_connect (daemon->priv->input, "rf-key-pressed",
 			  G_CALLBACK (urf_daemon_input_event_cb), daemon);
 
-	daemon->priv->consolekit = urf_consolekit_new ();
+	daemon->priv->session_checker = urf_session_checker_new ();
+	daemon->priv->trace = NULL;
+
+	daemon->priv->manager = g_dbus_object_manager_server_new (URFKILL_OBJECT_PATH);
+	daemon->priv->peer_server = urf_peer_server_new ();
+
+	daemon->priv->skeleton = urf_dbus_daemon_skeleton_new ();
+	urf_dbus_daemon_set_daemon_version (daemon->priv->skeleton, PACKAGE_VERSION);
+	g_signal_connect (daemon->priv->skeleton, "handle-block",
+			  G_CALLBACK (urf_daemon_handle_block), daemon);
+	g_signal_connect (daemon->priv->skeleton, "handle-block-idx",
+			  G_CALLBACK (urf_daemon_handle_block_idx), daemon);
+	g_signal_connect (daemon->priv->skeleton, "handle-enumerate-devices",
+			  G_CALLBACK (urf_daemon_handle_enumerate_devices), daemon);
+	g_signal_connect (daemon->priv->skeleton, "handle-is-inhibited",
+			  G_CALLBACK (urf_daemon_handle_is_inhibited), daemon);
+	g_signal_connect (daemon->priv->skeleton, "handle-inhibit",
+			  G_CALLBACK (urf_daemon_handle_inhibit), daemon);
+	g_signal_connect (daemon->priv->skeleton, "handle-uninhibit",
+			  G_CALLBACK (urf_daemon_handle_uninhibit), daemon);
+
+	daemon->priv->debug_skeleton = urf_dbus_debug_skeleton_new ();
+	g_signal_connect (daemon->priv->debug_skeleton, "handle-get-main-loop-stats",
+			  G_CALLBACK (urf_daemon_handle_get_main_loop_stats), daemon);
+	g_signal_connect (daemon->priv->debug_skeleton, "handle-get-blocking-calls",
+			  G_CALLBACK (urf_daemon_handle_get_blocking_calls), daemon);
+	g_signal_connect (daemon->priv->debug_skeleton, "handle-get-counters",
+			  G_CALLBACK (urf_daemon_handle_get_counters), daemon);
+	g_signal_connect (daemon->priv->debug_skeleton, "handle-get-key-presses",
+			  G_CALLBACK (urf_daemon_handle_get_key_presses), daemon);
+	g_signal_connect (daemon->priv->debug_skeleton, "handle-get-histograms",
+			  G_CALLBACK (urf_daemon_handle_get_histograms), daemon);
 }
 
-/**
- * urf_daemon_get_property:
- **/
-static void
-urf_daemon_get_property (GObject    *object,
-			 guint       prop_id,
-			 GValue     *value,
-			 GParamSpec *pspec)
-{
-	UrfDaemon *daemon = URF_DAEMON (object);
-
-	switch (prop_id) {
-	case PROP_DAEMON_VERSION:
-		g_value_set_string (value, PACKAGE_VERSION);
-		break;
-	case PROP_KEY_CONTROL:
-		g_value_set_boolean (value, daemon->priv->key_control);
-		break;
-	default:
-		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
-		break;
-	}
-}
+static const GDBusErrorEntry urf_daemon_error_entries[] = {
+	{ URF_DAEMON_ERROR_GENERAL, "org.freedesktop.URfkill.GeneralError" },
+};
+G_STATIC_ASSERT (G_N_ELEMENTS (urf_daemon_error_entries) == URF_DAEMON_NUM_ERRORS);
 
 /**
  * urf_daemon_error_quark:
@@ -460,30 +889,13 @@ urf_daemon_get_property (GObject    *object,
 GQuark
 urf_daemon_error_quark (void)
 {
-	static GQuark ret = 0;
-	if (ret == 0)
-		ret = g_quark_from_static_string ("urf_daemon_error");
-	return ret;
-}
-
-#define ENUM_ENTRY(NAME, DESC) { NAME, "" #NAME "", DESC }
-/**
- * urf_daemon_error_get_type:
- **/
-GType
-urf_daemon_error_get_type (void)
-{
-	static GType etype = 0;
+	static volatile gsize quark = 0;
 
-	if (etype == 0) {
-		static const GEnumValue values[] = {
-			ENUM_ENTRY (URF_DAEMON_ERROR_GENERAL, "GeneralError"),
-			{ 0, 0, 0 }
-		};
-		g_assert (URF_DAEMON_NUM_ERRORS == G_N_ELEMENTS (values) - 1);
-		etype = g_enum_register_static ("UrfDaemonError", values);
-	}
-	return etype;
+	g_dbus_error_register_error_domain ("urf_daemon_error",
+					    &quark,
+					    urf_daemon_error_entries,
+					    G_N_ELEMENTS (urf_daemon_error_entries));
+	return (GQuark) quark;
 }
 
 /**
@@ -494,60 +906,8 @@ urf_daemon_class_init (UrfDaemonClass *klass)
 {
 	GObjectClass *object_class = G_OBJECT_CLASS (klass);
 	object_class->dispose = urf_daemon_dispose;
-	object_class->get_property = urf_daemon_get_property;
 
 	g_type_class_add_private (klass, sizeof (UrfDaemonPrivate));
-
-	signals[SIGNAL_DEVICE_ADDED] =
-		g_signal_new ("device-added",
-			      G_OBJECT_CLASS_TYPE (klass),
-			      G_SIGNAL_RUN_LAST | G_SIGNAL_DETAILED,
-			      0, NULL, NULL,
-			      g_cclosure_marshal_VOID__STRING,
-			      G_TYPE_NONE, 1, G_TYPE_STRING);
-
-	signals[SIGNAL_DEVICE_REMOVED] =
-		g_signal_new ("device-removed",
-			      G_OBJECT_CLASS_TYPE (klass),
-			      G_SIGNAL_RUN_LAST | G_SIGNAL_DETAILED,
-			      0, NULL, NULL,
-			      g_cclosure_marshal_VOID__STRING,
-			      G_TYPE_NONE, 1, G_TYPE_STRING);
-
-	signals[SIGNAL_DEVICE_CHANGED] =
-		g_signal_new ("device-changed",
-			      G_OBJECT_CLASS_TYPE (klass),
-			      G_SIGNAL_RUN_LAST | G_SIGNAL_DETAILED,
-			      0, NULL, NULL,
-			      g_cclosure_marshal_VOID__STRING,
-			      G_TYPE_NONE, 1, G_TYPE_STRING);
-
-	signals[SIGNAL_URFKEY_PRESSED] =
-		g_signal_new ("urfkey-pressed",
-			      G_OBJECT_CLASS_TYPE (klass),
-			      G_SIGNAL_RUN_LAST | G_SIGNAL_DETAILED,
-			      0, NULL, NULL,
-			      g_cclosure_marshal_VOID__INT,
-			      G_TYPE_NONE, 1, G_TYPE_INT);
-
-	g_object_class_install_property (object_class,
-					 PROP_DAEMON_VERSION,
-					 g_param_spec_string ("daemon-version",
-							      "Daemon Version",
-							      "The version of the running daemon",
-							      NULL,
-							      G_PARAM_READABLE));
-
-	g_object_class_install_property (object_class,
-					 PROP_KEY_CONTROL,
-					 g_param_spec_boolean ("key-control",
-							       "Key Control",
-							       "Whether the key control is enabled",
-							       FALSE,
-							       G_PARAM_READABLE));
-
-	dbus_g_object_type_install_info (URF_TYPE_DAEMON, &dbus_glib_urf_daemon_object_info);
-	dbus_g_error_domain_register (URF_DAEMON_ERROR, NULL, URF_DAEMON_TYPE_ERROR);
 }
 
 /**
@@ -559,16 +919,16 @@ urf_daemon_dispose (GObject *object)
 	UrfDaemon *daemon = URF_DAEMON (object);
 	UrfDaemonPrivate *priv = daemon->priv;
 
+	if (priv->late_startup_id != 0) {
+		g_source_remove (priv->late_startup_id);
+		priv->late_startup_id = 0;
+	}
+
 	if (priv->config) {
 		g_object_unref (priv->config);
 		priv->config = NULL;
 	}
 
-	if (priv->connection) {
-		dbus_g_connection_unref (priv->connection);
-		priv->connection = NULL;
-	}
-
 	if (priv->polkit) {
 		g_object_unref (priv->polkit);
 		priv->polkit = NULL;
@@ -579,9 +939,59 @@ urf_daemon_dispose (GObject *object)
 		priv->killswitch = NULL;
 	}
 
-	if (priv->consolekit) {
-		g_object_unref (priv->consolekit);
-		priv->consolekit = NULL;
+	if (priv->trace) {
+		g_object_unref (priv->trace);
+		priv->trace = NULL;
+	}
+
+	if (priv->session_checker) {
+		g_object_unref (priv->session_checker);
+		priv->session_checker = NULL;
+	}
+
+	if (priv->devices_reply) {
+		g_variant_unref (priv->devices_reply);
+		priv->devices_reply = NULL;
+	}
+
+	/* drops the peer exports of the skeleton */
+	if (priv->peer_server) {
+		g_object_unref (priv->peer_server);
+		priv->peer_server = NULL;
+	}
+
+	if (priv->manager) {
+		g_object_unref (priv->manager);
+		priv->manager = NULL;
+	}
+
+	if (priv->skeleton) {
+		if (g_dbus_interface_skeleton_get_connection (G_DBUS_INTERFACE_SKELETON (priv->skeleton)))
+			g_dbus_interface_skeleton_unexport (G_DBUS_INTERFACE_SKELETON (priv->skeleton));
+		g_object_unref (priv->skeleton);
+		priv->skeleton = NULL;
+	}
+
+	if (priv->debug_skeleton) {
+		if (g_dbus_interface_skeleton_get_connection (G_DBUS_INTERFACE_SKELETON (priv->debug_skeleton)))
+			g_dbus_interface_skeleton_unexport (G_DBUS_INTERFACE_SKELETON (priv->debug_skeleton));
+		g_object_unref (priv->debug_skeleton);
+		priv->debug_skeleton = NULL;
+	}
+
+	if (priv->watchdog) {
+		g_object_unref (priv->watchdog);
+		priv->watchdog = NULL;
+	}
+
+	if (priv->metrics) {
+		g_object_unref (priv->metrics);
+		priv->metrics = NULL;
+	}
+
+	if (priv->connection) {
+		g_object_unref (priv->connection);
+		priv->connection = NULL;
 	}
 
 	G_OBJECT_CLASS (urf_daemon_parent_class)->dispose (object);
@@ -598,5 +1008,6 @@ urf_daemon_new (UrfConfig *config)
 	daemon->priv->config = g_object_ref (config);
 	daemon->priv->key_control = urf_config_get_key_control (config);
 	daemon->priv->master_key = urf_config_get_master_key (config);
+	urf_dbus_daemon_set_key_control (daemon->priv->skeleton, daemon->priv->key_control);
 	return daemon;
 }
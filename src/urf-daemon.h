@@ -23,7 +23,6 @@
 
 #include <glib-object.h>
 #include <polkit/polkit.h>
-#include <dbus/dbus-glib.h>
 
 #include "urf-config.h"
 
@@ -57,32 +56,11 @@ typedef enum
 
 #define URF_DAEMON_ERROR urf_daemon_error_quark ()
 
-GType urf_daemon_error_get_type (void);
-#define URF_DAEMON_TYPE_ERROR (urf_daemon_error_get_type ())
-
 GQuark		 urf_daemon_error_quark		(void);
 GType		 urf_daemon_get_type		(void);
 UrfDaemon	*urf_daemon_new			(UrfConfig		*config);
 
 gboolean	 urf_daemon_startup		(UrfDaemon		*daemon);
-gboolean	 urf_daemon_block		(UrfDaemon		*daemon,
-						 const guint		 type,
-						 const gboolean		 block,
-						 DBusGMethodInvocation  *context);
-gboolean	 urf_daemon_block_idx		(UrfDaemon		*daemon,
-						 const guint		 index,
-						 const gboolean		 block,
-						 DBusGMethodInvocation  *context);
-gboolean	 urf_daemon_enumerate_devices	(UrfDaemon		*daemon,
-						 DBusGMethodInvocation  *context);
-gboolean	 urf_daemon_is_inhibited	(UrfDaemon		*daemon,
-						 DBusGMethodInvocation  *context);
-gboolean	 urf_daemon_inhibit		(UrfDaemon		*daemon,
-						 const char		*reason,
-						 DBusGMethodInvocation  *context);
-void		 urf_daemon_uninhibit		(UrfDaemon		*daemon,
-						 const guint		 cookie,
-						 DBusGMethodInvocation  *context);
 
 G_END_DECLS
 
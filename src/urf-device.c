@@ -24,33 +24,17 @@
 
 #include <stdlib.h>
 #include <glib.h>
+#include <gio/gio.h>
 #include <linux/rfkill.h>
-#include <dbus/dbus-glib.h>
 #include <libudev.h>
 
 #include "urf-device.h"
+#include "urf-log.h"
 
 #include "urf-device-glue.h"
 #include "urf-utils.h"
-
-enum
-{
-	PROP_0,
-	PROP_DEVICE_INDEX,
-	PROP_DEVICE_TYPE,
-	PROP_DEVICE_NAME,
-	PROP_DEVICE_SOFT,
-	PROP_DEVICE_HARD,
-	PROP_DEVICE_PLATFORM,
-	PROP_LAST
-};
-
-enum {
-	SIGNAL_CHANGED,
-	LAST_SIGNAL
-};
-
-static int signals[LAST_SIGNAL] = { 0 };
+#include "urf-watchdog.h"
+#include "urf-metrics.h"
 
 #define URF_DEVICE_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), \
                                 URF_TYPE_DEVICE, UrfDevicePrivate))
@@ -62,8 +46,10 @@ struct UrfDevicePrivate {
 	gboolean	 soft;
 	gboolean	 hard;
 	gboolean	 platform;
+	guint		 generation;
 	char		*object_path;
-	DBusGConnection	*connection;
+	GDBusObjectSkeleton *object;
+	UrfDbusDevice	*skeleton;
 };
 
 G_DEFINE_TYPE(UrfDevice, urf_device, G_TYPE_OBJECT)
@@ -84,29 +70,6 @@ urf_device_error_quark (void)
 	return ret;
 }
 
-#define ENUM_ENTRY(NAME, DESC) { NAME, "" #NAME "", DESC }
-
-/**
- * up_device_error_get_type:
- **/
-GType
-urf_device_error_get_type (void)
-{
-static GType etype = 0;
-
-	if (etype == 0) {
-		static const GEnumValue values[] =
-			{
-				ENUM_ENTRY (URF_DEVICE_ERROR_GENERAL, "GeneralError"),
-				{ 0, 0, 0 }
-			};
-		g_assert (URF_DEVICE_NUM_ERRORS == G_N_ELEMENTS (values) - 1);
-		etype = g_enum_register_static ("UrfDeviceError", values);
-	}
-
-	return etype;
-}
-
 /**
  * urf_device_update_states:
  *
@@ -123,7 +86,14 @@ urf_device_update_states (UrfDevice      *device,
 	if (priv->soft != soft || priv->hard != hard) {
 		priv->soft = soft;
 		priv->hard = hard;
-		g_signal_emit (G_OBJECT (device), signals[SIGNAL_CHANGED], 0);
+		priv->generation++;
+		urf_dbus_device_set_soft (priv->skeleton, soft);
+		urf_dbus_device_set_hard (priv->skeleton, hard);
+		urf_dbus_device_set_generation (priv->skeleton, priv->generation);
+		/* let clients see the new states before Changed */
+		g_dbus_interface_skeleton_flush (G_DBUS_INTERFACE_SKELETON (priv->skeleton));
+		urf_dbus_device_emit_changed (priv->skeleton);
+		urf_metrics_count (URF_METRICS_SIGNALS_EMITTED);
 		return TRUE;
 	}
 
@@ -148,6 +118,15 @@ urf_device_get_rf_type (UrfDevice *device)
 	return device->priv->type;
 }
 
+/**
+ * urf_device_get_generation:
+ **/
+guint
+urf_device_get_generation (UrfDevice *device)
+{
+	return device->priv->generation;
+}
+
 /**
  * urf_device_get_name:
  **/
@@ -184,6 +163,18 @@ urf_device_get_object_path (UrfDevice *device)
 	return device->priv->object_path;
 }
 
+/**
+ * urf_device_get_object:
+ *
+ * Return value: (transfer none): the object to be exported by the
+ *               object manager of the daemon
+ **/
+GDBusObjectSkeleton *
+urf_device_get_object (UrfDevice *device)
+{
+	return device->priv->object;
+}
+
 /**
  * urf_device_is_platform:
  */
@@ -193,43 +184,6 @@ urf_device_is_platform (UrfDevice *device)
 	return device->priv->platform;
 }
 
-/**
- * urf_device_get_property:
- **/
-static void
-urf_device_get_property (GObject    *object,
-			 guint       prop_id,
-			 GValue     *value,
-			 GParamSpec *pspec)
-{
-	UrfDevice *device = URF_DEVICE (object);
-	UrfDevicePrivate *priv = device->priv;
-
-	switch (prop_id) {
-	case PROP_DEVICE_INDEX:
-		g_value_set_uint (value, priv->index);
-		break;
-	case PROP_DEVICE_TYPE:
-		g_value_set_uint (value, priv->type);
-		break;
-	case PROP_DEVICE_SOFT:
-		g_value_set_boolean (value, priv->soft);
-		break;
-	case PROP_DEVICE_HARD:
-		g_value_set_boolean (value, priv->hard);
-		break;
-	case PROP_DEVICE_NAME:
-		g_value_set_string (value, priv->name);
-		break;
-	case PROP_DEVICE_PLATFORM:
-		g_value_set_boolean (value, priv->platform);
-		break;
-	default:
-		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
-		break;
-	}
-}
-
 /**
  * urf_device_dispose:
  **/
@@ -238,9 +192,13 @@ urf_device_dispose (GObject *object)
 {
 	UrfDevicePrivate *priv = URF_DEVICE_GET_PRIVATE (object);
 
-	if (priv->connection) {
-		dbus_g_connection_unref (priv->connection);
-		priv->connection = NULL;
+	if (priv->object) {
+		g_object_unref (priv->object);
+		priv->object = NULL;
+	}
+	if (priv->skeleton) {
+		g_object_unref (priv->skeleton);
+		priv->skeleton = NULL;
 	}
 
 	G_OBJECT_CLASS(urf_device_parent_class)->dispose(object);
@@ -271,7 +229,10 @@ urf_device_init (UrfDevice *device)
 	device->priv = URF_DEVICE_GET_PRIVATE (device);
 	device->priv->name = NULL;
 	device->priv->platform = FALSE;
+	device->priv->generation = 1;
 	device->priv->object_path = NULL;
+	device->priv->object = NULL;
+	device->priv->skeleton = NULL;
 }
 
 /**
@@ -281,77 +242,10 @@ static void
 urf_device_class_init(UrfDeviceClass *klass)
 {
 	GObjectClass *object_class = (GObjectClass *) klass;
-	GParamSpec *pspec;
 
 	g_type_class_add_private(klass, sizeof(UrfDevicePrivate));
-	object_class->get_property = urf_device_get_property;
 	object_class->dispose = urf_device_dispose;
 	object_class->finalize = urf_device_finalize;
-
-	signals[SIGNAL_CHANGED] =
-		g_signal_new ("changed",
-			      G_OBJECT_CLASS_TYPE (klass),
-			      G_SIGNAL_RUN_LAST | G_SIGNAL_DETAILED,
-			      0, NULL, NULL,
-			      g_cclosure_marshal_VOID__VOID,
-			      G_TYPE_NONE, 0, G_TYPE_NONE);
-
-	pspec = g_param_spec_uint ("index",
-				   "Killswitch Index",
-				   "The Index of the killswitch device",
-				   0, G_MAXUINT, 0,
-				   G_PARAM_READABLE);
-	g_object_class_install_property (object_class,
-					 PROP_DEVICE_INDEX,
-					 pspec);
-
-	pspec = g_param_spec_uint ("type",
-				   "Killswitch Type",
-				   "The type of the killswitch device",
-				   0, NUM_RFKILL_TYPES, 0,
-				   G_PARAM_READABLE);
-	g_object_class_install_property (object_class,
-					 PROP_DEVICE_TYPE,
-					 pspec);
-
-	pspec = g_param_spec_boolean ("soft",
-				      "Killswitch Soft Block",
-				      "The soft block of the killswitch device",
-				      FALSE,
-				      G_PARAM_READABLE);
-	g_object_class_install_property (object_class,
-					 PROP_DEVICE_SOFT,
-					 pspec);
-
-	pspec = g_param_spec_boolean ("hard",
-				      "Killswitch Hard Block",
-				      "The hard block of the killswitch device",
-				      FALSE,
-				      G_PARAM_READABLE);
-	g_object_class_install_property (object_class,
-					 PROP_DEVICE_HARD,
-					 pspec);
-
-	pspec = g_param_spec_string ("name",
-				     "Killswitch Name",
-				     "The name of the killswitch device",
-				     NULL,
-				     G_PARAM_READABLE);
-	g_object_class_install_property (object_class,
-					 PROP_DEVICE_NAME,
-					 pspec);
-
-	pspec = g_param_spec_boolean ("platform",
-				      "Platform Driver",
-				      "Whether the device is generated by a platform driver or not",
-				      FALSE,
-				      G_PARAM_READABLE);
-	g_object_class_install_property (object_class,
-					 PROP_DEVICE_PLATFORM,
-					 pspec);
-
-	dbus_g_object_type_install_info (URF_TYPE_DEVICE, &dbus_glib_urf_device_object_info);
-	dbus_g_error_domain_register (URF_DEVICE_ERROR, NULL, URF_DEVICE_TYPE_ERROR);
 }
 
 /**
@@ -365,46 +259,58 @@ urf_device_compute_object_path (UrfDevice *device)
 }
 
 /**
- * urf_device_register_device:
+ * urf_device_create_object:
  **/
-static gboolean
-urf_device_register_device (UrfDevice *device)
+static void
+urf_device_create_object (UrfDevice *device)
 {
 	UrfDevicePrivate *priv = device->priv;
-	gboolean ret = TRUE;
-	GError *error = NULL;
 
-	device->priv->connection = dbus_g_bus_get (DBUS_BUS_SYSTEM, &error);
-	if (device->priv->connection == NULL) {
-		g_error ("error getting system bus: %s", error->message);
-		g_error_free (error);
-	}
+	priv->skeleton = urf_dbus_device_skeleton_new ();
+	urf_dbus_device_set_index (priv->skeleton, priv->index);
+	urf_dbus_device_set_device_type (priv->skeleton, priv->type);
+	urf_dbus_device_set_name (priv->skeleton, priv->name);
+	urf_dbus_device_set_soft (priv->skeleton, priv->soft);
+	urf_dbus_device_set_hard (priv->skeleton, priv->hard);
+	urf_dbus_device_set_platform (priv->skeleton, priv->platform);
+	urf_dbus_device_set_generation (priv->skeleton, priv->generation);
 
 	priv->object_path = urf_device_compute_object_path (device);
-	dbus_g_connection_register_g_object (priv->connection,
-					     priv->object_path, G_OBJECT (device));
-	return ret;
+	priv->object = g_dbus_object_skeleton_new (priv->object_path);
+	g_dbus_object_skeleton_add_interface (priv->object,
+					      G_DBUS_INTERFACE_SKELETON (priv->skeleton));
 }
 
 /**
  * urf_device_get_udev_attrs
  */
 static void
-urf_device_get_udev_attrs (UrfDevice *device)
+urf_device_get_udev_attrs (UrfDevice             *device,
+			   const RfkillUdevAttrs *attrs)
 {
 	UrfDevicePrivate *priv = device->priv;
 	struct udev *udev;
 	struct udev_device *dev;
 	struct udev_device *parent_dev;
+	gint64 start;
+
+	/* looked up ahead, possibly on another thread */
+	if (attrs != NULL) {
+		priv->name = g_strdup (attrs->name);
+		priv->platform = attrs->platform;
+		return;
+	}
 
 	udev = udev_new ();
 	if (udev == NULL) {
-		g_warning ("udev_new() failed");
+		urf_warning ("udev_new() failed");
 		return;
 	}
+	start = urf_watchdog_begin ();
 	dev = get_rfkill_device_by_index (udev, priv->index);
+	urf_watchdog_end (start, "udev rfkill lookup");
 	if (!dev) {
-		g_warning ("Failed to get udev device for index %u", priv->index);
+		urf_warning ("Failed to get udev device for index %u", priv->index);
 		udev_unref (udev);
 		return;
 	}
@@ -421,12 +327,14 @@ urf_device_get_udev_attrs (UrfDevice *device)
 
 /**
  * urf_device_new:
+ * @attrs: (allow-none): the udev attributes if they are already known
  */
 UrfDevice *
-urf_device_new (guint    index,
-		guint    type,
-		gboolean soft,
-		gboolean hard)
+urf_device_new (guint                  index,
+		guint                  type,
+		gboolean               soft,
+		gboolean               hard,
+		const RfkillUdevAttrs *attrs)
 {
 	UrfDevice *device = URF_DEVICE(g_object_new (URF_TYPE_DEVICE, NULL));
 	UrfDevicePrivate *priv = device->priv;
@@ -436,10 +344,8 @@ urf_device_new (guint    index,
 	priv->soft = soft;
 	priv->hard = hard;
 
-	urf_device_get_udev_attrs (device);
-
-	if (!urf_device_register_device (device))
-		return NULL;
+	urf_device_get_udev_attrs (device, attrs);
+	urf_device_create_object (device);
 
 	return device;
 }
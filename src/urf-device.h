@@ -22,6 +22,9 @@
 #define __URF_DEVICE_H__
 
 #include <glib-object.h>
+#include <gio/gio.h>
+
+#include "urf-utils.h"
 
 G_BEGIN_DECLS
 
@@ -55,14 +58,14 @@ typedef enum
 } UrfDeviceError;
 
 #define URF_DEVICE_ERROR urf_device_error_quark ()
-#define URF_DEVICE_TYPE_ERROR (urf_device_error_get_type ())
 
 GType			 urf_device_get_type		(void);
 
 UrfDevice		*urf_device_new			(guint		 index,
 							 guint		 type,
 							 gboolean	 soft,
-							 gboolean	 hard);
+							 gboolean	 hard,
+							 const RfkillUdevAttrs *attrs);
 
 gboolean		 urf_device_update_states	(UrfDevice	*device,
 							 const gboolean	 soft,
@@ -70,10 +73,12 @@ gboolean		 urf_device_update_states	(UrfDevice	*device,
 
 guint			 urf_device_get_index		(UrfDevice	*device);
 guint			 urf_device_get_rf_type		(UrfDevice	*device);
+guint			 urf_device_get_generation	(UrfDevice	*device);
 const char 		*urf_device_get_name		(UrfDevice	*device);
 gboolean		 urf_device_get_soft		(UrfDevice	*device);
 gboolean		 urf_device_get_hard		(UrfDevice	*device);
 const char		*urf_device_get_object_path	(UrfDevice	*device);
+GDBusObjectSkeleton	*urf_device_get_object		(UrfDevice	*device);
 gboolean		 urf_device_is_platform		(UrfDevice	*device);
 
 G_END_DECLS
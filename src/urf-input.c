@@ -39,6 +39,7 @@
 #define KEY_KEEPING_PRESSED 2
 
 #include "urf-input.h"
+#include "urf-log.h"
 
 enum {
 	RF_KEY_PRESSED,
@@ -136,7 +137,7 @@ input_event_cb (GIOChannel   *source,
 							  NULL);
 		}
 	} else {
-		g_warning ("Failed to fetch the input event");
+		urf_warning ("Failed to fetch the input event");
 		return FALSE;
 	}
 
@@ -153,7 +154,7 @@ input_dev_open_channel (UrfInput   *input,
 	fd = open(dev_node, O_RDONLY | O_NONBLOCK);
 	if (fd < 0) {
 		if (errno == EACCES)
-			g_warning ("Could not open %s", dev_node);
+			urf_warning ("Could not open %s", dev_node);
 		return FALSE;
 	}
 
@@ -165,16 +166,21 @@ input_dev_open_channel (UrfInput   *input,
 					 G_IO_IN | G_IO_HUP | G_IO_ERR,
 					 (GIOFunc) input_event_cb,
 					 input);
-	g_debug ("Watch %s", dev_node);
+	urf_debug ("Watch %s", dev_node);
 
 	return TRUE;
 }
 
 /**
- * urf_input_startup:
+ * urf_input_find_device:
+ *
+ * Look up the input device that issues the hotkey events. Only uses
+ * its own udev context, so it may run on a worker thread.
+ *
+ * Return value: the device node or %NULL, free with g_free()
  **/
-gboolean
-urf_input_startup (UrfInput *input)
+char *
+urf_input_find_device (void)
 {
 	struct udev *udev;
 	struct udev_enumerate *enumerate;
@@ -182,12 +188,11 @@ urf_input_startup (UrfInput *input)
 	struct udev_list_entry *dev_list_entry;
 	struct udev_device *dev;
 	char *dev_node = NULL;
-	gboolean ret;
 
 	udev = udev_new ();
 	if (!udev) {
-		g_warning ("Cannot create udev object");
-		return FALSE;
+		urf_warning ("Cannot create udev object");
+		return NULL;
 	}
 
 	enumerate = udev_enumerate_new (udev);
@@ -226,13 +231,21 @@ urf_input_startup (UrfInput *input)
 	udev_enumerate_unref(enumerate);
 	udev_unref(udev);
 
+	return dev_node;
+}
+
+/**
+ * urf_input_open_device:
+ * @dev_node: (allow-none): the device node from urf_input_find_device()
+ **/
+gboolean
+urf_input_open_device (UrfInput   *input,
+		       const char *dev_node)
+{
 	if (!dev_node)
 		return FALSE;
 
-	ret = input_dev_open_channel (input, dev_node);
-	g_free (dev_node);
-
-	return ret;
+	return input_dev_open_channel (input, dev_node);
 }
 
 /**
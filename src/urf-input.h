@@ -52,7 +52,9 @@ typedef struct {
 
 GType		 urf_input_get_type 	(void);
 UrfInput	*urf_input_new		(void);
-gboolean	 urf_input_startup	(UrfInput	*input);
+char		*urf_input_find_device	(void);
+gboolean	 urf_input_open_device	(UrfInput	*input,
+					 const char	*dev_node);
 
 G_END_DECLS
 
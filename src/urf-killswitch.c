@@ -24,25 +24,24 @@
 #include <config.h>
 #endif
 
-#include <errno.h>
-#include <unistd.h>
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <fcntl.h>
 #include <string.h>
-#include <sys/ioctl.h>
 
 #include <glib.h>
 
 #include <linux/rfkill.h>
 
-#ifndef RFKILL_EVENT_SIZE_V1
-#define RFKILL_EVENT_SIZE_V1    8
-#endif
-
 #include "urf-killswitch.h"
+#include "urf-log.h"
+#include "urf-metrics.h"
+#include "urf-probes.h"
+#include "urf-rfkill-backend.h"
+#include "urf-state-file.h"
+#include "urf-trace.h"
 #include "urf-utils.h"
 
+#include "liburfkill-glib/urf-state-format.h"
+#include "liburfkill-glib/urf-type-names.h"
+
 enum {
 	DEVICE_ADDED,
 	DEVICE_REMOVED,
@@ -55,13 +54,20 @@ static int signals[LAST_SIGNAL] = { 0 };
 #define URF_KILLSWITCH_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), \
                                 URF_TYPE_KILLSWITCH, UrfKillswitchPrivate))
 
+/* events handled per wakeup */
+#define URF_KILLSWITCH_EVENT_BATCH 16
+
 struct UrfKillswitchPrivate {
-	int		 fd;
+	UrfRfkillBackend *backend;
 	gboolean	 force_sync;
 	GIOChannel	*channel;
 	guint		 watch_id;
 	GList		*devices; /* a GList of UrfDevice */
 	UrfDevice	*type_pivot[NUM_RFKILL_TYPES];
+	UrfStateFile	*state_file;
+	gboolean	 state_file_dirty;
+	UrfTrace	*trace;
+	GHashTable	*udev_attrs;
 };
 
 G_DEFINE_TYPE(UrfKillswitch, urf_killswitch, G_TYPE_OBJECT)
@@ -78,47 +84,25 @@ event_to_state (gboolean soft,
 		return KILLSWITCH_STATE_UNBLOCKED;
 }
 
-static const char *
-state_to_string (KillswitchState state)
-{
-	switch (state) {
-	case KILLSWITCH_STATE_NO_ADAPTER:
-		return "KILLSWITCH_STATE_NO_ADAPTER";
-	case KILLSWITCH_STATE_SOFT_BLOCKED:
-		return "KILLSWITCH_STATE_SOFT_BLOCKED";
-	case KILLSWITCH_STATE_UNBLOCKED:
-		return "KILLSWITCH_STATE_UNBLOCKED";
-	case KILLSWITCH_STATE_HARD_BLOCKED:
-		return "KILLSWITCH_STATE_HARD_BLOCKED";
-	default:
-		g_assert_not_reached ();
-	}
-}
+/* indexed by the state plus one, NO_ADAPTER is -1 */
+static const char *state_names[] = {
+	"KILLSWITCH_STATE_NO_ADAPTER",
+	"KILLSWITCH_STATE_SOFT_BLOCKED",
+	"KILLSWITCH_STATE_UNBLOCKED",
+	"KILLSWITCH_STATE_HARD_BLOCKED",
+};
 
-static const char *
-type_to_string (unsigned int type)
-{
-	switch (type) {
-	case RFKILL_TYPE_ALL:
-		return "ALL";
-	case RFKILL_TYPE_WLAN:
-		return "WLAN";
-	case RFKILL_TYPE_BLUETOOTH:
-		return "BLUETOOTH";
-	case RFKILL_TYPE_UWB:
-		return "UWB";
-	case RFKILL_TYPE_WIMAX:
-		return "WIMAX";
-	case RFKILL_TYPE_WWAN:
-		return "WWAN";
-	case RFKILL_TYPE_GPS:
-		return "GPS";
-	case RFKILL_TYPE_FM:
-		return "FM";
-	default:
-		g_assert_not_reached ();
-	}
-}
+static const char *type_names[] = URF_TYPE_NAMES;
+
+static const char *op_names[] = {
+	[RFKILL_OP_ADD]		= "ADD",
+	[RFKILL_OP_DEL]		= "DEL",
+	[RFKILL_OP_CHANGE]	= "CHANGE",
+	[RFKILL_OP_CHANGE_ALL]	= "CHANGE_ALL",
+};
+
+#define NAME_OF(names, i) \
+	((guint) (i) < G_N_ELEMENTS (names) ? (names)[i] : "unknown")
 
 /**
  * urf_killswitch_find_device:
@@ -150,7 +134,6 @@ urf_killswitch_set_block (UrfKillswitch  *killswitch,
 {
 	UrfKillswitchPrivate *priv = killswitch->priv;
 	struct rfkill_event event;
-	ssize_t len;
 
 	g_return_val_if_fail (type < NUM_RFKILL_TYPES, FALSE);
 
@@ -159,14 +142,14 @@ urf_killswitch_set_block (UrfKillswitch  *killswitch,
 	event.type = type;
 	event.soft = block;
 
-	g_debug ("Set %s to %s", type_to_string (type), block?"block":"unblock");
-	len = write (priv->fd, &event, sizeof(event));
-	if (len < 0) {
-		g_warning ("Failed to change RFKILL state: %s",
-			   g_strerror (errno));
-		return FALSE;
-	}
-	return TRUE;
+	urf_debug ("Set %s to %s", NAME_OF (type_names, type), block?"block":"unblock");
+	if (priv->trace)
+		urf_trace_record_write (priv->trace, &event);
+	urf_metrics_count (URF_METRICS_RFKILL_WRITES);
+	if (URF_PROBE_ENABLED (rfkill__write))
+		URF_PROBE5 (rfkill__write, event.idx, event.type, event.op,
+			    event.soft, g_get_monotonic_time ());
+	return urf_rfkill_backend_write_event (priv->backend, &event);
 }
 
 /**
@@ -180,11 +163,10 @@ urf_killswitch_set_block_idx (UrfKillswitch  *killswitch,
 	UrfKillswitchPrivate *priv = killswitch->priv;
 	UrfDevice *device;
 	struct rfkill_event event;
-	ssize_t len;
 
 	device = urf_killswitch_find_device (killswitch, index);
 	if (device == NULL) {
-		g_warning ("Block index: No device with index %u", index);
+		urf_warning ("Block index: No device with index %u", index);
 		return FALSE;
 	}
 
@@ -193,14 +175,14 @@ urf_killswitch_set_block_idx (UrfKillswitch  *killswitch,
 	event.idx = index;
 	event.soft = block;
 
-	g_debug ("Set device %u to %s", index, block?"block":"unblock");
-	len = write (priv->fd, &event, sizeof(event));
-	if (len < 0) {
-		g_warning ("Failed to change RFKILL state: %s",
-			   g_strerror (errno));
-		return FALSE;
-	}
-	return TRUE;
+	urf_debug ("Set device %u to %s", index, block?"block":"unblock");
+	if (priv->trace)
+		urf_trace_record_write (priv->trace, &event);
+	urf_metrics_count (URF_METRICS_RFKILL_WRITES);
+	if (URF_PROBE_ENABLED (rfkill__write))
+		URF_PROBE5 (rfkill__write, event.idx, event.type, event.op,
+			    event.soft, g_get_monotonic_time ());
+	return urf_rfkill_backend_write_event (priv->backend, &event);
 }
 
 static KillswitchState
@@ -265,8 +247,9 @@ urf_killswitch_get_state (UrfKillswitch *killswitch,
 					urf_device_get_hard (device));
 	}
 
-	g_debug ("devices %s state %s",
-		 type_to_string (type), state_to_string (state));
+	urf_debug_fields ("Killswitch state",
+			  URF_LOG_STR ("RFKILL_TYPE", NAME_OF (type_names, type)),
+			  URF_LOG_STR ("KILLSWITCH_STATE", NAME_OF (state_names, state + 1)));
 
 	return state;
 }
@@ -295,7 +278,9 @@ urf_killswitch_get_state_idx (UrfKillswitch *killswitch,
 		soft = urf_device_get_soft (device);
 		hard = urf_device_get_hard (device);
 		state = event_to_state (soft, hard);
-		g_debug ("killswitch %d is %s", index, state_to_string (state));
+		urf_debug_fields ("Killswitch state",
+				  URF_LOG_INT ("RFKILL_INDEX", index),
+				  URF_LOG_STR ("KILLSWITCH_STATE", NAME_OF (state_names, state + 1)));
 	}
 
 	return state;
@@ -341,6 +326,30 @@ urf_killswitch_get_device (UrfKillswitch *killswitch,
 	return NULL;
 }
 
+/**
+ * urf_killswitch_sync_state_file:
+ *
+ * Rewrite the state file if a device changed since the last sync, once
+ * per batch of events rather than once per event
+ **/
+static void
+urf_killswitch_sync_state_file (UrfKillswitch *killswitch)
+{
+	int type_states[NUM_RFKILL_TYPES];
+	guint type;
+
+	if (!killswitch->priv->state_file_dirty)
+		return;
+	killswitch->priv->state_file_dirty = FALSE;
+
+	for (type = 0; type < NUM_RFKILL_TYPES; type++)
+		type_states[type] = urf_killswitch_get_state (killswitch, type);
+
+	urf_state_file_update (killswitch->priv->state_file,
+			       killswitch->priv->devices,
+			       type_states, NUM_RFKILL_TYPES);
+}
+
 /**
  * update_killswitch:
  **/
@@ -357,7 +366,7 @@ update_killswitch (UrfKillswitch *killswitch,
 
 	device = urf_killswitch_find_device (killswitch, index);
 	if (device == NULL) {
-		g_warning ("No device with index %u in the list", index);
+		urf_warning ("No device with index %u in the list", index);
 		return;
 	}
 
@@ -365,8 +374,9 @@ update_killswitch (UrfKillswitch *killswitch,
 	changed = urf_device_update_states (device, soft, hard);
 
 	if (changed == TRUE) {
-		g_debug ("updating killswitch status %d to soft %d hard %d",
-			 index, soft, hard);
+		urf_debug ("updating killswitch status %d to soft %d hard %d",
+			   index, soft, hard);
+		priv->state_file_dirty = TRUE;
 		object_path = g_strdup (urf_device_get_object_path (device));
 		g_signal_emit (G_OBJECT (killswitch), signals[DEVICE_CHANGED], 0, object_path);
 		g_free (object_path);
@@ -397,8 +407,8 @@ assign_new_pivot (UrfKillswitch *killswitch,
 		    (priv->type_pivot[type] == NULL ||
 		     urf_device_is_platform (device))) {
 			priv->type_pivot[type] = device;
-			g_debug ("assign killswitch idx %d %s as a pivot",
-				 urf_device_get_index (device), name);
+			urf_debug ("assign killswitch idx %d %s as a pivot",
+				   urf_device_get_index (device), name);
 		}
 	}
 }
@@ -419,7 +429,7 @@ remove_killswitch (UrfKillswitch *killswitch,
 
 	device = urf_killswitch_find_device (killswitch, index);
 	if (device == NULL) {
-		g_warning ("No device with index %u in the list", index);
+		urf_warning ("No device with index %u in the list", index);
 		return;
 	}
 
@@ -428,7 +438,9 @@ remove_killswitch (UrfKillswitch *killswitch,
 	object_path = g_strdup (urf_device_get_object_path(device));
 
 	name = urf_device_get_name (device);
-	g_debug ("removing killswitch idx %d %s", index, name);
+	urf_debug ("removing killswitch idx %d %s", index, name);
+	if (URF_PROBE_ENABLED (device__remove))
+		URF_PROBE3 (device__remove, index, type, g_get_monotonic_time ());
 
 	if (priv->type_pivot[type] == device) {
 		priv->type_pivot[type] = NULL;
@@ -441,6 +453,7 @@ remove_killswitch (UrfKillswitch *killswitch,
 	if (pivot_changed) {
 		assign_new_pivot (killswitch, type);
 	}
+	priv->state_file_dirty = TRUE;
 	g_signal_emit (G_OBJECT (killswitch), signals[DEVICE_REMOVED], 0, object_path);
 	g_free (object_path);
 }
@@ -462,21 +475,27 @@ add_killswitch (UrfKillswitch *killswitch,
 
 	device = urf_killswitch_find_device (killswitch, index);
 	if (device != NULL) {
-		g_warning ("device with index %u already in the list", index);
+		urf_warning ("device with index %u already in the list", index);
 		return;
 	}
 
-	g_debug ("adding killswitch idx %d soft %d hard %d", index, soft, hard);
+	urf_debug ("adding killswitch idx %d soft %d hard %d", index, soft, hard);
+	if (URF_PROBE_ENABLED (device__add))
+		URF_PROBE5 (device__add, index, type, soft, hard,
+			    g_get_monotonic_time ());
 
-	device = urf_device_new (index, type, soft, hard);
+	device = urf_device_new (index, type, soft, hard,
+				 priv->udev_attrs ? g_hash_table_lookup (priv->udev_attrs,
+									 GUINT_TO_POINTER (index)) : NULL);
 	priv->devices = g_list_append (priv->devices, device);
 
 	/* Assume that only one platform vendor in a machine */
 	name = urf_device_get_name (device);
 	if (priv->type_pivot[type] == NULL || urf_device_is_platform (device)) {
 		priv->type_pivot[type] = device;
-		g_debug ("assign killswitch idx %d %s as a pivot", index, name);
+		urf_debug ("assign killswitch idx %d %s as a pivot", index, name);
 	}
+	priv->state_file_dirty = TRUE;
 
 	g_signal_emit (G_OBJECT (killswitch), signals[DEVICE_ADDED], 0,
 		       urf_device_get_object_path (device));
@@ -485,31 +504,36 @@ add_killswitch (UrfKillswitch *killswitch,
 	}
 }
 
-static const char *
-op_to_string (unsigned int op)
+static void
+count_event (struct rfkill_event *event)
 {
-	switch (op) {
+	switch (event->op) {
 	case RFKILL_OP_ADD:
-		return "ADD";
+		urf_metrics_count (URF_METRICS_RFKILL_EVENTS_ADD);
+		break;
 	case RFKILL_OP_DEL:
-		return "DEL";
+		urf_metrics_count (URF_METRICS_RFKILL_EVENTS_DEL);
+		break;
 	case RFKILL_OP_CHANGE:
-		return "CHANGE";
+		urf_metrics_count (URF_METRICS_RFKILL_EVENTS_CHANGE);
+		break;
 	case RFKILL_OP_CHANGE_ALL:
-		return "CHANGE_ALL";
+		urf_metrics_count (URF_METRICS_RFKILL_EVENTS_CHANGE_ALL);
+		break;
 	default:
-		g_assert_not_reached ();
+		break;
 	}
 }
 
 static void
 print_event (struct rfkill_event *event)
 {
-	g_debug ("RFKILL event: idx %u type %u (%s) op %u (%s) soft %u hard %u",
-		 event->idx,
-		 event->type, type_to_string (event->type),
-		 event->op, op_to_string (event->op),
-		 event->soft, event->hard);
+	urf_debug_fields ("RFKILL event",
+			  URF_LOG_INT ("RFKILL_INDEX", event->idx),
+			  URF_LOG_STR ("RFKILL_TYPE", NAME_OF (type_names, event->type)),
+			  URF_LOG_STR ("RFKILL_OP", NAME_OF (op_names, event->op)),
+			  URF_LOG_INT ("RFKILL_SOFT", event->soft),
+			  URF_LOG_INT ("RFKILL_HARD", event->hard));
 }
 
 /**
@@ -521,45 +545,95 @@ event_cb (GIOChannel    *source,
 	  UrfKillswitch *killswitch)
 {
 	if (condition & G_IO_IN) {
-		GIOStatus status;
-		struct rfkill_event event;
-		gsize read;
+		struct rfkill_event events[URF_KILLSWITCH_EVENT_BATCH];
+		struct rfkill_event *event;
 		gboolean soft, hard;
-
-		status = g_io_channel_read_chars (source,
-						  (char *) &event,
-						  sizeof(event),
-						  &read,
-						  NULL);
-
-		while (status == G_IO_STATUS_NORMAL && read == sizeof(event)) {
-			print_event (&event);
-
-			soft = (event.soft > 0)?TRUE:FALSE;
-			hard = (event.hard > 0)?TRUE:FALSE;
-
-			if (event.op == RFKILL_OP_CHANGE) {
-				update_killswitch (killswitch, event.idx, soft, hard);
-			} else if (event.op == RFKILL_OP_DEL) {
-				remove_killswitch (killswitch, event.idx);
-			} else if (event.op == RFKILL_OP_ADD) {
-				add_killswitch (killswitch, event.idx, event.type, soft, hard);
+		gint64 start;
+		int n, i;
+
+		while ((n = urf_rfkill_backend_read_events (killswitch->priv->backend,
+							    events,
+							    G_N_ELEMENTS (events))) > 0) {
+			for (i = 0; i < n; i++) {
+				start = g_get_monotonic_time ();
+				event = &events[i];
+				print_event (event);
+				count_event (event);
+				if (URF_PROBE_ENABLED (rfkill__event))
+					URF_PROBE6 (rfkill__event, event->idx, event->type,
+						    event->op, event->soft, event->hard,
+						    start);
+				if (killswitch->priv->trace)
+					urf_trace_record_event (killswitch->priv->trace, event);
+
+				soft = (event->soft > 0)?TRUE:FALSE;
+				hard = (event->hard > 0)?TRUE:FALSE;
+
+				if (event->op == RFKILL_OP_CHANGE) {
+					update_killswitch (killswitch, event->idx, soft, hard);
+				} else if (event->op == RFKILL_OP_DEL) {
+					remove_killswitch (killswitch, event->idx);
+				} else if (event->op == RFKILL_OP_ADD) {
+					add_killswitch (killswitch, event->idx, event->type, soft, hard);
+				}
+				urf_metrics_observe (URF_METRICS_EVENT_LATENCY, start);
 			}
-
-			status = g_io_channel_read_chars (source,
-							  (char *) &event,
-							  sizeof(event),
-							  &read,
-							  NULL);
+			urf_killswitch_sync_state_file (killswitch);
 		}
 	} else {
-		g_debug ("something else happened");
+		urf_debug ("something else happened");
 		return FALSE;
 	}
 
 	return TRUE;
 }
 
+/**
+ * urf_killswitch_set_trace:
+ *
+ * Record the rfkill events and the writes to @trace, call before
+ * urf_killswitch_startup() to include the initial devices
+ **/
+void
+urf_killswitch_set_trace (UrfKillswitch *killswitch,
+			  UrfTrace      *trace)
+{
+	UrfKillswitchPrivate *priv = killswitch->priv;
+
+	if (priv->trace)
+		g_object_unref (priv->trace);
+	priv->trace = trace ? g_object_ref (trace) : NULL;
+}
+
+/**
+ * urf_killswitch_set_udev_attrs:
+ * @attrs: (transfer full): from get_rfkill_udev_attrs()
+ *
+ * Use @attrs for the devices found by urf_killswitch_startup() instead
+ * of looking each one up in udev. Devices added later are looked up.
+ **/
+void
+urf_killswitch_set_udev_attrs (UrfKillswitch *killswitch,
+			       GHashTable    *attrs)
+{
+	UrfKillswitchPrivate *priv = killswitch->priv;
+
+	if (priv->udev_attrs)
+		g_hash_table_unref (priv->udev_attrs);
+	priv->udev_attrs = attrs;
+}
+
+/**
+ * urf_killswitch_get_backend:
+ *
+ * Return value: the rfkill backend, or %NULL before startup
+ **/
+UrfRfkillBackend *
+urf_killswitch_get_backend (UrfKillswitch *killswitch)
+{
+	return killswitch->priv->backend;
+}
+
 /**
  * urf_killswitch_startup
  **/
@@ -568,49 +642,52 @@ urf_killswitch_startup (UrfKillswitch *killswitch,
 			UrfConfig     *config)
 {
 	UrfKillswitchPrivate *priv = killswitch->priv;
-	struct rfkill_event event;
-	int fd;
+	struct rfkill_event events[URF_KILLSWITCH_EVENT_BATCH];
+	struct rfkill_event *event;
+	char *state_path;
+	int n, i;
 
 	priv->force_sync = urf_config_get_force_sync (config);
 
-	fd = open("/dev/rfkill", O_RDWR | O_NONBLOCK);
-	if (fd < 0) {
-		if (errno == EACCES)
-			g_warning ("Could not open RFKILL control device, please verify your installation");
+	priv->backend = urf_rfkill_backend_new_for_spec (urf_config_get_rfkill_backend (config));
+	if (priv->backend == NULL)
 		return FALSE;
-	}
-
-	/* Disable rfkill input */
-	ioctl(fd, RFKILL_IOCTL_NOINPUT);
 
-	priv->fd = fd;
-
-	while (1) {
-		ssize_t len;
+	if (!urf_rfkill_backend_open (priv->backend))
+		return FALSE;
 
-		len = read(fd, &event, sizeof(event));
-		if (len < 0) {
-			if (errno == EAGAIN)
-				break;
-			g_debug ("Reading of RFKILL events failed");
-			break;
+	/* not fatal, the states are still available on the bus */
+	state_path = g_build_filename (urf_config_get_runtime_dir (config),
+				       URF_STATE_FILE_NAME, NULL);
+	if (!urf_state_file_open (priv->state_file, state_path))
+		urf_warning ("failed to publish the state file");
+	g_free (state_path);
+
+	while ((n = urf_rfkill_backend_read_events (priv->backend,
+						    events,
+						    G_N_ELEMENTS (events))) > 0) {
+		for (i = 0; i < n; i++) {
+			event = &events[i];
+			count_event (event);
+			if (priv->trace)
+				urf_trace_record_event (priv->trace, event);
+
+			if (event->op != RFKILL_OP_ADD)
+				continue;
+			if (event->type >= NUM_RFKILL_TYPES)
+				continue;
+
+			add_killswitch (killswitch, event->idx, event->type,
+					event->soft, event->hard);
 		}
-
-		if (len != RFKILL_EVENT_SIZE_V1) {
-			g_warning("Wrong size of RFKILL event\n");
-			continue;
-		}
-
-		if (event.op != RFKILL_OP_ADD)
-			continue;
-		if (event.type >= NUM_RFKILL_TYPES)
-			continue;
-
-		add_killswitch (killswitch, event.idx, event.type, event.soft, event.hard);
 	}
+	urf_killswitch_sync_state_file (killswitch);
+
+	/* only valid for the devices present at startup */
+	urf_killswitch_set_udev_attrs (killswitch, NULL);
 
 	/* Setup monitoring */
-	priv->channel = g_io_channel_unix_new (priv->fd);
+	priv->channel = g_io_channel_unix_new (urf_rfkill_backend_get_fd (priv->backend));
 	g_io_channel_set_encoding (priv->channel, NULL, NULL);
 	priv->watch_id = g_io_add_watch (priv->channel,
 					 G_IO_IN | G_IO_HUP | G_IO_ERR,
@@ -630,10 +707,15 @@ urf_killswitch_init (UrfKillswitch *killswitch)
 
 	killswitch->priv = priv;
 	priv->devices = NULL;
-	priv->fd = -1;
+	priv->backend = NULL;
+	priv->trace = NULL;
+	priv->udev_attrs = NULL;
 
 	for (i = 0; i < NUM_RFKILL_TYPES; i++)
 		priv->type_pivot[i] = NULL;
+
+	priv->state_file = urf_state_file_new ();
+	priv->state_file_dirty = FALSE;
 }
 
 /**
@@ -651,12 +733,21 @@ urf_killswitch_finalize (GObject *object)
 		g_io_channel_shutdown (priv->channel, FALSE, NULL);
 		g_io_channel_unref (priv->channel);
 	}
-	close(priv->fd);
+	if (priv->backend) {
+		urf_rfkill_backend_close (priv->backend);
+		g_object_unref (priv->backend);
+	}
 
 	g_list_foreach (priv->devices, (GFunc) g_object_unref, NULL);
 	g_list_free (priv->devices);
 	priv->devices = NULL;
 
+	g_object_unref (priv->state_file);
+	if (priv->trace)
+		g_object_unref (priv->trace);
+	if (priv->udev_attrs)
+		g_hash_table_unref (priv->udev_attrs);
+
 	G_OBJECT_CLASS(urf_killswitch_parent_class)->finalize(object);
 }
 
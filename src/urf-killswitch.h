@@ -27,6 +27,8 @@
 
 #include "urf-config.h"
 #include "urf-device.h"
+#include "urf-rfkill-backend.h"
+#include "urf-trace.h"
 
 G_BEGIN_DECLS
 
@@ -70,8 +72,13 @@ typedef struct {
 GType			 urf_killswitch_get_type		(void);
 UrfKillswitch		*urf_killswitch_new			(void);
 
+void			 urf_killswitch_set_trace		(UrfKillswitch	*killswitch,
+								 UrfTrace	*trace);
+void			 urf_killswitch_set_udev_attrs		(UrfKillswitch	*killswitch,
+								 GHashTable	*attrs);
 gboolean		 urf_killswitch_startup			(UrfKillswitch  *killswitch,
 								 UrfConfig	*config);
+UrfRfkillBackend	*urf_killswitch_get_backend		(UrfKillswitch	*killswitch);
 
 gboolean		 urf_killswitch_has_devices		(UrfKillswitch	*killswitch);
 GList			*urf_killswitch_get_devices		(UrfKillswitch	*killswitch);
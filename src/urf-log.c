@@ -0,0 +1,210 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ * urf_debug() and friends check the level before formatting anything,
+ * and the levels above URF_LOG_MAX_LEVEL are not compiled in at all.
+ * Under systemd the entries go to the journal with their fields,
+ * everywhere else they go through g_log() as before.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+
+#ifdef HAVE_JOURNAL
+#include <sys/uio.h>
+#include <systemd/sd-journal.h>
+#endif
+
+#include "urf-log.h"
+
+int urf_log_level = URF_LOG_LEVEL_MESSAGE;
+
+#ifdef HAVE_JOURNAL
+static gboolean urf_log_use_journal = FALSE;
+
+/* syslog priorities */
+static const char *urf_log_priorities[] = {
+	"PRIORITY=2",
+	"PRIORITY=4",
+	"PRIORITY=5",
+	"PRIORITY=6",
+	"PRIORITY=7",
+};
+#endif
+
+static const GLogLevelFlags urf_log_glib_levels[] = {
+	G_LOG_LEVEL_CRITICAL,
+	G_LOG_LEVEL_WARNING,
+	G_LOG_LEVEL_MESSAGE,
+	G_LOG_LEVEL_INFO,
+	G_LOG_LEVEL_DEBUG,
+};
+
+/**
+ * urf_log_debug_domains:
+ *
+ * Return value: %TRUE if G_MESSAGES_DEBUG asks for our debug output
+ **/
+static gboolean
+urf_log_debug_domains (void)
+{
+	const char *domains = g_getenv ("G_MESSAGES_DEBUG");
+
+	if (domains == NULL)
+		return FALSE;
+	return strstr (domains, "all") != NULL ||
+	       strstr (domains, G_LOG_DOMAIN) != NULL;
+}
+
+/**
+ * urf_log_init:
+ * @verbose: show the debug output
+ *
+ * Call once from main(), without it only g_log() is used.
+ **/
+void
+urf_log_init (gboolean verbose)
+{
+	/* g_log() wants the domain listed to show debug output */
+	if (verbose && g_getenv ("G_MESSAGES_DEBUG") == NULL)
+		g_setenv ("G_MESSAGES_DEBUG", G_LOG_DOMAIN, TRUE);
+
+	if (verbose || urf_log_debug_domains ())
+		urf_log_level = URF_LOG_LEVEL_DEBUG;
+
+#ifdef HAVE_JOURNAL
+	/* a terminal is for humans */
+	urf_log_use_journal = !isatty (STDERR_FILENO) &&
+			      g_file_test ("/run/systemd/journal/socket",
+					   G_FILE_TEST_EXISTS);
+#endif
+}
+
+#ifdef HAVE_JOURNAL
+/**
+ * urf_log_journal:
+ **/
+static void
+urf_log_journal (UrfLogLevel        level,
+		 const char        *file,
+		 const char        *line,
+		 const char        *func,
+		 const UrfLogField *fields,
+		 guint              n_fields,
+		 const char        *message)
+{
+	struct iovec *iov;
+	char **strings;
+	guint n = 0;
+	guint i;
+
+	iov = g_new (struct iovec, n_fields + 7);
+	strings = g_new0 (char *, n_fields + 5);
+
+	strings[0] = g_strconcat ("MESSAGE=", message, NULL);
+	strings[1] = g_strconcat ("CODE_FILE=", file, NULL);
+	strings[2] = g_strconcat ("CODE_LINE=", line, NULL);
+	strings[3] = g_strconcat ("CODE_FUNC=", func, NULL);
+	for (i = 0; i < n_fields; i++) {
+		if (fields[i].str != NULL)
+			strings[4 + i] = g_strconcat (fields[i].key, "=", fields[i].str, NULL);
+		else
+			strings[4 + i] = g_strdup_printf ("%s=%" G_GINT64_FORMAT,
+							  fields[i].key, fields[i].num);
+	}
+
+	for (i = 0; strings[i] != NULL; i++) {
+		iov[n].iov_base = strings[i];
+		iov[n].iov_len = strlen (strings[i]);
+		n++;
+	}
+	iov[n].iov_base = (char *) urf_log_priorities[level];
+	iov[n].iov_len = strlen (urf_log_priorities[level]);
+	n++;
+	iov[n].iov_base = (char *) "GLIB_DOMAIN=" G_LOG_DOMAIN;
+	iov[n].iov_len = strlen (iov[n].iov_base);
+	n++;
+	iov[n].iov_base = (char *) "SYSLOG_IDENTIFIER=urfkilld";
+	iov[n].iov_len = strlen (iov[n].iov_base);
+	n++;
+
+	sd_journal_sendv (iov, n);
+
+	g_strfreev (strings);
+	g_free (iov);
+}
+#endif
+
+/**
+ * urf_log_message:
+ *
+ * Use urf_debug() and friends, which check the level first.
+ **/
+void
+urf_log_message (UrfLogLevel        level,
+		 const char        *file,
+		 const char        *line,
+		 const char        *func,
+		 const UrfLogField *fields,
+		 guint              n_fields,
+		 const char        *format,
+		 ...)
+{
+	GString *str;
+	va_list args;
+	guint i;
+
+	g_return_if_fail (level <= URF_LOG_LEVEL_DEBUG);
+
+	str = g_string_new (NULL);
+	va_start (args, format);
+	g_string_append_vprintf (str, format, args);
+	va_end (args);
+
+#ifdef HAVE_JOURNAL
+	if (urf_log_use_journal) {
+		urf_log_journal (level, file, line, func,
+				 fields, n_fields, str->str);
+		goto out;
+	}
+#endif
+
+	for (i = 0; i < n_fields; i++) {
+		g_string_append (str, i == 0 ? ": " : " ");
+		if (fields[i].str != NULL)
+			g_string_append_printf (str, "%s=%s",
+						fields[i].key, fields[i].str);
+		else
+			g_string_append_printf (str, "%s=%" G_GINT64_FORMAT,
+						fields[i].key, fields[i].num);
+	}
+	g_log (G_LOG_DOMAIN, urf_log_glib_levels[level], "%s", str->str);
+#ifdef HAVE_JOURNAL
+out:
+#endif
+	g_string_free (str, TRUE);
+}
@@ -0,0 +1,103 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __URF_LOG_H__
+#define __URF_LOG_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+	URF_LOG_LEVEL_CRITICAL,
+	URF_LOG_LEVEL_WARNING,
+	URF_LOG_LEVEL_MESSAGE,
+	URF_LOG_LEVEL_INFO,
+	URF_LOG_LEVEL_DEBUG
+} UrfLogLevel;
+
+/**
+ * UrfLogField:
+ *
+ * A key/value pair of a structured log entry. @str has to outlive the
+ * call, @num is used when @str is %NULL.
+ **/
+typedef struct {
+	const char	*key;
+	const char	*str;
+	gint64		 num;
+} UrfLogField;
+
+#define URF_LOG_STR(key, value)	{ (key), (value), 0 }
+#define URF_LOG_INT(key, value)	{ (key), NULL, (gint64) (value) }
+
+/* the most verbose level compiled in, see --with-log-level */
+#ifndef URF_LOG_MAX_LEVEL
+#define URF_LOG_MAX_LEVEL	URF_LOG_LEVEL_DEBUG
+#endif
+
+extern int urf_log_level;
+
+/* the arguments are only evaluated when this is true */
+#define urf_log_enabled(level) \
+	((level) <= URF_LOG_MAX_LEVEL && (level) <= urf_log_level)
+
+#define urf_log(level, ...)						\
+	G_STMT_START {							\
+		if (urf_log_enabled (level))				\
+			urf_log_message ((level), __FILE__,		\
+					 G_STRINGIFY (__LINE__),	\
+					 G_STRFUNC, NULL, 0,		\
+					 __VA_ARGS__);			\
+	} G_STMT_END
+
+#define urf_log_fields(level, message, ...)				\
+	G_STMT_START {							\
+		if (urf_log_enabled (level)) {				\
+			const UrfLogField urf_log_fields_[] = { __VA_ARGS__ }; \
+			urf_log_message ((level), __FILE__,		\
+					 G_STRINGIFY (__LINE__),	\
+					 G_STRFUNC, urf_log_fields_,	\
+					 G_N_ELEMENTS (urf_log_fields_), \
+					 "%s", (message));		\
+		}							\
+	} G_STMT_END
+
+#define urf_debug(...)		urf_log (URF_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define urf_info(...)		urf_log (URF_LOG_LEVEL_INFO, __VA_ARGS__)
+#define urf_message(...)	urf_log (URF_LOG_LEVEL_MESSAGE, __VA_ARGS__)
+#define urf_warning(...)	urf_log (URF_LOG_LEVEL_WARNING, __VA_ARGS__)
+
+#define urf_debug_fields(message, ...) \
+	urf_log_fields (URF_LOG_LEVEL_DEBUG, (message), __VA_ARGS__)
+
+void		 urf_log_init			(gboolean	 verbose);
+void		 urf_log_message		(UrfLogLevel	 level,
+						 const char	*file,
+						 const char	*line,
+						 const char	*func,
+						 const UrfLogField *fields,
+						 guint		 n_fields,
+						 const char	*format,
+						 ...) G_GNUC_PRINTF (7, 8);
+
+G_END_DECLS
+
+#endif /* __URF_LOG_H__ */
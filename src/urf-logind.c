@@ -0,0 +1,193 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+#include <systemd/sd-login.h>
+
+#include "urf-logind.h"
+#include "urf-log.h"
+
+struct UrfLogindPrivate {
+	sd_login_monitor	*monitor;
+	GIOChannel		*channel;
+	guint			 watch_id;
+};
+
+G_DEFINE_TYPE (UrfLogind, urf_logind, URF_TYPE_SESSION_BACKEND)
+
+#define URF_LOGIND_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), \
+				URF_TYPE_LOGIND, UrfLogindPrivate))
+
+/**
+ * urf_logind_get_session_for_pid:
+ *
+ * The session is read from the cgroup of the process, no IPC needed.
+ **/
+static char *
+urf_logind_get_session_for_pid (UrfSessionBackend *backend,
+				guint              pid)
+{
+	char *session = NULL;
+	char *session_id;
+	int r;
+
+	r = sd_pid_get_session ((pid_t) pid, &session);
+	if (r < 0) {
+		urf_warning ("Failed to get the session of pid %u: %s",
+			     pid, strerror (-r));
+		return NULL;
+	}
+
+	/* sd-login allocates with malloc */
+	session_id = g_strdup (session);
+	free (session);
+
+	return session_id;
+}
+
+/**
+ * urf_logind_is_session_active:
+ **/
+static gboolean
+urf_logind_is_session_active (UrfSessionBackend *backend,
+			      const char        *session_id)
+{
+	return sd_session_is_active (session_id) > 0;
+}
+
+/**
+ * urf_logind_monitor_cb:
+ **/
+static gboolean
+urf_logind_monitor_cb (GIOChannel   *source,
+		       GIOCondition  condition,
+		       UrfLogind    *logind)
+{
+	UrfLogindPrivate *priv = logind->priv;
+
+	if (condition & (G_IO_HUP | G_IO_ERR)) {
+		urf_warning ("logind monitor died");
+		priv->watch_id = 0;
+		return FALSE;
+	}
+
+	sd_login_monitor_flush (priv->monitor);
+
+	/* a seat switched sessions, or a seat came or went */
+	urf_session_backend_active_changed (URF_SESSION_BACKEND (logind));
+
+	return TRUE;
+}
+
+/**
+ * urf_logind_startup:
+ **/
+static gboolean
+urf_logind_startup (UrfSessionBackend *backend)
+{
+	UrfLogind *logind = URF_LOGIND (backend);
+	UrfLogindPrivate *priv = logind->priv;
+	int r;
+
+	r = sd_login_monitor_new ("seat", &priv->monitor);
+	if (r < 0) {
+		urf_warning ("Failed to create the logind monitor: %s", strerror (-r));
+		return FALSE;
+	}
+
+	priv->channel = g_io_channel_unix_new (sd_login_monitor_get_fd (priv->monitor));
+	priv->watch_id = g_io_add_watch (priv->channel,
+					 G_IO_IN | G_IO_HUP | G_IO_ERR,
+					 (GIOFunc) urf_logind_monitor_cb,
+					 logind);
+
+	return TRUE;
+}
+
+/**
+ * urf_logind_dispose:
+ **/
+static void
+urf_logind_dispose (GObject *object)
+{
+	UrfLogindPrivate *priv = URF_LOGIND (object)->priv;
+
+	if (priv->watch_id > 0) {
+		g_source_remove (priv->watch_id);
+		priv->watch_id = 0;
+	}
+	if (priv->channel) {
+		g_io_channel_unref (priv->channel);
+		priv->channel = NULL;
+	}
+	if (priv->monitor) {
+		sd_login_monitor_unref (priv->monitor);
+		priv->monitor = NULL;
+	}
+
+	G_OBJECT_CLASS (urf_logind_parent_class)->dispose (object);
+}
+
+/**
+ * urf_logind_class_init:
+ **/
+static void
+urf_logind_class_init (UrfLogindClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	UrfSessionBackendClass *backend_class = URF_SESSION_BACKEND_CLASS (klass);
+
+	object_class->dispose = urf_logind_dispose;
+
+	backend_class->startup = urf_logind_startup;
+	backend_class->get_session_for_pid = urf_logind_get_session_for_pid;
+	backend_class->is_session_active = urf_logind_is_session_active;
+
+	g_type_class_add_private (klass, sizeof (UrfLogindPrivate));
+}
+
+/**
+ * urf_logind_init:
+ **/
+static void
+urf_logind_init (UrfLogind *logind)
+{
+	logind->priv = URF_LOGIND_GET_PRIVATE (logind);
+	logind->priv->monitor = NULL;
+	logind->priv->channel = NULL;
+	logind->priv->watch_id = 0;
+}
+
+/**
+ * urf_logind_new:
+ **/
+UrfLogind *
+urf_logind_new (void)
+{
+	UrfLogind *logind;
+	logind = URF_LOGIND (g_object_new (URF_TYPE_LOGIND, NULL));
+	return logind;
+}
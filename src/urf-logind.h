@@ -0,0 +1,59 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __URF_LOGIND_H__
+#define __URF_LOGIND_H__
+
+#include <glib-object.h>
+
+#include "urf-session-backend.h"
+
+G_BEGIN_DECLS
+
+#define URF_TYPE_LOGIND (urf_logind_get_type())
+#define URF_LOGIND(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj), \
+					URF_TYPE_LOGIND, UrfLogind))
+#define URF_LOGIND_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST((klass), \
+					URF_TYPE_LOGIND, UrfLogindClass))
+#define URF_IS_LOGIND(obj) (G_TYPE_CHECK_INSTANCE_TYPE((obj), \
+					URF_TYPE_LOGIND))
+#define URF_IS_LOGIND_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), \
+					URF_TYPE_LOGIND))
+#define URF_GET_LOGIND_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS((obj), \
+					URF_TYPE_LOGIND, UrfLogindClass))
+
+typedef struct UrfLogindPrivate UrfLogindPrivate;
+
+typedef struct {
+	UrfSessionBackend	 parent;
+	UrfLogindPrivate	*priv;
+} UrfLogind;
+
+typedef struct {
+	UrfSessionBackendClass	 parent_class;
+} UrfLogindClass;
+
+GType			 urf_logind_get_type		(void);
+
+UrfLogind		*urf_logind_new			(void);
+
+G_END_DECLS
+
+#endif /* __URF_LOGIND_H__ */
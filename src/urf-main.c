@@ -32,94 +32,83 @@
 #include <glib.h>
 #include <glib/gi18n-lib.h>
 #include <glib-object.h>
-
-#include <dbus/dbus-glib.h>
-#include <dbus/dbus-glib-lowlevel.h>
-
-#if GLIB_CHECK_VERSION(2,29,4)
- #include <glib-unix.h>
-#endif
+#include <gio/gio.h>
+#include <glib-unix.h>
 
 #include "urf-config.h"
 #include "urf-daemon.h"
+#include "urf-log.h"
+#include "urf-startup.h"
 
 #define URFKILL_SERVICE_NAME "org.freedesktop.URfkill"
 #define URFKILL_CONFIG_FILE URFKILL_CONFIG_DIR"urfkill.conf"
+/* DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER */
+#define REQUEST_NAME_REPLY_PRIMARY_OWNER 1
 static GMainLoop *loop = NULL;
 
 /**
- * urf_main_acquire_name_on_proxy:
+ * urf_main_acquire_name:
  **/
 static gboolean
-urf_main_acquire_name_on_proxy (DBusGProxy  *bus_proxy,
-				const gchar *name)
+urf_main_acquire_name (GDBusConnection *bus,
+		       const gchar     *name)
 {
 	GError *error = NULL;
+	GVariant *reply;
 	guint result;
 	gboolean ret = FALSE;
 
-	if (bus_proxy == NULL)
-		goto out;
-
-	ret = dbus_g_proxy_call (bus_proxy, "RequestName", &error,
-        			 G_TYPE_STRING, name,
-				 G_TYPE_UINT, 0,
-				 G_TYPE_INVALID,
-				 G_TYPE_UINT, &result,
-				 G_TYPE_INVALID);
-	if (!ret) {
-		if (error != NULL) {
-			g_warning ("Failed to acquire %s: %s", name, error->message);
-			g_error_free (error);
-		} else {
-			g_warning ("Failed to acquire %s", name);
-		}
+	reply = g_dbus_connection_call_sync (bus,
+					     "org.freedesktop.DBus",
+					     "/org/freedesktop/DBus",
+					     "org.freedesktop.DBus",
+					     "RequestName",
+					     g_variant_new ("(su)", name, 0),
+					     G_VARIANT_TYPE ("(u)"),
+					     G_DBUS_CALL_FLAGS_NONE,
+					     -1, NULL, &error);
+	if (reply == NULL) {
+		urf_warning ("Failed to acquire %s: %s", name, error->message);
+		g_error_free (error);
 		goto out;
 	}
+	g_variant_get (reply, "(u)", &result);
+	g_variant_unref (reply);
 
 	/* already taken */
-	if (result != DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER) {
-		if (error != NULL) {
-			g_warning ("Failed to acquire %s: %s", name, error->message);
-			g_error_free (error);
-		} else {
-			g_warning ("Failed to acquire %s", name);
-		}
-		ret = FALSE;
+	if (result != REQUEST_NAME_REPLY_PRIMARY_OWNER) {
+		urf_warning ("Failed to acquire %s", name);
 		goto out;
 	}
+
+	ret = TRUE;
 out:
 	return ret;
 }
 
-#if GLIB_CHECK_VERSION(2,29,4)
 /**
- * urf_main_sigint_cb:
+ * urf_main_load_config:
  **/
-static void
-urf_main_sigint_cb (gpointer user_data)
+static gpointer
+urf_main_load_config (gpointer filename)
 {
-	g_debug ("Handling SIGINT");
-	g_main_loop_quit (loop);
-	return FALSE;
+	UrfConfig *config;
+
+	config = urf_config_new ();
+	urf_config_load_from_file (config, filename);
+	return config;
 }
 
-#else
 /**
- * urf_main_sigint_handler:
+ * urf_main_sigint_cb:
  **/
-static void
-urf_main_sigint_handler (gint sig)
+static gboolean
+urf_main_sigint_cb (gpointer user_data)
 {
-	g_debug ("Handling SIGINT");
-
-	/* restore default */
-	signal (SIGINT, SIG_DFL);
-
-	/* cleanup */
+	urf_debug ("Handling SIGINT");
 	g_main_loop_quit (loop);
+	return FALSE;
 }
-#endif
 
 /**
  * urf_main_timed_exit_cb:
@@ -143,18 +132,27 @@ main (gint argc, gchar **argv)
 	UrfConfig *config = NULL;
 	UrfDaemon *daemon = NULL;
 	GOptionContext *context;
-	DBusGProxy *bus_proxy;
-	DBusGConnection *bus;
+	GDBusConnection *bus = NULL;
+	UrfStartupProbe *config_probe = NULL;
 	gboolean ret;
 	gint retval = 1;
 	gboolean timed_exit = FALSE;
 	gboolean immediate_exit = FALSE;
 	gboolean fork_daemon = FALSE;
+	gboolean verbose = FALSE;
+	gboolean startup_report = FALSE;
+	gboolean watch_main_loop = FALSE;
 	guint timer_id = 0;
 	struct passwd *user;
 	const char *username = NULL;
 	const char *conf_file = NULL;
+	const char *rfkill_backend = NULL;
+	const char *bus_address = NULL;
+	const char *trace_file = NULL;
+	const char *metrics_file = NULL;
+	const char *runtime_dir = NULL;
 	pid_t pid;
+	gint64 start;
 
 	const GOptionEntry options[] = {
 		{ "timed-exit", '\0', 0, G_OPTION_ARG_NONE, &timed_exit,
@@ -166,15 +164,40 @@ main (gint argc, gchar **argv)
 		{ "fork", 'f', 0, G_OPTION_ARG_NONE, &fork_daemon,
 		  /* TRANSLATORS: fork to background */
 		  _("Fork on startup"), NULL },
+		{ "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose,
+		  /* TRANSLATORS: show the debugging output */
+		  _("Show debugging information"), NULL },
+		{ "startup-report", '\0', 0, G_OPTION_ARG_NONE, &startup_report,
+		  /* TRANSLATORS: print how long each startup phase took, used with --immediate-exit */
+		  _("Print the startup phase timings on exit"), NULL },
+		{ "watch-main-loop", '\0', 0, G_OPTION_ARG_NONE, &watch_main_loop,
+		  /* TRANSLATORS: measure how late the main loop runs, implied by --verbose */
+		  _("Measure the main loop latency for the Debug interface"), NULL },
 		{ "user", 'u', 0, G_OPTION_ARG_STRING, &username,
 		  /* TRANSLATORS: change to another user and drop the privilege */
 		  _("Use a specific user instead of root"), NULL },
 		{ "config", 'c', 0, G_OPTION_ARG_STRING, &conf_file,
 		  /* TRANSLATORS: use another config file instead of the default one */
 		  _("Use a specific config file"), NULL },
+		{ "rfkill-backend", '\0', 0, G_OPTION_ARG_STRING, &rfkill_backend,
+		  /* TRANSLATORS: "kernel", a simulated rfkill core or a recorded trace for testing */
+		  _("Use \"kernel\", \"sim[:DEVICES[:LATENCY_MS]]\" or \"replay:FILE[:SPEED]\" for rfkill"), NULL },
+		{ "trace", '\0', 0, G_OPTION_ARG_FILENAME, &trace_file,
+		  /* TRANSLATORS: record what happens for debugging */
+		  _("Record rfkill events, key presses and block requests to FILE"), "FILE" },
+		{ "metrics-file", '\0', 0, G_OPTION_ARG_FILENAME, &metrics_file,
+		  /* TRANSLATORS: for the textfile collector of the Prometheus node_exporter */
+		  _("Write the metrics to FILE in the Prometheus text format"), "FILE" },
+		{ "bus-address", '\0', 0, G_OPTION_ARG_STRING, &bus_address,
+		  /* TRANSLATORS: connect to a private message bus, used for testing */
+		  _("Use the message bus at ADDRESS instead of the system bus"), "ADDRESS" },
+		{ "runtime-dir", '\0', 0, G_OPTION_ARG_FILENAME, &runtime_dir,
+		  /* TRANSLATORS: where the state file and the private socket go, used for testing */
+		  _("Put the state file and the socket into DIR instead of /run/urfkill"), "DIR" },
 		{ NULL }
 	};
 
+	urf_startup_init ();
 	g_type_init ();
 
 	context = g_option_context_new ("urfkill daemon");
@@ -182,55 +205,93 @@ main (gint argc, gchar **argv)
 	g_option_context_parse (context, &argc, &argv, NULL);
 	g_option_context_free (context);
 
+	/* fork as daemon Clone ourselves to make a child. GDBus and the
+	 * startup probes run threads, which the child would not inherit,
+	 * so this has to happen before anything of GIO is touched */
+	if(fork_daemon){
+		pid = fork(); 
+
+		/* If the pid is less than zero,
+		   something went wrong when forking */
+		if (pid < 0) {
+			return pid;
+		}
+
+		/* If the pid we got back was greater
+		   than zero, then the clone was
+		   successful and we are the parent. */
+		if (pid > 0) {
+			return 0;
+		}
+
+		/* If execution reaches this point we are the child,
+		   leave the session of the terminal */
+		setsid ();
+	}
+
+	urf_log_init (verbose);
+
 	if (conf_file == NULL)
 		conf_file = URFKILL_CONFIG_FILE;
 
-	config = urf_config_new ();
-	urf_config_load_from_file (config, conf_file);
+	/* an instance on another bus must leave the files of the system
+	 * daemon alone */
+	if (bus_address != NULL && runtime_dir == NULL) {
+		urf_warning ("--bus-address needs --runtime-dir");
+		goto out;
+	}
+
+	/* every system bus user, libpolkit included, follows this */
+	if (bus_address != NULL)
+		g_setenv ("DBUS_SYSTEM_BUS_ADDRESS", bus_address, TRUE);
+
+	/* the profiles and the DMI lookup don't need the bus */
+	config_probe = urf_startup_probe_start ("config", urf_main_load_config,
+						(gpointer) conf_file);
 
 	/* get bus connection */
-	bus = dbus_g_bus_get (DBUS_BUS_SYSTEM, &error);
+	start = urf_startup_begin ();
+	bus = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, &error);
 	if (bus == NULL) {
-		g_warning ("Couldn't connect to system bus: %s", error->message);
+		urf_warning ("Couldn't connect to system bus: %s", error->message);
 		g_error_free (error);
 		goto out;
 	}
-
-	/* get proxy */
-	bus_proxy = dbus_g_proxy_new_for_name (bus, DBUS_SERVICE_DBUS,
-					       DBUS_PATH_DBUS, DBUS_INTERFACE_DBUS);
-	if (bus_proxy == NULL) {
-		g_warning ("Could not construct bus_proxy object; bailing out");
-		goto out;
-	}
+	urf_startup_end (start, "bus");
 
 	/* aquire name */
-        ret = urf_main_acquire_name_on_proxy (bus_proxy, URFKILL_SERVICE_NAME);
+	start = urf_startup_begin ();
+	ret = urf_main_acquire_name (bus, URFKILL_SERVICE_NAME);
 	if (!ret) {
-		g_warning ("Could not acquire name; bailing out");
+		urf_warning ("Could not acquire name; bailing out");
 		goto out;
 	}
+	urf_startup_end (start, "name");
+
+	config = urf_startup_probe_join (config_probe);
+	config_probe = NULL;
+
+	/* the simulator lets tests and benchmarks run without radios */
+	if (rfkill_backend == NULL)
+		rfkill_backend = g_getenv ("URFKILL_RFKILL_BACKEND");
+	urf_config_set_rfkill_backend (config, rfkill_backend);
+	urf_config_set_trace_file (config, trace_file);
+	urf_config_set_metrics_file (config, metrics_file);
+	urf_config_set_runtime_dir (config, runtime_dir);
+	urf_config_set_watch_main_loop (config, watch_main_loop || verbose);
 
 	loop = g_main_loop_new (NULL, FALSE);
 
-#if GLIB_CHECK_VERSION(2,29,4)
 	/* do stuff on ctrl-c */
-	g_unix_signal_add_watch_full (SIGINT,
-				      G_PRIORITY_DEFAULT,
-				      urf_main_sigint_cb,
-				      loop,
-				      NULL);
-#else
-	signal (SIGINT, urf_main_sigint_handler);
-#endif
+	g_unix_signal_add (SIGINT, urf_main_sigint_cb, loop);
 
-	g_debug ("Starting urfkilld version %s", PACKAGE_VERSION);
+	urf_debug ("Starting urfkilld version %s", PACKAGE_VERSION);
 
 	/* start the daemon */
 	daemon = urf_daemon_new (config);
 	ret = urf_daemon_startup (daemon);
 	if (!ret) {
-		g_warning ("Could not startup; bailing out");
+		urf_warning ("Could not startup; bailing out");
 		goto out;
 	}
 
@@ -240,15 +301,15 @@ main (gint argc, gchar **argv)
 	if (username != NULL && g_strcmp0 (username, "root") != 0) {
 		/* Change uid/gid to a specific user and drop privilege */
 		if (!(user = getpwnam (username))) {
-			g_warning ("Can't get %s's uid and gid", username);
+			urf_warning ("Can't get %s's uid and gid", username);
 			goto out;
 		}
 		if (initgroups (username, user->pw_gid) != 0) {
-			g_warning ("initgroups failed");
+			urf_warning ("initgroups failed");
 			goto out;
 		}
 		if (setgid (user->pw_gid) != 0 || setuid (user->pw_uid) != 0) {
-			g_warning ("Can't drop privilege");
+			urf_warning ("Can't drop privilege");
 			goto out;
 		}
 	}
@@ -265,35 +326,24 @@ main (gint argc, gchar **argv)
 	if (immediate_exit)
 		g_timeout_add (50, (GSourceFunc) urf_main_timed_exit_cb, loop);
 
-	/* fork as daemon Clone ourselves to make a child */
-	if(fork_daemon){
-		pid = fork(); 
-
-		/* If the pid is less than zero,
-		   something went wrong when forking */
-		if (pid < 0) {
-			return pid;
-		}
-
-		/* If the pid we got back was greater
-		   than zero, then the clone was
-		   successful and we are the parent. */
-		if (pid > 0) {
-			return 0;
-		}
-
-		/* If execution reaches this point we are the child */
-	}
+	/* input devices and sessions are set up from the main loop */
+	urf_startup_ready ();
 
 	/* wait for input or timeout */
 	g_main_loop_run (loop);
 	retval = 0;
 out:
+	if (config_probe != NULL)
+		config = urf_startup_probe_join (config_probe);
+	if (startup_report)
+		urf_startup_print_report ();
 	if (daemon != NULL)
 		g_object_unref (daemon);
 	if (config != NULL)
 		g_object_unref (config);
 	if (loop != NULL)
 		g_main_loop_unref (loop);
+	if (bus != NULL)
+		g_object_unref (bus);
 	return retval;
 }
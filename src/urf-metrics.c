@@ -0,0 +1,500 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ * Counters and latency histograms of the daemon. The instrumented code
+ * calls urf_metrics_count() and urf_metrics_observe(), which do nothing
+ * until the daemon creates the UrfMetrics singleton. The numbers are
+ * read over the Debug interface, and can be written periodically in
+ * the Prometheus text format for the textfile collector of
+ * node_exporter.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "urf-metrics.h"
+#include "urf-log.h"
+
+#define URF_METRICS_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), \
+                                URF_TYPE_METRICS, UrfMetricsPrivate))
+
+typedef struct {
+	guint64		 buckets[URF_METRICS_NUM_BUCKETS];
+	guint64		 count;
+	guint64		 sum;
+} UrfMetricsHistogramData;
+
+struct UrfMetricsPrivate {
+	guint64			 counters[URF_METRICS_NUM_COUNTERS];
+	GHashTable		*keys;		/* code -> guint64 */
+	UrfMetricsHistogramData	 histograms[URF_METRICS_NUM_HISTOGRAMS];
+	char			*textfile;
+	guint			 textfile_id;
+	gboolean		 textfile_failed;
+};
+
+/* counters sharing a family are told apart by their label */
+static const struct {
+	const char	*name;
+	const char	*family;
+	const char	*label;
+	const char	*help;
+} counter_info[] = {
+	{ "rfkill_events_add", "urfkill_rfkill_events_total", "op=\"add\"",
+	  "rfkill events read, by operation" },
+	{ "rfkill_events_del", "urfkill_rfkill_events_total", "op=\"del\"",
+	  "rfkill events read, by operation" },
+	{ "rfkill_events_change", "urfkill_rfkill_events_total", "op=\"change\"",
+	  "rfkill events read, by operation" },
+	{ "rfkill_events_change_all", "urfkill_rfkill_events_total", "op=\"change_all\"",
+	  "rfkill events read, by operation" },
+	{ "rfkill_writes", "urfkill_rfkill_writes_total", NULL,
+	  "block requests written to rfkill" },
+	{ "rfkill_writes_elided", "urfkill_rfkill_writes_elided_total", NULL,
+	  "block requests answered without a write" },
+	{ "signals_emitted", "urfkill_signals_emitted_total", NULL,
+	  "D-Bus signals emitted" },
+	{ "polkit_checks", "urfkill_polkit_checks_total", NULL,
+	  "PolicyKit authorization checks" },
+	{ "credentials_cache_hits", "urfkill_credentials_lookups_total", "result=\"hit\"",
+	  "caller credential lookups, by cache result" },
+	{ "credentials_cache_misses", "urfkill_credentials_lookups_total", "result=\"miss\"",
+	  "caller credential lookups, by cache result" },
+	{ "inhibits", "urfkill_inhibits_total", NULL,
+	  "Inhibit calls" },
+	{ "uninhibits", "urfkill_uninhibits_total", NULL,
+	  "Uninhibit calls" },
+};
+G_STATIC_ASSERT (G_N_ELEMENTS (counter_info) == URF_METRICS_NUM_COUNTERS);
+
+static const struct {
+	const char	*name;
+	const char	*family;
+	const char	*help;
+} histogram_info[] = {
+	{ "event_handling", "urfkill_event_handling_seconds",
+	  "time to handle one rfkill event" },
+	{ "method_calls", "urfkill_method_call_seconds",
+	  "time to answer a method call of the daemon" },
+};
+G_STATIC_ASSERT (G_N_ELEMENTS (histogram_info) == URF_METRICS_NUM_HISTOGRAMS);
+
+G_DEFINE_TYPE (UrfMetrics, urf_metrics, G_TYPE_OBJECT)
+
+/* the counters may be bumped from other threads */
+static gpointer urf_metrics_object = NULL;
+G_LOCK_DEFINE_STATIC (urf_metrics_object);
+
+/**
+ * urf_metrics_count:
+ **/
+void
+urf_metrics_count (UrfMetricsCounter counter)
+{
+	g_return_if_fail (counter < URF_METRICS_NUM_COUNTERS);
+
+	G_LOCK (urf_metrics_object);
+	if (urf_metrics_object != NULL)
+		URF_METRICS (urf_metrics_object)->priv->counters[counter]++;
+	G_UNLOCK (urf_metrics_object);
+}
+
+/**
+ * urf_metrics_count_key:
+ * @code: the input event code of the key
+ **/
+void
+urf_metrics_count_key (guint code)
+{
+	UrfMetricsPrivate *priv;
+	guint64 *count;
+
+	G_LOCK (urf_metrics_object);
+	if (urf_metrics_object == NULL)
+		goto out;
+
+	priv = URF_METRICS (urf_metrics_object)->priv;
+	count = g_hash_table_lookup (priv->keys, GUINT_TO_POINTER (code));
+	if (count == NULL) {
+		count = g_new0 (guint64, 1);
+		g_hash_table_insert (priv->keys, GUINT_TO_POINTER (code), count);
+	}
+	(*count)++;
+out:
+	G_UNLOCK (urf_metrics_object);
+}
+
+/**
+ * urf_metrics_observe:
+ * @start: a g_get_monotonic_time() value
+ *
+ * Add the time since @start to @histogram.
+ **/
+void
+urf_metrics_observe (UrfMetricsHistogram histogram,
+		     gint64              start)
+{
+	UrfMetricsHistogramData *data;
+	guint64 duration;
+	guint bucket;
+
+	g_return_if_fail (histogram < URF_METRICS_NUM_HISTOGRAMS);
+
+	duration = MAX (g_get_monotonic_time () - start, 0);
+	if (duration == 0)
+		bucket = 0;
+	else if (duration >= G_GUINT64_CONSTANT (1) << (URF_METRICS_NUM_BUCKETS - 2))
+		bucket = URF_METRICS_NUM_BUCKETS - 1;
+	else
+		bucket = g_bit_storage ((gulong) duration);
+
+	G_LOCK (urf_metrics_object);
+	if (urf_metrics_object != NULL) {
+		data = &URF_METRICS (urf_metrics_object)->priv->histograms[histogram];
+		data->buckets[bucket]++;
+		data->count++;
+		data->sum += duration;
+	}
+	G_UNLOCK (urf_metrics_object);
+}
+
+/**
+ * urf_metrics_get_counters:
+ *
+ * Return value: a floating a{st} of the counters
+ **/
+GVariant *
+urf_metrics_get_counters (UrfMetrics *metrics)
+{
+	UrfMetricsPrivate *priv = metrics->priv;
+	GVariantBuilder builder;
+	guint i;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{st}"));
+
+	G_LOCK (urf_metrics_object);
+	for (i = 0; i < URF_METRICS_NUM_COUNTERS; i++)
+		g_variant_builder_add (&builder, "{st}",
+				       counter_info[i].name, priv->counters[i]);
+	G_UNLOCK (urf_metrics_object);
+
+	return g_variant_builder_end (&builder);
+}
+
+/**
+ * urf_metrics_compare_codes:
+ **/
+static gint
+urf_metrics_compare_codes (gconstpointer a,
+			   gconstpointer b)
+{
+	guint code_a = GPOINTER_TO_UINT (a);
+	guint code_b = GPOINTER_TO_UINT (b);
+
+	return (code_a > code_b) - (code_a < code_b);
+}
+
+/**
+ * urf_metrics_get_sorted_keys:
+ *
+ * Call with the lock held.
+ **/
+static GList *
+urf_metrics_get_sorted_keys (UrfMetrics *metrics)
+{
+	GList *codes;
+
+	codes = g_hash_table_get_keys (metrics->priv->keys);
+	return g_list_sort (codes, urf_metrics_compare_codes);
+}
+
+/**
+ * urf_metrics_get_key_presses:
+ *
+ * Return value: a floating a{ut} of the presses by input event code
+ **/
+GVariant *
+urf_metrics_get_key_presses (UrfMetrics *metrics)
+{
+	UrfMetricsPrivate *priv = metrics->priv;
+	GVariantBuilder builder;
+	GList *codes, *item;
+	guint64 *count;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{ut}"));
+
+	G_LOCK (urf_metrics_object);
+	codes = urf_metrics_get_sorted_keys (metrics);
+	for (item = codes; item != NULL; item = item->next) {
+		count = g_hash_table_lookup (priv->keys, item->data);
+		g_variant_builder_add (&builder, "{ut}",
+				       GPOINTER_TO_UINT (item->data), *count);
+	}
+	G_UNLOCK (urf_metrics_object);
+	g_list_free (codes);
+
+	return g_variant_builder_end (&builder);
+}
+
+/**
+ * urf_metrics_get_histograms:
+ *
+ * Return value: a floating a(satt) of the name, the bucket counts,
+ * the number of samples and their sum in microseconds
+ **/
+GVariant *
+urf_metrics_get_histograms (UrfMetrics *metrics)
+{
+	UrfMetricsPrivate *priv = metrics->priv;
+	UrfMetricsHistogramData *data;
+	GVariantBuilder builder;
+	GVariantBuilder buckets;
+	guint i, j;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(satt)"));
+
+	G_LOCK (urf_metrics_object);
+	for (i = 0; i < URF_METRICS_NUM_HISTOGRAMS; i++) {
+		data = &priv->histograms[i];
+		g_variant_builder_init (&buckets, G_VARIANT_TYPE ("at"));
+		for (j = 0; j < URF_METRICS_NUM_BUCKETS; j++)
+			g_variant_builder_add (&buckets, "t", data->buckets[j]);
+		g_variant_builder_add (&builder, "(satt)",
+				       histogram_info[i].name, &buckets,
+				       data->count, data->sum);
+	}
+	G_UNLOCK (urf_metrics_object);
+
+	return g_variant_builder_end (&builder);
+}
+
+/**
+ * urf_metrics_append_seconds:
+ **/
+static void
+urf_metrics_append_seconds (GString *str,
+			    gdouble  seconds)
+{
+	char buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+	/* the format wants a dot whatever the locale */
+	g_string_append (str, g_ascii_formatd (buf, sizeof (buf), "%g", seconds));
+}
+
+/**
+ * urf_metrics_to_prometheus:
+ *
+ * Return value: the metrics in the Prometheus text format
+ **/
+static char *
+urf_metrics_to_prometheus (UrfMetrics *metrics)
+{
+	UrfMetricsPrivate *priv = metrics->priv;
+	UrfMetricsHistogramData *data;
+	const char *family = NULL;
+	GString *str;
+	GList *codes, *item;
+	guint64 cumulative;
+	guint i, j;
+
+	str = g_string_sized_new (4096);
+
+	G_LOCK (urf_metrics_object);
+	for (i = 0; i < URF_METRICS_NUM_COUNTERS; i++) {
+		if (g_strcmp0 (family, counter_info[i].family) != 0) {
+			family = counter_info[i].family;
+			g_string_append_printf (str, "# HELP %s %s\n# TYPE %s counter\n",
+						family, counter_info[i].help, family);
+		}
+		if (counter_info[i].label != NULL)
+			g_string_append_printf (str, "%s{%s} %" G_GUINT64_FORMAT "\n",
+						family, counter_info[i].label,
+						priv->counters[i]);
+		else
+			g_string_append_printf (str, "%s %" G_GUINT64_FORMAT "\n",
+						family, priv->counters[i]);
+	}
+
+	g_string_append (str, "# HELP urfkill_key_presses_total rfkill key presses, by input event code\n"
+			      "# TYPE urfkill_key_presses_total counter\n");
+	codes = urf_metrics_get_sorted_keys (metrics);
+	for (item = codes; item != NULL; item = item->next)
+		g_string_append_printf (str, "urfkill_key_presses_total{code=\"%u\"} %" G_GUINT64_FORMAT "\n",
+					GPOINTER_TO_UINT (item->data),
+					*(guint64 *) g_hash_table_lookup (priv->keys, item->data));
+	g_list_free (codes);
+
+	for (i = 0; i < URF_METRICS_NUM_HISTOGRAMS; i++) {
+		data = &priv->histograms[i];
+		family = histogram_info[i].family;
+		g_string_append_printf (str, "# HELP %s %s\n# TYPE %s histogram\n",
+					family, histogram_info[i].help, family);
+
+		cumulative = 0;
+		for (j = 0; j < URF_METRICS_NUM_BUCKETS - 1; j++) {
+			cumulative += data->buckets[j];
+			g_string_append_printf (str, "%s_bucket{le=\"", family);
+			urf_metrics_append_seconds (str, (gdouble) (G_GUINT64_CONSTANT (1) << j) / G_USEC_PER_SEC);
+			g_string_append_printf (str, "\"} %" G_GUINT64_FORMAT "\n", cumulative);
+		}
+		g_string_append_printf (str, "%s_bucket{le=\"+Inf\"} %" G_GUINT64_FORMAT "\n",
+					family, data->count);
+		g_string_append_printf (str, "%s_sum ", family);
+		urf_metrics_append_seconds (str, (gdouble) data->sum / G_USEC_PER_SEC);
+		g_string_append_printf (str, "\n%s_count %" G_GUINT64_FORMAT "\n",
+					family, data->count);
+	}
+	G_UNLOCK (urf_metrics_object);
+
+	return g_string_free (str, FALSE);
+}
+
+/**
+ * urf_metrics_write_textfile:
+ **/
+static gboolean
+urf_metrics_write_textfile (UrfMetrics *metrics)
+{
+	UrfMetricsPrivate *priv = metrics->priv;
+	GError *error = NULL;
+	char *contents;
+	gboolean ret;
+
+	/* replaced with a rename, the collector never sees half a file */
+	contents = urf_metrics_to_prometheus (metrics);
+	ret = g_file_set_contents (priv->textfile, contents, -1, &error);
+	g_free (contents);
+
+	if (!ret) {
+		/* once, not on every tick */
+		if (!priv->textfile_failed)
+			urf_warning ("failed to write %s: %s", priv->textfile, error->message);
+		g_error_free (error);
+	}
+	priv->textfile_failed = !ret;
+
+	return ret;
+}
+
+/**
+ * urf_metrics_textfile_cb:
+ **/
+static gboolean
+urf_metrics_textfile_cb (UrfMetrics *metrics)
+{
+	urf_metrics_write_textfile (metrics);
+	return TRUE;
+}
+
+/**
+ * urf_metrics_start_textfile:
+ * @filename: the file to write, ending in .prom for node_exporter
+ * @interval: the seconds between two updates
+ *
+ * Return value: %FALSE if the first write failed
+ **/
+gboolean
+urf_metrics_start_textfile (UrfMetrics *metrics,
+			    const char *filename,
+			    guint       interval)
+{
+	UrfMetricsPrivate *priv = metrics->priv;
+
+	g_return_val_if_fail (priv->textfile == NULL, FALSE);
+	g_return_val_if_fail (interval > 0, FALSE);
+
+	priv->textfile = g_strdup (filename);
+	if (!urf_metrics_write_textfile (metrics)) {
+		g_free (priv->textfile);
+		priv->textfile = NULL;
+		return FALSE;
+	}
+
+	priv->textfile_id = g_timeout_add_seconds (interval,
+						   (GSourceFunc) urf_metrics_textfile_cb,
+						   metrics);
+	return TRUE;
+}
+
+/**
+ * urf_metrics_finalize:
+ **/
+static void
+urf_metrics_finalize (GObject *object)
+{
+	UrfMetricsPrivate *priv = URF_METRICS (object)->priv;
+
+	if (priv->textfile_id > 0)
+		g_source_remove (priv->textfile_id);
+	g_free (priv->textfile);
+	g_hash_table_destroy (priv->keys);
+
+	G_OBJECT_CLASS (urf_metrics_parent_class)->finalize (object);
+}
+
+/**
+ * urf_metrics_class_init:
+ **/
+static void
+urf_metrics_class_init (UrfMetricsClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = urf_metrics_finalize;
+
+	g_type_class_add_private (klass, sizeof (UrfMetricsPrivate));
+}
+
+/**
+ * urf_metrics_init:
+ **/
+static void
+urf_metrics_init (UrfMetrics *metrics)
+{
+	UrfMetricsPrivate *priv = URF_METRICS_GET_PRIVATE (metrics);
+
+	metrics->priv = priv;
+	priv->keys = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+	priv->textfile = NULL;
+	priv->textfile_id = 0;
+	priv->textfile_failed = FALSE;
+}
+
+/**
+ * urf_metrics_new:
+ **/
+UrfMetrics *
+urf_metrics_new (void)
+{
+	G_LOCK (urf_metrics_object);
+	if (urf_metrics_object != NULL) {
+		g_object_ref (urf_metrics_object);
+	} else {
+		urf_metrics_object = g_object_new (URF_TYPE_METRICS, NULL);
+		g_object_add_weak_pointer (urf_metrics_object, &urf_metrics_object);
+	}
+	G_UNLOCK (urf_metrics_object);
+
+	return URF_METRICS (urf_metrics_object);
+}
@@ -0,0 +1,95 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __URF_METRICS_H__
+#define __URF_METRICS_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define URF_TYPE_METRICS (urf_metrics_get_type())
+#define URF_METRICS(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj), \
+					URF_TYPE_METRICS, UrfMetrics))
+#define URF_METRICS_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST((klass), \
+					URF_TYPE_METRICS, UrfMetricsClass))
+#define URF_IS_METRICS(obj) (G_TYPE_CHECK_INSTANCE_TYPE((obj), \
+					URF_TYPE_METRICS))
+#define URF_IS_METRICS_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), \
+					URF_TYPE_METRICS))
+#define URF_GET_METRICS_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS((obj), \
+					URF_TYPE_METRICS, UrfMetricsClass))
+
+typedef struct UrfMetricsPrivate UrfMetricsPrivate;
+
+typedef struct {
+	GObject			 parent;
+	UrfMetricsPrivate	*priv;
+} UrfMetrics;
+
+typedef struct {
+        GObjectClass		 parent_class;
+} UrfMetricsClass;
+
+typedef enum {
+	URF_METRICS_RFKILL_EVENTS_ADD,
+	URF_METRICS_RFKILL_EVENTS_DEL,
+	URF_METRICS_RFKILL_EVENTS_CHANGE,
+	URF_METRICS_RFKILL_EVENTS_CHANGE_ALL,
+	URF_METRICS_RFKILL_WRITES,
+	URF_METRICS_RFKILL_WRITES_ELIDED,
+	URF_METRICS_SIGNALS_EMITTED,
+	URF_METRICS_POLKIT_CHECKS,
+	URF_METRICS_CREDENTIALS_CACHE_HITS,
+	URF_METRICS_CREDENTIALS_CACHE_MISSES,
+	URF_METRICS_INHIBITS,
+	URF_METRICS_UNINHIBITS,
+	URF_METRICS_NUM_COUNTERS
+} UrfMetricsCounter;
+
+typedef enum {
+	URF_METRICS_EVENT_LATENCY,
+	URF_METRICS_METHOD_LATENCY,
+	URF_METRICS_NUM_HISTOGRAMS
+} UrfMetricsHistogram;
+
+/* bucket i counts the durations from 2^(i-1) up to 2^i microseconds,
+ * the last one counts everything longer */
+#define URF_METRICS_NUM_BUCKETS	24
+
+GType			 urf_metrics_get_type		(void);
+UrfMetrics		*urf_metrics_new		(void);
+
+void			 urf_metrics_count		(UrfMetricsCounter counter);
+void			 urf_metrics_count_key		(guint		 code);
+void			 urf_metrics_observe		(UrfMetricsHistogram histogram,
+							 gint64		 start);
+
+GVariant		*urf_metrics_get_counters	(UrfMetrics	*metrics);
+GVariant		*urf_metrics_get_key_presses	(UrfMetrics	*metrics);
+GVariant		*urf_metrics_get_histograms	(UrfMetrics	*metrics);
+
+gboolean		 urf_metrics_start_textfile	(UrfMetrics	*metrics,
+							 const char	*filename,
+							 guint		 interval);
+
+G_END_DECLS
+
+#endif /* __URF_METRICS_H__ */
@@ -0,0 +1,469 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "urf-peer-server.h"
+#include "urf-log.h"
+
+#define URFKILL_OBJECT_PATH "/org/freedesktop/URfkill"
+
+/* every peer costs one object manager with all devices, and anyone may
+ * connect, so one user must not be able to take all the slots */
+#define URF_PEER_SERVER_MAX_PEERS 32
+#define URF_PEER_SERVER_MAX_PEERS_PER_UID 4
+
+#define URF_PEER_SERVER_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), \
+					URF_TYPE_PEER_SERVER, UrfPeerServerPrivate))
+
+typedef struct {
+	UrfPeerServer			*server;
+	GDBusConnection			*connection;
+	GDBusObjectManagerServer	*manager;
+	gulong				 closed_id;
+	uid_t				 uid;
+} UrfPeer;
+
+struct UrfPeerServerPrivate {
+	GDBusServer		*dbus_server;
+	GDBusAuthObserver	*observer;
+	GDBusInterfaceSkeleton	*daemon_skeleton;
+	GHashTable		*objects;
+	GList			*peers;
+	char			*path;
+	dev_t			 dev;
+	ino_t			 ino;
+};
+
+G_DEFINE_TYPE(UrfPeerServer, urf_peer_server, G_TYPE_OBJECT)
+
+/**
+ * urf_peer_free:
+ **/
+static void
+urf_peer_free (UrfPeer *peer)
+{
+	UrfPeerServerPrivate *priv = peer->server->priv;
+
+	g_signal_handler_disconnect (peer->connection, peer->closed_id);
+	g_dbus_interface_skeleton_unexport_from_connection (priv->daemon_skeleton,
+							    peer->connection);
+	g_dbus_object_manager_server_set_connection (peer->manager, NULL);
+	g_object_unref (peer->manager);
+	g_object_unref (peer->connection);
+	g_free (peer);
+}
+
+/**
+ * urf_peer_server_connection_closed_cb:
+ **/
+static void
+urf_peer_server_connection_closed_cb (GDBusConnection *connection,
+				      gboolean         remote_peer_vanished,
+				      GError          *error,
+				      UrfPeer         *peer)
+{
+	UrfPeerServerPrivate *priv = peer->server->priv;
+
+	urf_debug ("peer connection closed");
+	priv->peers = g_list_remove (priv->peers, peer);
+	urf_peer_free (peer);
+}
+
+/**
+ * urf_peer_server_count_peers:
+ *
+ * Return value: the number of open connections from @uid
+ **/
+static guint
+urf_peer_server_count_peers (UrfPeerServer *server,
+			     uid_t          uid)
+{
+	GList *item;
+	guint count = 0;
+
+	for (item = server->priv->peers; item; item = g_list_next (item)) {
+		UrfPeer *peer = item->data;
+		if (peer->uid == uid)
+			count++;
+	}
+
+	return count;
+}
+
+/**
+ * urf_peer_server_new_connection_cb:
+ **/
+static gboolean
+urf_peer_server_new_connection_cb (GDBusServer     *dbus_server,
+				   GDBusConnection *connection,
+				   UrfPeerServer   *server)
+{
+	UrfPeerServerPrivate *priv = server->priv;
+	UrfPeer *peer;
+	GHashTableIter iter;
+	gpointer object;
+	GCredentials *credentials;
+	GError *error = NULL;
+	uid_t uid;
+
+	/* the auth observer already made sure the credentials are there */
+	credentials = g_dbus_connection_get_peer_credentials (connection);
+	uid = g_credentials_get_unix_user (credentials, NULL);
+
+	if (g_list_length (priv->peers) >= URF_PEER_SERVER_MAX_PEERS) {
+		urf_warning ("Too many peer connections, rejecting");
+		return FALSE;
+	}
+	if (urf_peer_server_count_peers (server, uid) >= URF_PEER_SERVER_MAX_PEERS_PER_UID) {
+		urf_warning ("Too many peer connections from uid %d, rejecting", (int) uid);
+		return FALSE;
+	}
+
+	/* the same skeleton serves the system bus and all peers */
+	if (!g_dbus_interface_skeleton_export (priv->daemon_skeleton,
+					       connection,
+					       URFKILL_OBJECT_PATH,
+					       &error)) {
+		urf_warning ("Failed to export interface on peer connection: %s",
+			     error->message);
+		g_error_free (error);
+		return FALSE;
+	}
+
+	peer = g_new0 (UrfPeer, 1);
+	peer->server = server;
+	peer->connection = g_object_ref (connection);
+	peer->uid = uid;
+	peer->manager = g_dbus_object_manager_server_new (URFKILL_OBJECT_PATH);
+
+	g_hash_table_iter_init (&iter, priv->objects);
+	while (g_hash_table_iter_next (&iter, NULL, &object))
+		g_dbus_object_manager_server_export (peer->manager,
+						     G_DBUS_OBJECT_SKELETON (object));
+	g_dbus_object_manager_server_set_connection (peer->manager, connection);
+
+	peer->closed_id = g_signal_connect (connection, "closed",
+					    G_CALLBACK (urf_peer_server_connection_closed_cb),
+					    peer);
+	priv->peers = g_list_prepend (priv->peers, peer);
+
+	return TRUE;
+}
+
+/**
+ * urf_peer_server_authorize_cb:
+ *
+ * Only accept peers the kernel could identify, polkit needs the process
+ * and the peer limits need the user
+ **/
+static gboolean
+urf_peer_server_authorize_cb (GDBusAuthObserver *observer,
+			      GIOStream         *stream,
+			      GCredentials      *credentials,
+			      UrfPeerServer     *server)
+{
+	return credentials != NULL &&
+	       g_credentials_get_unix_pid (credentials, NULL) > 0 &&
+	       g_credentials_get_unix_user (credentials, NULL) != (uid_t) -1;
+}
+
+/**
+ * urf_peer_server_export_device:
+ **/
+void
+urf_peer_server_export_device (UrfPeerServer       *server,
+			       GDBusObjectSkeleton *object)
+{
+	UrfPeerServerPrivate *priv;
+	GList *item;
+
+	g_return_if_fail (URF_IS_PEER_SERVER (server));
+
+	priv = server->priv;
+	g_hash_table_replace (priv->objects,
+			      g_strdup (g_dbus_object_get_object_path (G_DBUS_OBJECT (object))),
+			      g_object_ref (object));
+
+	for (item = priv->peers; item; item = g_list_next (item)) {
+		UrfPeer *peer = item->data;
+		g_dbus_object_manager_server_export (peer->manager, object);
+	}
+}
+
+/**
+ * urf_peer_server_unexport_device:
+ **/
+void
+urf_peer_server_unexport_device (UrfPeerServer *server,
+				 const char    *object_path)
+{
+	UrfPeerServerPrivate *priv;
+	GList *item;
+
+	g_return_if_fail (URF_IS_PEER_SERVER (server));
+
+	priv = server->priv;
+	for (item = priv->peers; item; item = g_list_next (item)) {
+		UrfPeer *peer = item->data;
+		g_dbus_object_manager_server_unexport (peer->manager, object_path);
+	}
+
+	g_hash_table_remove (priv->objects, object_path);
+}
+
+/**
+ * urf_peer_server_in_use:
+ *
+ * Return value: %TRUE if something accepts connections on @path
+ **/
+gboolean
+urf_peer_server_in_use (const char *path)
+{
+	struct sockaddr_un addr;
+	gboolean ret;
+	int fd;
+
+	if (strlen (path) >= sizeof (addr.sun_path))
+		return FALSE;
+
+	memset (&addr, 0, sizeof (addr));
+	addr.sun_family = AF_UNIX;
+	strcpy (addr.sun_path, path);
+
+	fd = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return FALSE;
+	ret = connect (fd, (struct sockaddr *) &addr, sizeof (addr)) == 0;
+	close (fd);
+
+	return ret;
+}
+
+/**
+ * urf_peer_server_remove_stale:
+ *
+ * Return value: %TRUE if @path is free for bind()
+ **/
+static gboolean
+urf_peer_server_remove_stale (const char *path)
+{
+	struct stat st;
+
+	if (lstat (path, &st) < 0) {
+		if (errno == ENOENT)
+			return TRUE;
+		urf_warning ("Failed to stat %s: %s", path, g_strerror (errno));
+		return FALSE;
+	}
+
+	/* never remove what is not ours to remove */
+	if (!S_ISSOCK (st.st_mode)) {
+		urf_warning ("%s exists and is not a socket", path);
+		return FALSE;
+	}
+	if (urf_peer_server_in_use (path)) {
+		urf_warning ("%s is in use by another instance", path);
+		return FALSE;
+	}
+
+	/* nobody listens, left behind by an instance that died */
+	if (unlink (path) < 0 && errno != ENOENT) {
+		urf_warning ("Failed to remove %s: %s", path, g_strerror (errno));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * urf_peer_server_startup:
+ **/
+gboolean
+urf_peer_server_startup (UrfPeerServer          *server,
+			 const char             *path,
+			 GDBusInterfaceSkeleton *daemon_skeleton)
+{
+	UrfPeerServerPrivate *priv;
+	char *dir = NULL;
+	char *address = NULL;
+	char *guid = NULL;
+	struct stat st;
+	GError *error = NULL;
+	gboolean ret = FALSE;
+
+	g_return_val_if_fail (URF_IS_PEER_SERVER (server), FALSE);
+	g_return_val_if_fail (path != NULL, FALSE);
+
+	priv = server->priv;
+	priv->path = g_strdup (path);
+	priv->daemon_skeleton = g_object_ref (daemon_skeleton);
+
+	dir = g_path_get_dirname (path);
+	if (g_mkdir_with_parents (dir, 0755) < 0) {
+		urf_warning ("Failed to create %s: %s", dir, g_strerror (errno));
+		goto out;
+	}
+
+	/* a stale socket from a previous instance blocks bind() */
+	if (!urf_peer_server_remove_stale (path))
+		goto out;
+
+	priv->observer = g_dbus_auth_observer_new ();
+	g_signal_connect (priv->observer, "authorize-authenticated-peer",
+			  G_CALLBACK (urf_peer_server_authorize_cb), server);
+
+	address = g_strdup_printf ("unix:path=%s", path);
+	guid = g_dbus_generate_guid ();
+	priv->dbus_server = g_dbus_server_new_sync (address,
+						    G_DBUS_SERVER_FLAGS_NONE,
+						    guid,
+						    priv->observer,
+						    NULL,
+						    &error);
+	if (priv->dbus_server == NULL) {
+		urf_warning ("Failed to listen on %s: %s", path, error->message);
+		g_error_free (error);
+		goto out;
+	}
+
+	/* so only this very socket is removed again */
+	if (lstat (path, &st) == 0) {
+		priv->dev = st.st_dev;
+		priv->ino = st.st_ino;
+	}
+
+	g_signal_connect (priv->dbus_server, "new-connection",
+			  G_CALLBACK (urf_peer_server_new_connection_cb), server);
+	g_dbus_server_start (priv->dbus_server);
+
+	/* everyone may connect, polkit still guards the methods */
+	if (chmod (path, 0666) < 0)
+		urf_warning ("Failed to chmod %s: %s", path, g_strerror (errno));
+
+	ret = TRUE;
+out:
+	g_free (dir);
+	g_free (address);
+	g_free (guid);
+	return ret;
+}
+
+/**
+ * urf_peer_server_unlink:
+ *
+ * Remove the socket unless another instance has replaced it
+ **/
+static void
+urf_peer_server_unlink (UrfPeerServer *server)
+{
+	UrfPeerServerPrivate *priv = server->priv;
+	struct stat st;
+
+	if (lstat (priv->path, &st) < 0)
+		return;
+	if (st.st_dev != priv->dev || st.st_ino != priv->ino) {
+		urf_debug ("%s was replaced, leaving it", priv->path);
+		return;
+	}
+	if (unlink (priv->path) < 0)
+		urf_warning ("Failed to remove %s: %s", priv->path, g_strerror (errno));
+}
+
+/**
+ * urf_peer_server_finalize:
+ **/
+static void
+urf_peer_server_finalize (GObject *object)
+{
+	UrfPeerServerPrivate *priv = URF_PEER_SERVER (object)->priv;
+
+	if (priv->dbus_server) {
+		g_dbus_server_stop (priv->dbus_server);
+		g_object_unref (priv->dbus_server);
+		if (priv->ino != 0)
+			urf_peer_server_unlink (URF_PEER_SERVER (object));
+	}
+
+	g_list_free_full (priv->peers, (GDestroyNotify) urf_peer_free);
+
+	if (priv->observer)
+		g_object_unref (priv->observer);
+	if (priv->daemon_skeleton)
+		g_object_unref (priv->daemon_skeleton);
+
+	g_hash_table_destroy (priv->objects);
+	g_free (priv->path);
+
+	G_OBJECT_CLASS(urf_peer_server_parent_class)->finalize(object);
+}
+
+/**
+ * urf_peer_server_init:
+ **/
+static void
+urf_peer_server_init (UrfPeerServer *server)
+{
+	server->priv = URF_PEER_SERVER_GET_PRIVATE (server);
+	server->priv->dbus_server = NULL;
+	server->priv->observer = NULL;
+	server->priv->daemon_skeleton = NULL;
+	server->priv->objects = g_hash_table_new_full (g_str_hash, g_str_equal,
+						       g_free, g_object_unref);
+	server->priv->peers = NULL;
+	server->priv->path = NULL;
+	server->priv->dev = 0;
+	server->priv->ino = 0;
+}
+
+/**
+ * urf_peer_server_class_init:
+ **/
+static void
+urf_peer_server_class_init (UrfPeerServerClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS(klass);
+
+	g_type_class_add_private(klass, sizeof(UrfPeerServerPrivate));
+	object_class->finalize = urf_peer_server_finalize;
+}
+
+/**
+ * urf_peer_server_new:
+ **/
+UrfPeerServer *
+urf_peer_server_new (void)
+{
+	UrfPeerServer *server;
+	server = URF_PEER_SERVER(g_object_new (URF_TYPE_PEER_SERVER, NULL));
+	return server;
+}
@@ -0,0 +1,65 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __URF_PEER_SERVER_H__
+#define __URF_PEER_SERVER_H__
+
+#include <glib-object.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define URF_TYPE_PEER_SERVER (urf_peer_server_get_type())
+#define URF_PEER_SERVER(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj), \
+					URF_TYPE_PEER_SERVER, UrfPeerServer))
+#define URF_PEER_SERVER_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST((klass), \
+					URF_TYPE_PEER_SERVER, UrfPeerServerClass))
+#define URF_IS_PEER_SERVER(obj) (G_TYPE_CHECK_INSTANCE_TYPE((obj), \
+					URF_TYPE_PEER_SERVER))
+#define URF_IS_PEER_SERVER_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), \
+					URF_TYPE_PEER_SERVER))
+#define URF_GET_PEER_SERVER_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS((obj), \
+					URF_TYPE_PEER_SERVER, UrfPeerServerClass))
+
+typedef struct UrfPeerServerPrivate UrfPeerServerPrivate;
+
+typedef struct {
+	GObject parent;
+	UrfPeerServerPrivate *priv;
+} UrfPeerServer;
+
+typedef struct {
+        GObjectClass parent_class;
+} UrfPeerServerClass;
+
+GType		 urf_peer_server_get_type	(void);
+UrfPeerServer	*urf_peer_server_new		(void);
+gboolean	 urf_peer_server_in_use		(const char		*path);
+gboolean	 urf_peer_server_startup	(UrfPeerServer		*server,
+						 const char		*path,
+						 GDBusInterfaceSkeleton	*daemon_skeleton);
+void		 urf_peer_server_export_device	(UrfPeerServer		*server,
+						 GDBusObjectSkeleton	*object);
+void		 urf_peer_server_unexport_device (UrfPeerServer		*server,
+						 const char		*object_path);
+
+G_END_DECLS
+
+#endif /* __URF_PEER_SERVER_H__ */
@@ -26,19 +26,23 @@
 #endif
 
 #include <glib.h>
-#include <dbus/dbus-glib.h>
-#include <dbus/dbus-glib-lowlevel.h>
+#include <gio/gio.h>
 
 #include <polkit/polkit.h>
 
 #include "urf-polkit.h"
+#include "urf-log.h"
 #include "urf-daemon.h"
+#include "urf-credentials.h"
+#include "urf-watchdog.h"
+#include "urf-metrics.h"
+#include "urf-probes.h"
 
 #define URF_POLKIT_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), URF_TYPE_POLKIT, UrfPolkitPrivate))
 
 struct UrfPolkitPrivate
 {
-	DBusGConnection	*connection;
+	UrfCredentials	*credentials;
 	PolkitAuthority	*authority;
 };
 
@@ -50,19 +54,38 @@ static gpointer urf_polkit_object = NULL;
  **/
 PolkitSubject *
 urf_polkit_get_subject (UrfPolkit             *polkit,
-			DBusGMethodInvocation *context)
+			GDBusMethodInvocation *invocation)
 {
-	GError *error;
 	const gchar *sender;
-	PolkitSubject *subject;
-
-	sender = dbus_g_method_get_sender (context);
-	subject = polkit_system_bus_name_new (sender);
+	GCredentials *credentials;
+	PolkitSubject *subject = NULL;
+	pid_t pid;
+	uid_t uid;
+
+	sender = g_dbus_method_invocation_get_sender (invocation);
+	if (sender != NULL) {
+		subject = polkit_system_bus_name_new (sender);
+	} else {
+		/* peer-to-peer connection: the kernel vouches for the caller,
+		 * pass the uid too so a reused pid is not authorized */
+		credentials = g_dbus_connection_get_peer_credentials (g_dbus_method_invocation_get_connection (invocation));
+		if (credentials != NULL) {
+			pid = g_credentials_get_unix_pid (credentials, NULL);
+			uid = g_credentials_get_unix_user (credentials, NULL);
+#ifdef HAVE_POLKIT_UNIX_PROCESS_NEW_FOR_OWNER
+			if (pid > 0 && uid != (uid_t) -1)
+				subject = polkit_unix_process_new_for_owner (pid, 0, uid);
+#else
+			urf_debug ("polkit is too old to check pid %d uid %d safely",
+				   (int) pid, (int) uid);
+#endif
+		}
+	}
 
 	if (subject == NULL) {
-		error = g_error_new (URF_DAEMON_ERROR, URF_DAEMON_ERROR_GENERAL, "failed to get PolicyKit subject");
-		dbus_g_method_return_error (context, error);
-		g_error_free (error);
+		g_dbus_method_invocation_return_error (invocation,
+						       URF_DAEMON_ERROR, URF_DAEMON_ERROR_GENERAL,
+						       "failed to get PolicyKit subject");
 	}
 
 	return subject;
@@ -75,23 +98,33 @@ gboolean
 urf_polkit_check_auth (UrfPolkit             *polkit,
 		       PolkitSubject         *subject,
 		       const gchar           *action_id,
-		       DBusGMethodInvocation *context)
+		       GDBusMethodInvocation *invocation)
 {
 	gboolean ret = FALSE;
-	GError *error;
 	GError *error_local = NULL;
 	PolkitAuthorizationResult *result;
+	gint64 start;
 
 	/* check auth */
+	urf_metrics_count (URF_METRICS_POLKIT_CHECKS);
+	start = urf_watchdog_begin ();
+	if (URF_PROBE_ENABLED (polkit__check__start))
+		URF_PROBE2 (polkit__check__start, action_id, start);
 	result = polkit_authority_check_authorization_sync (polkit->priv->authority,
 							    subject, action_id, NULL,
 							    POLKIT_CHECK_AUTHORIZATION_FLAGS_ALLOW_USER_INTERACTION,
 							    NULL, &error_local);
+	urf_watchdog_end (start, "polkit_authority_check_authorization_sync");
+	if (URF_PROBE_ENABLED (polkit__check__end))
+		URF_PROBE4 (polkit__check__end, action_id,
+			    result != NULL && polkit_authorization_result_get_is_authorized (result),
+			    start, g_get_monotonic_time ());
 	if (result == NULL) {
-		error = g_error_new (URF_DAEMON_ERROR, URF_DAEMON_ERROR_GENERAL, "failed to check authorisation: %s", error_local->message);
-		dbus_g_method_return_error (context, error);
+		g_dbus_method_invocation_return_error (invocation,
+						       URF_DAEMON_ERROR, URF_DAEMON_ERROR_GENERAL,
+						       "failed to check authorisation: %s",
+						       error_local->message);
 		g_error_free (error_local);
-		g_error_free (error);
 		goto out;
 	}
 
@@ -99,9 +132,9 @@ urf_polkit_check_auth (UrfPolkit             *polkit,
 	if (polkit_authorization_result_get_is_authorized (result)) {
 		ret = TRUE;
 	} else {
-		error = g_error_new (URF_DAEMON_ERROR, URF_DAEMON_ERROR_GENERAL, "not authorized");
-		dbus_g_method_return_error (context, error);
-		g_error_free (error);
+		g_dbus_method_invocation_return_error (invocation,
+						       URF_DAEMON_ERROR, URF_DAEMON_ERROR_GENERAL,
+						       "not authorized");
 	}
 out:
 	if (result != NULL)
@@ -121,12 +154,22 @@ urf_polkit_is_allowed (UrfPolkit     *polkit,
 	gboolean ret = FALSE;
 	GError *error_local = NULL;
 	PolkitAuthorizationResult *result;
+	gint64 start;
 
 	/* check auth */
+	urf_metrics_count (URF_METRICS_POLKIT_CHECKS);
+	start = urf_watchdog_begin ();
+	if (URF_PROBE_ENABLED (polkit__check__start))
+		URF_PROBE2 (polkit__check__start, action_id, start);
 	result = polkit_authority_check_authorization_sync (polkit->priv->authority,
 							    subject, action_id, NULL,
 							    POLKIT_CHECK_AUTHORIZATION_FLAGS_NONE,
 							    NULL, &error_local);
+	urf_watchdog_end (start, "polkit_authority_check_authorization_sync");
+	if (URF_PROBE_ENABLED (polkit__check__end))
+		URF_PROBE4 (polkit__check__end, action_id,
+			    result != NULL && polkit_authorization_result_get_is_authorized (result),
+			    start, g_get_monotonic_time ());
 	if (result == NULL) {
 		g_set_error (error, URF_DAEMON_ERROR, URF_DAEMON_ERROR_GENERAL, "failed to check authorisation: %s", error_local->message);
 		g_error_free (error_local);
@@ -149,17 +192,19 @@ urf_polkit_get_uid (UrfPolkit     *polkit,
 		    PolkitSubject *subject,
 		    uid_t         *uid)
 {
-	DBusConnection *connection;
 	const gchar *name;
+	guint cached_uid;
 
 	if (!POLKIT_IS_SYSTEM_BUS_NAME (subject)) {
-		g_debug ("not system bus name");
+		urf_debug ("not system bus name");
 		return FALSE;
 	}
 
-	connection = dbus_g_connection_get_connection (polkit->priv->connection);
 	name = polkit_system_bus_name_get_name (POLKIT_SYSTEM_BUS_NAME (subject));
-	*uid = dbus_bus_get_unix_user (connection, name, NULL);
+	if (!urf_credentials_get_uid (polkit->priv->credentials, name, &cached_uid))
+		return FALSE;
+
+	*uid = (uid_t) cached_uid;
 	return TRUE;
 }
 
@@ -171,43 +216,22 @@ urf_polkit_get_pid (UrfPolkit     *polkit,
 		    PolkitSubject *subject,
 		    pid_t         *pid)
 {
-	gboolean ret = FALSE;
-	GError *error = NULL;
 	const gchar *name;
-	DBusGProxy *proxy = NULL;
+	guint cached_pid;
 
 	/* bus name? */
 	if (!POLKIT_IS_SYSTEM_BUS_NAME (subject)) {
-		g_debug ("not system bus name");
-		goto out;
+		urf_debug ("not system bus name");
+		return FALSE;
 	}
 
+	/* answered from the cache after the first call for this peer */
 	name = polkit_system_bus_name_get_name (POLKIT_SYSTEM_BUS_NAME (subject));
-	proxy = dbus_g_proxy_new_for_name_owner (polkit->priv->connection,
-						 "org.freedesktop.DBus",
-						 "/org/freedesktop/DBus/Bus",
-						 "org.freedesktop.DBus", &error);
-	if (proxy == NULL) {
-		g_warning ("DBUS error: %s", error->message);
-		g_error_free (error);
-		goto out;
-	}
+	if (!urf_credentials_get_pid (polkit->priv->credentials, name, &cached_pid))
+		return FALSE;
 
-	/* get pid from DBus (quite slow) */
-	ret = dbus_g_proxy_call (proxy, "GetConnectionUnixProcessID", &error,
-				 G_TYPE_STRING, name,
-				 G_TYPE_INVALID,
-				 G_TYPE_UINT, pid,
-				 G_TYPE_INVALID);
-	if (!ret) {
-		g_warning ("failed to get pid: %s", error->message);
-		g_error_free (error);
-		goto out;
-        }
-out:
-	if (proxy != NULL)
-		g_object_unref (proxy);
-	return ret;
+	*pid = (pid_t) cached_pid;
+	return TRUE;
 }
 
 /**
@@ -220,8 +244,7 @@ urf_polkit_finalize (GObject *object)
 	g_return_if_fail (URF_IS_POLKIT (object));
 	polkit = URF_POLKIT (object);
 
-	if (polkit->priv->connection != NULL)
-		dbus_g_connection_unref (polkit->priv->connection);
+	g_object_unref (polkit->priv->credentials);
 	g_object_unref (polkit->priv->authority);
 
 	G_OBJECT_CLASS (urf_polkit_parent_class)->finalize (object);
@@ -249,20 +272,17 @@ static void
 urf_polkit_init (UrfPolkit *polkit)
 {
 	GError *error = NULL;
+#ifdef USE_SECURITY_POLKIT_NEW
+	gint64 start;
+#endif
 
 	polkit->priv = URF_POLKIT_GET_PRIVATE (polkit);
-
-	polkit->priv->connection = dbus_g_bus_get (DBUS_BUS_SYSTEM, &error);
-	if (polkit->priv->connection == NULL) {
-		if (error != NULL) {
-			g_critical ("error getting system bus: %s", error->message);
-			g_error_free (error);
-		}
-		goto out;
-	}
+	polkit->priv->credentials = urf_credentials_new ();
 
 #ifdef USE_SECURITY_POLKIT_NEW
+	start = urf_watchdog_begin ();
 	polkit->priv->authority = polkit_authority_get_sync (NULL, &error);
+	urf_watchdog_end (start, "polkit_authority_get_sync");
 	if (polkit->priv->authority == NULL) {
 		g_error ("failed to get pokit authority: %s", error->message);
 		g_error_free (error);
@@ -24,6 +24,7 @@
 #define __URF_POLKIT_H
 
 #include <glib-object.h>
+#include <gio/gio.h>
 #include <polkit/polkit.h>
 
 G_BEGIN_DECLS
@@ -53,11 +54,11 @@ UrfPolkit	*urf_polkit_new			(void);
 void		 urf_polkit_test		(gpointer		 user_data);
 
 PolkitSubject	*urf_polkit_get_subject		(UrfPolkit		*polkit,
-						 DBusGMethodInvocation	*context);
+						 GDBusMethodInvocation	*invocation);
 gboolean	 urf_polkit_check_auth		(UrfPolkit		*polkit,
 						 PolkitSubject		*subject,
 						 const gchar		*action_id,
-						 DBusGMethodInvocation	*context);
+						 GDBusMethodInvocation	*invocation);
 gboolean	 urf_polkit_is_allowed		(UrfPolkit		*polkit,
 						 PolkitSubject		*subject,
 						 const gchar		*action_id,
@@ -0,0 +1,47 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ * The semaphores of the probes in urf-probes.h. The .probes section is
+ * where the tracers look for them, as with the objects generated by
+ * dtrace -G.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "urf-probes.h"
+
+#define URF_PROBE_DEFINE_SEMAPHORE(name) \
+	volatile unsigned short URF_PROBE_SEMAPHORE (name) \
+		__attribute__ ((section (".probes"))) = 0
+
+URF_PROBE_DEFINE_SEMAPHORE (rfkill__event);
+URF_PROBE_DEFINE_SEMAPHORE (rfkill__write);
+URF_PROBE_DEFINE_SEMAPHORE (device__add);
+URF_PROBE_DEFINE_SEMAPHORE (device__remove);
+URF_PROBE_DEFINE_SEMAPHORE (method__entry);
+URF_PROBE_DEFINE_SEMAPHORE (method__return);
+URF_PROBE_DEFINE_SEMAPHORE (polkit__check__start);
+URF_PROBE_DEFINE_SEMAPHORE (polkit__check__end);
+URF_PROBE_DEFINE_SEMAPHORE (key__dispatch);
@@ -0,0 +1,89 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __URF_PROBES_H__
+#define __URF_PROBES_H__
+
+/*
+ * USDT probes of the "urfkill" provider, built with --enable-usdt.
+ * The timestamps are g_get_monotonic_time() values in microseconds.
+ *
+ *   rfkill__event		(idx, type, op, soft, hard, timestamp)
+ *   rfkill__write		(idx, type, op, soft, timestamp)
+ *   device__add		(idx, type, soft, hard, timestamp)
+ *   device__remove		(idx, type, timestamp)
+ *   method__entry		(method, timestamp)
+ *   method__return		(method, start, timestamp)
+ *   polkit__check__start	(action_id, timestamp)
+ *   polkit__check__end		(action_id, authorized, start, timestamp)
+ *   key__dispatch		(code, inhibited, timestamp)
+ *
+ * Every probe has a semaphore which the tracer raises when it attaches,
+ * so the arguments are only computed while somebody listens:
+ *
+ *	if (URF_PROBE_ENABLED (rfkill__write))
+ *		URF_PROBE5 (rfkill__write, ...);
+ *
+ * e.g. bpftrace -e 'usdt:/usr/libexec/urfkilld:urfkill:rfkill__event
+ *			{ printf ("%d %d\n", arg0, arg2); }'
+ */
+
+#ifdef HAVE_USDT
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define URF_PROBE_SEMAPHORE(name)	urfkill_##name##_semaphore
+#define URF_PROBE_ENABLED(name)		G_UNLIKELY (URF_PROBE_SEMAPHORE (name))
+
+#define URF_PROBE2(name, a, b)			\
+	DTRACE_PROBE2 (urfkill, name, a, b)
+#define URF_PROBE3(name, a, b, c)		\
+	DTRACE_PROBE3 (urfkill, name, a, b, c)
+#define URF_PROBE4(name, a, b, c, d)		\
+	DTRACE_PROBE4 (urfkill, name, a, b, c, d)
+#define URF_PROBE5(name, a, b, c, d, e)		\
+	DTRACE_PROBE5 (urfkill, name, a, b, c, d, e)
+#define URF_PROBE6(name, a, b, c, d, e, f)	\
+	DTRACE_PROBE6 (urfkill, name, a, b, c, d, e, f)
+
+extern volatile unsigned short URF_PROBE_SEMAPHORE (rfkill__event);
+extern volatile unsigned short URF_PROBE_SEMAPHORE (rfkill__write);
+extern volatile unsigned short URF_PROBE_SEMAPHORE (device__add);
+extern volatile unsigned short URF_PROBE_SEMAPHORE (device__remove);
+extern volatile unsigned short URF_PROBE_SEMAPHORE (method__entry);
+extern volatile unsigned short URF_PROBE_SEMAPHORE (method__return);
+extern volatile unsigned short URF_PROBE_SEMAPHORE (polkit__check__start);
+extern volatile unsigned short URF_PROBE_SEMAPHORE (polkit__check__end);
+extern volatile unsigned short URF_PROBE_SEMAPHORE (key__dispatch);
+
+#else /* HAVE_USDT */
+
+#define URF_PROBE_ENABLED(name)			(0)
+
+#define URF_PROBE2(name, a, b)			do { } while (0)
+#define URF_PROBE3(name, a, b, c)		do { } while (0)
+#define URF_PROBE4(name, a, b, c, d)		do { } while (0)
+#define URF_PROBE5(name, a, b, c, d, e)		do { } while (0)
+#define URF_PROBE6(name, a, b, c, d, e, f)	do { } while (0)
+
+#endif /* HAVE_USDT */
+
+#endif /* __URF_PROBES_H__ */
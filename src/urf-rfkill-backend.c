@@ -0,0 +1,193 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib-object.h>
+
+#include "urf-rfkill-backend.h"
+#include "urf-log.h"
+#include "urf-rfkill-kernel.h"
+#include "urf-rfkill-replay.h"
+#include "urf-rfkill-sim.h"
+
+#define URF_RFKILL_SIM_DEFAULT_DEVICES 4
+
+G_DEFINE_ABSTRACT_TYPE (UrfRfkillBackend, urf_rfkill_backend, G_TYPE_OBJECT)
+
+/**
+ * urf_rfkill_backend_new_replay:
+ *
+ * A trailing ":SPEED" is only taken as the speed if it is a number,
+ * so the file name may contain colons.
+ **/
+static UrfRfkillBackend *
+urf_rfkill_backend_new_replay (const char *args)
+{
+	UrfRfkillBackend *backend;
+	const char *colon;
+	char *filename;
+	char *end = NULL;
+	gdouble speed = 1.0;
+
+	colon = strrchr (args, ':');
+	if (colon != NULL && colon[1] != '\0')
+		speed = g_ascii_strtod (colon + 1, &end);
+
+	if (end != NULL && *end == '\0' && speed >= 0) {
+		filename = g_strndup (args, colon - args);
+	} else {
+		filename = g_strdup (args);
+		speed = 1.0;
+	}
+
+	backend = URF_RFKILL_BACKEND (urf_rfkill_replay_new (filename, speed));
+	g_free (filename);
+
+	return backend;
+}
+
+/**
+ * urf_rfkill_backend_new_for_spec:
+ * @spec: "kernel", "sim[:DEVICES[:LATENCY_MS]]", "replay:FILE[:SPEED]",
+ * or %NULL
+ *
+ * Return value: the backend, or %NULL if @spec is invalid
+ **/
+UrfRfkillBackend *
+urf_rfkill_backend_new_for_spec (const char *spec)
+{
+	UrfRfkillBackend *backend = NULL;
+	char **tokens = NULL;
+	guint n_devices = URF_RFKILL_SIM_DEFAULT_DEVICES;
+	guint latency = 0;
+
+	if (spec == NULL || g_strcmp0 (spec, "kernel") == 0) {
+		urf_debug ("Using /dev/rfkill");
+		return URF_RFKILL_BACKEND (urf_rfkill_kernel_new ());
+	}
+
+	if (g_str_has_prefix (spec, "replay:"))
+		return urf_rfkill_backend_new_replay (spec + strlen ("replay:"));
+
+	tokens = g_strsplit (spec, ":", 3);
+	if (g_strcmp0 (tokens[0], "sim") != 0) {
+		urf_warning ("Unknown rfkill backend '%s'", spec);
+		goto out;
+	}
+	if (tokens[1] != NULL)
+		n_devices = atoi (tokens[1]);
+	if (tokens[1] != NULL && tokens[2] != NULL)
+		latency = atoi (tokens[2]);
+
+	urf_debug ("Using simulated rfkill with %u devices and %u ms latency",
+		   n_devices, latency);
+	backend = URF_RFKILL_BACKEND (urf_rfkill_sim_new (n_devices, latency));
+out:
+	g_strfreev (tokens);
+	return backend;
+}
+
+/**
+ * urf_rfkill_backend_open:
+ **/
+gboolean
+urf_rfkill_backend_open (UrfRfkillBackend *backend)
+{
+	g_return_val_if_fail (URF_IS_RFKILL_BACKEND (backend), FALSE);
+
+	return URF_GET_RFKILL_BACKEND_CLASS (backend)->open (backend);
+}
+
+/**
+ * urf_rfkill_backend_get_fd:
+ *
+ * Return value: a file descriptor which polls readable when events
+ * are pending
+ **/
+int
+urf_rfkill_backend_get_fd (UrfRfkillBackend *backend)
+{
+	g_return_val_if_fail (URF_IS_RFKILL_BACKEND (backend), -1);
+
+	return URF_GET_RFKILL_BACKEND_CLASS (backend)->get_fd (backend);
+}
+
+/**
+ * urf_rfkill_backend_read_events:
+ *
+ * Read the pending events without blocking, up to @n_events of them.
+ *
+ * Return value: the number of events read, or -1 on error
+ **/
+int
+urf_rfkill_backend_read_events (UrfRfkillBackend    *backend,
+				struct rfkill_event *events,
+				guint                n_events)
+{
+	g_return_val_if_fail (URF_IS_RFKILL_BACKEND (backend), -1);
+
+	return URF_GET_RFKILL_BACKEND_CLASS (backend)->read_events (backend, events, n_events);
+}
+
+/**
+ * urf_rfkill_backend_write_event:
+ **/
+gboolean
+urf_rfkill_backend_write_event (UrfRfkillBackend          *backend,
+				const struct rfkill_event *event)
+{
+	g_return_val_if_fail (URF_IS_RFKILL_BACKEND (backend), FALSE);
+
+	return URF_GET_RFKILL_BACKEND_CLASS (backend)->write_event (backend, event);
+}
+
+/**
+ * urf_rfkill_backend_close:
+ **/
+void
+urf_rfkill_backend_close (UrfRfkillBackend *backend)
+{
+	g_return_if_fail (URF_IS_RFKILL_BACKEND (backend));
+
+	URF_GET_RFKILL_BACKEND_CLASS (backend)->close (backend);
+}
+
+/**
+ * urf_rfkill_backend_class_init:
+ **/
+static void
+urf_rfkill_backend_class_init (UrfRfkillBackendClass *klass)
+{
+}
+
+/**
+ * urf_rfkill_backend_init:
+ **/
+static void
+urf_rfkill_backend_init (UrfRfkillBackend *backend)
+{
+}
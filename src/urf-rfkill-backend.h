@@ -0,0 +1,73 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __URF_RFKILL_BACKEND_H__
+#define __URF_RFKILL_BACKEND_H__
+
+#include <glib-object.h>
+#include <linux/rfkill.h>
+
+G_BEGIN_DECLS
+
+#define URF_TYPE_RFKILL_BACKEND (urf_rfkill_backend_get_type())
+#define URF_RFKILL_BACKEND(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj), \
+					URF_TYPE_RFKILL_BACKEND, UrfRfkillBackend))
+#define URF_RFKILL_BACKEND_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST((klass), \
+					URF_TYPE_RFKILL_BACKEND, UrfRfkillBackendClass))
+#define URF_IS_RFKILL_BACKEND(obj) (G_TYPE_CHECK_INSTANCE_TYPE((obj), \
+					URF_TYPE_RFKILL_BACKEND))
+#define URF_IS_RFKILL_BACKEND_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), \
+					URF_TYPE_RFKILL_BACKEND))
+#define URF_GET_RFKILL_BACKEND_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS((obj), \
+					URF_TYPE_RFKILL_BACKEND, UrfRfkillBackendClass))
+
+typedef struct {
+	GObject 		 parent;
+} UrfRfkillBackend;
+
+typedef struct {
+        GObjectClass	 	 parent_class;
+
+	/* vtable */
+	gboolean		(*open)			(UrfRfkillBackend	*backend);
+	int			(*get_fd)		(UrfRfkillBackend	*backend);
+	int			(*read_events)		(UrfRfkillBackend	*backend,
+							 struct rfkill_event	*events,
+							 guint			 n_events);
+	gboolean		(*write_event)		(UrfRfkillBackend	*backend,
+							 const struct rfkill_event *event);
+	void			(*close)		(UrfRfkillBackend	*backend);
+} UrfRfkillBackendClass;
+
+GType			 urf_rfkill_backend_get_type		(void);
+
+UrfRfkillBackend	*urf_rfkill_backend_new_for_spec	(const char		*spec);
+gboolean		 urf_rfkill_backend_open		(UrfRfkillBackend	*backend);
+int			 urf_rfkill_backend_get_fd		(UrfRfkillBackend	*backend);
+int			 urf_rfkill_backend_read_events		(UrfRfkillBackend	*backend,
+								 struct rfkill_event	*events,
+								 guint			 n_events);
+gboolean		 urf_rfkill_backend_write_event		(UrfRfkillBackend	*backend,
+								 const struct rfkill_event *event);
+void			 urf_rfkill_backend_close		(UrfRfkillBackend	*backend);
+
+G_END_DECLS
+
+#endif /* __URF_RFKILL_BACKEND_H__ */
@@ -0,0 +1,199 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include <glib.h>
+
+#include "urf-rfkill-kernel.h"
+#include "urf-log.h"
+
+#ifndef RFKILL_EVENT_SIZE_V1
+#define RFKILL_EVENT_SIZE_V1    8
+#endif
+
+struct UrfRfkillKernelPrivate {
+	int	 fd;
+};
+
+G_DEFINE_TYPE (UrfRfkillKernel, urf_rfkill_kernel, URF_TYPE_RFKILL_BACKEND)
+
+#define URF_RFKILL_KERNEL_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), \
+				URF_TYPE_RFKILL_KERNEL, UrfRfkillKernelPrivate))
+
+/**
+ * urf_rfkill_kernel_open:
+ **/
+static gboolean
+urf_rfkill_kernel_open (UrfRfkillBackend *backend)
+{
+	UrfRfkillKernelPrivate *priv = URF_RFKILL_KERNEL (backend)->priv;
+	int fd;
+
+	fd = open("/dev/rfkill", O_RDWR | O_NONBLOCK);
+	if (fd < 0) {
+		if (errno == EACCES)
+			urf_warning ("Could not open RFKILL control device, please verify your installation");
+		return FALSE;
+	}
+
+	/* Disable rfkill input */
+	ioctl(fd, RFKILL_IOCTL_NOINPUT);
+
+	priv->fd = fd;
+	return TRUE;
+}
+
+/**
+ * urf_rfkill_kernel_get_fd:
+ **/
+static int
+urf_rfkill_kernel_get_fd (UrfRfkillBackend *backend)
+{
+	return URF_RFKILL_KERNEL (backend)->priv->fd;
+}
+
+/**
+ * urf_rfkill_kernel_read_events:
+ *
+ * The kernel returns one event per read()
+ **/
+static int
+urf_rfkill_kernel_read_events (UrfRfkillBackend    *backend,
+			       struct rfkill_event *events,
+			       guint                n_events)
+{
+	UrfRfkillKernelPrivate *priv = URF_RFKILL_KERNEL (backend)->priv;
+	guint n = 0;
+	ssize_t len;
+
+	while (n < n_events) {
+		len = read (priv->fd, &events[n], sizeof (struct rfkill_event));
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN)
+				break;
+			urf_debug ("Reading of RFKILL events failed");
+			return n > 0 ? (int) n : -1;
+		}
+
+		if (len != RFKILL_EVENT_SIZE_V1) {
+			urf_warning ("Wrong size of RFKILL event\n");
+			continue;
+		}
+
+		n++;
+	}
+
+	return n;
+}
+
+/**
+ * urf_rfkill_kernel_write_event:
+ **/
+static gboolean
+urf_rfkill_kernel_write_event (UrfRfkillBackend          *backend,
+			       const struct rfkill_event *event)
+{
+	UrfRfkillKernelPrivate *priv = URF_RFKILL_KERNEL (backend)->priv;
+	ssize_t len;
+
+	len = write (priv->fd, event, sizeof (struct rfkill_event));
+	if (len < 0) {
+		urf_warning ("Failed to change RFKILL state: %s",
+			     g_strerror (errno));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * urf_rfkill_kernel_close:
+ **/
+static void
+urf_rfkill_kernel_close (UrfRfkillBackend *backend)
+{
+	UrfRfkillKernelPrivate *priv = URF_RFKILL_KERNEL (backend)->priv;
+
+	if (priv->fd >= 0) {
+		close (priv->fd);
+		priv->fd = -1;
+	}
+}
+
+/**
+ * urf_rfkill_kernel_finalize:
+ **/
+static void
+urf_rfkill_kernel_finalize (GObject *object)
+{
+	urf_rfkill_kernel_close (URF_RFKILL_BACKEND (object));
+
+	G_OBJECT_CLASS (urf_rfkill_kernel_parent_class)->finalize (object);
+}
+
+/**
+ * urf_rfkill_kernel_class_init:
+ **/
+static void
+urf_rfkill_kernel_class_init (UrfRfkillKernelClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	UrfRfkillBackendClass *backend_class = URF_RFKILL_BACKEND_CLASS (klass);
+
+	object_class->finalize = urf_rfkill_kernel_finalize;
+
+	backend_class->open = urf_rfkill_kernel_open;
+	backend_class->get_fd = urf_rfkill_kernel_get_fd;
+	backend_class->read_events = urf_rfkill_kernel_read_events;
+	backend_class->write_event = urf_rfkill_kernel_write_event;
+	backend_class->close = urf_rfkill_kernel_close;
+
+	g_type_class_add_private (klass, sizeof (UrfRfkillKernelPrivate));
+}
+
+/**
+ * urf_rfkill_kernel_init:
+ **/
+static void
+urf_rfkill_kernel_init (UrfRfkillKernel *kernel)
+{
+	kernel->priv = URF_RFKILL_KERNEL_GET_PRIVATE (kernel);
+	kernel->priv->fd = -1;
+}
+
+/**
+ * urf_rfkill_kernel_new:
+ **/
+UrfRfkillKernel *
+urf_rfkill_kernel_new (void)
+{
+	UrfRfkillKernel *kernel;
+	kernel = URF_RFKILL_KERNEL (g_object_new (URF_TYPE_RFKILL_KERNEL, NULL));
+	return kernel;
+}
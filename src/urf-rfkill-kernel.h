@@ -0,0 +1,59 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __URF_RFKILL_KERNEL_H__
+#define __URF_RFKILL_KERNEL_H__
+
+#include <glib-object.h>
+
+#include "urf-rfkill-backend.h"
+
+G_BEGIN_DECLS
+
+#define URF_TYPE_RFKILL_KERNEL (urf_rfkill_kernel_get_type())
+#define URF_RFKILL_KERNEL(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj), \
+					URF_TYPE_RFKILL_KERNEL, UrfRfkillKernel))
+#define URF_RFKILL_KERNEL_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST((klass), \
+					URF_TYPE_RFKILL_KERNEL, UrfRfkillKernelClass))
+#define URF_IS_RFKILL_KERNEL(obj) (G_TYPE_CHECK_INSTANCE_TYPE((obj), \
+					URF_TYPE_RFKILL_KERNEL))
+#define URF_IS_RFKILL_KERNEL_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), \
+					URF_TYPE_RFKILL_KERNEL))
+#define URF_GET_RFKILL_KERNEL_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS((obj), \
+					URF_TYPE_RFKILL_KERNEL, UrfRfkillKernelClass))
+
+typedef struct UrfRfkillKernelPrivate UrfRfkillKernelPrivate;
+
+typedef struct {
+	UrfRfkillBackend	 parent;
+	UrfRfkillKernelPrivate	*priv;
+} UrfRfkillKernel;
+
+typedef struct {
+	UrfRfkillBackendClass	 parent_class;
+} UrfRfkillKernelClass;
+
+GType			 urf_rfkill_kernel_get_type		(void);
+
+UrfRfkillKernel		*urf_rfkill_kernel_new		(void);
+
+G_END_DECLS
+
+#endif /* __URF_RFKILL_KERNEL_H__ */
@@ -0,0 +1,409 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ * Replays a trace recorded with --trace. The rfkill events are fed to
+ * the killswitch through a pipe like the simulator does, key presses
+ * are emitted as signals, and the recorded writes are informational
+ * only since their outcome is part of the trace. With a speed of 0
+ * the records are replayed as fast as the main loop takes them, which
+ * makes a trace a repeatable workload.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "urf-rfkill-replay.h"
+#include "urf-log.h"
+#include "urf-trace.h"
+
+/* records dispatched per main loop iteration when catching up */
+#define URF_RFKILL_REPLAY_BATCH 64
+
+enum {
+	RF_KEY_PRESSED,
+	FINISHED,
+	LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
+struct UrfRfkillReplayPrivate {
+	char			*filename;
+	gdouble			 speed;
+	GMappedFile		*file;
+	const UrfTraceRecord	*records;
+	guint			 n_records;
+	guint			 next;
+	gint64			 base;
+	gint64			 started;
+	GQueue			*pending;
+	int			 pipe_fds[2];
+	guint			 source_id;
+};
+
+G_DEFINE_TYPE (UrfRfkillReplay, urf_rfkill_replay, URF_TYPE_RFKILL_BACKEND)
+
+#define URF_RFKILL_REPLAY_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), \
+				URF_TYPE_RFKILL_REPLAY, UrfRfkillReplayPrivate))
+
+static void urf_rfkill_replay_schedule (UrfRfkillReplay *replay);
+
+/**
+ * urf_rfkill_replay_queue_event:
+ **/
+static void
+urf_rfkill_replay_queue_event (UrfRfkillReplay           *replay,
+			       const struct rfkill_event *event)
+{
+	UrfRfkillReplayPrivate *priv = replay->priv;
+	char byte = 0;
+
+	/* wake up the reader */
+	if (g_queue_is_empty (priv->pending)) {
+		if (write (priv->pipe_fds[1], &byte, 1) < 0)
+			urf_warning ("Failed to wake up the reader: %s", g_strerror (errno));
+	}
+	g_queue_push_tail (priv->pending, g_memdup (event, sizeof (struct rfkill_event)));
+}
+
+/**
+ * urf_rfkill_replay_get_due:
+ *
+ * Return value: the monotonic time at which @record is due
+ **/
+static gint64
+urf_rfkill_replay_get_due (UrfRfkillReplay      *replay,
+			   const UrfTraceRecord *record)
+{
+	UrfRfkillReplayPrivate *priv = replay->priv;
+	gint64 offset;
+
+	if (priv->speed <= 0)
+		return priv->started;
+
+	/* the wall clock of the recording may have been stepped back */
+	offset = MAX (record->timestamp - priv->base, 0);
+	return priv->started + (gint64) (offset / priv->speed);
+}
+
+/**
+ * urf_rfkill_replay_dispatch:
+ **/
+static void
+urf_rfkill_replay_dispatch (UrfRfkillReplay      *replay,
+			    const UrfTraceRecord *record)
+{
+	switch (record->type) {
+	case URF_TRACE_RECORD_RFKILL_EVENT:
+		urf_rfkill_replay_queue_event (replay, &record->event);
+		break;
+	case URF_TRACE_RECORD_KEY:
+		g_signal_emit (replay, signals[RF_KEY_PRESSED], 0, record->code);
+		break;
+	case URF_TRACE_RECORD_RFKILL_WRITE:
+		urf_debug ("Replay: write idx %u type %u op %u soft %u",
+			   record->event.idx, record->event.type,
+			   record->event.op, record->event.soft);
+		break;
+	default:
+		urf_debug ("Replay: skipping record of unknown type %u", record->type);
+		break;
+	}
+}
+
+/**
+ * urf_rfkill_replay_cb:
+ **/
+static gboolean
+urf_rfkill_replay_cb (UrfRfkillReplay *replay)
+{
+	UrfRfkillReplayPrivate *priv = replay->priv;
+	const UrfTraceRecord *record;
+	gint64 now = g_get_monotonic_time ();
+	guint n;
+
+	priv->source_id = 0;
+
+	for (n = 0; n < URF_RFKILL_REPLAY_BATCH && priv->next < priv->n_records; n++) {
+		record = &priv->records[priv->next];
+		if (urf_rfkill_replay_get_due (replay, record) > now)
+			break;
+		priv->next++;
+		urf_rfkill_replay_dispatch (replay, record);
+	}
+
+	urf_rfkill_replay_schedule (replay);
+	return FALSE;
+}
+
+/**
+ * urf_rfkill_replay_schedule:
+ **/
+static void
+urf_rfkill_replay_schedule (UrfRfkillReplay *replay)
+{
+	UrfRfkillReplayPrivate *priv = replay->priv;
+	gint64 delay;
+
+	if (priv->next >= priv->n_records) {
+		urf_message ("Replayed %u records of %s in %.3f seconds",
+			     priv->n_records, priv->filename,
+			     (g_get_monotonic_time () - priv->started) / (gdouble) G_USEC_PER_SEC);
+		g_signal_emit (replay, signals[FINISHED], 0);
+		return;
+	}
+
+	delay = urf_rfkill_replay_get_due (replay, &priv->records[priv->next]) -
+		g_get_monotonic_time ();
+	if (delay <= 0)
+		priv->source_id = g_idle_add ((GSourceFunc) urf_rfkill_replay_cb, replay);
+	else
+		priv->source_id = g_timeout_add (delay / 1000,
+						 (GSourceFunc) urf_rfkill_replay_cb,
+						 replay);
+}
+
+/**
+ * urf_rfkill_replay_open:
+ **/
+static gboolean
+urf_rfkill_replay_open (UrfRfkillBackend *backend)
+{
+	UrfRfkillReplay *replay = URF_RFKILL_REPLAY (backend);
+	UrfRfkillReplayPrivate *priv = replay->priv;
+	const UrfTraceRecord *record;
+	guint i;
+
+	priv->file = urf_trace_map (priv->filename, &priv->records, &priv->n_records);
+	if (priv->file == NULL)
+		return FALSE;
+
+	if (pipe (priv->pipe_fds) < 0) {
+		urf_warning ("Failed to create the replay pipe: %s",
+			     g_strerror (errno));
+		return FALSE;
+	}
+	for (i = 0; i < 2; i++) {
+		fcntl (priv->pipe_fds[i], F_SETFL, O_NONBLOCK);
+		fcntl (priv->pipe_fds[i], F_SETFD, FD_CLOEXEC);
+	}
+
+	/* the devices present when recording started are read on open */
+	for (priv->next = 0; priv->next < priv->n_records; priv->next++) {
+		record = &priv->records[priv->next];
+		if (record->type != URF_TRACE_RECORD_RFKILL_EVENT ||
+		    record->event.op != RFKILL_OP_ADD)
+			break;
+		urf_rfkill_replay_queue_event (replay, &record->event);
+	}
+
+	urf_debug ("Replaying %u records of %s at speed %g",
+		   priv->n_records, priv->filename, priv->speed);
+	if (priv->next < priv->n_records)
+		priv->base = priv->records[priv->next].timestamp;
+	priv->started = g_get_monotonic_time ();
+	urf_rfkill_replay_schedule (replay);
+
+	return TRUE;
+}
+
+/**
+ * urf_rfkill_replay_get_fd:
+ **/
+static int
+urf_rfkill_replay_get_fd (UrfRfkillBackend *backend)
+{
+	return URF_RFKILL_REPLAY (backend)->priv->pipe_fds[0];
+}
+
+/**
+ * urf_rfkill_replay_read_events:
+ **/
+static int
+urf_rfkill_replay_read_events (UrfRfkillBackend    *backend,
+			       struct rfkill_event *events,
+			       guint                n_events)
+{
+	UrfRfkillReplayPrivate *priv = URF_RFKILL_REPLAY (backend)->priv;
+	struct rfkill_event *event;
+	char buf[16];
+	guint n = 0;
+
+	while (n < n_events && !g_queue_is_empty (priv->pending)) {
+		event = g_queue_pop_head (priv->pending);
+		events[n++] = *event;
+		g_free (event);
+	}
+
+	/* drained, stop polling readable */
+	if (g_queue_is_empty (priv->pending)) {
+		while (read (priv->pipe_fds[0], buf, sizeof (buf)) > 0)
+			;
+	}
+
+	return n;
+}
+
+/**
+ * urf_rfkill_replay_write_event:
+ **/
+static gboolean
+urf_rfkill_replay_write_event (UrfRfkillBackend          *backend,
+			       const struct rfkill_event *event)
+{
+	/* the trace decides what happens */
+	urf_debug ("Replay: ignoring write idx %u type %u op %u soft %u",
+		   event->idx, event->type, event->op, event->soft);
+	return TRUE;
+}
+
+/**
+ * urf_rfkill_replay_close:
+ **/
+static void
+urf_rfkill_replay_close (UrfRfkillBackend *backend)
+{
+	UrfRfkillReplayPrivate *priv = URF_RFKILL_REPLAY (backend)->priv;
+	guint i;
+
+	if (priv->source_id > 0) {
+		g_source_remove (priv->source_id);
+		priv->source_id = 0;
+	}
+
+	while (!g_queue_is_empty (priv->pending))
+		g_free (g_queue_pop_head (priv->pending));
+
+	for (i = 0; i < 2; i++) {
+		if (priv->pipe_fds[i] >= 0) {
+			close (priv->pipe_fds[i]);
+			priv->pipe_fds[i] = -1;
+		}
+	}
+
+	if (priv->file != NULL) {
+		g_mapped_file_unref (priv->file);
+		priv->file = NULL;
+		priv->records = NULL;
+		priv->n_records = 0;
+	}
+}
+
+/**
+ * urf_rfkill_replay_finalize:
+ **/
+static void
+urf_rfkill_replay_finalize (GObject *object)
+{
+	UrfRfkillReplayPrivate *priv = URF_RFKILL_REPLAY (object)->priv;
+
+	urf_rfkill_replay_close (URF_RFKILL_BACKEND (object));
+	g_queue_free (priv->pending);
+	g_free (priv->filename);
+
+	G_OBJECT_CLASS (urf_rfkill_replay_parent_class)->finalize (object);
+}
+
+/**
+ * urf_rfkill_replay_class_init:
+ **/
+static void
+urf_rfkill_replay_class_init (UrfRfkillReplayClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	UrfRfkillBackendClass *backend_class = URF_RFKILL_BACKEND_CLASS (klass);
+
+	object_class->finalize = urf_rfkill_replay_finalize;
+
+	backend_class->open = urf_rfkill_replay_open;
+	backend_class->get_fd = urf_rfkill_replay_get_fd;
+	backend_class->read_events = urf_rfkill_replay_read_events;
+	backend_class->write_event = urf_rfkill_replay_write_event;
+	backend_class->close = urf_rfkill_replay_close;
+
+	signals[RF_KEY_PRESSED] =
+		g_signal_new ("rf-key-pressed",
+			      G_TYPE_FROM_CLASS (klass),
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (UrfRfkillReplayClass, rf_key_pressed),
+			      NULL, NULL,
+			      g_cclosure_marshal_VOID__UINT,
+			      G_TYPE_NONE, 1, G_TYPE_UINT);
+
+	signals[FINISHED] =
+		g_signal_new ("finished",
+			      G_TYPE_FROM_CLASS (klass),
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (UrfRfkillReplayClass, finished),
+			      NULL, NULL,
+			      g_cclosure_marshal_VOID__VOID,
+			      G_TYPE_NONE, 0);
+
+	g_type_class_add_private (klass, sizeof (UrfRfkillReplayPrivate));
+}
+
+/**
+ * urf_rfkill_replay_init:
+ **/
+static void
+urf_rfkill_replay_init (UrfRfkillReplay *replay)
+{
+	replay->priv = URF_RFKILL_REPLAY_GET_PRIVATE (replay);
+	replay->priv->filename = NULL;
+	replay->priv->speed = 1.0;
+	replay->priv->file = NULL;
+	replay->priv->records = NULL;
+	replay->priv->n_records = 0;
+	replay->priv->next = 0;
+	replay->priv->base = 0;
+	replay->priv->started = 0;
+	replay->priv->pending = g_queue_new ();
+	replay->priv->pipe_fds[0] = -1;
+	replay->priv->pipe_fds[1] = -1;
+	replay->priv->source_id = 0;
+}
+
+/**
+ * urf_rfkill_replay_new:
+ * @filename: a trace recorded with urf_trace_open()
+ * @speed: 1 for the original timing, 10 for ten times faster, or 0 to
+ * replay as fast as possible
+ **/
+UrfRfkillReplay *
+urf_rfkill_replay_new (const char *filename,
+		       gdouble     speed)
+{
+	UrfRfkillReplay *replay;
+
+	replay = URF_RFKILL_REPLAY (g_object_new (URF_TYPE_RFKILL_REPLAY, NULL));
+	replay->priv->filename = g_strdup (filename);
+	replay->priv->speed = speed;
+
+	return replay;
+}
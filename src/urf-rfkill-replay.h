@@ -0,0 +1,63 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __URF_RFKILL_REPLAY_H__
+#define __URF_RFKILL_REPLAY_H__
+
+#include <glib-object.h>
+
+#include "urf-rfkill-backend.h"
+
+G_BEGIN_DECLS
+
+#define URF_TYPE_RFKILL_REPLAY (urf_rfkill_replay_get_type())
+#define URF_RFKILL_REPLAY(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj), \
+					URF_TYPE_RFKILL_REPLAY, UrfRfkillReplay))
+#define URF_RFKILL_REPLAY_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST((klass), \
+					URF_TYPE_RFKILL_REPLAY, UrfRfkillReplayClass))
+#define URF_IS_RFKILL_REPLAY(obj) (G_TYPE_CHECK_INSTANCE_TYPE((obj), \
+					URF_TYPE_RFKILL_REPLAY))
+#define URF_IS_RFKILL_REPLAY_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), \
+					URF_TYPE_RFKILL_REPLAY))
+#define URF_GET_RFKILL_REPLAY_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS((obj), \
+					URF_TYPE_RFKILL_REPLAY, UrfRfkillReplayClass))
+
+typedef struct UrfRfkillReplayPrivate UrfRfkillReplayPrivate;
+
+typedef struct {
+	UrfRfkillBackend	 parent;
+	UrfRfkillReplayPrivate	*priv;
+} UrfRfkillReplay;
+
+typedef struct {
+	UrfRfkillBackendClass	 parent_class;
+	void			(*rf_key_pressed)	(UrfRfkillReplay	*replay,
+							 guint			 code);
+	void			(*finished)		(UrfRfkillReplay	*replay);
+} UrfRfkillReplayClass;
+
+GType			 urf_rfkill_replay_get_type	(void);
+
+UrfRfkillReplay		*urf_rfkill_replay_new		(const char	*filename,
+							 gdouble	 speed);
+
+G_END_DECLS
+
+#endif /* __URF_RFKILL_REPLAY_H__ */
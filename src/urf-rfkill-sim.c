@@ -0,0 +1,476 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ * A simulated rfkill core. It keeps a list of devices with soft and
+ * hard blocks, applies RFKILL_OP_CHANGE and RFKILL_OP_CHANGE_ALL like
+ * the kernel does and queues the resulting events, optionally after a
+ * delay. A pipe polls readable while events are queued, so the main
+ * loop treats it like /dev/rfkill.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "urf-rfkill-sim.h"
+#include "urf-log.h"
+
+typedef struct {
+	guint		 index;
+	guint		 type;
+	gboolean	 soft;
+	gboolean	 hard;
+} UrfRfkillSimDevice;
+
+typedef struct {
+	UrfRfkillSim		*sim;
+	struct rfkill_event	 event;
+	guint			 source_id;
+} UrfRfkillSimOp;
+
+struct UrfRfkillSimPrivate {
+	GArray		*devices;
+	guint		 next_index;
+	gboolean	 type_soft[NUM_RFKILL_TYPES];
+	GQueue		*pending;
+	GList		*ops;
+	int		 pipe_fds[2];
+	guint		 latency;
+	gboolean	 opened;
+};
+
+G_DEFINE_TYPE (UrfRfkillSim, urf_rfkill_sim, URF_TYPE_RFKILL_BACKEND)
+
+#define URF_RFKILL_SIM_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), \
+				URF_TYPE_RFKILL_SIM, UrfRfkillSimPrivate))
+
+/**
+ * urf_rfkill_sim_find_device:
+ **/
+static UrfRfkillSimDevice *
+urf_rfkill_sim_find_device (UrfRfkillSim *sim,
+			    guint         index)
+{
+	GArray *devices = sim->priv->devices;
+	guint i;
+
+	for (i = 0; i < devices->len; i++) {
+		if (g_array_index (devices, UrfRfkillSimDevice, i).index == index)
+			return &g_array_index (devices, UrfRfkillSimDevice, i);
+	}
+	return NULL;
+}
+
+/**
+ * urf_rfkill_sim_queue_event:
+ **/
+static void
+urf_rfkill_sim_queue_event (UrfRfkillSim             *sim,
+			    guint                     op,
+			    const UrfRfkillSimDevice *device)
+{
+	UrfRfkillSimPrivate *priv = sim->priv;
+	struct rfkill_event *event;
+	char byte = 0;
+
+	/* nobody listens yet, the ADD events are sent on open */
+	if (!priv->opened)
+		return;
+
+	event = g_new0 (struct rfkill_event, 1);
+	event->idx = device->index;
+	event->type = device->type;
+	event->op = op;
+	event->soft = device->soft;
+	event->hard = device->hard;
+
+	/* wake up the reader */
+	if (g_queue_is_empty (priv->pending)) {
+		if (write (priv->pipe_fds[1], &byte, 1) < 0)
+			urf_warning ("Failed to wake up the reader: %s", g_strerror (errno));
+	}
+	g_queue_push_tail (priv->pending, event);
+}
+
+/**
+ * urf_rfkill_sim_set_soft:
+ **/
+static void
+urf_rfkill_sim_set_soft (UrfRfkillSim       *sim,
+			 UrfRfkillSimDevice *device,
+			 gboolean            soft)
+{
+	if (device->soft == soft)
+		return;
+
+	device->soft = soft;
+	urf_rfkill_sim_queue_event (sim, RFKILL_OP_CHANGE, device);
+}
+
+/**
+ * urf_rfkill_sim_apply:
+ **/
+static void
+urf_rfkill_sim_apply (UrfRfkillSim              *sim,
+		      const struct rfkill_event *event)
+{
+	UrfRfkillSimPrivate *priv = sim->priv;
+	UrfRfkillSimDevice *device;
+	gboolean soft = event->soft ? TRUE : FALSE;
+	guint i;
+
+	if (event->op == RFKILL_OP_CHANGE) {
+		/* like the kernel, an unknown index is ignored */
+		device = urf_rfkill_sim_find_device (sim, event->idx);
+		if (device != NULL)
+			urf_rfkill_sim_set_soft (sim, device, soft);
+		return;
+	}
+
+	/* RFKILL_OP_CHANGE_ALL also sets the state of future devices */
+	for (i = 0; i < NUM_RFKILL_TYPES; i++) {
+		if (event->type == RFKILL_TYPE_ALL || event->type == i)
+			priv->type_soft[i] = soft;
+	}
+
+	for (i = 0; i < priv->devices->len; i++) {
+		device = &g_array_index (priv->devices, UrfRfkillSimDevice, i);
+		if (event->type == RFKILL_TYPE_ALL || event->type == device->type)
+			urf_rfkill_sim_set_soft (sim, device, soft);
+	}
+}
+
+/**
+ * urf_rfkill_sim_op_cb:
+ **/
+static gboolean
+urf_rfkill_sim_op_cb (UrfRfkillSimOp *op)
+{
+	UrfRfkillSimPrivate *priv = op->sim->priv;
+
+	priv->ops = g_list_remove (priv->ops, op);
+	urf_rfkill_sim_apply (op->sim, &op->event);
+	g_free (op);
+
+	return FALSE;
+}
+
+/**
+ * urf_rfkill_sim_open:
+ **/
+static gboolean
+urf_rfkill_sim_open (UrfRfkillBackend *backend)
+{
+	UrfRfkillSim *sim = URF_RFKILL_SIM (backend);
+	UrfRfkillSimPrivate *priv = sim->priv;
+	guint i;
+
+	if (pipe (priv->pipe_fds) < 0) {
+		urf_warning ("Failed to create the simulator pipe: %s",
+			     g_strerror (errno));
+		return FALSE;
+	}
+	for (i = 0; i < 2; i++) {
+		fcntl (priv->pipe_fds[i], F_SETFL, O_NONBLOCK);
+		fcntl (priv->pipe_fds[i], F_SETFD, FD_CLOEXEC);
+	}
+
+	/* the kernel reports the existing devices on open */
+	priv->opened = TRUE;
+	for (i = 0; i < priv->devices->len; i++)
+		urf_rfkill_sim_queue_event (sim, RFKILL_OP_ADD,
+					    &g_array_index (priv->devices, UrfRfkillSimDevice, i));
+
+	return TRUE;
+}
+
+/**
+ * urf_rfkill_sim_get_fd:
+ **/
+static int
+urf_rfkill_sim_get_fd (UrfRfkillBackend *backend)
+{
+	return URF_RFKILL_SIM (backend)->priv->pipe_fds[0];
+}
+
+/**
+ * urf_rfkill_sim_read_events:
+ **/
+static int
+urf_rfkill_sim_read_events (UrfRfkillBackend    *backend,
+			    struct rfkill_event *events,
+			    guint                n_events)
+{
+	UrfRfkillSimPrivate *priv = URF_RFKILL_SIM (backend)->priv;
+	struct rfkill_event *event;
+	char buf[16];
+	guint n = 0;
+
+	while (n < n_events && !g_queue_is_empty (priv->pending)) {
+		event = g_queue_pop_head (priv->pending);
+		events[n++] = *event;
+		g_free (event);
+	}
+
+	/* drained, stop polling readable */
+	if (g_queue_is_empty (priv->pending)) {
+		while (read (priv->pipe_fds[0], buf, sizeof (buf)) > 0)
+			;
+	}
+
+	return n;
+}
+
+/**
+ * urf_rfkill_sim_write_event:
+ **/
+static gboolean
+urf_rfkill_sim_write_event (UrfRfkillBackend          *backend,
+			    const struct rfkill_event *event)
+{
+	UrfRfkillSim *sim = URF_RFKILL_SIM (backend);
+	UrfRfkillSimPrivate *priv = sim->priv;
+	UrfRfkillSimOp *op;
+
+	if (event->op != RFKILL_OP_CHANGE && event->op != RFKILL_OP_CHANGE_ALL) {
+		urf_warning ("Failed to change RFKILL state: %s", g_strerror (EINVAL));
+		return FALSE;
+	}
+	if (event->op == RFKILL_OP_CHANGE_ALL && event->type >= NUM_RFKILL_TYPES) {
+		urf_warning ("Failed to change RFKILL state: %s", g_strerror (EINVAL));
+		return FALSE;
+	}
+
+	if (priv->latency == 0) {
+		urf_rfkill_sim_apply (sim, event);
+		return TRUE;
+	}
+
+	op = g_new0 (UrfRfkillSimOp, 1);
+	op->sim = sim;
+	op->event = *event;
+	op->source_id = g_timeout_add (priv->latency, (GSourceFunc) urf_rfkill_sim_op_cb, op);
+	priv->ops = g_list_prepend (priv->ops, op);
+
+	return TRUE;
+}
+
+/**
+ * urf_rfkill_sim_close:
+ **/
+static void
+urf_rfkill_sim_close (UrfRfkillBackend *backend)
+{
+	UrfRfkillSimPrivate *priv = URF_RFKILL_SIM (backend)->priv;
+	UrfRfkillSimOp *op;
+	guint i;
+
+	while (priv->ops != NULL) {
+		op = priv->ops->data;
+		g_source_remove (op->source_id);
+		g_free (op);
+		priv->ops = g_list_delete_link (priv->ops, priv->ops);
+	}
+
+	while (!g_queue_is_empty (priv->pending))
+		g_free (g_queue_pop_head (priv->pending));
+
+	for (i = 0; i < 2; i++) {
+		if (priv->pipe_fds[i] >= 0) {
+			close (priv->pipe_fds[i]);
+			priv->pipe_fds[i] = -1;
+		}
+	}
+	priv->opened = FALSE;
+}
+
+/**
+ * urf_rfkill_sim_add_device:
+ *
+ * Return value: the index of the new device
+ **/
+guint
+urf_rfkill_sim_add_device (UrfRfkillSim *sim,
+			   guint         type,
+			   gboolean      soft,
+			   gboolean      hard)
+{
+	UrfRfkillSimPrivate *priv;
+	UrfRfkillSimDevice device;
+
+	g_return_val_if_fail (URF_IS_RFKILL_SIM (sim), 0);
+	g_return_val_if_fail (type > RFKILL_TYPE_ALL && type < NUM_RFKILL_TYPES, 0);
+
+	priv = sim->priv;
+	device.index = priv->next_index++;
+	device.type = type;
+	device.soft = soft || priv->type_soft[type];
+	device.hard = hard;
+	g_array_append_val (priv->devices, device);
+
+	urf_rfkill_sim_queue_event (sim, RFKILL_OP_ADD, &device);
+
+	return device.index;
+}
+
+/**
+ * urf_rfkill_sim_remove_device:
+ **/
+gboolean
+urf_rfkill_sim_remove_device (UrfRfkillSim *sim,
+			      guint         index)
+{
+	UrfRfkillSimPrivate *priv;
+	UrfRfkillSimDevice device;
+	guint i;
+
+	g_return_val_if_fail (URF_IS_RFKILL_SIM (sim), FALSE);
+
+	priv = sim->priv;
+	for (i = 0; i < priv->devices->len; i++) {
+		device = g_array_index (priv->devices, UrfRfkillSimDevice, i);
+		if (device.index != index)
+			continue;
+		g_array_remove_index (priv->devices, i);
+		urf_rfkill_sim_queue_event (sim, RFKILL_OP_DEL, &device);
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/**
+ * urf_rfkill_sim_set_hard:
+ *
+ * Flip the hard block, as a hardware switch would
+ **/
+gboolean
+urf_rfkill_sim_set_hard (UrfRfkillSim *sim,
+			 guint         index,
+			 gboolean      hard)
+{
+	UrfRfkillSimDevice *device;
+
+	g_return_val_if_fail (URF_IS_RFKILL_SIM (sim), FALSE);
+
+	device = urf_rfkill_sim_find_device (sim, index);
+	if (device == NULL)
+		return FALSE;
+
+	if (device->hard != hard) {
+		device->hard = hard;
+		urf_rfkill_sim_queue_event (sim, RFKILL_OP_CHANGE, device);
+	}
+
+	return TRUE;
+}
+
+/**
+ * urf_rfkill_sim_finalize:
+ **/
+static void
+urf_rfkill_sim_finalize (GObject *object)
+{
+	UrfRfkillSimPrivate *priv = URF_RFKILL_SIM (object)->priv;
+
+	urf_rfkill_sim_close (URF_RFKILL_BACKEND (object));
+	g_queue_free (priv->pending);
+	g_array_free (priv->devices, TRUE);
+
+	G_OBJECT_CLASS (urf_rfkill_sim_parent_class)->finalize (object);
+}
+
+/**
+ * urf_rfkill_sim_class_init:
+ **/
+static void
+urf_rfkill_sim_class_init (UrfRfkillSimClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	UrfRfkillBackendClass *backend_class = URF_RFKILL_BACKEND_CLASS (klass);
+
+	object_class->finalize = urf_rfkill_sim_finalize;
+
+	backend_class->open = urf_rfkill_sim_open;
+	backend_class->get_fd = urf_rfkill_sim_get_fd;
+	backend_class->read_events = urf_rfkill_sim_read_events;
+	backend_class->write_event = urf_rfkill_sim_write_event;
+	backend_class->close = urf_rfkill_sim_close;
+
+	g_type_class_add_private (klass, sizeof (UrfRfkillSimPrivate));
+}
+
+/**
+ * urf_rfkill_sim_init:
+ **/
+static void
+urf_rfkill_sim_init (UrfRfkillSim *sim)
+{
+	guint i;
+
+	sim->priv = URF_RFKILL_SIM_GET_PRIVATE (sim);
+	sim->priv->devices = g_array_new (FALSE, FALSE, sizeof (UrfRfkillSimDevice));
+	sim->priv->next_index = 0;
+	for (i = 0; i < NUM_RFKILL_TYPES; i++)
+		sim->priv->type_soft[i] = FALSE;
+	sim->priv->pending = g_queue_new ();
+	sim->priv->ops = NULL;
+	sim->priv->pipe_fds[0] = -1;
+	sim->priv->pipe_fds[1] = -1;
+	sim->priv->latency = 0;
+	sim->priv->opened = FALSE;
+}
+
+/**
+ * urf_rfkill_sim_new:
+ * @n_devices: the number of devices to start with
+ * @latency_ms: the delay before a write takes effect
+ *
+ * The initial devices cycle through WLAN, bluetooth, WWAN and GPS,
+ * all unblocked.
+ **/
+UrfRfkillSim *
+urf_rfkill_sim_new (guint n_devices,
+		    guint latency_ms)
+{
+	static const guint types[] = {
+		RFKILL_TYPE_WLAN,
+		RFKILL_TYPE_BLUETOOTH,
+		RFKILL_TYPE_WWAN,
+		RFKILL_TYPE_GPS,
+	};
+	UrfRfkillSim *sim;
+	guint i;
+
+	sim = URF_RFKILL_SIM (g_object_new (URF_TYPE_RFKILL_SIM, NULL));
+	sim->priv->latency = latency_ms;
+	for (i = 0; i < n_devices; i++)
+		urf_rfkill_sim_add_device (sim, types[i % G_N_ELEMENTS (types)], FALSE, FALSE);
+
+	return sim;
+}
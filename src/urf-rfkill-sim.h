@@ -0,0 +1,69 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __URF_RFKILL_SIM_H__
+#define __URF_RFKILL_SIM_H__
+
+#include <glib-object.h>
+
+#include "urf-rfkill-backend.h"
+
+G_BEGIN_DECLS
+
+#define URF_TYPE_RFKILL_SIM (urf_rfkill_sim_get_type())
+#define URF_RFKILL_SIM(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj), \
+					URF_TYPE_RFKILL_SIM, UrfRfkillSim))
+#define URF_RFKILL_SIM_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST((klass), \
+					URF_TYPE_RFKILL_SIM, UrfRfkillSimClass))
+#define URF_IS_RFKILL_SIM(obj) (G_TYPE_CHECK_INSTANCE_TYPE((obj), \
+					URF_TYPE_RFKILL_SIM))
+#define URF_IS_RFKILL_SIM_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), \
+					URF_TYPE_RFKILL_SIM))
+#define URF_GET_RFKILL_SIM_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS((obj), \
+					URF_TYPE_RFKILL_SIM, UrfRfkillSimClass))
+
+typedef struct UrfRfkillSimPrivate UrfRfkillSimPrivate;
+
+typedef struct {
+	UrfRfkillBackend	 parent;
+	UrfRfkillSimPrivate	*priv;
+} UrfRfkillSim;
+
+typedef struct {
+	UrfRfkillBackendClass	 parent_class;
+} UrfRfkillSimClass;
+
+GType			 urf_rfkill_sim_get_type		(void);
+
+UrfRfkillSim		*urf_rfkill_sim_new		(guint		 n_devices,
+							 guint		 latency_ms);
+guint			 urf_rfkill_sim_add_device	(UrfRfkillSim	*sim,
+							 guint		 type,
+							 gboolean	 soft,
+							 gboolean	 hard);
+gboolean		 urf_rfkill_sim_remove_device	(UrfRfkillSim	*sim,
+							 guint		 index);
+gboolean		 urf_rfkill_sim_set_hard	(UrfRfkillSim	*sim,
+							 guint		 index,
+							 gboolean	 hard);
+
+G_END_DECLS
+
+#endif /* __URF_RFKILL_SIM_H__ */
@@ -24,9 +24,10 @@
 
 #include <glib.h>
 #include <glib-object.h>
-#include <dbus/dbus-glib.h>
+#include <gio/gio.h>
 
 #include "urf-seat.h"
+#include "urf-log.h"
 
 enum {
 	SIGNAL_ACTIVE_CHANGED,
@@ -36,9 +37,13 @@ enum {
 static guint signals[SIGNAL_LAST] = { 0 };
 
 
+#define CONSOLEKIT_NAME			"org.freedesktop.ConsoleKit"
+#define CONSOLEKIT_SEAT_INTERFACE	"org.freedesktop.ConsoleKit.Seat"
+
 struct UrfSeatPrivate {
-	DBusGConnection	*connection;
-	DBusGProxy	*proxy;
+	GDBusConnection	*connection;
+	guint		 active_changed_id;
+	GCancellable	*call;
 	char		*object_path;
 	char		*active;
 };
@@ -67,12 +72,11 @@ urf_seat_get_active (UrfSeat *seat)
 }
 
 /**
- * urf_seat_active_session_changed_cb:
+ * urf_seat_set_active:
  **/
 static void
-urf_seat_active_session_changed_cb (DBusGProxy *proxy,
-				    const char *session_id,
-				    UrfSeat    *seat)
+urf_seat_set_active (UrfSeat    *seat,
+		     const char *session_id)
 {
 	g_free (seat->priv->active);
 	seat->priv->active = g_strdup (session_id);
@@ -81,52 +85,125 @@ urf_seat_active_session_changed_cb (DBusGProxy *proxy,
 }
 
 /**
- * urf_seat_object_path_sync:
+ * urf_seat_cancel_call:
  **/
-gboolean
-urf_seat_object_path_sync (UrfSeat    *seat,
-			   const char *object_path)
+static void
+urf_seat_cancel_call (UrfSeat *seat)
 {
-	UrfSeatPrivate *priv = seat->priv;
-	char *session_id;
-	GError *error = NULL;
-	gboolean ret = FALSE;
+	if (seat->priv->call == NULL)
+		return;
 
-	priv->object_path = g_strdup (object_path);
+	g_cancellable_cancel (seat->priv->call);
+	g_object_unref (seat->priv->call);
+	seat->priv->call = NULL;
+}
+
+/**
+ * urf_seat_active_session_changed_cb:
+ **/
+static void
+urf_seat_active_session_changed_cb (GDBusConnection *connection,
+				    const char      *sender_name,
+				    const char      *object_path,
+				    const char      *interface_name,
+				    const char      *signal_name,
+				    GVariant        *parameters,
+				    gpointer         user_data)
+{
+	UrfSeat *seat = URF_SEAT (user_data);
+	GVariant *session_id;
+
+	if (!g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(o)")) &&
+	    !g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(s)")))
+		return;
+
+	/* newer than anything the pending GetActiveSession could tell */
+	urf_seat_cancel_call (seat);
+
+	session_id = g_variant_get_child_value (parameters, 0);
+	urf_seat_set_active (seat, g_variant_get_string (session_id, NULL));
+	g_variant_unref (session_id);
+}
+
+/**
+ * urf_seat_get_active_session_cb:
+ **/
+static void
+urf_seat_get_active_session_cb (GObject      *source,
+				GAsyncResult *res,
+				gpointer      user_data)
+{
+	UrfSeat *seat;
+	GVariant *reply;
+	const char *session_id;
+	GError *error = NULL;
 
-	priv->connection = dbus_g_bus_get (DBUS_BUS_SYSTEM, &error);
-	if (error != NULL) {
-		g_warning ("Failed to get bus: %s", error->message);
+	reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source), res, &error);
+	if (reply == NULL && g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		/* superseded by a signal or the seat is gone */
 		g_error_free (error);
-		return FALSE;
+		return;
 	}
 
-	priv->proxy = dbus_g_proxy_new_for_name (priv->connection,
-						 "org.freedesktop.ConsoleKit",
-						 priv->object_path,
-						 "org.freedesktop.ConsoleKit.Seat");
-	ret = dbus_g_proxy_call (priv->proxy, "GetActiveSession", &error,
-				 G_TYPE_INVALID,
-				 DBUS_TYPE_G_OBJECT_PATH, &session_id,
-				 G_TYPE_INVALID);
-	if (!ret) {
-		g_warning ("Failed to get Active Session: %s", error->message);
+	seat = URF_SEAT (user_data);
+	g_object_unref (seat->priv->call);
+	seat->priv->call = NULL;
+
+	if (reply == NULL) {
+		urf_warning ("Failed to get Active Session: %s", error->message);
 		g_error_free (error);
-		return FALSE;
+		return;
 	}
 
-	priv->active = g_strdup (session_id);
+	g_variant_get (reply, "(&o)", &session_id);
+	urf_seat_set_active (seat, session_id);
+	g_variant_unref (reply);
+}
 
-	/* connect signals */
-	dbus_g_proxy_add_signal (priv->proxy, "ActiveSessionChanged",
-				 G_TYPE_STRING,
-				 G_TYPE_INVALID);
+/**
+ * urf_seat_object_path_async:
+ *
+ * Start monitoring the seat. The active session is requested without
+ * blocking and announced with "active-changed" once the answer arrives,
+ * until then urf_seat_get_active() returns %NULL.
+ **/
+void
+urf_seat_object_path_async (UrfSeat         *seat,
+			    GDBusConnection *connection,
+			    const char      *object_path)
+{
+	UrfSeatPrivate *priv = seat->priv;
 
-	/* callbacks */
-	dbus_g_proxy_connect_signal (priv->proxy, "ActiveSessionChanged",
-				     G_CALLBACK (urf_seat_active_session_changed_cb), seat, NULL);
+	g_return_if_fail (priv->connection == NULL);
 
-	return TRUE;
+	priv->object_path = g_strdup (object_path);
+	priv->connection = g_object_ref (connection);
+
+	/* connect signals */
+	priv->active_changed_id =
+		g_dbus_connection_signal_subscribe (priv->connection,
+						    CONSOLEKIT_NAME,
+						    CONSOLEKIT_SEAT_INTERFACE,
+						    "ActiveSessionChanged",
+						    priv->object_path,
+						    NULL,
+						    G_DBUS_SIGNAL_FLAGS_NONE,
+						    urf_seat_active_session_changed_cb,
+						    seat, NULL);
+
+	priv->call = g_cancellable_new ();
+	g_dbus_connection_call (priv->connection,
+				CONSOLEKIT_NAME,
+				priv->object_path,
+				CONSOLEKIT_SEAT_INTERFACE,
+				"GetActiveSession",
+				NULL,
+				G_VARIANT_TYPE ("(o)"),
+				G_DBUS_CALL_FLAGS_NONE,
+				-1,
+				priv->call,
+				urf_seat_get_active_session_cb,
+				seat);
 }
 
 /**
@@ -137,14 +214,13 @@ urf_seat_dispose (GObject *object)
 {
 	UrfSeat *seat = URF_SEAT (object);
 
+	urf_seat_cancel_call (seat);
 	if (seat->priv->connection) {
-		dbus_g_connection_unref (seat->priv->connection);
+		g_dbus_connection_signal_unsubscribe (seat->priv->connection,
+						      seat->priv->active_changed_id);
+		g_object_unref (seat->priv->connection);
 		seat->priv->connection = NULL;
 	}
-	if (seat->priv->proxy) {
-		g_object_unref (seat->priv->proxy);
-		seat->priv->proxy = NULL;
-	}
 
 	G_OBJECT_CLASS (urf_seat_parent_class)->dispose (object);
 }
@@ -191,6 +267,9 @@ static void
 urf_seat_init (UrfSeat *seat)
 {
 	seat->priv = URF_SEAT_GET_PRIVATE (seat);
+	seat->priv->connection = NULL;
+	seat->priv->active_changed_id = 0;
+	seat->priv->call = NULL;
 	seat->priv->object_path = NULL;
 	seat->priv->active = NULL;
 }
@@ -22,6 +22,7 @@
 #define __URF_SEAT_H__
 
 #include <glib-object.h>
+#include <gio/gio.h>
 
 G_BEGIN_DECLS
 
@@ -55,7 +56,8 @@ typedef struct {
 GType			 urf_seat_get_type		(void);
 
 UrfSeat			*urf_seat_new			(void);
-gboolean		 urf_seat_object_path_sync	(UrfSeat	*seat,
+void			 urf_seat_object_path_async	(UrfSeat	*seat,
+							 GDBusConnection *connection,
 							 const char	*object_path);
 
 const char		*urf_seat_get_object_path	(UrfSeat	*seat);
@@ -0,0 +1,116 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <glib.h>
+#include <glib-object.h>
+
+#include "urf-session-backend.h"
+
+enum {
+	SIGNAL_ACTIVE_CHANGED,
+	SIGNAL_LAST
+};
+
+static guint signals[SIGNAL_LAST] = { 0 };
+
+G_DEFINE_ABSTRACT_TYPE (UrfSessionBackend, urf_session_backend, G_TYPE_OBJECT)
+
+/**
+ * urf_session_backend_startup:
+ **/
+gboolean
+urf_session_backend_startup (UrfSessionBackend *backend)
+{
+	g_return_val_if_fail (URF_IS_SESSION_BACKEND (backend), FALSE);
+
+	return URF_GET_SESSION_BACKEND_CLASS (backend)->startup (backend);
+}
+
+/**
+ * urf_session_backend_get_session_for_pid:
+ *
+ * Return value: the session id the process belongs to, or %NULL.
+ * Free it with g_free().
+ **/
+char *
+urf_session_backend_get_session_for_pid (UrfSessionBackend *backend,
+					 guint              pid)
+{
+	g_return_val_if_fail (URF_IS_SESSION_BACKEND (backend), NULL);
+
+	return URF_GET_SESSION_BACKEND_CLASS (backend)->get_session_for_pid (backend, pid);
+}
+
+/**
+ * urf_session_backend_is_session_active:
+ *
+ * Return value: #TRUE if the session is the active one on its seat
+ **/
+gboolean
+urf_session_backend_is_session_active (UrfSessionBackend *backend,
+				       const char        *session_id)
+{
+	g_return_val_if_fail (URF_IS_SESSION_BACKEND (backend), FALSE);
+
+	if (session_id == NULL)
+		return FALSE;
+
+	return URF_GET_SESSION_BACKEND_CLASS (backend)->is_session_active (backend, session_id);
+}
+
+/**
+ * urf_session_backend_active_changed:
+ *
+ * For the implementations: the active session of some seat changed,
+ * or a seat came or went.
+ **/
+void
+urf_session_backend_active_changed (UrfSessionBackend *backend)
+{
+	g_signal_emit (backend, signals[SIGNAL_ACTIVE_CHANGED], 0);
+}
+
+/**
+ * urf_session_backend_class_init:
+ **/
+static void
+urf_session_backend_class_init (UrfSessionBackendClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	signals[SIGNAL_ACTIVE_CHANGED] =
+		g_signal_new ("active-changed",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (UrfSessionBackendClass, active_changed),
+			      NULL, NULL, g_cclosure_marshal_VOID__VOID,
+			      G_TYPE_NONE, 0);
+}
+
+/**
+ * urf_session_backend_init:
+ **/
+static void
+urf_session_backend_init (UrfSessionBackend *backend)
+{
+}
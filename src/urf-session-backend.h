@@ -0,0 +1,69 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __URF_SESSION_BACKEND_H__
+#define __URF_SESSION_BACKEND_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define URF_TYPE_SESSION_BACKEND (urf_session_backend_get_type())
+#define URF_SESSION_BACKEND(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj), \
+					URF_TYPE_SESSION_BACKEND, UrfSessionBackend))
+#define URF_SESSION_BACKEND_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST((klass), \
+					URF_TYPE_SESSION_BACKEND, UrfSessionBackendClass))
+#define URF_IS_SESSION_BACKEND(obj) (G_TYPE_CHECK_INSTANCE_TYPE((obj), \
+					URF_TYPE_SESSION_BACKEND))
+#define URF_IS_SESSION_BACKEND_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), \
+					URF_TYPE_SESSION_BACKEND))
+#define URF_GET_SESSION_BACKEND_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS((obj), \
+					URF_TYPE_SESSION_BACKEND, UrfSessionBackendClass))
+
+typedef struct {
+	GObject 		 parent;
+} UrfSessionBackend;
+
+typedef struct {
+        GObjectClass	 	 parent_class;
+
+	/* vtable */
+	gboolean		(*startup)		(UrfSessionBackend	*backend);
+	char			*(*get_session_for_pid)	(UrfSessionBackend	*backend,
+							 guint			 pid);
+	gboolean		(*is_session_active)	(UrfSessionBackend	*backend,
+							 const char		*session_id);
+
+	/* signals */
+	void			(*active_changed)	(UrfSessionBackend	*backend);
+} UrfSessionBackendClass;
+
+GType			 urf_session_backend_get_type		(void);
+
+gboolean		 urf_session_backend_startup		(UrfSessionBackend	*backend);
+char			*urf_session_backend_get_session_for_pid (UrfSessionBackend	*backend,
+								 guint			 pid);
+gboolean		 urf_session_backend_is_session_active	(UrfSessionBackend	*backend,
+								 const char		*session_id);
+void			 urf_session_backend_active_changed	(UrfSessionBackend	*backend);
+
+G_END_DECLS
+
+#endif /* __URF_SESSION_BACKEND_H__ */
@@ -0,0 +1,439 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <glib.h>
+#include <unistd.h>
+
+#include "urf-session-checker.h"
+#include "urf-log.h"
+#include "urf-session-backend.h"
+#include "urf-credentials.h"
+#include "urf-consolekit.h"
+#ifdef HAVE_SYSTEMD
+#include "urf-logind.h"
+#endif
+
+typedef struct {
+	guint		 cookie;
+	char		*session_id;
+	char		*bus_name;
+	char		*reason;
+} UrfInhibitor;
+
+typedef struct {
+	guint		 n_inhibitors;
+	gboolean	 active;
+} UrfInhibitSession;
+
+struct UrfSessionCheckerPrivate {
+	UrfCredentials		*credentials;
+	UrfSessionBackend	*backend;
+	GHashTable		*inhibitors;	/* cookie -> UrfInhibitor */
+	GHashTable		*bus_names;	/* bus name -> UrfInhibitor */
+	GHashTable		*sessions;	/* session id -> UrfInhibitSession */
+	guint			 n_active;	/* active sessions in sessions */
+	guint			 next_cookie;
+};
+
+G_DEFINE_TYPE (UrfSessionChecker, urf_session_checker, G_TYPE_OBJECT)
+
+#define URF_SESSION_CHECKER_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), \
+				URF_TYPE_SESSION_CHECKER, UrfSessionCheckerPrivate))
+
+/**
+ * urf_session_checker_is_running:
+ *
+ * Return value: #TRUE once the session backend started up
+ **/
+gboolean
+urf_session_checker_is_running (UrfSessionChecker *checker)
+{
+	return checker->priv->backend != NULL;
+}
+
+/**
+ * urf_session_checker_is_inhibited:
+ **/
+gboolean
+urf_session_checker_is_inhibited (UrfSessionChecker *checker)
+{
+	return checker->priv->n_active > 0;
+}
+
+static UrfInhibitor *
+find_inhibitor_by_bus_name (UrfSessionChecker *checker,
+			    const char        *bus_name)
+{
+	return g_hash_table_lookup (checker->priv->bus_names, bus_name);
+}
+
+static UrfInhibitor *
+find_inhibitor_by_cookie (UrfSessionChecker *checker,
+			  const guint        cookie)
+{
+	if (cookie == 0)
+		return NULL;
+
+	return g_hash_table_lookup (checker->priv->inhibitors,
+				    GUINT_TO_POINTER (cookie));
+}
+
+/**
+ * session_set_active:
+ **/
+static void
+session_set_active (UrfSessionChecker *checker,
+		    UrfInhibitSession *session,
+		    gboolean           active)
+{
+	if (session->active == active)
+		return;
+
+	session->active = active;
+	if (active)
+		checker->priv->n_active++;
+	else
+		checker->priv->n_active--;
+}
+
+/**
+ * session_ref:
+ *
+ * The backend is only asked for a session's state when its first
+ * inhibitor shows up and when the active sessions change.
+ **/
+static void
+session_ref (UrfSessionChecker *checker,
+	     const char        *session_id)
+{
+	UrfSessionCheckerPrivate *priv = checker->priv;
+	UrfInhibitSession *session;
+
+	session = g_hash_table_lookup (priv->sessions, session_id);
+	if (session == NULL) {
+		session = g_new0 (UrfInhibitSession, 1);
+		g_hash_table_insert (priv->sessions, g_strdup (session_id), session);
+		session_set_active (checker, session,
+				    urf_session_backend_is_session_active (priv->backend,
+									   session_id));
+	}
+
+	session->n_inhibitors++;
+}
+
+/**
+ * session_unref:
+ **/
+static void
+session_unref (UrfSessionChecker *checker,
+	       const char        *session_id)
+{
+	UrfSessionCheckerPrivate *priv = checker->priv;
+	UrfInhibitSession *session;
+
+	session = g_hash_table_lookup (priv->sessions, session_id);
+	if (session == NULL)
+		return;
+
+	if (--session->n_inhibitors > 0)
+		return;
+
+	session_set_active (checker, session, FALSE);
+	g_hash_table_remove (priv->sessions, session_id);
+}
+
+static void
+free_inhibitor (UrfInhibitor *inhibitor)
+{
+	g_free (inhibitor->session_id);
+	g_free (inhibitor->bus_name);
+	g_free (inhibitor->reason);
+	g_free (inhibitor);
+}
+
+/**
+ * urf_session_checker_active_changed_cb:
+ **/
+static void
+urf_session_checker_active_changed_cb (UrfSessionBackend *backend,
+				       UrfSessionChecker *checker)
+{
+	GHashTableIter iter;
+	gpointer session_id;
+	gpointer session;
+
+	/* the signal doesn't tell which session changed, so only the
+	 * sessions holding an inhibitor are asked again */
+	g_hash_table_iter_init (&iter, checker->priv->sessions);
+	while (g_hash_table_iter_next (&iter, &session_id, &session))
+		session_set_active (checker, session,
+				    urf_session_backend_is_session_active (backend, session_id));
+
+	urf_debug ("Active session changed, inhibit: %s",
+		   urf_session_checker_is_inhibited (checker) ? "yes" : "no");
+}
+
+/**
+ * generate_unique_cookie:
+ *
+ * Cookies are handed out in increasing order. The counter only has to
+ * skip the cookies still in use after it wraps around.
+ **/
+static guint
+generate_unique_cookie (UrfSessionChecker *checker)
+{
+	UrfSessionCheckerPrivate *priv = checker->priv;
+	guint cookie;
+
+	do {
+		cookie = priv->next_cookie++;
+		if (priv->next_cookie == 0)
+			priv->next_cookie = 1;
+	} while (find_inhibitor_by_cookie (checker, cookie) != NULL);
+
+	return cookie;
+}
+
+/**
+ * urf_session_checker_inhibit:
+ **/
+guint
+urf_session_checker_inhibit (UrfSessionChecker *checker,
+			     const char        *bus_name,
+			     const char        *reason)
+{
+	UrfSessionCheckerPrivate *priv = checker->priv;
+	UrfInhibitor *inhibitor;
+	const char *session_id;
+
+	g_return_val_if_fail (priv->backend != NULL, 0);
+
+	inhibitor = find_inhibitor_by_bus_name (checker, bus_name);
+	if (inhibitor)
+		return inhibitor->cookie;
+
+	session_id = urf_credentials_get_session (priv->credentials, bus_name);
+	if (session_id == NULL)
+		return 0;
+
+	inhibitor = g_new0 (UrfInhibitor, 1);
+	inhibitor->session_id = g_strdup (session_id);
+	inhibitor->reason = g_strdup (reason);
+	inhibitor->bus_name = g_strdup (bus_name);
+	inhibitor->cookie = generate_unique_cookie (checker);
+
+	g_hash_table_insert (priv->inhibitors,
+			     GUINT_TO_POINTER (inhibitor->cookie),
+			     inhibitor);
+	g_hash_table_insert (priv->bus_names, inhibitor->bus_name, inhibitor);
+
+	session_ref (checker, inhibitor->session_id);
+
+	urf_debug ("Inhibit: %s for %s", bus_name, reason);
+
+	return inhibitor->cookie;
+}
+
+static void
+remove_inhibitor (UrfSessionChecker *checker,
+		  UrfInhibitor      *inhibitor)
+{
+	UrfSessionCheckerPrivate *priv = checker->priv;
+
+	urf_debug ("Remove inhibitor: %s", inhibitor->bus_name);
+
+	g_hash_table_remove (priv->bus_names, inhibitor->bus_name);
+	session_unref (checker, inhibitor->session_id);
+
+	/* frees the inhibitor */
+	g_hash_table_remove (priv->inhibitors, GUINT_TO_POINTER (inhibitor->cookie));
+}
+
+/**
+ * urf_session_checker_uninhibit:
+ **/
+void
+urf_session_checker_uninhibit (UrfSessionChecker *checker,
+			       const guint        cookie)
+{
+	UrfInhibitor *inhibitor;
+
+	inhibitor = find_inhibitor_by_cookie (checker, cookie);
+	if (inhibitor == NULL) {
+		urf_debug ("Cookie outdated");
+		return;
+	}
+	remove_inhibitor (checker, inhibitor);
+}
+
+/**
+ * urf_session_checker_vanished_cb:
+ **/
+static void
+urf_session_checker_vanished_cb (UrfCredentials    *credentials,
+				 const char        *bus_name,
+				 UrfSessionChecker *checker)
+{
+	UrfInhibitor *inhibitor;
+
+	/* A process disconnected from the bus */
+	inhibitor = find_inhibitor_by_bus_name (checker, bus_name);
+	if (inhibitor != NULL)
+		remove_inhibitor (checker, inhibitor);
+}
+
+/**
+ * urf_session_checker_create_backend:
+ **/
+static UrfSessionBackend *
+urf_session_checker_create_backend (void)
+{
+#ifdef HAVE_SYSTEMD
+	/* logind is running if this directory exists */
+	if (access ("/run/systemd/seats/", F_OK) == 0) {
+		urf_debug ("Using logind to track sessions");
+		return URF_SESSION_BACKEND (urf_logind_new ());
+	}
+#endif
+	urf_debug ("Using ConsoleKit to track sessions");
+	return URF_SESSION_BACKEND (urf_consolekit_new ());
+}
+
+/**
+ * urf_session_checker_startup:
+ **/
+gboolean
+urf_session_checker_startup (UrfSessionChecker *checker)
+{
+	UrfSessionCheckerPrivate *priv = checker->priv;
+	UrfSessionBackend *backend;
+
+	backend = urf_session_checker_create_backend ();
+	if (!urf_session_backend_startup (backend)) {
+		/* leave nothing half set up, Inhibit checks for the backend */
+		g_object_unref (backend);
+		return FALSE;
+	}
+
+	priv->backend = backend;
+	g_signal_connect (priv->backend, "active-changed",
+			  G_CALLBACK (urf_session_checker_active_changed_cb),
+			  checker);
+
+	/* sessions are looked up through the shared credential cache */
+	urf_credentials_set_session_backend (priv->credentials, priv->backend);
+	g_signal_connect (priv->credentials, "vanished",
+			  G_CALLBACK (urf_session_checker_vanished_cb),
+			  checker);
+
+	return TRUE;
+}
+
+/**
+ * urf_session_checker_dispose:
+ **/
+static void
+urf_session_checker_dispose (GObject *object)
+{
+	UrfSessionChecker *checker = URF_SESSION_CHECKER (object);
+
+	if (checker->priv->credentials) {
+		g_signal_handlers_disconnect_by_func (checker->priv->credentials,
+						      urf_session_checker_vanished_cb,
+						      checker);
+		g_object_unref (checker->priv->credentials);
+		checker->priv->credentials = NULL;
+	}
+	if (checker->priv->backend) {
+		g_signal_handlers_disconnect_by_func (checker->priv->backend,
+						      urf_session_checker_active_changed_cb,
+						      checker);
+		g_object_unref (checker->priv->backend);
+		checker->priv->backend = NULL;
+	}
+
+	G_OBJECT_CLASS (urf_session_checker_parent_class)->dispose (object);
+}
+
+/**
+ * urf_session_checker_finalize:
+ **/
+static void
+urf_session_checker_finalize (GObject *object)
+{
+	UrfSessionChecker *checker = URF_SESSION_CHECKER (object);
+
+	g_hash_table_destroy (checker->priv->bus_names);
+	g_hash_table_destroy (checker->priv->sessions);
+	g_hash_table_destroy (checker->priv->inhibitors);
+
+	G_OBJECT_CLASS (urf_session_checker_parent_class)->finalize (object);
+}
+
+/**
+ * urf_session_checker_class_init:
+ **/
+static void
+urf_session_checker_class_init (UrfSessionCheckerClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->dispose = urf_session_checker_dispose;
+	object_class->finalize = urf_session_checker_finalize;
+
+	g_type_class_add_private (klass, sizeof (UrfSessionCheckerPrivate));
+}
+
+/**
+ * urf_session_checker_init:
+ **/
+static void
+urf_session_checker_init (UrfSessionChecker *checker)
+{
+	checker->priv = URF_SESSION_CHECKER_GET_PRIVATE (checker);
+	checker->priv->inhibitors = g_hash_table_new_full (g_direct_hash,
+							   g_direct_equal,
+							   NULL,
+							   (GDestroyNotify) free_inhibitor);
+	checker->priv->bus_names = g_hash_table_new (g_str_hash, g_str_equal);
+	checker->priv->sessions = g_hash_table_new_full (g_str_hash,
+							 g_str_equal,
+							 g_free,
+							 g_free);
+	checker->priv->n_active = 0;
+	checker->priv->next_cookie = 1;
+	checker->priv->credentials = urf_credentials_new ();
+	checker->priv->backend = NULL;
+}
+
+/**
+ * urf_session_checker_new:
+ **/
+UrfSessionChecker *
+urf_session_checker_new (void)
+{
+	UrfSessionChecker *checker;
+	checker = URF_SESSION_CHECKER (g_object_new (URF_TYPE_SESSION_CHECKER, NULL));
+	return checker;
+}
@@ -0,0 +1,325 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <stdio.h>
+#include <glib.h>
+
+#include "urf-startup.h"
+#include "urf-log.h"
+
+/* the probes mostly wait on sysfs, a few threads are plenty */
+#define URF_STARTUP_MAX_THREADS	3
+
+struct UrfStartupProbe {
+	const char		*phase;
+	UrfStartupProbeFunc	 func;
+	gpointer		 user_data;
+	gpointer		 result;
+	gint64			 start;
+	gint64			 duration;
+	gboolean		 done;
+	GMutex			 mutex;
+	GCond			 cond;
+};
+
+typedef struct {
+	const char	*phase;
+	gint64		 offset;
+	gint64		 duration;
+	gboolean	 deferred;
+} UrfStartupPhase;
+
+G_LOCK_DEFINE_STATIC (urf_startup);
+static gint64 urf_startup_origin = 0;
+static gint64 urf_startup_ready_at = 0;
+static GArray *urf_startup_phases = NULL;
+static GThreadPool *urf_startup_pool = NULL;
+
+/* probes still running on a worker */
+static GMutex urf_startup_running_mutex;
+static guint urf_startup_running = 0;
+
+/**
+ * urf_startup_init:
+ *
+ * Start the startup clock, call first thing in main().
+ **/
+void
+urf_startup_init (void)
+{
+	G_LOCK (urf_startup);
+	if (urf_startup_phases == NULL) {
+		urf_startup_origin = g_get_monotonic_time ();
+		urf_startup_phases = g_array_new (FALSE, FALSE, sizeof (UrfStartupPhase));
+	}
+	G_UNLOCK (urf_startup);
+}
+
+/**
+ * urf_startup_begin:
+ *
+ * Return value: the start time to pass to urf_startup_end()
+ **/
+gint64
+urf_startup_begin (void)
+{
+	return g_get_monotonic_time ();
+}
+
+/**
+ * urf_startup_record:
+ **/
+static void
+urf_startup_record (const char *phase,
+		    gint64      start,
+		    gint64      duration)
+{
+	UrfStartupPhase entry;
+
+	G_LOCK (urf_startup);
+	if (urf_startup_phases == NULL) {
+		G_UNLOCK (urf_startup);
+		return;
+	}
+	entry.phase = phase;
+	entry.offset = start - urf_startup_origin;
+	entry.duration = duration;
+	entry.deferred = urf_startup_ready_at != 0;
+	g_array_append_val (urf_startup_phases, entry);
+	G_UNLOCK (urf_startup);
+
+	urf_debug_fields ("Startup phase",
+			  URF_LOG_STR ("STARTUP_PHASE", phase),
+			  URF_LOG_INT ("STARTUP_DURATION_USEC", entry.duration),
+			  URF_LOG_INT ("STARTUP_DEFERRED", entry.deferred));
+}
+
+/**
+ * urf_startup_end:
+ * @start: the value returned by urf_startup_begin()
+ * @phase: a static string naming the phase
+ *
+ * Record a phase. Phases ending after urf_startup_ready() are
+ * reported as deferred. Does nothing unless urf_startup_init()
+ * was called, so the daemon objects can be used without it.
+ **/
+void
+urf_startup_end (gint64      start,
+		 const char *phase)
+{
+	urf_startup_record (phase, start, g_get_monotonic_time () - start);
+}
+
+/**
+ * urf_startup_ready:
+ *
+ * Mark the end of the critical path, the main loop is about to run.
+ **/
+void
+urf_startup_ready (void)
+{
+	gint64 elapsed;
+
+	G_LOCK (urf_startup);
+	if (urf_startup_phases == NULL || urf_startup_ready_at != 0) {
+		G_UNLOCK (urf_startup);
+		return;
+	}
+	urf_startup_ready_at = g_get_monotonic_time ();
+	elapsed = urf_startup_ready_at - urf_startup_origin;
+	G_UNLOCK (urf_startup);
+
+	urf_info ("Ready after %.1f ms", elapsed / 1000.0);
+}
+
+/**
+ * urf_startup_print_report:
+ *
+ * Print every recorded phase to stdout, in the order they ended.
+ **/
+void
+urf_startup_print_report (void)
+{
+	UrfStartupPhase *entry;
+	guint i;
+
+	G_LOCK (urf_startup);
+	if (urf_startup_phases == NULL) {
+		G_UNLOCK (urf_startup);
+		return;
+	}
+
+	printf ("%-20s %10s %10s\n", "phase", "start_ms", "took_ms");
+	for (i = 0; i < urf_startup_phases->len; i++) {
+		entry = &g_array_index (urf_startup_phases, UrfStartupPhase, i);
+		printf ("%-20s %10.1f %10.1f%s\n", entry->phase,
+			entry->offset / 1000.0, entry->duration / 1000.0,
+			entry->deferred ? " deferred" : "");
+	}
+	if (urf_startup_ready_at != 0)
+		printf ("%-20s %10.1f\n", "ready",
+			(urf_startup_ready_at - urf_startup_origin) / 1000.0);
+	fflush (stdout);
+	G_UNLOCK (urf_startup);
+}
+
+/**
+ * urf_startup_probe_run:
+ **/
+static void
+urf_startup_probe_run (UrfStartupProbe *probe)
+{
+	probe->start = g_get_monotonic_time ();
+	probe->result = probe->func (probe->user_data);
+	probe->duration = g_get_monotonic_time () - probe->start;
+}
+
+/**
+ * urf_startup_probe_done:
+ **/
+static void
+urf_startup_probe_done (UrfStartupProbe *probe)
+{
+	g_mutex_lock (&probe->mutex);
+	probe->done = TRUE;
+	g_cond_signal (&probe->cond);
+	g_mutex_unlock (&probe->mutex);
+}
+
+/**
+ * urf_startup_probe_worker:
+ **/
+static void
+urf_startup_probe_worker (UrfStartupProbe *probe,
+			  gpointer         unused)
+{
+	urf_startup_probe_run (probe);
+
+	/* before the join wakes up, so it sees the pool idle */
+	g_mutex_lock (&urf_startup_running_mutex);
+	urf_startup_running--;
+	g_mutex_unlock (&urf_startup_running_mutex);
+
+	urf_startup_probe_done (probe);
+}
+
+/**
+ * urf_startup_probe_start:
+ * @phase: a static string naming the probe
+ * @func: the probe, only touching data nobody else uses until the join
+ *
+ * Run @func on the startup worker pool. Falls back to running it
+ * right away when no thread can be started.
+ *
+ * Return value: the probe to pass to urf_startup_probe_join()
+ **/
+UrfStartupProbe *
+urf_startup_probe_start (const char          *phase,
+			 UrfStartupProbeFunc  func,
+			 gpointer             user_data)
+{
+	UrfStartupProbe *probe;
+	GError *error = NULL;
+	gboolean ret;
+
+	probe = g_new0 (UrfStartupProbe, 1);
+	probe->phase = phase;
+	probe->func = func;
+	probe->user_data = user_data;
+	g_mutex_init (&probe->mutex);
+	g_cond_init (&probe->cond);
+
+	g_mutex_lock (&urf_startup_running_mutex);
+	urf_startup_running++;
+	g_mutex_unlock (&urf_startup_running_mutex);
+
+	G_LOCK (urf_startup);
+	if (urf_startup_pool == NULL)
+		urf_startup_pool = g_thread_pool_new ((GFunc) urf_startup_probe_worker,
+						      NULL,
+						      URF_STARTUP_MAX_THREADS,
+						      FALSE, &error);
+	ret = urf_startup_pool != NULL &&
+	      g_thread_pool_push (urf_startup_pool, probe, &error);
+	G_UNLOCK (urf_startup);
+
+	if (!ret) {
+		g_mutex_lock (&urf_startup_running_mutex);
+		urf_startup_running--;
+		g_mutex_unlock (&urf_startup_running_mutex);
+
+		urf_warning ("Failed to start the %s probe: %s", phase,
+			     error->message);
+		g_error_free (error);
+		urf_startup_probe_run (probe);
+		urf_startup_probe_done (probe);
+	}
+
+	return probe;
+}
+
+/**
+ * urf_startup_probe_join:
+ *
+ * Wait for @probe to finish and record how long it ran.
+ *
+ * Return value: what the probe function returned
+ **/
+gpointer
+urf_startup_probe_join (UrfStartupProbe *probe)
+{
+	GThreadPool *pool = NULL;
+	gpointer result;
+
+	g_mutex_lock (&probe->mutex);
+	while (!probe->done)
+		g_cond_wait (&probe->cond, &probe->mutex);
+	g_mutex_unlock (&probe->mutex);
+
+	urf_startup_record (probe->phase, probe->start, probe->duration);
+
+	/* nothing else runs on the pool, don't keep its threads around.
+	 * A probe started later gets a new pool */
+	G_LOCK (urf_startup);
+	g_mutex_lock (&urf_startup_running_mutex);
+	if (urf_startup_running == 0) {
+		pool = urf_startup_pool;
+		urf_startup_pool = NULL;
+	}
+	g_mutex_unlock (&urf_startup_running_mutex);
+	G_UNLOCK (urf_startup);
+
+	if (pool != NULL) {
+		/* waits for the workers to return */
+		g_thread_pool_free (pool, FALSE, TRUE);
+		g_thread_pool_stop_unused_threads ();
+	}
+
+	result = probe->result;
+	g_mutex_clear (&probe->mutex);
+	g_cond_clear (&probe->cond);
+	g_free (probe);
+
+	return result;
+}
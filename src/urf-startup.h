@@ -0,0 +1,47 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __URF_STARTUP_H__
+#define __URF_STARTUP_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct UrfStartupProbe UrfStartupProbe;
+
+/* runs on a worker thread, keep away from the main context */
+typedef gpointer (*UrfStartupProbeFunc)	(gpointer	 user_data);
+
+void			 urf_startup_init		(void);
+gint64			 urf_startup_begin		(void);
+void			 urf_startup_end		(gint64		 start,
+							 const char	*phase);
+void			 urf_startup_ready		(void);
+void			 urf_startup_print_report	(void);
+
+UrfStartupProbe		*urf_startup_probe_start	(const char	*phase,
+							 UrfStartupProbeFunc func,
+							 gpointer	 user_data);
+gpointer		 urf_startup_probe_join		(UrfStartupProbe *probe);
+
+G_END_DECLS
+
+#endif /* __URF_STARTUP_H__ */
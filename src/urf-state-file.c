@@ -0,0 +1,256 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "liburfkill-glib/urf-state-format.h"
+
+#include "urf-state-file.h"
+#include "urf-log.h"
+#include "urf-killswitch.h"
+#include "urf-device.h"
+
+#define URF_STATE_FILE_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), \
+                                URF_TYPE_STATE_FILE, UrfStateFilePrivate))
+
+struct UrfStateFilePrivate {
+	int		 fd;
+	UrfStateFileData *data;
+};
+
+G_DEFINE_TYPE(UrfStateFile, urf_state_file, G_TYPE_OBJECT)
+
+/**
+ * urf_state_file_begin:
+ **/
+static void
+urf_state_file_begin (UrfStateFileData *data)
+{
+	/* odd sequence, readers retry until the update is done */
+	g_atomic_int_inc (&data->sequence);
+}
+
+/**
+ * urf_state_file_commit:
+ **/
+static void
+urf_state_file_commit (UrfStateFile *state_file)
+{
+	g_atomic_int_inc (&state_file->priv->data->sequence);
+
+	/* writes through the mapping are invisible to inotify, so touch
+	 * the file to let watchers see IN_ATTRIB */
+	if (futimens (state_file->priv->fd, NULL) < 0)
+		urf_debug ("failed to touch the state file: %s", g_strerror (errno));
+}
+
+/**
+ * urf_state_file_clear:
+ **/
+static void
+urf_state_file_clear (UrfStateFileData *data)
+{
+	guint i;
+
+	data->n_devices = 0;
+	for (i = 0; i < URF_STATE_FILE_MAX_TYPES; i++)
+		data->type_state[i] = KILLSWITCH_STATE_NO_ADAPTER;
+}
+
+/**
+ * urf_state_file_open:
+ *
+ * Create the state file and map it into memory. The file stays mapped
+ * after the daemon drops its privileges.
+ **/
+gboolean
+urf_state_file_open (UrfStateFile *state_file,
+		     const char   *path)
+{
+	UrfStateFilePrivate *priv = state_file->priv;
+	char *dirname;
+	void *data;
+	int fd;
+
+	g_return_val_if_fail (URF_IS_STATE_FILE (state_file), FALSE);
+	g_return_val_if_fail (priv->data == NULL, FALSE);
+
+	dirname = g_path_get_dirname (path);
+	if (g_mkdir_with_parents (dirname, 0755) < 0) {
+		urf_warning ("failed to create %s: %s", dirname, g_strerror (errno));
+		g_free (dirname);
+		return FALSE;
+	}
+	g_free (dirname);
+
+	fd = open (path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		urf_warning ("failed to open %s: %s", path, g_strerror (errno));
+		return FALSE;
+	}
+
+	if (ftruncate (fd, sizeof (UrfStateFileData)) < 0) {
+		urf_warning ("failed to resize %s: %s", path, g_strerror (errno));
+		close (fd);
+		return FALSE;
+	}
+
+	data = mmap (NULL, sizeof (UrfStateFileData),
+		     PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED) {
+		urf_warning ("failed to map %s: %s", path, g_strerror (errno));
+		close (fd);
+		return FALSE;
+	}
+
+	priv->fd = fd;
+	priv->data = data;
+
+	/* keep the sequence of an old file so readers see a change, but
+	 * a daemon killed in the middle of an update left it odd */
+	if (priv->data->sequence & 1)
+		priv->data->sequence++;
+	urf_state_file_begin (priv->data);
+	priv->data->magic = URF_STATE_FILE_MAGIC;
+	priv->data->version = URF_STATE_FILE_VERSION;
+	urf_state_file_clear (priv->data);
+	urf_state_file_commit (state_file);
+
+	return TRUE;
+}
+
+/**
+ * urf_state_file_update:
+ * @devices: a #GList of #UrfDevice
+ * @type_states: the aggregated #KillswitchState of every rfkill type
+ * @n_types: the length of @type_states
+ **/
+void
+urf_state_file_update (UrfStateFile *state_file,
+		       GList        *devices,
+		       const int    *type_states,
+		       guint         n_types)
+{
+	UrfStateFileData *data = state_file->priv->data;
+	UrfStateFileDevice *entry;
+	UrfDevice *device;
+	GList *item;
+	guint i = 0;
+
+	if (data == NULL)
+		return;
+
+	urf_state_file_begin (data);
+
+	for (item = devices; item; item = item->next) {
+		if (i == URF_STATE_FILE_MAX_DEVICES) {
+			urf_warning ("too many devices for the state file");
+			break;
+		}
+		device = URF_DEVICE (item->data);
+		entry = &data->devices[i++];
+		entry->index = urf_device_get_index (device);
+		entry->type = urf_device_get_rf_type (device);
+		entry->soft = urf_device_get_soft (device);
+		entry->hard = urf_device_get_hard (device);
+		entry->platform = urf_device_is_platform (device);
+	}
+	data->n_devices = i;
+
+	for (i = 0; i < URF_STATE_FILE_MAX_TYPES; i++) {
+		if (i < n_types)
+			data->type_state[i] = type_states[i];
+		else
+			data->type_state[i] = KILLSWITCH_STATE_NO_ADAPTER;
+	}
+
+	urf_state_file_commit (state_file);
+}
+
+/**
+ * urf_state_file_finalize:
+ **/
+static void
+urf_state_file_finalize (GObject *object)
+{
+	UrfStateFile *state_file = URF_STATE_FILE (object);
+	UrfStateFilePrivate *priv = state_file->priv;
+
+	if (priv->data) {
+		/* the file is owned by root, so leave it but drop the devices */
+		urf_state_file_begin (priv->data);
+		urf_state_file_clear (priv->data);
+		urf_state_file_commit (state_file);
+
+		munmap (priv->data, sizeof (UrfStateFileData));
+		priv->data = NULL;
+	}
+	if (priv->fd >= 0)
+		close (priv->fd);
+
+	G_OBJECT_CLASS(urf_state_file_parent_class)->finalize(object);
+}
+
+/**
+ * urf_state_file_init:
+ **/
+static void
+urf_state_file_init (UrfStateFile *state_file)
+{
+	state_file->priv = URF_STATE_FILE_GET_PRIVATE (state_file);
+	state_file->priv->fd = -1;
+	state_file->priv->data = NULL;
+}
+
+/**
+ * urf_state_file_class_init:
+ **/
+static void
+urf_state_file_class_init (UrfStateFileClass *klass)
+{
+	GObjectClass *object_class = (GObjectClass *) klass;
+
+	g_type_class_add_private (klass, sizeof (UrfStateFilePrivate));
+	object_class->finalize = urf_state_file_finalize;
+}
+
+/**
+ * urf_state_file_new:
+ **/
+UrfStateFile *
+urf_state_file_new (void)
+{
+	UrfStateFile *state_file;
+	state_file = URF_STATE_FILE (g_object_new (URF_TYPE_STATE_FILE, NULL));
+	return state_file;
+}
@@ -0,0 +1,62 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __URF_STATE_FILE_H__
+#define __URF_STATE_FILE_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define URF_TYPE_STATE_FILE (urf_state_file_get_type())
+#define URF_STATE_FILE(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj), \
+					URF_TYPE_STATE_FILE, UrfStateFile))
+#define URF_STATE_FILE_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST((klass), \
+					URF_TYPE_STATE_FILE, UrfStateFileClass))
+#define URF_IS_STATE_FILE(obj) (G_TYPE_CHECK_INSTANCE_TYPE((obj), \
+					URF_TYPE_STATE_FILE))
+#define URF_IS_STATE_FILE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), \
+					URF_TYPE_STATE_FILE))
+#define URF_GET_STATE_FILE_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS((obj), \
+					URF_TYPE_STATE_FILE, UrfStateFileClass))
+
+typedef struct UrfStateFilePrivate UrfStateFilePrivate;
+
+typedef struct {
+	GObject parent;
+	UrfStateFilePrivate *priv;
+} UrfStateFile;
+
+typedef struct {
+        GObjectClass parent_class;
+} UrfStateFileClass;
+
+GType		 urf_state_file_get_type	(void);
+UrfStateFile	*urf_state_file_new		(void);
+gboolean	 urf_state_file_open		(UrfStateFile	*state_file,
+						 const char	*path);
+void		 urf_state_file_update		(UrfStateFile	*state_file,
+						 GList		*devices,
+						 const int	*type_states,
+						 guint		 n_types);
+
+G_END_DECLS
+
+#endif /* __URF_STATE_FILE_H__ */
@@ -0,0 +1,297 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <glib.h>
+
+#include "urf-trace.h"
+#include "urf-log.h"
+
+#define URF_TRACE_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), \
+                                URF_TYPE_TRACE, UrfTracePrivate))
+
+/* the records are read in place from a mapped file */
+G_STATIC_ASSERT (sizeof (UrfTraceHeader) % 8 == 0);
+G_STATIC_ASSERT (sizeof (UrfTraceRecord) % 8 == 0);
+
+struct UrfTracePrivate {
+	int		 fd;
+	char		*filename;
+};
+
+G_DEFINE_TYPE (UrfTrace, urf_trace, G_TYPE_OBJECT)
+
+/**
+ * urf_trace_check_header:
+ **/
+static gboolean
+urf_trace_check_header (const UrfTraceHeader *header,
+			const char           *filename)
+{
+	if (memcmp (header->magic, URF_TRACE_MAGIC, sizeof (header->magic)) != 0) {
+		urf_warning ("%s is not an urfkill trace", filename);
+		return FALSE;
+	}
+	if (header->byte_order != URF_TRACE_BYTE_ORDER) {
+		urf_warning ("%s was recorded on a machine with another byte order", filename);
+		return FALSE;
+	}
+	if (header->version != URF_TRACE_VERSION ||
+	    header->header_size != sizeof (UrfTraceHeader) ||
+	    header->record_size != sizeof (UrfTraceRecord)) {
+		urf_warning ("%s has the unsupported trace version %u", filename, header->version);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * urf_trace_open:
+ *
+ * Create the trace, or append to it if it exists
+ **/
+gboolean
+urf_trace_open (UrfTrace   *trace,
+		const char *filename)
+{
+	UrfTracePrivate *priv = trace->priv;
+	UrfTraceHeader header;
+	struct stat st;
+	off_t size;
+	int fd;
+
+	g_return_val_if_fail (URF_IS_TRACE (trace), FALSE);
+	g_return_val_if_fail (priv->fd < 0, FALSE);
+
+	fd = open (filename, O_RDWR | O_CREAT | O_APPEND | O_NOFOLLOW | O_CLOEXEC, 0640);
+	if (fd < 0) {
+		urf_warning ("failed to open %s: %s", filename, g_strerror (errno));
+		return FALSE;
+	}
+
+	if (fstat (fd, &st) < 0) {
+		urf_warning ("failed to stat %s: %s", filename, g_strerror (errno));
+		goto fail;
+	}
+
+	if (st.st_size == 0) {
+		memset (&header, 0, sizeof (header));
+		memcpy (header.magic, URF_TRACE_MAGIC, sizeof (header.magic));
+		header.version = URF_TRACE_VERSION;
+		header.byte_order = URF_TRACE_BYTE_ORDER;
+		header.header_size = sizeof (UrfTraceHeader);
+		header.record_size = sizeof (UrfTraceRecord);
+		header.created = g_get_real_time ();
+		if (write (fd, &header, sizeof (header)) != sizeof (header)) {
+			urf_warning ("failed to write %s: %s", filename, g_strerror (errno));
+			goto fail;
+		}
+	} else {
+		if (pread (fd, &header, sizeof (header), 0) != sizeof (header)) {
+			urf_warning ("%s is not an urfkill trace", filename);
+			goto fail;
+		}
+		if (!urf_trace_check_header (&header, filename))
+			goto fail;
+
+		/* drop a record torn by a crash, the next ones stay aligned */
+		size = st.st_size - sizeof (UrfTraceHeader);
+		if (size % sizeof (UrfTraceRecord) != 0 &&
+		    ftruncate (fd, st.st_size - size % sizeof (UrfTraceRecord)) < 0) {
+			urf_warning ("failed to truncate %s: %s", filename, g_strerror (errno));
+			goto fail;
+		}
+	}
+
+	priv->fd = fd;
+	priv->filename = g_strdup (filename);
+	return TRUE;
+fail:
+	close (fd);
+	return FALSE;
+}
+
+/**
+ * urf_trace_append:
+ **/
+static void
+urf_trace_append (UrfTrace                  *trace,
+		  UrfTraceRecordType         type,
+		  guint                      code,
+		  const struct rfkill_event *event)
+{
+	UrfTracePrivate *priv = trace->priv;
+	UrfTraceRecord record;
+
+	if (priv->fd < 0)
+		return;
+
+	memset (&record, 0, sizeof (record));
+	record.timestamp = g_get_real_time ();
+	record.type = type;
+	record.code = code;
+	if (event != NULL)
+		record.event = *event;
+
+	/* one write per record, O_APPEND keeps it in one piece */
+	if (write (priv->fd, &record, sizeof (record)) != sizeof (record)) {
+		urf_warning ("failed to write %s, stop tracing: %s",
+			     priv->filename, g_strerror (errno));
+		close (priv->fd);
+		priv->fd = -1;
+	}
+}
+
+/**
+ * urf_trace_record_event:
+ **/
+void
+urf_trace_record_event (UrfTrace                  *trace,
+			const struct rfkill_event *event)
+{
+	g_return_if_fail (URF_IS_TRACE (trace));
+
+	urf_trace_append (trace, URF_TRACE_RECORD_RFKILL_EVENT, 0, event);
+}
+
+/**
+ * urf_trace_record_write:
+ **/
+void
+urf_trace_record_write (UrfTrace                  *trace,
+			const struct rfkill_event *event)
+{
+	g_return_if_fail (URF_IS_TRACE (trace));
+
+	urf_trace_append (trace, URF_TRACE_RECORD_RFKILL_WRITE, 0, event);
+}
+
+/**
+ * urf_trace_record_key:
+ **/
+void
+urf_trace_record_key (UrfTrace *trace,
+		      guint     code)
+{
+	g_return_if_fail (URF_IS_TRACE (trace));
+
+	urf_trace_append (trace, URF_TRACE_RECORD_KEY, code, NULL);
+}
+
+/**
+ * urf_trace_map:
+ * @records: the records in the mapped file
+ * @n_records: the number of records
+ *
+ * Map a trace for reading. A record torn by a crash is ignored.
+ *
+ * Return value: the mapped file, or %NULL if it isn't a valid trace
+ **/
+GMappedFile *
+urf_trace_map (const char            *filename,
+	       const UrfTraceRecord **records,
+	       guint                 *n_records)
+{
+	GMappedFile *file;
+	GError *error = NULL;
+	const char *contents;
+	gsize length;
+
+	file = g_mapped_file_new (filename, FALSE, &error);
+	if (file == NULL) {
+		urf_warning ("failed to map %s: %s", filename, error->message);
+		g_error_free (error);
+		return NULL;
+	}
+
+	contents = g_mapped_file_get_contents (file);
+	length = g_mapped_file_get_length (file);
+	if (length < sizeof (UrfTraceHeader)) {
+		urf_warning ("%s is not an urfkill trace", filename);
+		goto fail;
+	}
+	if (!urf_trace_check_header ((const UrfTraceHeader *) contents, filename))
+		goto fail;
+
+	*records = (const UrfTraceRecord *) (contents + sizeof (UrfTraceHeader));
+	*n_records = (length - sizeof (UrfTraceHeader)) / sizeof (UrfTraceRecord);
+	return file;
+fail:
+	g_mapped_file_unref (file);
+	return NULL;
+}
+
+/**
+ * urf_trace_finalize:
+ **/
+static void
+urf_trace_finalize (GObject *object)
+{
+	UrfTracePrivate *priv = URF_TRACE (object)->priv;
+
+	if (priv->fd >= 0)
+		close (priv->fd);
+	g_free (priv->filename);
+
+	G_OBJECT_CLASS (urf_trace_parent_class)->finalize (object);
+}
+
+/**
+ * urf_trace_class_init:
+ **/
+static void
+urf_trace_class_init (UrfTraceClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = urf_trace_finalize;
+
+	g_type_class_add_private (klass, sizeof (UrfTracePrivate));
+}
+
+/**
+ * urf_trace_init:
+ **/
+static void
+urf_trace_init (UrfTrace *trace)
+{
+	trace->priv = URF_TRACE_GET_PRIVATE (trace);
+	trace->priv->fd = -1;
+	trace->priv->filename = NULL;
+}
+
+/**
+ * urf_trace_new:
+ **/
+UrfTrace *
+urf_trace_new (void)
+{
+	return URF_TRACE (g_object_new (URF_TYPE_TRACE, NULL));
+}
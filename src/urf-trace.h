@@ -0,0 +1,101 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __URF_TRACE_H__
+#define __URF_TRACE_H__
+
+#include <glib-object.h>
+#include <linux/rfkill.h>
+
+G_BEGIN_DECLS
+
+/*
+ * A trace is a fixed header followed by fixed-size records in host
+ * byte order, so a mapped trace can be read as an array of records.
+ * The file is only ever appended to.
+ */
+#define URF_TRACE_MAGIC		"URFTRACE"
+#define URF_TRACE_VERSION	1
+#define URF_TRACE_BYTE_ORDER	0x01020304
+
+typedef enum {
+	URF_TRACE_RECORD_RFKILL_EVENT = 1,	/* read from the rfkill core */
+	URF_TRACE_RECORD_RFKILL_WRITE,		/* a block request written to it */
+	URF_TRACE_RECORD_KEY,			/* an rfkill key press */
+} UrfTraceRecordType;
+
+typedef struct {
+	char			 magic[8];
+	guint32			 version;
+	guint32			 byte_order;
+	guint32			 header_size;
+	guint32			 record_size;
+	gint64			 created;	/* wall clock, in microseconds */
+} UrfTraceHeader;
+
+typedef struct {
+	gint64			 timestamp;	/* wall clock, in microseconds */
+	guint32			 type;
+	guint32			 code;		/* the keycode of a key press */
+	struct rfkill_event	 event;
+} UrfTraceRecord;
+
+#define URF_TYPE_TRACE (urf_trace_get_type())
+#define URF_TRACE(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj), \
+					URF_TYPE_TRACE, UrfTrace))
+#define URF_TRACE_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST((klass), \
+					URF_TYPE_TRACE, UrfTraceClass))
+#define URF_IS_TRACE(obj) (G_TYPE_CHECK_INSTANCE_TYPE((obj), \
+					URF_TYPE_TRACE))
+#define URF_IS_TRACE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), \
+					URF_TYPE_TRACE))
+#define URF_GET_TRACE_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS((obj), \
+					URF_TYPE_TRACE, UrfTraceClass))
+
+typedef struct UrfTracePrivate UrfTracePrivate;
+
+typedef struct {
+	GObject			 parent;
+	UrfTracePrivate		*priv;
+} UrfTrace;
+
+typedef struct {
+        GObjectClass		 parent_class;
+} UrfTraceClass;
+
+GType			 urf_trace_get_type		(void);
+UrfTrace		*urf_trace_new			(void);
+
+gboolean		 urf_trace_open			(UrfTrace	*trace,
+							 const char	*filename);
+void			 urf_trace_record_event		(UrfTrace	*trace,
+							 const struct rfkill_event *event);
+void			 urf_trace_record_write		(UrfTrace	*trace,
+							 const struct rfkill_event *event);
+void			 urf_trace_record_key		(UrfTrace	*trace,
+							 guint		 code);
+
+GMappedFile		*urf_trace_map			(const char	*filename,
+							 const UrfTraceRecord **records,
+							 guint		*n_records);
+
+G_END_DECLS
+
+#endif /* __URF_TRACE_H__ */
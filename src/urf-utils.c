@@ -1,5 +1,7 @@
+#include <stdlib.h>
 #include <libudev.h>
 #include "urf-utils.h"
+#include "urf-log.h"
 
 /**
  * get_dmi_info:
@@ -16,7 +18,7 @@ get_dmi_info ()
 
 	udev = udev_new ();
 	if (!udev) {
-		g_warning ("Cannot create udev");
+		urf_warning ("Cannot create udev");
 		return NULL;
 	}
 
@@ -113,3 +115,69 @@ get_rfkill_device_by_index (struct udev *udev,
 
 	return dev;
 }
+
+/**
+ * rfkill_udev_attrs_free:
+ **/
+static void
+rfkill_udev_attrs_free (RfkillUdevAttrs *attrs)
+{
+	g_free (attrs->name);
+	g_free (attrs);
+}
+
+/**
+ * get_rfkill_udev_attrs:
+ *
+ * Read the udev attributes of every rfkill device in one enumeration.
+ * Only uses its own udev context, so it may run on a worker thread.
+ *
+ * Return value: a table from the rfkill index to a #RfkillUdevAttrs
+ **/
+GHashTable *
+get_rfkill_udev_attrs (void)
+{
+	struct udev *udev;
+	struct udev_enumerate *enumerate;
+	struct udev_list_entry *devices;
+	struct udev_list_entry *dev_list_entry;
+	struct udev_device *dev;
+	RfkillUdevAttrs *attrs;
+	GHashTable *table;
+	const char *index_c;
+
+	table = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+				       (GDestroyNotify) rfkill_udev_attrs_free);
+
+	udev = udev_new ();
+	if (!udev) {
+		urf_warning ("Cannot create udev");
+		return table;
+	}
+
+	enumerate = udev_enumerate_new (udev);
+	udev_enumerate_add_match_subsystem (enumerate, "rfkill");
+	udev_enumerate_scan_devices (enumerate);
+	devices = udev_enumerate_get_list_entry (enumerate);
+
+	udev_list_entry_foreach (dev_list_entry, devices) {
+		dev = udev_device_new_from_syspath (udev, udev_list_entry_get_name (dev_list_entry));
+		if (!dev)
+			continue;
+
+		index_c = udev_device_get_sysattr_value (dev, "index");
+		if (index_c) {
+			attrs = g_new0 (RfkillUdevAttrs, 1);
+			attrs->name = g_strdup (udev_device_get_sysattr_value (dev, "name"));
+			attrs->platform = udev_device_get_parent_with_subsystem_devtype (dev, "platform", NULL) != NULL;
+			g_hash_table_insert (table, GUINT_TO_POINTER (atoi (index_c)), attrs);
+		}
+
+		udev_device_unref (dev);
+	}
+
+	udev_enumerate_unref (enumerate);
+	udev_unref (udev);
+
+	return table;
+}
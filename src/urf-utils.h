@@ -33,9 +33,15 @@ typedef struct {
 	char *product_version;
 } DmiInfo;
 
+typedef struct {
+	char *name;
+	gboolean platform;
+} RfkillUdevAttrs;
+
 DmiInfo			*get_dmi_info			(void);
 void			 dmi_info_free			(DmiInfo	*info);
 struct udev_device 	*get_rfkill_device_by_index	(struct udev	*udev,
 							 guint		 index);
+GHashTable		*get_rfkill_udev_attrs		(void);
 
 #endif /* __URF_UTILS_H__ */
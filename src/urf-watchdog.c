@@ -0,0 +1,320 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ * Everything in urfkilld runs on the main loop, so a blocking call
+ * delays every other client. The blocking call sites account their
+ * time with urf_watchdog_begin() and urf_watchdog_end(). When asked
+ * with urf_watchdog_watch_main_loop(), a high priority timer also
+ * measures how late the loop dispatches it; it wakes the CPU ten times
+ * a second, so it is off by default. Both warn above
+ * URF_WATCHDOG_THRESHOLD and are reported over the Debug interface of
+ * the daemon.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "urf-watchdog.h"
+#include "urf-log.h"
+
+#define URF_WATCHDOG_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), \
+                                URF_TYPE_WATCHDOG, UrfWatchdogPrivate))
+
+/* in milliseconds */
+#define URF_WATCHDOG_INTERVAL	100
+#define URF_WATCHDOG_THRESHOLD	200
+
+typedef struct {
+	const char	*site;
+	const char	*what;
+	guint		 count;
+	guint64		 total;
+	guint64		 max;
+} UrfWatchdogCall;
+
+struct UrfWatchdogPrivate {
+	GSource		*timer;
+	gint64		 last_tick;
+	guint64		 ticks;
+	guint64		 stalls;
+	guint64		 max_latency;
+	guint64		 total_latency;
+	GHashTable	*calls;
+};
+
+G_DEFINE_TYPE (UrfWatchdog, urf_watchdog, G_TYPE_OBJECT)
+
+/* the blocking calls may be accounted from other threads */
+static gpointer urf_watchdog_object = NULL;
+G_LOCK_DEFINE_STATIC (urf_watchdog_object);
+
+/**
+ * urf_watchdog_tick_cb:
+ **/
+static gboolean
+urf_watchdog_tick_cb (UrfWatchdog *watchdog)
+{
+	UrfWatchdogPrivate *priv = watchdog->priv;
+	gint64 now = g_get_monotonic_time ();
+	gint64 latency;
+
+	/* the loop may only start running after the startup */
+	if (priv->last_tick == 0) {
+		priv->last_tick = now;
+		return TRUE;
+	}
+
+	/* the timer is rearmed when dispatched, so any delay is ours */
+	latency = now - priv->last_tick - URF_WATCHDOG_INTERVAL * 1000;
+	if (latency < 0)
+		latency = 0;
+	priv->last_tick = now;
+
+	G_LOCK (urf_watchdog_object);
+	priv->ticks++;
+	priv->total_latency += latency;
+	if ((guint64) latency > priv->max_latency)
+		priv->max_latency = latency;
+	if (latency > URF_WATCHDOG_THRESHOLD * 1000)
+		priv->stalls++;
+	G_UNLOCK (urf_watchdog_object);
+
+	if (latency > URF_WATCHDOG_THRESHOLD * 1000)
+		urf_warning ("the main loop stalled for %" G_GINT64_FORMAT " ms",
+			     latency / 1000);
+
+	return TRUE;
+}
+
+/**
+ * urf_watchdog_begin:
+ *
+ * Return value: the start time to pass to urf_watchdog_end()
+ **/
+gint64
+urf_watchdog_begin (void)
+{
+	return g_get_monotonic_time ();
+}
+
+/**
+ * urf_watchdog_account:
+ *
+ * Use urf_watchdog_end(), which fills in @site.
+ **/
+void
+urf_watchdog_account (gint64      start,
+		      const char *site,
+		      const char *what)
+{
+	UrfWatchdogPrivate *priv;
+	UrfWatchdogCall *call;
+	guint64 duration;
+
+	duration = MAX (g_get_monotonic_time () - start, 0);
+
+	G_LOCK (urf_watchdog_object);
+	if (urf_watchdog_object == NULL) {
+		G_UNLOCK (urf_watchdog_object);
+		return;
+	}
+
+	priv = URF_WATCHDOG (urf_watchdog_object)->priv;
+	call = g_hash_table_lookup (priv->calls, site);
+	if (call == NULL) {
+		call = g_new0 (UrfWatchdogCall, 1);
+		call->site = site;
+		call->what = what;
+		g_hash_table_insert (priv->calls, (gpointer) site, call);
+	}
+	call->count++;
+	call->total += duration;
+	if (duration > call->max)
+		call->max = duration;
+	G_UNLOCK (urf_watchdog_object);
+
+	if (duration > URF_WATCHDOG_THRESHOLD * 1000)
+		urf_warning ("%s: %s blocked for %" G_GUINT64_FORMAT " ms",
+			     site, what, duration / 1000);
+}
+
+/**
+ * urf_watchdog_get_main_loop_stats:
+ * @interval_ms: the timer interval, 0 if the main loop is not watched
+ * @max_latency: the longest dispatch delay of the timer, in microseconds
+ * @total_latency: the sum of all delays, in microseconds
+ **/
+void
+urf_watchdog_get_main_loop_stats (UrfWatchdog *watchdog,
+				  guint       *interval_ms,
+				  guint64     *ticks,
+				  guint64     *stalls,
+				  guint64     *max_latency,
+				  guint64     *total_latency)
+{
+	UrfWatchdogPrivate *priv = watchdog->priv;
+
+	G_LOCK (urf_watchdog_object);
+	*interval_ms = priv->timer ? URF_WATCHDOG_INTERVAL : 0;
+	*ticks = priv->ticks;
+	*stalls = priv->stalls;
+	*max_latency = priv->max_latency;
+	*total_latency = priv->total_latency;
+	G_UNLOCK (urf_watchdog_object);
+}
+
+/**
+ * urf_watchdog_watch_main_loop:
+ *
+ * Start the timer that measures the main loop latency
+ **/
+void
+urf_watchdog_watch_main_loop (UrfWatchdog *watchdog)
+{
+	UrfWatchdogPrivate *priv = watchdog->priv;
+
+	if (priv->timer != NULL)
+		return;
+
+	/* ahead of every other source, so only a blocked loop delays it */
+	priv->last_tick = 0;
+	priv->timer = g_timeout_source_new (URF_WATCHDOG_INTERVAL);
+	g_source_set_priority (priv->timer, G_PRIORITY_HIGH);
+	g_source_set_callback (priv->timer, (GSourceFunc) urf_watchdog_tick_cb,
+			       watchdog, NULL);
+	g_source_attach (priv->timer, NULL);
+}
+
+/**
+ * urf_watchdog_compare_calls:
+ **/
+static gint
+urf_watchdog_compare_calls (gconstpointer a,
+			    gconstpointer b)
+{
+	const UrfWatchdogCall *call_a = a;
+	const UrfWatchdogCall *call_b = b;
+
+	if (call_a->max != call_b->max)
+		return call_a->max < call_b->max ? 1 : -1;
+	return g_strcmp0 (call_a->site, call_b->site);
+}
+
+/**
+ * urf_watchdog_get_blocking_calls:
+ *
+ * Return value: a floating a(ssutt) of the call site, the call, the
+ * count, the total and the longest time in microseconds, the worst
+ * offender first
+ **/
+GVariant *
+urf_watchdog_get_blocking_calls (UrfWatchdog *watchdog)
+{
+	UrfWatchdogPrivate *priv = watchdog->priv;
+	GVariantBuilder builder;
+	UrfWatchdogCall *call;
+	GList *calls, *item;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(ssutt)"));
+
+	G_LOCK (urf_watchdog_object);
+	calls = g_hash_table_get_values (priv->calls);
+	calls = g_list_sort (calls, urf_watchdog_compare_calls);
+	for (item = calls; item != NULL; item = item->next) {
+		call = item->data;
+		g_variant_builder_add (&builder, "(ssutt)",
+				       call->site, call->what, call->count,
+				       call->total, call->max);
+	}
+	G_UNLOCK (urf_watchdog_object);
+	g_list_free (calls);
+
+	return g_variant_builder_end (&builder);
+}
+
+/**
+ * urf_watchdog_finalize:
+ **/
+static void
+urf_watchdog_finalize (GObject *object)
+{
+	UrfWatchdogPrivate *priv = URF_WATCHDOG (object)->priv;
+
+	if (priv->timer != NULL) {
+		g_source_destroy (priv->timer);
+		g_source_unref (priv->timer);
+	}
+	g_hash_table_destroy (priv->calls);
+
+	G_OBJECT_CLASS (urf_watchdog_parent_class)->finalize (object);
+}
+
+/**
+ * urf_watchdog_class_init:
+ **/
+static void
+urf_watchdog_class_init (UrfWatchdogClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = urf_watchdog_finalize;
+
+	g_type_class_add_private (klass, sizeof (UrfWatchdogPrivate));
+}
+
+/**
+ * urf_watchdog_init:
+ **/
+static void
+urf_watchdog_init (UrfWatchdog *watchdog)
+{
+	UrfWatchdogPrivate *priv = URF_WATCHDOG_GET_PRIVATE (watchdog);
+
+	watchdog->priv = priv;
+	priv->ticks = 0;
+	priv->stalls = 0;
+	priv->max_latency = 0;
+	priv->total_latency = 0;
+	priv->calls = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+	priv->last_tick = 0;
+	priv->timer = NULL;
+}
+
+/**
+ * urf_watchdog_new:
+ **/
+UrfWatchdog *
+urf_watchdog_new (void)
+{
+	G_LOCK (urf_watchdog_object);
+	if (urf_watchdog_object != NULL) {
+		g_object_ref (urf_watchdog_object);
+	} else {
+		urf_watchdog_object = g_object_new (URF_TYPE_WATCHDOG, NULL);
+		g_object_add_weak_pointer (urf_watchdog_object, &urf_watchdog_object);
+	}
+	G_UNLOCK (urf_watchdog_object);
+
+	return URF_WATCHDOG (urf_watchdog_object);
+}
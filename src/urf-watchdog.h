@@ -0,0 +1,80 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __URF_WATCHDOG_H__
+#define __URF_WATCHDOG_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define URF_TYPE_WATCHDOG (urf_watchdog_get_type())
+#define URF_WATCHDOG(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj), \
+					URF_TYPE_WATCHDOG, UrfWatchdog))
+#define URF_WATCHDOG_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST((klass), \
+					URF_TYPE_WATCHDOG, UrfWatchdogClass))
+#define URF_IS_WATCHDOG(obj) (G_TYPE_CHECK_INSTANCE_TYPE((obj), \
+					URF_TYPE_WATCHDOG))
+#define URF_IS_WATCHDOG_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), \
+					URF_TYPE_WATCHDOG))
+#define URF_GET_WATCHDOG_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS((obj), \
+					URF_TYPE_WATCHDOG, UrfWatchdogClass))
+
+typedef struct UrfWatchdogPrivate UrfWatchdogPrivate;
+
+typedef struct {
+	GObject			 parent;
+	UrfWatchdogPrivate	*priv;
+} UrfWatchdog;
+
+typedef struct {
+        GObjectClass		 parent_class;
+} UrfWatchdogClass;
+
+/**
+ * urf_watchdog_end:
+ * @start: the value returned by urf_watchdog_begin()
+ * @what: a static string naming the blocking call
+ *
+ * Account the time since @start to the calling site.
+ **/
+#define urf_watchdog_end(start, what) \
+	urf_watchdog_account ((start), G_STRLOC, (what))
+
+GType			 urf_watchdog_get_type		(void);
+UrfWatchdog		*urf_watchdog_new		(void);
+
+gint64			 urf_watchdog_begin		(void);
+void			 urf_watchdog_account		(gint64		 start,
+							 const char	*site,
+							 const char	*what);
+
+void			 urf_watchdog_watch_main_loop	(UrfWatchdog	*watchdog);
+void			 urf_watchdog_get_main_loop_stats (UrfWatchdog	*watchdog,
+							 guint		*interval_ms,
+							 guint64	*ticks,
+							 guint64	*stalls,
+							 guint64	*max_latency,
+							 guint64	*total_latency);
+GVariant		*urf_watchdog_get_blocking_calls (UrfWatchdog	*watchdog);
+
+G_END_DECLS
+
+#endif /* __URF_WATCHDOG_H__ */
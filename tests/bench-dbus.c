@@ -0,0 +1,412 @@
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <urfkill.h>
+
+#include "daemon-harness.h"
+
+/*
+ * Starts a private dbus-daemon, a stub PolicyKit authority that allows
+ * everything and urfkilld with a simulated rfkill core, then drives the
+ * daemon through liburfkill-glib. One line of key=value pairs is printed
+ * per measurement, times are in nanoseconds:
+ *
+ *   test=call         Block from one client: time to the method reply
+ *                     and to the DeviceTypeChanged signal on the caller
+ *   test=fanout       one caller, K other clients watching: time from the
+ *                     call to each subscriber seeing the change, and to
+ *                     the last subscriber of a round
+ *   test=throughput   C clients, each keeping one Block call in flight
+ *                     on its own device: completed calls per second
+ */
+
+#define BENCH_DEVICES		16
+#define BENCH_ROUNDS		200
+#define BENCH_CALLS		200
+
+static const guint fanout_counts[] = { 1, 10, 50 };
+static const guint caller_counts[] = { 1, 4, 16 };
+
+typedef struct Round Round;
+
+typedef struct {
+	UrfClient	*client;
+	guint		 watch_id;
+	guint		 seen;
+	Round		*round;
+} Subscriber;
+
+struct Round {
+	guint		 number;
+	const char	*object_path;
+	gboolean	 block;
+	gint64		 start;
+	guint		 waiting;
+	gboolean	 replied;
+	GArray		*reply;
+	GArray		*change;
+	GArray		*last;
+};
+
+typedef struct {
+	UrfClient	*client;
+	guint		 index;
+	guint		 done;
+	gint64		 start;
+	GArray		*reply;
+} Caller;
+
+static GMainLoop *loop = NULL;
+static guint n_running = 0;
+
+static void caller_reply_cb (GObject *source_object, GAsyncResult *res, Caller *caller);
+
+static gint64
+bench_now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (gint64) ts.tv_sec * G_GINT64_CONSTANT (1000000000) + ts.tv_nsec;
+}
+
+static int
+compare_gint64 (gconstpointer a, gconstpointer b)
+{
+	gint64 x = *(const gint64 *) a;
+	gint64 y = *(const gint64 *) b;
+
+	return (x > y) - (x < y);
+}
+
+/* samples has to be sorted */
+static gint64
+percentile (GArray *samples, guint pct)
+{
+	guint i;
+
+	if (samples->len == 0)
+		return 0;
+	i = (guint) (((guint64) samples->len * pct + 99) / 100);
+	if (i > 0)
+		i--;
+	return g_array_index (samples, gint64, MIN (i, samples->len - 1));
+}
+
+static void
+print_percentiles (const char *prefix, GArray *samples)
+{
+	g_array_sort (samples, compare_gint64);
+	printf (" %s_p50_ns=%" G_GINT64_FORMAT
+		" %s_p90_ns=%" G_GINT64_FORMAT
+		" %s_p99_ns=%" G_GINT64_FORMAT
+		" %s_max_ns=%" G_GINT64_FORMAT,
+		prefix, percentile (samples, 50),
+		prefix, percentile (samples, 90),
+		prefix, percentile (samples, 99),
+		prefix, percentile (samples, 100));
+}
+
+static void
+round_check_done (Round *round)
+{
+	if (round->replied && round->waiting == 0)
+		g_main_loop_quit (loop);
+}
+
+static void
+round_reply_cb (GObject      *source_object,
+		GAsyncResult *res,
+		Round        *round)
+{
+	GError *error = NULL;
+	gint64 delta = bench_now () - round->start;
+
+	if (!urf_client_set_block_idx_finish (URF_CLIENT (source_object), res, &error)) {
+		fprintf (stderr, "Block failed: %s\n", error->message);
+		g_error_free (error);
+	}
+
+	g_array_append_val (round->reply, delta);
+	round->replied = TRUE;
+	round_check_done (round);
+}
+
+static void
+subscriber_changed_cb (UrfClient     *client,
+		       UrfDeviceType  type,
+		       const char    *object_path,
+		       gboolean       soft,
+		       gboolean       hard,
+		       guint          generation,
+		       Subscriber    *sub)
+{
+	Round *round = sub->round;
+	gint64 delta;
+
+	/* only the first report of this round's change counts */
+	if (round == NULL || sub->seen == round->number)
+		return;
+	if (g_strcmp0 (object_path, round->object_path) != 0 || soft != round->block)
+		return;
+
+	delta = bench_now () - round->start;
+	g_array_append_val (round->change, delta);
+	sub->seen = round->number;
+
+	if (--round->waiting == 0)
+		g_array_append_val (round->last, delta);
+	round_check_done (round);
+}
+
+/* with no subscribers the caller watches its own change */
+static void
+bench_fanout (const char *address, guint n_subs)
+{
+	UrfClient *caller;
+	UrfDevice *device;
+	Subscriber *subs;
+	GError *error = NULL;
+	Round round;
+	guint n_watchers = MAX (n_subs, 1);
+	guint index;
+	guint i;
+
+	caller = urf_client_new_for_address (address, NULL, &error);
+	if (caller == NULL) {
+		fprintf (stderr, "Couldn't create client: %s\n", error->message);
+		g_error_free (error);
+		return;
+	}
+
+	subs = g_new0 (Subscriber, n_watchers);
+	for (i = 0; i < n_watchers; i++) {
+		if (n_subs == 0)
+			subs[i].client = g_object_ref (caller);
+		else
+			subs[i].client = urf_client_new_for_address (address, NULL, NULL);
+		if (subs[i].client == NULL)
+			continue;
+		subs[i].watch_id = urf_client_watch_type (subs[i].client,
+							  URFDEVICE_TYPE_ALL,
+							  (UrfClientTypeFunc) subscriber_changed_cb,
+							  &subs[i], NULL);
+	}
+
+	memset (&round, 0, sizeof (round));
+	device = urf_client_get_device_by_index (caller, 0);
+	if (device == NULL) {
+		fprintf (stderr, "No simulated device\n");
+		goto out;
+	}
+	g_object_get (device, "index", &index, NULL);
+	round.object_path = urf_device_get_object_path (device);
+	round.reply = g_array_new (FALSE, FALSE, sizeof (gint64));
+	round.change = g_array_new (FALSE, FALSE, sizeof (gint64));
+	round.last = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+	for (i = 0; i < n_watchers; i++)
+		subs[i].round = &round;
+
+	/* the simulated devices start unblocked, every round flips the state */
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		round.number = i + 1;
+		round.block = (i % 2 == 0);
+		round.waiting = n_watchers;
+		round.replied = FALSE;
+		round.start = bench_now ();
+		urf_client_set_block_idx_async (caller, index, round.block, NULL,
+						(GAsyncReadyCallback) round_reply_cb,
+						&round);
+		g_main_loop_run (loop);
+	}
+
+	if (n_subs == 0) {
+		printf ("test=call rounds=%u", BENCH_ROUNDS);
+		print_percentiles ("reply", round.reply);
+		print_percentiles ("signal", round.change);
+	} else {
+		printf ("test=fanout subscribers=%u rounds=%u", n_subs, BENCH_ROUNDS);
+		print_percentiles ("reply", round.reply);
+		print_percentiles ("signal", round.change);
+		print_percentiles ("last", round.last);
+	}
+	printf ("\n");
+	fflush (stdout);
+
+	g_array_free (round.reply, TRUE);
+	g_array_free (round.change, TRUE);
+	g_array_free (round.last, TRUE);
+out:
+	for (i = 0; i < n_watchers; i++) {
+		if (subs[i].client == NULL)
+			continue;
+		urf_client_unwatch_type (subs[i].client, subs[i].watch_id);
+		g_object_unref (subs[i].client);
+	}
+	g_free (subs);
+	g_object_unref (caller);
+}
+
+static void
+caller_next (Caller *caller)
+{
+	caller->start = bench_now ();
+	urf_client_set_block_idx_async (caller->client, caller->index,
+					caller->done % 2 == 0, NULL,
+					(GAsyncReadyCallback) caller_reply_cb,
+					caller);
+}
+
+static void
+caller_reply_cb (GObject      *source_object,
+		 GAsyncResult *res,
+		 Caller       *caller)
+{
+	GError *error = NULL;
+	gint64 delta = bench_now () - caller->start;
+
+	if (!urf_client_set_block_idx_finish (caller->client, res, &error)) {
+		fprintf (stderr, "Block failed: %s\n", error->message);
+		g_error_free (error);
+	}
+	g_array_append_val (caller->reply, delta);
+
+	if (++caller->done < BENCH_CALLS) {
+		caller_next (caller);
+		return;
+	}
+
+	if (--n_running == 0)
+		g_main_loop_quit (loop);
+}
+
+static void
+bench_throughput (const char *address, guint n_callers)
+{
+	Caller *callers;
+	GArray *reply;
+	UrfDevice *device;
+	gint64 start, elapsed;
+	guint i;
+
+	callers = g_new0 (Caller, n_callers);
+	reply = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+	for (i = 0; i < n_callers; i++) {
+		callers[i].client = urf_client_new_for_address (address, NULL, NULL);
+		if (callers[i].client == NULL)
+			goto out;
+		device = urf_client_get_device_by_index (callers[i].client, i % BENCH_DEVICES);
+		if (device == NULL)
+			goto out;
+		g_object_get (device, "index", &callers[i].index, NULL);
+		callers[i].reply = reply;
+	}
+
+	n_running = n_callers;
+	start = bench_now ();
+	for (i = 0; i < n_callers; i++)
+		caller_next (&callers[i]);
+	g_main_loop_run (loop);
+	elapsed = bench_now () - start;
+
+	printf ("test=throughput callers=%u calls=%u calls_sec=%.0f",
+		n_callers, reply->len, reply->len / (elapsed / 1e9));
+	print_percentiles ("reply", reply);
+	printf ("\n");
+	fflush (stdout);
+out:
+	for (i = 0; i < n_callers; i++) {
+		if (callers[i].client != NULL)
+			g_object_unref (callers[i].client);
+	}
+	g_array_free (reply, TRUE);
+	g_free (callers);
+}
+
+int
+main (int argc, char **argv)
+{
+	GDBusConnection *connection = NULL;
+	GMainLoop *polkit_loop = NULL;
+	GError *error = NULL;
+	char *address = NULL;
+	char *config_file = NULL;
+	char *runtime_dir = NULL;
+	char *backend = NULL;
+	GPid bus_pid = 0;
+	GPid daemon_pid = 0;
+	guint i;
+	int retval = 1;
+
+	g_type_init ();
+	loop = g_main_loop_new (NULL, FALSE);
+
+	address = harness_bus_start (BENCH_DBUS_CONF, &bus_pid, &error);
+	if (address == NULL) {
+		fprintf (stderr, "Couldn't start dbus-daemon: %s\n",
+			 error ? error->message : "no address");
+		goto out;
+	}
+
+	connection = harness_polkit_start (address, &polkit_loop, &error);
+	if (connection == NULL) {
+		fprintf (stderr, "Couldn't start the stub authority: %s\n", error->message);
+		goto out;
+	}
+
+	config_file = harness_write_config (&error);
+	if (config_file == NULL) {
+		fprintf (stderr, "Couldn't write the config: %s\n", error->message);
+		goto out;
+	}
+
+	runtime_dir = harness_runtime_dir_new (&error);
+	if (runtime_dir == NULL) {
+		fprintf (stderr, "Couldn't create the runtime directory: %s\n", error->message);
+		goto out;
+	}
+
+	backend = g_strdup_printf ("sim:%u", BENCH_DEVICES);
+	if (!harness_daemon_start (connection, BENCH_URFKILLD, address, config_file,
+				   runtime_dir, backend, &daemon_pid, &error)) {
+		fprintf (stderr, "Couldn't start urfkilld: %s\n", error->message);
+		goto out;
+	}
+
+	bench_fanout (address, 0);
+	for (i = 0; i < G_N_ELEMENTS (fanout_counts); i++)
+		bench_fanout (address, fanout_counts[i]);
+	for (i = 0; i < G_N_ELEMENTS (caller_counts); i++)
+		bench_throughput (address, caller_counts[i]);
+
+	retval = 0;
+out:
+	if (error != NULL)
+		g_error_free (error);
+	if (daemon_pid > 0)
+		harness_daemon_stop (connection, daemon_pid);
+	if (connection != NULL)
+		g_object_unref (connection);
+	if (bus_pid > 0)
+		kill (bus_pid, SIGTERM);
+	if (config_file != NULL) {
+		g_unlink (config_file);
+		g_free (config_file);
+	}
+	if (runtime_dir != NULL) {
+		harness_runtime_dir_remove (runtime_dir);
+		g_free (runtime_dir);
+	}
+	g_free (backend);
+	g_free (address);
+	g_main_loop_unref (loop);
+	return retval;
+}
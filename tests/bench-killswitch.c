@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <glib.h>
+#include <glib-object.h>
+#include <linux/rfkill.h>
+
+#include "urf-config.h"
+#include "urf-killswitch.h"
+
+/*
+ * Drives UrfKillswitch from the simulated rfkill core and prints one
+ * line of key=value pairs per device count:
+ *
+ *   devices      number of simulated devices
+ *   rounds       number of block/unblock rounds
+ *   events       rfkill change events processed
+ *   events_sec   events processed per second, write included
+ *   p50_ns ...   time between consecutive device-changed emissions;
+ *                the first event of a round is timed from the return
+ *                of the write
+ *   allocs_event g_malloc/g_realloc/g_new0 calls per event; g_slice
+ *                is forced onto malloc so it is counted too
+ *   signals_event killswitch signal emissions per event
+ */
+
+static const guint device_counts[] = { 1, 10, 100, 1000 };
+
+#define BENCH_MIN_ROUNDS	20
+#define BENCH_MIN_EVENTS	20000
+
+typedef struct {
+	guint64		 n_signals;
+	gint64		 last;
+	GArray		*samples;
+} Bench;
+
+static volatile guint64 n_allocs = 0;
+
+static gpointer
+bench_malloc (gsize n_bytes)
+{
+	n_allocs++;
+	return malloc (n_bytes);
+}
+
+static gpointer
+bench_realloc (gpointer mem, gsize n_bytes)
+{
+	n_allocs++;
+	return realloc (mem, n_bytes);
+}
+
+static gpointer
+bench_calloc (gsize n_blocks, gsize n_block_bytes)
+{
+	n_allocs++;
+	return calloc (n_blocks, n_block_bytes);
+}
+
+static GMemVTable bench_vtable = {
+	bench_malloc,
+	bench_realloc,
+	free,
+	bench_calloc,
+	NULL,
+	NULL,
+};
+
+static gint64
+bench_now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (gint64) ts.tv_sec * G_GINT64_CONSTANT (1000000000) + ts.tv_nsec;
+}
+
+static void
+bench_log_handler (const gchar    *log_domain,
+		   GLogLevelFlags  log_level,
+		   const gchar    *message,
+		   gpointer        user_data)
+{
+	/* the simulated devices have no udev node and the state file is
+	 * usually not writable, keep stdout machine-readable */
+}
+
+static void
+device_changed_cb (UrfKillswitch *killswitch,
+		   const char    *object_path,
+		   Bench         *bench)
+{
+	gint64 now = bench_now ();
+	gint64 delta = now - bench->last;
+
+	g_array_append_val (bench->samples, delta);
+	bench->last = now;
+	bench->n_signals++;
+}
+
+static void
+device_added_removed_cb (UrfKillswitch *killswitch,
+			 const char    *object_path,
+			 Bench         *bench)
+{
+	bench->n_signals++;
+}
+
+static int
+compare_gint64 (gconstpointer a, gconstpointer b)
+{
+	gint64 x = *(const gint64 *) a;
+	gint64 y = *(const gint64 *) b;
+
+	return (x > y) - (x < y);
+}
+
+static gint64
+percentile (GArray *samples, guint pct)
+{
+	guint i;
+
+	if (samples->len == 0)
+		return 0;
+	i = (guint) (((guint64) samples->len * pct + 99) / 100);
+	if (i > 0)
+		i--;
+	return g_array_index (samples, gint64, MIN (i, samples->len - 1));
+}
+
+static gboolean
+bench_run (UrfConfig *config, guint n_devices)
+{
+	UrfKillswitch *killswitch;
+	Bench bench;
+	char *spec;
+	guint rounds, round, expected;
+	guint64 allocs = 0;
+	guint64 before;
+	gint64 elapsed = 0;
+	gint64 start;
+	gboolean ret = FALSE;
+
+	memset (&bench, 0, sizeof (bench));
+	rounds = MAX (BENCH_MIN_ROUNDS, BENCH_MIN_EVENTS / n_devices);
+	bench.samples = g_array_sized_new (FALSE, FALSE, sizeof (gint64),
+					   rounds * n_devices);
+
+	spec = g_strdup_printf ("sim:%u", n_devices);
+	urf_config_set_rfkill_backend (config, spec);
+	g_free (spec);
+
+	killswitch = urf_killswitch_new ();
+	if (!urf_killswitch_startup (killswitch, config)) {
+		fprintf (stderr, "failed to start the killswitch with %u devices\n",
+			 n_devices);
+		goto out;
+	}
+
+	g_signal_connect (killswitch, "device-added",
+			  G_CALLBACK (device_added_removed_cb), &bench);
+	g_signal_connect (killswitch, "device-removed",
+			  G_CALLBACK (device_added_removed_cb), &bench);
+	g_signal_connect (killswitch, "device-changed",
+			  G_CALLBACK (device_changed_cb), &bench);
+
+	/* the simulated devices start unblocked, so every round flips all of them */
+	for (round = 0; round < rounds; round++) {
+		expected = (round + 1) * n_devices;
+
+		before = n_allocs;
+		start = bench_now ();
+		urf_killswitch_set_block (killswitch, RFKILL_TYPE_ALL, round % 2 == 0);
+		bench.last = bench_now ();
+
+		while (bench.samples->len < expected)
+			g_main_context_iteration (NULL, TRUE);
+
+		elapsed += bench_now () - start;
+		allocs += n_allocs - before;
+	}
+
+	g_array_sort (bench.samples, compare_gint64);
+
+	printf ("devices=%u rounds=%u events=%u events_sec=%.0f "
+		"p50_ns=%" G_GINT64_FORMAT " p90_ns=%" G_GINT64_FORMAT " "
+		"p99_ns=%" G_GINT64_FORMAT " max_ns=%" G_GINT64_FORMAT " "
+		"allocs_event=%.2f signals_event=%.2f\n",
+		n_devices, rounds, bench.samples->len,
+		bench.samples->len / (elapsed / 1e9),
+		percentile (bench.samples, 50),
+		percentile (bench.samples, 90),
+		percentile (bench.samples, 99),
+		percentile (bench.samples, 100),
+		(double) allocs / bench.samples->len,
+		(double) bench.n_signals / bench.samples->len);
+	fflush (stdout);
+
+	ret = TRUE;
+out:
+	g_object_unref (killswitch);
+	g_array_free (bench.samples, TRUE);
+	return ret;
+}
+
+int
+main (int argc, char **argv)
+{
+	UrfConfig *config;
+	guint i;
+	int retval = 0;
+
+	/* both have to happen before GLib allocates anything */
+	setenv ("G_SLICE", "always-malloc", 1);
+	g_mem_set_vtable (&bench_vtable);
+
+	g_type_init ();
+
+	g_log_set_handler ("URfkill",
+			   G_LOG_LEVEL_WARNING | G_LOG_LEVEL_MESSAGE |
+			   G_LOG_LEVEL_INFO | G_LOG_LEVEL_DEBUG,
+			   bench_log_handler, NULL);
+
+	config = urf_config_new ();
+
+	for (i = 0; i < G_N_ELEMENTS (device_counts); i++) {
+		if (!bench_run (config, device_counts[i])) {
+			retval = 1;
+			break;
+		}
+	}
+
+	g_object_unref (config);
+	return retval;
+}
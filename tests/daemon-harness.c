@@ -0,0 +1,394 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <signal.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "daemon-harness.h"
+
+#define HARNESS_TIMEOUT		10
+
+#define URFKILL_DBUS_NAME	"org.freedesktop.URfkill"
+#define POLKIT_DBUS_NAME	"org.freedesktop.PolicyKit1"
+#define POLKIT_OBJECT_PATH	"/org/freedesktop/PolicyKit1/Authority"
+
+static const char polkit_xml[] =
+	"<node>"
+	"  <interface name='org.freedesktop.PolicyKit1.Authority'>"
+	"    <method name='CheckAuthorization'>"
+	"      <arg type='(sa{sv})' name='subject' direction='in'/>"
+	"      <arg type='s' name='action_id' direction='in'/>"
+	"      <arg type='a{ss}' name='details' direction='in'/>"
+	"      <arg type='u' name='flags' direction='in'/>"
+	"      <arg type='s' name='cancellation_id' direction='in'/>"
+	"      <arg type='(bba{ss})' name='result' direction='out'/>"
+	"    </method>"
+	"    <property type='s' name='BackendName' access='read'/>"
+	"    <property type='s' name='BackendVersion' access='read'/>"
+	"    <property type='u' name='BackendFeatures' access='read'/>"
+	"    <signal name='Changed'/>"
+	"  </interface>"
+	"</node>";
+
+typedef struct {
+	GMainLoop	*loop;
+	gboolean	 owned;
+} NameWait;
+
+static void
+polkit_method_call_cb (GDBusConnection       *connection,
+		       const gchar           *sender,
+		       const gchar           *object_path,
+		       const gchar           *interface_name,
+		       const gchar           *method_name,
+		       GVariant              *parameters,
+		       GDBusMethodInvocation *invocation,
+		       gpointer               user_data)
+{
+	GVariantBuilder details;
+
+	if (g_strcmp0 (method_name, "CheckAuthorization") != 0) {
+		g_dbus_method_invocation_return_dbus_error (invocation,
+							    "org.freedesktop.PolicyKit1.Error.NotSupported",
+							    "Not supported by the stub authority");
+		return;
+	}
+
+	/* authorized, no challenge */
+	g_variant_builder_init (&details, G_VARIANT_TYPE ("a{ss}"));
+	g_dbus_method_invocation_return_value (invocation,
+					       g_variant_new ("((bba{ss}))",
+							      TRUE, FALSE, &details));
+}
+
+static GVariant *
+polkit_get_property_cb (GDBusConnection  *connection,
+			const gchar      *sender,
+			const gchar      *object_path,
+			const gchar      *interface_name,
+			const gchar      *property_name,
+			GError          **error,
+			gpointer          user_data)
+{
+	if (g_strcmp0 (property_name, "BackendFeatures") == 0)
+		return g_variant_new_uint32 (0);
+	if (g_strcmp0 (property_name, "BackendName") == 0)
+		return g_variant_new_string ("urfkill-test-stub");
+	return g_variant_new_string ("0");
+}
+
+static const GDBusInterfaceVTable polkit_vtable = {
+	polkit_method_call_cb,
+	polkit_get_property_cb,
+	NULL
+};
+
+static gpointer
+polkit_thread_func (GMainLoop *polkit_loop)
+{
+	g_main_loop_run (polkit_loop);
+	return NULL;
+}
+
+/* the authority answers from its own thread, the daemon checks
+ * authorizations synchronously while the caller may be blocked */
+GDBusConnection *
+harness_polkit_start (const char *address, GMainLoop **polkit_loop, GError **error)
+{
+	GDBusConnection *connection;
+	GDBusNodeInfo *info = NULL;
+	GMainContext *context;
+	GVariant *reply;
+	guint id;
+
+	connection = g_dbus_connection_new_for_address_sync (address,
+							     G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+							     G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+							     NULL, NULL, error);
+	if (connection == NULL)
+		goto out;
+
+	info = g_dbus_node_info_new_for_xml (polkit_xml, error);
+	if (info == NULL)
+		goto fail;
+
+	/* method calls are dispatched in the thread-default context */
+	context = g_main_context_new ();
+	g_main_context_push_thread_default (context);
+	id = g_dbus_connection_register_object (connection, POLKIT_OBJECT_PATH,
+						info->interfaces[0], &polkit_vtable,
+						NULL, NULL, error);
+	g_main_context_pop_thread_default (context);
+	if (id == 0) {
+		g_main_context_unref (context);
+		goto fail;
+	}
+
+	*polkit_loop = g_main_loop_new (context, FALSE);
+	g_main_context_unref (context);
+	g_thread_new ("polkit-stub", (GThreadFunc) polkit_thread_func, *polkit_loop);
+
+	reply = g_dbus_connection_call_sync (connection,
+					     "org.freedesktop.DBus",
+					     "/org/freedesktop/DBus",
+					     "org.freedesktop.DBus",
+					     "RequestName",
+					     g_variant_new ("(su)", POLKIT_DBUS_NAME, 0),
+					     G_VARIANT_TYPE ("(u)"),
+					     G_DBUS_CALL_FLAGS_NONE,
+					     -1, NULL, error);
+	if (reply == NULL)
+		goto fail;
+	g_variant_unref (reply);
+	goto out;
+fail:
+	g_object_unref (connection);
+	connection = NULL;
+out:
+	if (info != NULL)
+		g_dbus_node_info_unref (info);
+	return connection;
+}
+
+/**
+ * harness_bus_start:
+ *
+ * Return value: the address of the new bus
+ **/
+char *
+harness_bus_start (const char *dbus_config, GPid *pid, GError **error)
+{
+	GIOChannel *channel;
+	char *argv[5];
+	char *address = NULL;
+	int out_fd;
+
+	argv[0] = (char *) "dbus-daemon";
+	argv[1] = g_strdup_printf ("--config-file=%s", dbus_config);
+	argv[2] = (char *) "--nofork";
+	argv[3] = (char *) "--print-address=1";
+	argv[4] = NULL;
+
+	if (!g_spawn_async_with_pipes (NULL, argv, NULL, G_SPAWN_SEARCH_PATH,
+				       NULL, NULL, pid, NULL, &out_fd, NULL, error))
+		goto out;
+
+	channel = g_io_channel_unix_new (out_fd);
+	g_io_channel_set_close_on_unref (channel, TRUE);
+	if (g_io_channel_read_line (channel, &address, NULL, NULL, error) != G_IO_STATUS_NORMAL) {
+		kill (*pid, SIGTERM);
+		address = NULL;
+	} else {
+		g_strchomp (address);
+	}
+	g_io_channel_unref (channel);
+out:
+	g_free (argv[1]);
+	return address;
+}
+
+/**
+ * harness_write_config:
+ *
+ * Return value: a temporary urfkill.conf without key control, so the
+ * daemon needs no input devices and no session tracking
+ **/
+char *
+harness_write_config (GError **error)
+{
+	char *config_file = NULL;
+	int fd;
+
+	fd = g_file_open_tmp ("urfkill-test-XXXXXX.conf", &config_file, error);
+	if (fd < 0)
+		return NULL;
+	close (fd);
+
+	if (!g_file_set_contents (config_file, "[general]\nkey_control=false\n", -1, error)) {
+		g_unlink (config_file);
+		g_free (config_file);
+		return NULL;
+	}
+
+	return config_file;
+}
+
+/**
+ * harness_runtime_dir_new:
+ *
+ * Return value: a temporary directory for the state file and the peer
+ * socket of the daemon, so it leaves those of the system daemon alone
+ **/
+char *
+harness_runtime_dir_new (GError **error)
+{
+	return g_dir_make_tmp ("urfkill-test-XXXXXX", error);
+}
+
+/**
+ * harness_runtime_dir_remove:
+ *
+ * Remove the directory and whatever the daemon left in it.
+ **/
+void
+harness_runtime_dir_remove (const char *runtime_dir)
+{
+	GDir *dir;
+	const char *name;
+	char *path;
+
+	dir = g_dir_open (runtime_dir, 0, NULL);
+	if (dir != NULL) {
+		while ((name = g_dir_read_name (dir)) != NULL) {
+			path = g_build_filename (runtime_dir, name, NULL);
+			g_unlink (path);
+			g_free (path);
+		}
+		g_dir_close (dir);
+	}
+	g_rmdir (runtime_dir);
+}
+
+static void
+name_appeared_cb (GDBusConnection *connection,
+		  const gchar     *name,
+		  const gchar     *name_owner,
+		  NameWait        *wait)
+{
+	if (wait->owned)
+		return;
+	wait->owned = TRUE;
+	g_main_loop_quit (wait->loop);
+}
+
+static void
+name_vanished_cb (GDBusConnection *connection,
+		  const gchar     *name,
+		  NameWait        *wait)
+{
+	if (!wait->owned)
+		return;
+	wait->owned = FALSE;
+	g_main_loop_quit (wait->loop);
+}
+
+static gboolean
+name_timeout_cb (GMainLoop *loop)
+{
+	g_main_loop_quit (loop);
+	return FALSE;
+}
+
+/**
+ * harness_wait_for_name:
+ *
+ * Return value: %TRUE if the daemon owns its name or not, as @owned
+ **/
+static gboolean
+harness_wait_for_name (GDBusConnection *connection,
+		       gboolean         owned)
+{
+	NameWait wait;
+	guint watch_id, timeout_id;
+
+	wait.loop = g_main_loop_new (NULL, FALSE);
+	wait.owned = !owned;
+
+	watch_id = g_bus_watch_name_on_connection (connection, URFKILL_DBUS_NAME,
+						   G_BUS_NAME_WATCHER_FLAGS_NONE,
+						   (GBusNameAppearedCallback) name_appeared_cb,
+						   (GBusNameVanishedCallback) name_vanished_cb,
+						   &wait, NULL);
+	timeout_id = g_timeout_add_seconds (HARNESS_TIMEOUT,
+					    (GSourceFunc) name_timeout_cb, wait.loop);
+	g_main_loop_run (wait.loop);
+	g_bus_unwatch_name (watch_id);
+	if (wait.owned == owned)
+		g_source_remove (timeout_id);
+	g_main_loop_unref (wait.loop);
+
+	return wait.owned == owned;
+}
+
+/**
+ * harness_daemon_start:
+ * @urfkilld: the daemon to run, $URFKILLD overrides it
+ * @runtime_dir: the --runtime-dir of the daemon
+ * @rfkill_backend: the --rfkill-backend of the daemon
+ *
+ * Start urfkilld and wait until it owns its name on the bus.
+ **/
+gboolean
+harness_daemon_start (GDBusConnection *connection,
+		      const char      *urfkilld,
+		      const char      *address,
+		      const char      *config_file,
+		      const char      *runtime_dir,
+		      const char      *rfkill_backend,
+		      GPid            *pid,
+		      GError         **error)
+{
+	char *backend;
+	char *argv[9];
+	gboolean ret;
+
+	backend = g_strdup_printf ("--rfkill-backend=%s", rfkill_backend);
+	argv[0] = (char *) (g_getenv ("URFKILLD") ? g_getenv ("URFKILLD") : urfkilld);
+	argv[1] = (char *) "--bus-address";
+	argv[2] = (char *) address;
+	argv[3] = backend;
+	argv[4] = (char *) "--config";
+	argv[5] = (char *) config_file;
+	argv[6] = (char *) "--runtime-dir";
+	argv[7] = (char *) runtime_dir;
+	argv[8] = NULL;
+
+	ret = g_spawn_async (NULL, argv, NULL, G_SPAWN_STDOUT_TO_DEV_NULL |
+			     G_SPAWN_STDERR_TO_DEV_NULL, NULL, NULL, pid, error);
+	g_free (backend);
+	if (!ret)
+		return FALSE;
+
+	if (!harness_wait_for_name (connection, TRUE)) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+			     "urfkilld did not show up on the bus");
+		kill (*pid, SIGTERM);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * harness_daemon_stop:
+ *
+ * Stop urfkilld and wait until its name is free for the next one.
+ **/
+void
+harness_daemon_stop (GDBusConnection *connection,
+		     GPid             pid)
+{
+	kill (pid, SIGTERM);
+	if (!harness_wait_for_name (connection, FALSE))
+		g_warning ("urfkilld did not leave the bus");
+}
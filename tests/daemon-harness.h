@@ -0,0 +1,57 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __DAEMON_HARNESS_H__
+#define __DAEMON_HARNESS_H__
+
+#include <glib.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/*
+ * A private dbus-daemon, a stub PolicyKit authority that allows
+ * everything and urfkilld on a test rfkill backend, shared by the
+ * benchmarks and the client tests.
+ */
+
+char		*harness_bus_start		(const char	 *dbus_config,
+						 GPid		 *pid,
+						 GError		**error);
+GDBusConnection	*harness_polkit_start		(const char	 *address,
+						 GMainLoop	**polkit_loop,
+						 GError		**error);
+char		*harness_write_config		(GError		**error);
+char		*harness_runtime_dir_new	(GError		**error);
+void		 harness_runtime_dir_remove	(const char	 *runtime_dir);
+gboolean	 harness_daemon_start		(GDBusConnection *connection,
+						 const char	 *urfkilld,
+						 const char	 *address,
+						 const char	 *config_file,
+						 const char	 *runtime_dir,
+						 const char	 *rfkill_backend,
+						 GPid		 *pid,
+						 GError		**error);
+void		 harness_daemon_stop		(GDBusConnection *connection,
+						 GPid		  pid);
+
+G_END_DECLS
+
+#endif /* __DAEMON_HARNESS_H__ */
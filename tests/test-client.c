@@ -0,0 +1,777 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2012 Gary Ching-Pang Lin <glin@suse.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <urfkill.h>
+
+#include "src/urf-trace.h"
+
+#include "daemon-harness.h"
+
+/*
+ * Drives liburfkill-glib against urfkilld on a private bus, mostly with
+ * the simulated rfkill core: index 0 is WLAN, 1 bluetooth, 2 WWAN and 3
+ * GPS, all unblocked at the start. Hotplug comes from a replayed trace.
+ * Every test gets a fresh daemon, except /client/resync that owns the
+ * name of urfkilld by itself.
+ */
+
+#define TEST_DEVICES	4
+#define TEST_TIMEOUT	10
+
+#define URFKILL_DBUS_NAME	"org.freedesktop.URfkill"
+#define FAKE_DEVICE_PATH	"/org/freedesktop/URfkill/devices/0"
+
+static char *address = NULL;
+static char *config_file = NULL;
+static GDBusConnection *connection = NULL;
+
+typedef struct {
+	GPid		 daemon_pid;
+	UrfClient	*client;
+	char		*runtime_dir;
+	char		*trace_file;
+} Fixture;
+
+typedef struct {
+	guint		 n_done;
+	gboolean	 ret;
+	GError		*error;
+} Async;
+
+typedef struct {
+	gboolean	 soft;
+	gboolean	 hard;
+	guint		 generation;
+} FakeDevice;
+
+static const char fake_device_xml[] =
+	"<node>"
+	"  <interface name='org.freedesktop.URfkill.Device'>"
+	"    <property type='u' name='index' access='read'/>"
+	"    <property type='u' name='type' access='read'/>"
+	"    <property type='s' name='name' access='read'/>"
+	"    <property type='b' name='soft' access='read'/>"
+	"    <property type='b' name='hard' access='read'/>"
+	"    <property type='b' name='platform' access='read'/>"
+	"    <property type='u' name='generation' access='read'/>"
+	"    <signal name='Changed'/>"
+	"  </interface>"
+	"</node>";
+
+typedef struct {
+	guint		 n_calls;
+	guint		 n_freed;
+	UrfDeviceType	 type;
+	char		*object_path;
+	gboolean	 soft;
+} Watch;
+
+static gboolean
+timeout_cb (gpointer user_data)
+{
+	g_error ("timed out waiting for the daemon");
+	return FALSE;
+}
+
+/**
+ * wait_for:
+ *
+ * Run the main loop until @counter reaches @n
+ **/
+static void
+wait_for (const guint *counter, guint n)
+{
+	guint id;
+
+	id = g_timeout_add_seconds (TEST_TIMEOUT, timeout_cb, NULL);
+	while (*counter < n)
+		g_main_context_iteration (NULL, TRUE);
+	g_source_remove (id);
+}
+
+static guint
+get_generation (UrfDevice *device)
+{
+	guint generation;
+
+	g_object_get (device, "generation", &generation, NULL);
+	return generation;
+}
+
+/**
+ * wait_for_generation:
+ *
+ * Run the main loop until @device reaches @generation
+ **/
+static void
+wait_for_generation (UrfDevice *device, guint generation)
+{
+	guint id;
+
+	id = g_timeout_add_seconds (TEST_TIMEOUT, timeout_cb, NULL);
+	while (get_generation (device) < generation)
+		g_main_context_iteration (NULL, TRUE);
+	g_source_remove (id);
+}
+
+static gboolean
+get_soft (UrfDevice *device)
+{
+	gboolean soft;
+
+	g_object_get (device, "soft", &soft, NULL);
+	return soft;
+}
+
+static gboolean
+get_hard (UrfDevice *device)
+{
+	gboolean hard;
+
+	g_object_get (device, "hard", &hard, NULL);
+	return hard;
+}
+
+static void
+start_daemon (Fixture *f, const char *rfkill_backend)
+{
+	GError *error = NULL;
+
+	/* a fresh directory, the previous daemon may still be going away */
+	f->runtime_dir = harness_runtime_dir_new (&error);
+	g_assert_no_error (error);
+
+	g_assert (harness_daemon_start (connection, URFKILLD, address, config_file,
+					f->runtime_dir, rfkill_backend,
+					&f->daemon_pid, &error));
+	g_assert_no_error (error);
+
+	f->client = urf_client_new_for_address (address, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (f->client != NULL);
+}
+
+static void
+fixture_setup_sim (Fixture *f, gconstpointer data)
+{
+	char *backend = g_strdup_printf ("sim:%u", TEST_DEVICES);
+
+	start_daemon (f, backend);
+	g_free (backend);
+}
+
+static void
+add_record (GByteArray *trace,
+	    gint64      timestamp,
+	    guint32     type,
+	    guint       index,
+	    guint       rfkill_type,
+	    guint       op)
+{
+	UrfTraceRecord record;
+
+	memset (&record, 0, sizeof (record));
+	record.timestamp = timestamp;
+	record.type = type;
+	record.event.idx = index;
+	record.event.type = rfkill_type;
+	record.event.op = op;
+	g_byte_array_append (trace, (const guint8 *) &record, sizeof (record));
+}
+
+/*
+ * WLAN 0, bluetooth 1 and WWAN 2 are there from the start. Two seconds
+ * later, enough for the client to connect, 1 and 0 are replaced by 3
+ * and 4 in turn.
+ */
+static void
+fixture_setup_replay (Fixture *f, gconstpointer data)
+{
+	UrfTraceHeader header;
+	GByteArray *trace;
+	GError *error = NULL;
+	char *backend;
+	gint64 start;
+	int fd;
+
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, URF_TRACE_MAGIC, sizeof (header.magic));
+	header.version = URF_TRACE_VERSION;
+	header.byte_order = URF_TRACE_BYTE_ORDER;
+	header.header_size = sizeof (UrfTraceHeader);
+	header.record_size = sizeof (UrfTraceRecord);
+	header.created = g_get_real_time ();
+
+	trace = g_byte_array_new ();
+	g_byte_array_append (trace, (const guint8 *) &header, sizeof (header));
+
+	start = header.created;
+	add_record (trace, start, URF_TRACE_RECORD_RFKILL_EVENT, 0, RFKILL_TYPE_WLAN, RFKILL_OP_ADD);
+	add_record (trace, start, URF_TRACE_RECORD_RFKILL_EVENT, 1, RFKILL_TYPE_BLUETOOTH, RFKILL_OP_ADD);
+	add_record (trace, start, URF_TRACE_RECORD_RFKILL_EVENT, 2, RFKILL_TYPE_WWAN, RFKILL_OP_ADD);
+
+	/* the replay clock starts at the first record after the devices */
+	add_record (trace, start, URF_TRACE_RECORD_RFKILL_WRITE, 0, RFKILL_TYPE_WLAN, RFKILL_OP_CHANGE);
+	add_record (trace, start + 2000000, URF_TRACE_RECORD_RFKILL_EVENT, 1, RFKILL_TYPE_BLUETOOTH, RFKILL_OP_DEL);
+	add_record (trace, start + 2200000, URF_TRACE_RECORD_RFKILL_EVENT, 3, RFKILL_TYPE_BLUETOOTH, RFKILL_OP_ADD);
+	add_record (trace, start + 2400000, URF_TRACE_RECORD_RFKILL_EVENT, 0, RFKILL_TYPE_WLAN, RFKILL_OP_DEL);
+	add_record (trace, start + 2600000, URF_TRACE_RECORD_RFKILL_EVENT, 4, RFKILL_TYPE_WLAN, RFKILL_OP_ADD);
+
+	fd = g_file_open_tmp ("urfkill-test-XXXXXX.trace", &f->trace_file, &error);
+	g_assert_no_error (error);
+	close (fd);
+	g_file_set_contents (f->trace_file, (const char *) trace->data, trace->len, &error);
+	g_assert_no_error (error);
+	g_byte_array_free (trace, TRUE);
+
+	backend = g_strdup_printf ("replay:%s:1", f->trace_file);
+	start_daemon (f, backend);
+	g_free (backend);
+}
+
+static void
+fixture_teardown (Fixture *f, gconstpointer data)
+{
+	if (f->client != NULL)
+		g_object_unref (f->client);
+	if (f->daemon_pid > 0)
+		harness_daemon_stop (connection, f->daemon_pid);
+	if (f->runtime_dir != NULL) {
+		harness_runtime_dir_remove (f->runtime_dir);
+		g_free (f->runtime_dir);
+	}
+	if (f->trace_file != NULL) {
+		g_unlink (f->trace_file);
+		g_free (f->trace_file);
+	}
+}
+
+static void
+block_idx (Fixture *f, guint index, gboolean block)
+{
+	GError *error = NULL;
+
+	g_assert (urf_client_set_block_idx (f->client, index, block, NULL, &error));
+	g_assert_no_error (error);
+}
+
+static void
+watch_changed_cb (UrfClient     *client,
+		  UrfDeviceType  type,
+		  const char    *object_path,
+		  gboolean       soft,
+		  gboolean       hard,
+		  guint          generation,
+		  Watch         *watch)
+{
+	watch->n_calls++;
+	watch->type = type;
+	watch->soft = soft;
+	g_free (watch->object_path);
+	watch->object_path = g_strdup (object_path);
+}
+
+static void
+watch_freed_cb (Watch *watch)
+{
+	watch->n_freed++;
+}
+
+static void
+test_watch_type (Fixture *f, gconstpointer data)
+{
+	Watch wlan, all;
+	UrfDevice *device;
+	guint wlan_id, all_id;
+
+	memset (&wlan, 0, sizeof (wlan));
+	memset (&all, 0, sizeof (all));
+	wlan_id = urf_client_watch_type (f->client, URFDEVICE_TYPE_WLAN,
+					 (UrfClientTypeFunc) watch_changed_cb,
+					 &wlan, (GDestroyNotify) watch_freed_cb);
+	all_id = urf_client_watch_type (f->client, URFDEVICE_TYPE_ALL,
+					(UrfClientTypeFunc) watch_changed_cb,
+					&all, (GDestroyNotify) watch_freed_cb);
+	g_assert_cmpuint (wlan_id, !=, 0);
+	g_assert_cmpuint (all_id, !=, 0);
+
+	/* bluetooth, so only the catch-all watch sees it */
+	block_idx (f, 1, TRUE);
+	wait_for (&all.n_calls, 1);
+	g_assert_cmpint (all.type, ==, URFDEVICE_TYPE_BLUETOOTH);
+	g_assert_cmpuint (wlan.n_calls, ==, 0);
+
+	/* WLAN, both see it */
+	block_idx (f, 0, TRUE);
+	wait_for (&all.n_calls, 2);
+	wait_for (&wlan.n_calls, 1);
+	device = urf_client_get_device_by_index (f->client, 0);
+	g_assert_cmpint (wlan.type, ==, URFDEVICE_TYPE_WLAN);
+	g_assert_cmpstr (wlan.object_path, ==, urf_device_get_object_path (device));
+	g_assert (wlan.soft);
+
+	/* the user data goes with the subscription */
+	urf_client_unwatch_type (f->client, wlan_id);
+	wait_for (&wlan.n_freed, 1);
+
+	/* and no more calls after it */
+	block_idx (f, 0, FALSE);
+	wait_for (&all.n_calls, 3);
+	g_assert_cmpint (all.type, ==, URFDEVICE_TYPE_WLAN);
+	g_assert (!all.soft);
+	g_assert_cmpuint (wlan.n_calls, ==, 1);
+
+	urf_client_unwatch_type (f->client, all_id);
+	g_free (wlan.object_path);
+	g_free (all.object_path);
+}
+
+static void
+test_generation (Fixture *f, gconstpointer data)
+{
+	UrfDevice *wlan, *bluetooth;
+	guint generation;
+
+	wlan = urf_client_get_device_by_index (f->client, 0);
+	bluetooth = urf_client_get_device_by_index (f->client, 1);
+	g_assert (wlan != NULL);
+	g_assert (bluetooth != NULL);
+	generation = get_generation (wlan);
+
+	block_idx (f, 0, TRUE);
+	wait_for_generation (wlan, generation + 1);
+	g_assert (get_soft (wlan));
+
+	/* no change, no new generation; the daemon is in order, so once
+	 * the other device changed, a bump of this one would be here */
+	block_idx (f, 0, TRUE);
+	block_idx (f, 1, TRUE);
+	wait_for_generation (bluetooth, get_generation (bluetooth) + 1);
+	g_assert_cmpuint (get_generation (wlan), ==, generation + 1);
+
+	block_idx (f, 0, FALSE);
+	wait_for_generation (wlan, generation + 2);
+	g_assert_cmpuint (get_generation (wlan), ==, generation + 2);
+	g_assert (!get_soft (wlan));
+}
+
+static void
+block_idx_cb (UrfClient    *client,
+	      GAsyncResult *res,
+	      Async        *async)
+{
+	async->ret = urf_client_set_block_idx_finish (client, res, &async->error);
+	async->n_done++;
+}
+
+static void
+block_idx_multiple_cb (UrfClient    *client,
+		       GAsyncResult *res,
+		       Async        *async)
+{
+	async->ret = urf_client_set_block_idx_multiple_finish (client, res, &async->error);
+	async->n_done++;
+}
+
+static void
+test_async_block (Fixture *f, gconstpointer data)
+{
+	UrfDevice *wlan;
+	Async async;
+	guint generation;
+
+	wlan = urf_client_get_device_by_index (f->client, 0);
+	generation = get_generation (wlan);
+
+	memset (&async, 0, sizeof (async));
+	urf_client_set_block_idx_async (f->client, 0, TRUE, NULL,
+					(GAsyncReadyCallback) block_idx_cb, &async);
+	wait_for (&async.n_done, 1);
+	g_assert_no_error (async.error);
+	g_assert (async.ret);
+
+	wait_for_generation (wlan, generation + 1);
+	g_assert (get_soft (wlan));
+}
+
+static void
+test_async_cancel (Fixture *f, gconstpointer data)
+{
+	GCancellable *cancellable;
+	Async async;
+
+	cancellable = g_cancellable_new ();
+	memset (&async, 0, sizeof (async));
+	urf_client_set_block_idx_async (f->client, 0, TRUE, cancellable,
+					(GAsyncReadyCallback) block_idx_cb, &async);
+	g_cancellable_cancel (cancellable);
+	wait_for (&async.n_done, 1);
+	g_assert_error (async.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	g_assert (!async.ret);
+	g_clear_error (&async.error);
+	g_object_unref (cancellable);
+
+	/* the client is still usable */
+	memset (&async, 0, sizeof (async));
+	urf_client_set_block_idx_async (f->client, 1, TRUE, NULL,
+					(GAsyncReadyCallback) block_idx_cb, &async);
+	wait_for (&async.n_done, 1);
+	g_assert_no_error (async.error);
+	g_assert (async.ret);
+}
+
+static void
+test_async_multiple (Fixture *f, gconstpointer data)
+{
+	const guint indices[] = { 0, 1, 2 };
+	const guint with_unknown[] = { 3, 42 };
+	guint generations[G_N_ELEMENTS (indices)];
+	UrfDevice *device;
+	Async async;
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (indices); i++)
+		generations[i] = get_generation (urf_client_get_device_by_index (f->client, indices[i]));
+
+	memset (&async, 0, sizeof (async));
+	urf_client_set_block_idx_multiple_async (f->client, indices, G_N_ELEMENTS (indices),
+						 TRUE, NULL,
+						 (GAsyncReadyCallback) block_idx_multiple_cb,
+						 &async);
+	wait_for (&async.n_done, 1);
+	g_assert_no_error (async.error);
+	g_assert (async.ret);
+
+	for (i = 0; i < G_N_ELEMENTS (indices); i++) {
+		device = urf_client_get_device_by_index (f->client, indices[i]);
+		wait_for_generation (device, generations[i] + 1);
+		g_assert (get_soft (device));
+	}
+
+	/* one unknown index fails the batch, without an error */
+	memset (&async, 0, sizeof (async));
+	urf_client_set_block_idx_multiple_async (f->client, with_unknown,
+						 G_N_ELEMENTS (with_unknown),
+						 TRUE, NULL,
+						 (GAsyncReadyCallback) block_idx_multiple_cb,
+						 &async);
+	wait_for (&async.n_done, 1);
+	g_assert_no_error (async.error);
+	g_assert (!async.ret);
+}
+
+static guint
+get_index (UrfDevice *device)
+{
+	guint index;
+
+	g_object_get (device, "index", &index, NULL);
+	return index;
+}
+
+/**
+ * check_lookups:
+ *
+ * The list and both lookups have to agree on every device
+ **/
+static void
+check_lookups (UrfClient *client)
+{
+	UrfDevice *device;
+	GList *item;
+
+	for (item = urf_client_get_devices (client); item; item = item->next) {
+		device = item->data;
+		g_assert (urf_client_get_device_by_path (client, urf_device_get_object_path (device)) == device);
+		g_assert (urf_client_get_device_by_index (client, get_index (device)) == device);
+	}
+}
+
+static void
+device_added_cb (UrfClient *client,
+		 UrfDevice *device,
+		 guint     *n_added)
+{
+	(*n_added)++;
+	g_assert (g_list_find (urf_client_get_devices (client), device) != NULL);
+	check_lookups (client);
+}
+
+static void
+device_removed_cb (UrfClient *client,
+		   UrfDevice *device,
+		   guint     *n_removed)
+{
+	(*n_removed)++;
+	g_assert (g_list_find (urf_client_get_devices (client), device) == NULL);
+	g_assert (urf_client_get_device_by_path (client, urf_device_get_object_path (device)) == NULL);
+	g_assert (urf_client_get_device_by_index (client, get_index (device)) == NULL);
+	check_lookups (client);
+}
+
+static void
+test_lookup (Fixture *f, gconstpointer data)
+{
+	guint n_added = 0, n_removed = 0;
+	GList *item;
+	guint mask = 0;
+
+	check_lookups (f->client);
+	g_signal_connect (f->client, "device-added",
+			  G_CALLBACK (device_added_cb), &n_added);
+	g_signal_connect (f->client, "device-removed",
+			  G_CALLBACK (device_removed_cb), &n_removed);
+
+	/* the last change of the trace */
+	wait_for (&n_added, 2);
+	g_assert_cmpuint (n_removed, ==, 2);
+	check_lookups (f->client);
+
+	for (item = urf_client_get_devices (f->client); item; item = item->next)
+		mask |= 1 << get_index (item->data);
+	g_assert_cmpuint (mask, ==, (1 << 2) | (1 << 3) | (1 << 4));
+	g_assert (urf_client_get_device_by_index (f->client, 0) == NULL);
+	g_assert (urf_client_get_device_by_index (f->client, 1) == NULL);
+	g_assert (urf_client_get_device_by_path (f->client, "/org/freedesktop/URfkill/devices/0") == NULL);
+	g_assert (urf_client_get_device_by_path (f->client, "/org/freedesktop/URfkill/devices/1") == NULL);
+}
+
+static GVariant *
+fake_get_property_cb (GDBusConnection  *connection,
+		      const gchar      *sender,
+		      const gchar      *object_path,
+		      const gchar      *interface_name,
+		      const gchar      *property_name,
+		      GError          **error,
+		      gpointer          user_data)
+{
+	FakeDevice *fake = user_data;
+
+	if (g_strcmp0 (property_name, "soft") == 0)
+		return g_variant_new_boolean (fake->soft);
+	if (g_strcmp0 (property_name, "hard") == 0)
+		return g_variant_new_boolean (fake->hard);
+	if (g_strcmp0 (property_name, "platform") == 0)
+		return g_variant_new_boolean (FALSE);
+	if (g_strcmp0 (property_name, "generation") == 0)
+		return g_variant_new_uint32 (fake->generation);
+	if (g_strcmp0 (property_name, "type") == 0)
+		return g_variant_new_uint32 (URFDEVICE_TYPE_WLAN);
+	if (g_strcmp0 (property_name, "name") == 0)
+		return g_variant_new_string ("fake");
+	return g_variant_new_uint32 (0);
+}
+
+static const GDBusInterfaceVTable fake_vtable = {
+	NULL,
+	fake_get_property_cb,
+	NULL
+};
+
+/**
+ * fake_emit:
+ *
+ * Send a PropertiesChanged with @soft or @hard, -1 leaves one out
+ **/
+static void
+fake_emit (GDBusConnection *fake_connection,
+	   int              soft,
+	   int              hard,
+	   guint            generation)
+{
+	GVariantBuilder changed;
+	GError *error = NULL;
+
+	g_variant_builder_init (&changed, G_VARIANT_TYPE ("a{sv}"));
+	if (soft >= 0)
+		g_variant_builder_add (&changed, "{sv}", "soft",
+				       g_variant_new_boolean (soft));
+	if (hard >= 0)
+		g_variant_builder_add (&changed, "{sv}", "hard",
+				       g_variant_new_boolean (hard));
+	g_variant_builder_add (&changed, "{sv}", "generation",
+			       g_variant_new_uint32 (generation));
+
+	g_dbus_connection_emit_signal (fake_connection, NULL, FAKE_DEVICE_PATH,
+				       "org.freedesktop.DBus.Properties",
+				       "PropertiesChanged",
+				       g_variant_new ("(sa{sv}as)",
+						      "org.freedesktop.URfkill.Device",
+						      &changed, NULL),
+				       &error);
+	g_assert_no_error (error);
+}
+
+static void
+set_object_path_cb (UrfDevice    *device,
+		    GAsyncResult *res,
+		    guint        *n_done)
+{
+	GError *error = NULL;
+
+	g_assert (urf_device_set_object_path_finish (device, res, &error));
+	g_assert_no_error (error);
+	(*n_done)++;
+}
+
+/* a device object that loses signals on purpose, in place of urfkilld */
+static void
+test_resync (void)
+{
+	GDBusConnection *fake_connection;
+	GDBusNodeInfo *info;
+	FakeDevice fake;
+	UrfDevice *device;
+	GVariant *reply;
+	GError *error = NULL;
+	guint n_done = 0;
+	guint id;
+
+	fake.soft = FALSE;
+	fake.hard = FALSE;
+	fake.generation = 1;
+
+	fake_connection = g_dbus_connection_new_for_address_sync (address,
+								  G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+								  G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+								  NULL, NULL, &error);
+	g_assert_no_error (error);
+	info = g_dbus_node_info_new_for_xml (fake_device_xml, &error);
+	g_assert_no_error (error);
+	id = g_dbus_connection_register_object (fake_connection, FAKE_DEVICE_PATH,
+						info->interfaces[0], &fake_vtable,
+						&fake, NULL, &error);
+	g_assert_no_error (error);
+	reply = g_dbus_connection_call_sync (fake_connection,
+					     "org.freedesktop.DBus",
+					     "/org/freedesktop/DBus",
+					     "org.freedesktop.DBus",
+					     "RequestName",
+					     g_variant_new ("(su)", URFKILL_DBUS_NAME, 0),
+					     G_VARIANT_TYPE ("(u)"),
+					     G_DBUS_CALL_FLAGS_NONE,
+					     -1, NULL, &error);
+	g_assert_no_error (error);
+	g_variant_unref (reply);
+
+	/* async, the fake object answers GetAll from this thread */
+	device = urf_device_new ();
+	urf_device_set_object_path (device, FAKE_DEVICE_PATH, NULL,
+				    (GAsyncReadyCallback) set_object_path_cb, &n_done);
+	wait_for (&n_done, 1);
+	g_assert_cmpuint (get_generation (device), ==, 1);
+
+	/* the next generation is applied as it is */
+	fake.soft = TRUE;
+	fake.generation = 2;
+	fake_emit (fake_connection, TRUE, -1, 2);
+	wait_for_generation (device, 2);
+	g_assert (get_soft (device));
+
+	/* 3 and 4 are lost, hard only comes with GetAll */
+	fake.soft = FALSE;
+	fake.hard = TRUE;
+	fake.generation = 5;
+	fake_emit (fake_connection, FALSE, -1, 5);
+	wait_for_generation (device, 5);
+	g_assert (!get_soft (device));
+	g_assert (get_hard (device));
+
+	/* a late one is dropped */
+	fake_emit (fake_connection, -1, FALSE, 4);
+	fake.soft = TRUE;
+	fake.generation = 6;
+	fake_emit (fake_connection, TRUE, -1, 6);
+	wait_for_generation (device, 6);
+	g_assert (get_soft (device));
+	g_assert (get_hard (device));
+
+	g_object_unref (device);
+	g_dbus_connection_unregister_object (fake_connection, id);
+	g_dbus_node_info_unref (info);
+
+	/* free the name for the daemon of the next test */
+	g_dbus_connection_close_sync (fake_connection, NULL, &error);
+	g_assert_no_error (error);
+	g_object_unref (fake_connection);
+}
+
+int
+main (int argc, char **argv)
+{
+	GMainLoop *polkit_loop = NULL;
+	GError *error = NULL;
+	GPid bus_pid = 0;
+	char *dbus_daemon;
+	int retval;
+
+	g_type_init ();
+	g_test_init (&argc, &argv, NULL);
+
+	/* a skip for automake, not a failure */
+	dbus_daemon = g_find_program_in_path ("dbus-daemon");
+	if (dbus_daemon == NULL) {
+		g_printerr ("dbus-daemon not found, skipping\n");
+		return 77;
+	}
+	g_free (dbus_daemon);
+
+	address = harness_bus_start (TEST_DBUS_CONF, &bus_pid, &error);
+	g_assert_no_error (error);
+	g_assert (address != NULL);
+
+	/* UrfDevice looks devices up on the system bus */
+	g_setenv ("DBUS_SYSTEM_BUS_ADDRESS", address, TRUE);
+
+	connection = harness_polkit_start (address, &polkit_loop, &error);
+	g_assert_no_error (error);
+	config_file = harness_write_config (&error);
+	g_assert_no_error (error);
+
+	g_test_add ("/client/watch-type", Fixture, NULL,
+		    fixture_setup_sim, test_watch_type, fixture_teardown);
+	g_test_add ("/client/generation", Fixture, NULL,
+		    fixture_setup_sim, test_generation, fixture_teardown);
+	g_test_add ("/client/async/block", Fixture, NULL,
+		    fixture_setup_sim, test_async_block, fixture_teardown);
+	g_test_add ("/client/async/cancel", Fixture, NULL,
+		    fixture_setup_sim, test_async_cancel, fixture_teardown);
+	g_test_add ("/client/async/multiple", Fixture, NULL,
+		    fixture_setup_sim, test_async_multiple, fixture_teardown);
+	g_test_add ("/client/lookup", Fixture, NULL,
+		    fixture_setup_replay, test_lookup, fixture_teardown);
+	g_test_add_func ("/client/resync", test_resync);
+
+	retval = g_test_run ();
+
+	g_object_unref (connection);
+	kill (bus_pid, SIGTERM);
+	g_unlink (config_file);
+	g_free (config_file);
+	g_free (address);
+	return retval;
+}
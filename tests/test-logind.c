@@ -0,0 +1,231 @@
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib-object.h>
+#include <systemd/sd-login.h>
+
+#include "urf-logind.h"
+
+/*
+ * Runs UrfLogind against a stand-in for sd-login. The functions below
+ * replace the ones from libsystemd at link time and answer from the
+ * fixture tables, the monitor is a pipe the tests write to.
+ */
+
+struct sd_login_monitor {
+	int	 fds[2];
+	int	 n_flushes;
+};
+
+typedef struct {
+	GHashTable		*pids;		/* pid -> session id */
+	GHashTable		*active;	/* session id -> "1" or "0" */
+	int			 monitor_error;
+	sd_login_monitor	*monitor;
+} Fixture;
+
+static Fixture *fixture = NULL;
+
+int
+sd_pid_get_session (pid_t pid, char **session)
+{
+	const char *id;
+
+	id = g_hash_table_lookup (fixture->pids, GINT_TO_POINTER (pid));
+	if (id == NULL)
+		return -ENODATA;
+
+	/* the callers free() it */
+	*session = strdup (id);
+	return 0;
+}
+
+int
+sd_session_is_active (const char *session)
+{
+	const char *active;
+
+	active = g_hash_table_lookup (fixture->active, session);
+	if (active == NULL)
+		return -ENXIO;
+	return g_strcmp0 (active, "1") == 0;
+}
+
+int
+sd_login_monitor_new (const char *category, sd_login_monitor **ret)
+{
+	sd_login_monitor *monitor;
+
+	g_assert_cmpstr (category, ==, "seat");
+	if (fixture->monitor_error != 0)
+		return -fixture->monitor_error;
+
+	monitor = g_new0 (sd_login_monitor, 1);
+	g_assert (pipe (monitor->fds) == 0);
+	fixture->monitor = monitor;
+	*ret = monitor;
+	return 0;
+}
+
+sd_login_monitor *
+sd_login_monitor_unref (sd_login_monitor *monitor)
+{
+	if (monitor == NULL)
+		return NULL;
+	close (monitor->fds[0]);
+	close (monitor->fds[1]);
+	if (fixture->monitor == monitor)
+		fixture->monitor = NULL;
+	g_free (monitor);
+	return NULL;
+}
+
+int
+sd_login_monitor_flush (sd_login_monitor *monitor)
+{
+	char buf[64];
+
+	monitor->n_flushes++;
+	if (read (monitor->fds[0], buf, sizeof (buf)) < 0)
+		return -errno;
+	return 0;
+}
+
+int
+sd_login_monitor_get_fd (sd_login_monitor *monitor)
+{
+	return monitor->fds[0];
+}
+
+static void
+fixture_setup (Fixture *f, gconstpointer data)
+{
+	f->pids = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+	f->active = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	f->monitor_error = 0;
+	f->monitor = NULL;
+
+	/* the same layout as /run/systemd/sessions, two sessions on seat0 */
+	g_hash_table_insert (f->pids, GINT_TO_POINTER (1000), g_strdup ("c1"));
+	g_hash_table_insert (f->pids, GINT_TO_POINTER (2000), g_strdup ("c2"));
+	g_hash_table_insert (f->active, g_strdup ("c1"), g_strdup ("1"));
+	g_hash_table_insert (f->active, g_strdup ("c2"), g_strdup ("0"));
+
+	fixture = f;
+}
+
+static void
+fixture_teardown (Fixture *f, gconstpointer data)
+{
+	g_hash_table_destroy (f->pids);
+	g_hash_table_destroy (f->active);
+	fixture = NULL;
+}
+
+static void
+count_cb (UrfSessionBackend *backend, guint *count)
+{
+	(*count)++;
+}
+
+static void
+test_session_for_pid (Fixture *f, gconstpointer data)
+{
+	UrfSessionBackend *backend = URF_SESSION_BACKEND (urf_logind_new ());
+	char *session;
+
+	session = urf_session_backend_get_session_for_pid (backend, 1000);
+	g_assert_cmpstr (session, ==, "c1");
+	g_free (session);
+
+	session = urf_session_backend_get_session_for_pid (backend, 2000);
+	g_assert_cmpstr (session, ==, "c2");
+	g_free (session);
+
+	/* not in any session */
+	session = urf_session_backend_get_session_for_pid (backend, 3000);
+	g_assert (session == NULL);
+
+	g_object_unref (backend);
+}
+
+static void
+test_session_active (Fixture *f, gconstpointer data)
+{
+	UrfSessionBackend *backend = URF_SESSION_BACKEND (urf_logind_new ());
+
+	g_assert (urf_session_backend_is_session_active (backend, "c1"));
+	g_assert (!urf_session_backend_is_session_active (backend, "c2"));
+	g_assert (!urf_session_backend_is_session_active (backend, "c3"));
+	g_assert (!urf_session_backend_is_session_active (backend, NULL));
+
+	/* a session switch on the seat */
+	g_hash_table_replace (f->active, g_strdup ("c1"), g_strdup ("0"));
+	g_hash_table_replace (f->active, g_strdup ("c2"), g_strdup ("1"));
+	g_assert (!urf_session_backend_is_session_active (backend, "c1"));
+	g_assert (urf_session_backend_is_session_active (backend, "c2"));
+
+	g_object_unref (backend);
+}
+
+static void
+test_monitor (Fixture *f, gconstpointer data)
+{
+	UrfSessionBackend *backend = URF_SESSION_BACKEND (urf_logind_new ());
+	guint count = 0;
+
+	g_signal_connect (backend, "active-changed", G_CALLBACK (count_cb), &count);
+	g_assert (urf_session_backend_startup (backend));
+	g_assert (f->monitor != NULL);
+
+	/* nothing changed yet */
+	while (g_main_context_iteration (NULL, FALSE));
+	g_assert_cmpuint (count, ==, 0);
+
+	g_assert (write (f->monitor->fds[1], "x", 1) == 1);
+	while (g_main_context_iteration (NULL, FALSE));
+	g_assert_cmpuint (count, ==, 1);
+	g_assert_cmpint (f->monitor->n_flushes, ==, 1);
+
+	g_assert (write (f->monitor->fds[1], "x", 1) == 1);
+	while (g_main_context_iteration (NULL, FALSE));
+	g_assert_cmpuint (count, ==, 2);
+
+	/* the monitor goes away with the backend */
+	g_object_unref (backend);
+	g_assert (f->monitor == NULL);
+}
+
+static void
+test_monitor_failure (Fixture *f, gconstpointer data)
+{
+	UrfSessionBackend *backend = URF_SESSION_BACKEND (urf_logind_new ());
+
+	f->monitor_error = ENOMEM;
+	g_assert (!urf_session_backend_startup (backend));
+	g_assert (f->monitor == NULL);
+
+	g_object_unref (backend);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_type_init ();
+	g_test_init (&argc, &argv, NULL);
+
+	/* the failure paths log warnings on purpose */
+	g_log_set_always_fatal (G_LOG_FATAL_MASK | G_LOG_LEVEL_CRITICAL);
+
+	g_test_add ("/logind/session-for-pid", Fixture, NULL,
+		    fixture_setup, test_session_for_pid, fixture_teardown);
+	g_test_add ("/logind/session-active", Fixture, NULL,
+		    fixture_setup, test_session_active, fixture_teardown);
+	g_test_add ("/logind/monitor", Fixture, NULL,
+		    fixture_setup, test_monitor, fixture_teardown);
+	g_test_add ("/logind/monitor-failure", Fixture, NULL,
+		    fixture_setup, test_monitor_failure, fixture_teardown);
+
+	return g_test_run ();
+}
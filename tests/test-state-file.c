@@ -0,0 +1,267 @@
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <glib-object.h>
+
+#include "liburfkill-glib/urf-state-format.h"
+
+#include "urf-device.h"
+#include "urf-state-file.h"
+
+/*
+ * Checks the writer side of the state file against the protocol in
+ * urf-state-format.h, with a reader that copies the data the same way
+ * liburfkill-glib does.
+ */
+
+#define TEST_N_DEVICES	8
+#define TEST_N_UPDATES	20000
+
+typedef struct {
+	char		*dir;
+	char		*path;
+	UrfStateFile	*state_file;
+	GList		*devices;
+} Fixture;
+
+typedef struct {
+	const UrfStateFileData	*data;
+	volatile gint		 stop;
+	guint			 n_snapshots;
+	guint			 n_torn;
+} Reader;
+
+/**
+ * read_snapshot:
+ *
+ * Return value: %TRUE if @snapshot is consistent
+ **/
+static gboolean
+read_snapshot (const UrfStateFileData *data,
+	       UrfStateFileData       *snapshot)
+{
+	gint *sequence = (gint *) &data->sequence;
+	gint begin, end;
+
+	begin = g_atomic_int_get (sequence);
+	if (begin & 1)
+		return FALSE;
+
+	__sync_synchronize ();
+	memcpy (snapshot, data, sizeof (UrfStateFileData));
+	__sync_synchronize ();
+
+	end = g_atomic_int_get (sequence);
+	snapshot->sequence = begin;
+	return begin == end;
+}
+
+static const UrfStateFileData *
+map_file (const char *path)
+{
+	void *map;
+	int fd;
+
+	fd = open (path, O_RDONLY);
+	g_assert (fd >= 0);
+	map = mmap (NULL, sizeof (UrfStateFileData), PROT_READ, MAP_SHARED, fd, 0);
+	g_assert (map != MAP_FAILED);
+	close (fd);
+
+	return map;
+}
+
+static void
+update (Fixture *f, int type_state)
+{
+	int type_states[2] = { type_state, type_state };
+
+	urf_state_file_update (f->state_file, f->devices, type_states, 2);
+}
+
+static void
+fixture_setup (Fixture *f, gconstpointer data)
+{
+	RfkillUdevAttrs attrs = { (char *) "test", FALSE };
+	guint i;
+
+	f->dir = g_dir_make_tmp ("test-state-file-XXXXXX", NULL);
+	g_assert (f->dir != NULL);
+	f->path = g_build_filename (f->dir, "state", NULL);
+	f->state_file = urf_state_file_new ();
+
+	f->devices = NULL;
+	for (i = 0; i < TEST_N_DEVICES; i++)
+		f->devices = g_list_append (f->devices,
+					    urf_device_new (i, 1, FALSE, FALSE, &attrs));
+}
+
+static void
+fixture_teardown (Fixture *f, gconstpointer data)
+{
+	if (f->state_file != NULL)
+		g_object_unref (f->state_file);
+	g_list_foreach (f->devices, (GFunc) g_object_unref, NULL);
+	g_list_free (f->devices);
+	g_unlink (f->path);
+	g_rmdir (f->dir);
+	g_free (f->path);
+	g_free (f->dir);
+}
+
+static void
+test_open (Fixture *f, gconstpointer data)
+{
+	const UrfStateFileData *map;
+	UrfStateFileData snapshot;
+
+	g_assert (urf_state_file_open (f->state_file, f->path));
+	map = map_file (f->path);
+
+	g_assert (read_snapshot (map, &snapshot));
+	g_assert_cmpuint (snapshot.magic, ==, URF_STATE_FILE_MAGIC);
+	g_assert_cmpuint (snapshot.version, ==, URF_STATE_FILE_VERSION);
+	g_assert_cmpint (snapshot.sequence, ==, 2);
+	g_assert_cmpuint (snapshot.n_devices, ==, 0);
+
+	munmap ((void *) map, sizeof (UrfStateFileData));
+}
+
+static void
+test_update (Fixture *f, gconstpointer data)
+{
+	const UrfStateFileData *map;
+	UrfStateFileData snapshot;
+	guint i;
+
+	g_assert (urf_state_file_open (f->state_file, f->path));
+	map = map_file (f->path);
+
+	urf_device_update_states (f->devices->data, TRUE, FALSE);
+	update (f, 0);
+
+	g_assert (read_snapshot (map, &snapshot));
+	g_assert_cmpint (snapshot.sequence, ==, 4);
+	g_assert_cmpuint (snapshot.n_devices, ==, TEST_N_DEVICES);
+	g_assert_cmpint (snapshot.type_state[1], ==, 0);
+	for (i = 0; i < TEST_N_DEVICES; i++) {
+		g_assert_cmpuint (snapshot.devices[i].index, ==, i);
+		g_assert_cmpuint (snapshot.devices[i].soft, ==, i == 0);
+	}
+	/* the types past the given ones have no adapter */
+	g_assert_cmpint (snapshot.type_state[2], ==, -1);
+
+	/* the devices are dropped when the daemon goes away */
+	g_object_unref (f->state_file);
+	f->state_file = NULL;
+	g_assert (read_snapshot (map, &snapshot));
+	g_assert_cmpint (snapshot.sequence, ==, 6);
+	g_assert_cmpuint (snapshot.n_devices, ==, 0);
+
+	munmap ((void *) map, sizeof (UrfStateFileData));
+}
+
+static void
+test_stale_sequence (Fixture *f, gconstpointer data)
+{
+	const UrfStateFileData *map;
+	UrfStateFileData stale, snapshot;
+
+	/* a daemon killed in the middle of an update */
+	memset (&stale, 0, sizeof (stale));
+	stale.magic = URF_STATE_FILE_MAGIC;
+	stale.version = URF_STATE_FILE_VERSION;
+	stale.sequence = 7;
+	g_assert (g_file_set_contents (f->path, (const char *) &stale, sizeof (stale), NULL));
+
+	g_assert (urf_state_file_open (f->state_file, f->path));
+	map = map_file (f->path);
+
+	/* readers see a new, even sequence */
+	g_assert (read_snapshot (map, &snapshot));
+	g_assert_cmpint (snapshot.sequence, >, 7);
+	g_assert_cmpint (snapshot.sequence % 2, ==, 0);
+
+	/* and it stays even after every update */
+	update (f, 1);
+	g_assert (read_snapshot (map, &snapshot));
+	g_assert_cmpint (snapshot.sequence % 2, ==, 0);
+	g_assert_cmpuint (snapshot.n_devices, ==, TEST_N_DEVICES);
+
+	munmap ((void *) map, sizeof (UrfStateFileData));
+}
+
+static gpointer
+reader_thread (Reader *reader)
+{
+	UrfStateFileData snapshot;
+	guint i;
+
+	while (!g_atomic_int_get (&reader->stop)) {
+		if (!read_snapshot (reader->data, &snapshot))
+			continue;
+		reader->n_snapshots++;
+
+		/* every update sets all devices and the type to one value */
+		for (i = 0; i < snapshot.n_devices; i++) {
+			if (snapshot.devices[i].soft != snapshot.type_state[0]) {
+				reader->n_torn++;
+				break;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static void
+test_concurrent (Fixture *f, gconstpointer data)
+{
+	Reader reader;
+	GThread *thread;
+	GList *item;
+	guint i;
+
+	g_assert (urf_state_file_open (f->state_file, f->path));
+	update (f, 0);
+
+	memset (&reader, 0, sizeof (reader));
+	reader.data = map_file (f->path);
+	thread = g_thread_new ("reader", (GThreadFunc) reader_thread, &reader);
+
+	for (i = 0; i < TEST_N_UPDATES; i++) {
+		for (item = f->devices; item; item = item->next)
+			urf_device_update_states (item->data, i % 2, FALSE);
+		update (f, i % 2);
+	}
+
+	g_atomic_int_set (&reader.stop, 1);
+	g_thread_join (thread);
+
+	g_assert_cmpuint (reader.n_torn, ==, 0);
+	g_assert_cmpuint (reader.n_snapshots, >, 0);
+	g_assert_cmpint (reader.data->sequence % 2, ==, 0);
+
+	munmap ((void *) reader.data, sizeof (UrfStateFileData));
+}
+
+int
+main (int argc, char **argv)
+{
+	g_type_init ();
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add ("/state-file/open", Fixture, NULL,
+		    fixture_setup, test_open, fixture_teardown);
+	g_test_add ("/state-file/update", Fixture, NULL,
+		    fixture_setup, test_update, fixture_teardown);
+	g_test_add ("/state-file/stale-sequence", Fixture, NULL,
+		    fixture_setup, test_stale_sequence, fixture_teardown);
+	g_test_add ("/state-file/concurrent", Fixture, NULL,
+		    fixture_setup, test_concurrent, fixture_teardown);
+
+	return g_test_run ();
+}